@@ -50,6 +50,11 @@ static uint32_t total_instance_id;
 
 static int vblk_major;
 
+/* Number of blk-mq hardware queues, 0 selects one per online CPU */
+static unsigned int nr_hw_queues;
+module_param(nr_hw_queues, uint, 0444);
+MODULE_PARM_DESC(nr_hw_queues, "Number of hardware queues (0 = one per CPU)");
+
 static inline uint64_t _arch_counter_get_cntvct(void)
 {
 	uint64_t cval;
@@ -225,6 +230,27 @@ static int vblk_get_configinfo(struct vblk_dev *vblkdev)
 	return 0;
 }
 
+/**
+ * vblk_dma_dir: DMA direction of the data moved for a read/write request,
+ *		so that only the cache maintenance actually needed is done.
+ */
+static inline enum dma_data_direction vblk_dma_dir(struct request *bio_req)
+{
+	return (req_op(bio_req) == REQ_OP_READ) ? DMA_FROM_DEVICE :
+						DMA_TO_DEVICE;
+}
+
+static void vblk_unmap_sg(struct vblk_dev *vblkdev,
+		struct vsc_request *vsc_req)
+{
+	if (vsc_req->sg_num_ents == 0)
+		return;
+
+	dma_unmap_sg(vblkdev->device, vsc_req->sg_lst,
+		vsc_req->sg_num_ents, vblk_dma_dir(vsc_req->req));
+	vsc_req->sg_num_ents = 0;
+}
+
 static void req_error_handler(struct vblk_dev *vblkdev, struct request *breq)
 {
 	dev_err(vblkdev->device,
@@ -296,11 +322,7 @@ end:
 	if (vblkdev->config.blk_config.use_vm_address) {
 		if ((req_op(bio_req) == REQ_OP_READ) ||
 			(req_op(bio_req) == REQ_OP_WRITE)) {
-			dma_unmap_sg(vblkdev->device,
-				vsc_req->sg_lst,
-				vsc_req->sg_num_ents,
-				DMA_BIDIRECTIONAL);
-			devm_kfree(vblkdev->device, vsc_req->sg_lst);
+			vblk_unmap_sg(vblkdev, vsc_req);
 		}
 	}
 
@@ -316,44 +338,32 @@ end:
  * complete_bio_req: Complete a bio request after server is
  *		done processing the request.
  */
-static bool complete_bio_req(struct vblk_dev *vblkdev)
+static void complete_bio_req(struct vblk_dev *vblkdev,
+		struct vs_request *req_resp)
 {
 	int status = 0;
 	struct vsc_request *vsc_req = NULL;
 	struct vs_request *vs_req;
-	struct vs_request req_resp;
 	struct request *bio_req;
 
-	/* First check if ivc read queue is empty */
-	if (!tegra_hv_ivc_can_read(vblkdev->ivck))
-		goto no_valid_io;
-
-	/* Copy the data and advance to next frame */
-	if ((tegra_hv_ivc_read(vblkdev->ivck, &req_resp,
-				sizeof(struct vs_request)) <= 0)) {
-		dev_err(vblkdev->device,
-				"Couldn't increment read frame pointer!\n");
-		goto no_valid_io;
-	}
-
-	status = req_resp.status;
+	status = req_resp->status;
 	if (status != 0) {
 		dev_err(vblkdev->device, "IO request error = %d\n",
 				status);
 	}
 
 #if (IS_ENABLED(CONFIG_TEGRA_HSIERRRPTINJ))
-	if (req_resp.req_id != HSI_ERROR_MAGIC) {
+	if (req_resp->req_id != HSI_ERROR_MAGIC) {
 #endif
-		vsc_req = vblk_get_req_by_sr_num(vblkdev, req_resp.req_id);
+		vsc_req = vblk_get_req_by_sr_num(vblkdev, req_resp->req_id);
 		if (vsc_req == NULL) {
 			dev_err(vblkdev->device, "serial_number mismatch num %d!\n",
-					req_resp.req_id);
+					req_resp->req_id);
 			goto complete_bio_exit;
 		}
 #if (IS_ENABLED(CONFIG_TEGRA_HSIERRRPTINJ))
 	} else {
-		vblkdev->hsierror_status = req_resp.error_inject_resp.status;
+		vblkdev->hsierror_status = req_resp->error_inject_resp.status;
 		complete(&vblkdev->hsierror_handle);
 		goto complete_bio_exit;
 	}
@@ -366,13 +376,13 @@ static bool complete_bio_req(struct vblk_dev *vblkdev)
 		if ((vblkdev->config.blk_config.req_ops_supported & VS_BLK_IOCTL_OP_F)
 			&& (req_op(bio_req) == REQ_OP_DRV_IN)) {
 			vblk_complete_ioctl_req(vblkdev, vsc_req,
-					req_resp.blkdev_resp.
+					req_resp->blkdev_resp.
 					ioctl_resp.status);
 			vblkdev->inflight_ioctl_reqs--;
 			blk_mq_end_request(bio_req, BLK_STS_OK);
 		}  else if (req_op(bio_req) != REQ_OP_DRV_IN) {
 			handle_non_ioctl_resp(vblkdev, vsc_req,
-				&(req_resp.blkdev_resp.blk_resp));
+				&(req_resp->blkdev_resp.blk_resp));
 		} else {
 			dev_info(vblkdev->device, "ioctl(pass through) command not supported\n");
 		}
@@ -402,10 +412,7 @@ bio_null:
 	vblk_put_req(vsc_req);
 
 complete_bio_exit:
-	return true;
-
-no_valid_io:
-	return false;
+	return;
 }
 
 static bool bio_req_sanity_check(struct vblk_dev *vblkdev,
@@ -484,7 +491,6 @@ static bool submit_bio_req(struct vblk_dev *vblkdev)
 	size_t total_size = 0;
 	void *buffer;
 	struct req_entry *entry = NULL;
-	size_t sz;
 	uint32_t sg_cnt;
 	uint32_t ops_supported = vblkdev->config.blk_config.req_ops_supported;
 	dma_addr_t  sg_dma_addr = 0;
@@ -500,7 +506,6 @@ static bool submit_bio_req(struct vblk_dev *vblkdev)
 	if (vsc_req == NULL)
 		goto bio_exit;
 
-	spin_lock(&vblkdev->queue_lock);
 	if(!list_empty(&vblkdev->req_list)) {
 		entry = list_first_entry(&vblkdev->req_list, struct req_entry,
 						list_entry);
@@ -508,44 +513,35 @@ static bool submit_bio_req(struct vblk_dev *vblkdev)
 				(req_op(entry->req) == REQ_OP_DRV_IN) &&
 				(vblkdev->config.blk_config.use_vm_address) &&
 				(vblkdev->inflight_ioctl_reqs >= vblkdev->max_ioctl_requests)) {
-			spin_unlock(&vblkdev->queue_lock);
 			goto bio_exit;
 		}
 		list_del(&entry->list_entry);
 		bio_req = entry->req;
-		kfree(entry);
 	}
-	spin_unlock(&vblkdev->queue_lock);
 
 	if (bio_req == NULL)
 		goto bio_exit;
 
+	vsc_req->req = bio_req;
+
+	/* Guest pages are handed to the server by IOVA, so the scatterlist
+	 * preallocated for this slot is mapped in place of any data copy.
+	 */
 	if ((vblkdev->config.blk_config.use_vm_address) &&
 		((req_op(bio_req) == REQ_OP_READ) ||
 		(req_op(bio_req) == REQ_OP_WRITE))) {
-		sz = (sizeof(struct scatterlist)
-			* bio_req->nr_phys_segments);
-		vsc_req->sg_lst =  devm_kzalloc(vblkdev->device, sz,
-					GFP_KERNEL);
-		if (vsc_req->sg_lst == NULL) {
-			dev_err(vblkdev->device,
-				"SG mem allocation failed\n");
-			goto bio_exit;
-		}
 		sg_init_table(vsc_req->sg_lst,
 			bio_req->nr_phys_segments);
 		sg_cnt = blk_rq_map_sg(vblkdev->queue, bio_req,
 				vsc_req->sg_lst);
-		vsc_req->sg_num_ents = sg_nents(vsc_req->sg_lst);
 		if (dma_map_sg(vblkdev->device, vsc_req->sg_lst,
-			vsc_req->sg_num_ents, DMA_BIDIRECTIONAL) == 0) {
+			sg_cnt, vblk_dma_dir(bio_req)) == 0) {
 			dev_err(vblkdev->device, "dma_map_sg failed\n");
 			goto bio_exit;
 		}
+		vsc_req->sg_num_ents = sg_cnt;
 		sg_dma_addr = sg_dma_address(vsc_req->sg_lst);
 	}
-
-	vsc_req->req = bio_req;
 	vs_req = &vsc_req->vs_req;
 
 	vs_req->type = VS_DATA_REQ;
@@ -672,6 +668,8 @@ static bool submit_bio_req(struct vblk_dev *vblkdev)
 
 bio_exit:
 	if (vsc_req != NULL) {
+		if (bio_req != NULL)
+			vblk_unmap_sg(vblkdev, vsc_req);
 		vblk_put_req(vsc_req);
 	}
 
@@ -683,11 +681,31 @@ bio_exit:
 	return false;
 }
 
+/**
+ * vblk_fetch_pending_reqs: Move requests queued by the hardware contexts
+ *		onto the submission list, preserving their arrival order.
+ *		Must be called with ivc_lock held.
+ */
+static void vblk_fetch_pending_reqs(struct vblk_dev *vblkdev)
+{
+	struct llist_node *nodes;
+	struct req_entry *entry, *tmp;
+
+	nodes = llist_del_all(&vblkdev->req_llist);
+	if (nodes == NULL)
+		return;
+
+	nodes = llist_reverse_order(nodes);
+	llist_for_each_entry_safe(entry, tmp, nodes, llnode)
+		list_add_tail(&entry->list_entry, &vblkdev->req_list);
+}
+
 static void vblk_request_work(struct work_struct *ws)
 {
 	struct vblk_dev *vblkdev =
 		container_of(ws, struct vblk_dev, work);
-	bool req_submitted, req_completed;
+	uint32_t nr_submitted, nr_completed, i;
+	int ret;
 
 	/* Taking ivc lock before performing IVC read/write */
 	mutex_lock(&vblkdev->ivc_lock);
@@ -696,13 +714,28 @@ static void vblk_request_work(struct work_struct *ws)
 		return;
 	}
 
-	req_submitted = true;
-	req_completed = true;
-	while (req_submitted || req_completed) {
-		req_completed = complete_bio_req(vblkdev);
-
-		req_submitted = submit_bio_req(vblkdev);
-	}
+	do {
+		/*
+		 * Harvest a batch of responses to free up request slots. The
+		 * frames are released with one counter update and at most one
+		 * notification of the server.
+		 */
+		ret = tegra_hv_ivc_read_batch(vblkdev->ivck,
+				vblkdev->resp_batch, sizeof(struct vs_request),
+				VBLK_COMPLETION_BATCH);
+		if ((ret < 0) && (ret != -ENOSPC) && (ret != -ECONNRESET))
+			dev_err(vblkdev->device,
+				"Couldn't read responses (%d)!\n", ret);
+		nr_completed = (ret > 0) ? ret : 0;
+		for (i = 0; i < nr_completed; i++)
+			complete_bio_req(vblkdev, &vblkdev->resp_batch[i]);
+
+		/* Then refill the IVC queue with as many requests as fit */
+		vblk_fetch_pending_reqs(vblkdev);
+		nr_submitted = 0;
+		while (submit_bio_req(vblkdev))
+			nr_submitted++;
+	} while ((nr_submitted != 0) || (nr_completed != 0));
 	mutex_unlock(&vblkdev->ivc_lock);
 }
 
@@ -710,34 +743,30 @@ static void vblk_request_work(struct work_struct *ws)
 static blk_status_t vblk_request(struct blk_mq_hw_ctx *hctx,
 			const struct blk_mq_queue_data *bd)
 {
-	struct req_entry *entry;
 	struct request *req = bd->rq;
+	struct req_entry *entry = blk_mq_rq_to_pdu(req);
 	struct vblk_dev *vblkdev = hctx->queue->queuedata;
 
 	blk_mq_start_request(req);
 
-	/* malloc for req list entry */
-	entry = kmalloc(sizeof(struct req_entry), GFP_ATOMIC);
-	if (entry == NULL) {
-		dev_err(vblkdev->device, "Failed to allocate memory\n");
-		return BLK_STS_IOERR;
-	}
-
-	/* Initialise the entry */
+	/* Hand the request over to the IVC worker without taking any lock */
 	entry->req = req;
-	INIT_LIST_HEAD(&entry->list_entry);
+	llist_add(&entry->llnode, &vblkdev->req_llist);
 
-	/* Insert the req to list */
-	spin_lock(&vblkdev->queue_lock);
-	list_add_tail(&entry->list_entry, &vblkdev->req_list);
-	spin_unlock(&vblkdev->queue_lock);
-
-	/* Now invoke the queue to handle data inserted in queue */
-	queue_work_on(WORK_CPU_UNBOUND, vblkdev->wq, &vblkdev->work);
+	/* Kick the worker once for the whole batch from this hctx */
+	if (bd->last)
+		queue_work_on(WORK_CPU_UNBOUND, vblkdev->wq, &vblkdev->work);
 
 	return BLK_STS_OK;
 }
 
+static void vblk_commit_rqs(struct blk_mq_hw_ctx *hctx)
+{
+	struct vblk_dev *vblkdev = hctx->queue->queuedata;
+
+	queue_work_on(WORK_CPU_UNBOUND, vblkdev->wq, &vblkdev->work);
+}
+
 /* Open and release */
 #if defined(NV_BLOCK_DEVICE_OPERATIONS_OPEN_HAS_GENDISK_ARG) /* Linux v6.5 */
 static int vblk_open(struct gendisk *disk, fmode_t mode)
@@ -892,6 +921,7 @@ static const struct device_attribute dev_attr_speed_mode_ro =
 
 static const struct blk_mq_ops vblk_mq_ops = {
 	.queue_rq	= vblk_request,
+	.commit_rqs	= vblk_commit_rqs,
 };
 
 #if (IS_ENABLED(CONFIG_TEGRA_HSIERRRPTINJ))
@@ -965,6 +995,15 @@ static int vblk_inject_err_fsi(unsigned int inst_id, struct epl_error_report_fra
 }
 #endif
 
+static void bio_request_timeout_callback(struct timer_list *timer)
+{
+	struct vsc_request *req = from_timer(req, timer, timer);
+
+	dev_err(req->vblkdev->device, "Request id %d timed out. curr ctr: %llu sched ctr: %llu\n",
+						req->id, _arch_counter_get_cntvct(), req->time);
+
+}
+
 /* Set up virtual device. */
 static void setup_device(struct vblk_dev *vblkdev)
 {
@@ -983,40 +1022,6 @@ static void setup_device(struct vblk_dev *vblkdev)
 		vblkdev->config.blk_config.num_blks *
 			vblkdev->config.blk_config.hardblk_size;
 
-	memset(&vblkdev->tag_set, 0, sizeof(vblkdev->tag_set));
-	vblkdev->tag_set.ops = &vblk_mq_ops;
-	vblkdev->tag_set.nr_hw_queues = 1;
-	vblkdev->tag_set.nr_maps = 1;
-	vblkdev->tag_set.queue_depth = 16;
-	vblkdev->tag_set.numa_node = NUMA_NO_NODE;
-	vblkdev->tag_set.flags = BLK_MQ_F_SHOULD_MERGE;
-
-	ret = blk_mq_alloc_tag_set(&vblkdev->tag_set);
-	if (ret)
-		return;
-
-#if defined(NV_BLK_MQ_ALLOC_QUEUE_PRESENT)
-	vblkdev->queue = blk_mq_alloc_queue(&vblkdev->tag_set, NULL, NULL);
-#else
-	vblkdev->queue = blk_mq_init_queue(&vblkdev->tag_set);
-#endif
-	if (IS_ERR(vblkdev->queue)) {
-		dev_err(vblkdev->device, "failed to init blk queue\n");
-		blk_mq_free_tag_set(&vblkdev->tag_set);
-		return;
-	}
-
-	vblkdev->queue->queuedata = vblkdev;
-
-	blk_queue_logical_block_size(vblkdev->queue,
-		vblkdev->config.blk_config.hardblk_size);
-	blk_queue_physical_block_size(vblkdev->queue,
-		vblkdev->config.blk_config.hardblk_size);
-
-	if (vblkdev->config.blk_config.req_ops_supported & VS_BLK_FLUSH_OP_F) {
-		blk_queue_write_cache(vblkdev->queue, true, false);
-	}
-
 	if (vblkdev->config.blk_config.max_read_blks_per_io !=
 		vblkdev->config.blk_config.max_write_blks_per_io) {
 		dev_err(vblkdev->device,
@@ -1138,6 +1143,16 @@ static void setup_device(struct vblk_dev *vblkdev)
 		}
 	}
 
+	vblkdev->reqs = devm_kcalloc(vblkdev->device, max_requests,
+			sizeof(struct vsc_request), GFP_KERNEL);
+	vblkdev->pending_reqs = devm_kcalloc(vblkdev->device,
+			BITS_TO_LONGS(max_requests), sizeof(unsigned long),
+			GFP_KERNEL);
+	if ((vblkdev->reqs == NULL) || (vblkdev->pending_reqs == NULL)) {
+		dev_err(vblkdev->device, "Failed to allocate request table\n");
+		return;
+	}
+
 	for (req_id = 0; req_id < max_requests; req_id++){
 		req = &vblkdev->reqs[req_id];
 		if (vblkdev->config.blk_config.use_vm_address == 0U) {
@@ -1154,6 +1169,8 @@ static void setup_device(struct vblk_dev *vblkdev)
 		req->mempool_len = max_io_bytes;
 		req->id = req_id;
 		req->vblkdev = vblkdev;
+		/* Create timer to track the request going to storage server */
+		timer_setup(&req->timer, bio_request_timeout_callback, 0);
 	}
 
 	if (max_requests == 0) {
@@ -1164,6 +1181,65 @@ static void setup_device(struct vblk_dev *vblkdev)
 
 	vblkdev->max_requests = max_requests;
 	vblkdev->max_ioctl_requests = max_ioctl_requests;
+
+	memset(&vblkdev->tag_set, 0, sizeof(vblkdev->tag_set));
+	vblkdev->tag_set.ops = &vblk_mq_ops;
+	vblkdev->tag_set.nr_hw_queues = nr_hw_queues ? nr_hw_queues :
+					num_online_cpus();
+	vblkdev->tag_set.nr_maps = 1;
+	/*
+	 * All hardware queues feed the one IVC channel, so they share a
+	 * single set of max_requests tags instead of max_requests each.
+	 * Once the channel is full blk-mq stops dispatching on every hctx.
+	 */
+	vblkdev->tag_set.queue_depth = max_requests;
+	vblkdev->tag_set.cmd_size = sizeof(struct req_entry);
+	vblkdev->tag_set.numa_node = NUMA_NO_NODE;
+	vblkdev->tag_set.flags = BLK_MQ_F_SHOULD_MERGE |
+				 BLK_MQ_F_TAG_HCTX_SHARED;
+
+	ret = blk_mq_alloc_tag_set(&vblkdev->tag_set);
+	if (ret)
+		return;
+
+#if defined(NV_BLK_MQ_ALLOC_QUEUE_PRESENT)
+	vblkdev->queue = blk_mq_alloc_queue(&vblkdev->tag_set, NULL, NULL);
+#else
+	vblkdev->queue = blk_mq_init_queue(&vblkdev->tag_set);
+#endif
+	if (IS_ERR(vblkdev->queue)) {
+		dev_err(vblkdev->device, "failed to init blk queue\n");
+		blk_mq_free_tag_set(&vblkdev->tag_set);
+		return;
+	}
+
+	vblkdev->queue->queuedata = vblkdev;
+
+	blk_queue_logical_block_size(vblkdev->queue,
+		vblkdev->config.blk_config.hardblk_size);
+	blk_queue_physical_block_size(vblkdev->queue,
+		vblkdev->config.blk_config.hardblk_size);
+
+	if (vblkdev->config.blk_config.req_ops_supported & VS_BLK_FLUSH_OP_F) {
+		blk_queue_write_cache(vblkdev->queue, true, false);
+	}
+
+	/* Preallocate the scatterlists used to hand over guest pages by IOVA,
+	 * instead of allocating and freeing one for every read/write.
+	 */
+	if (vblkdev->config.blk_config.use_vm_address == 1U) {
+		for (req_id = 0; req_id < max_requests; req_id++) {
+			req = &vblkdev->reqs[req_id];
+			req->sg_lst = devm_kcalloc(vblkdev->device,
+					queue_max_segments(vblkdev->queue),
+					sizeof(struct scatterlist), GFP_KERNEL);
+			if (req->sg_lst == NULL) {
+				dev_err(vblkdev->device,
+					"SG mem allocation failed\n");
+				return;
+			}
+		}
+	}
 #if defined(NV_BLK_QUEUE_MAX_HW_SECTORS_PRESENT) /* Removed in Linux v6.10 */
 	blk_queue_max_hw_sectors(vblkdev->queue, max_io_bytes / SECTOR_SIZE);
 #endif
@@ -1335,24 +1411,6 @@ static irqreturn_t ivc_irq_handler(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
-static void bio_request_timeout_callback(struct timer_list *timer)
-{
-	struct vsc_request *req = from_timer(req, timer, timer);
-
-	dev_err(req->vblkdev->device, "Request id %d timed out. curr ctr: %llu sched ctr: %llu\n",
-						req->id, _arch_counter_get_cntvct(), req->time);
-
-}
-
-static void tegra_create_timers(struct vblk_dev *vblkdev)
-{
-	uint32_t i;
-
-	for (i = 0; i < MAX_VSC_REQS; i++)
-		timer_setup(&vblkdev->reqs[i].timer, bio_request_timeout_callback, 0);
-
-}
-
 static int tegra_hv_vblk_probe(struct platform_device *pdev)
 {
 	static struct device_node *vblk_node;
@@ -1425,7 +1483,6 @@ static int tegra_hv_vblk_probe(struct platform_device *pdev)
 	vblkdev->queue_state = VBLK_QUEUE_ACTIVE;
 
 	spin_lock_init(&vblkdev->lock);
-	spin_lock_init(&vblkdev->queue_lock);
 	mutex_init(&vblkdev->ioctl_lock);
 	mutex_init(&vblkdev->ivc_lock);
 
@@ -1433,9 +1490,7 @@ static int tegra_hv_vblk_probe(struct platform_device *pdev)
 	INIT_WORK(&vblkdev->work, vblk_request_work);
 	/* creating and initializing the an internal request list */
 	INIT_LIST_HEAD(&vblkdev->req_list);
-
-	/* Create timers for each request going to storage server*/
-	tegra_create_timers(vblkdev);
+	init_llist_head(&vblkdev->req_llist);
 
 	if (devm_request_irq(vblkdev->device, vblkdev->ivck->irq,
 		ivc_irq_handler, 0, "vblk", vblkdev)) {
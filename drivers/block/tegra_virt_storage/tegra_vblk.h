@@ -14,6 +14,7 @@
 #include <soc/tegra/virt/hv-ivc.h>
 #include <linux/workqueue.h>
 #include <linux/mutex.h>
+#include <linux/llist.h>
 #include <tegra_virt_storage_spec.h>
 
 #define DRV_NAME "tegra_hv_vblk"
@@ -26,7 +27,10 @@
 #define VS_LOG_HEADS 4
 #define VS_LOG_SECTS 16
 
-#define MAX_VSC_REQS 32
+#define MAX_VSC_REQS 256
+
+/* Max responses harvested from IVC before refilling the submit side */
+#define VBLK_COMPLETION_BATCH 16
 
 struct vblk_ioctl_req {
 	uint32_t ioctl_id;
@@ -35,8 +39,10 @@ struct vblk_ioctl_req {
 	int32_t status;
 };
 
+/* Per request driver data, allocated by blk-mq as the request pdu */
 struct req_entry {
 	struct list_head list_entry;
+	struct llist_node llnode;
 	struct request *req;
 };
 
@@ -76,7 +82,8 @@ struct vblk_dev {
 	struct request_queue *queue;     /* The device request queue */
 	struct gendisk *gd;              /* The gendisk structure */
 	struct blk_mq_tag_set tag_set;
-	struct list_head req_list;	/* List containing req */
+	struct list_head req_list;	/* List containing req, ivc_lock */
+	struct llist_head req_llist;	/* Lockless list filled by hctxs */
 	uint32_t ivc_id;
 	uint32_t ivm_id;
 	struct tegra_hv_ivc_cookie *ivck;
@@ -89,9 +96,8 @@ struct vblk_dev {
 	struct device *device;
 	void *shared_buffer;
 	struct mutex ioctl_lock;
-	spinlock_t queue_lock;
-	struct vsc_request reqs[MAX_VSC_REQS];
-	DECLARE_BITMAP(pending_reqs, MAX_VSC_REQS);
+	struct vsc_request *reqs;
+	unsigned long *pending_reqs;
 	uint32_t inflight_reqs;
 	uint32_t inflight_ioctl_reqs;
 	uint32_t max_requests;
@@ -104,6 +110,8 @@ struct vblk_dev {
 	struct completion hsierror_handle;
 #endif
 	struct mutex ivc_lock;
+	/* Responses read from the IVC queue at once, ivc_lock */
+	struct vs_request resp_batch[VBLK_COMPLETION_BATCH];
 	enum vblk_queue_state queue_state;
 	struct completion req_queue_empty;
 };
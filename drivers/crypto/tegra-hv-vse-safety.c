@@ -31,22 +31,39 @@
 #include <crypto/sha1.h>
 #include <crypto/sha2.h>
 #include <crypto/sha3.h>
+#include <crypto/engine.h>
 #include <linux/delay.h>
+#include <linux/iopoll.h>
 #include <soc/tegra/virt/hv-ivc.h>
 #include <linux/iommu.h>
 #include <linux/completion.h>
 #include <linux/interrupt.h>
 #include <linux/kthread.h>
+#include <linux/dma-fence.h>
+#include <linux/workqueue.h>
 #include <linux/host1x.h>
 #include <linux/version.h>
 
 #include "tegra-hv-vse.h"
 
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+#define CRYPTO_REGISTER(alg, ...) \
+		crypto_engine_register_##alg(__VA_ARGS__)
+#define CRYPTO_UNREGISTER(alg, ...) \
+		crypto_engine_unregister_##alg(__VA_ARGS__)
+#else
+#define CRYPTO_REGISTER(alg, ...) \
+		crypto_register_##alg(__VA_ARGS__)
+#define CRYPTO_UNREGISTER(alg, ...) \
+		crypto_unregister_##alg(__VA_ARGS__)
+#endif
+
 #define SE_MAX_SCHEDULE_TIMEOUT					LONG_MAX
 #define TEGRA_HV_VSE_SHA_MAX_LL_NUM_1				1
 #define TEGRA_HV_VSE_AES_CMAC_MAX_LL_NUM			2
 #define TEGRA_HV_VSE_MAX_TASKS_PER_SUBMIT			1
 #define TEGRA_HV_VSE_TIMEOUT			(msecs_to_jiffies(10000))
+#define TEGRA_HV_VSE_ENGINE_QLEN		(TEGRA_VSE_MAX_INFLIGHT * 4U)
 #define TEGRA_HV_VSE_SHA_MAX_BLOCK_SIZE				128
 #define TEGRA_VIRTUAL_SE_AES_BLOCK_SIZE				16
 #define TEGRA_VIRTUAL_SE_AES_GCM_TAG_SIZE			16
@@ -229,6 +246,7 @@
 #define SHA3_STATE_SIZE	200
 
 #define TEGRA_VIRTUAL_SE_TIMEOUT_1S				1000000
+#define TEGRA_VIRTUAL_SE_IVC_POLL_US				10
 
 #define TEGRA_VIRTUAL_SE_AES_CMAC_DIGEST_SIZE			16
 
@@ -296,8 +314,10 @@ struct tegra_virtual_se_ll {
 	u32 data_len; /* Data length in DMA buffer */
 };
 
+/* Echoed back by the server, identifies the in-flight table entry */
 struct tegra_vse_tag {
-	unsigned int *priv_data;
+	uint32_t slot;
+	uint32_t gen;
 };
 
 /* Tegra Virtual Security Engine commands */
@@ -358,6 +378,14 @@ struct tegra_vse_priv_data {
 	uint32_t syncpt_id;
 	uint32_t syncpt_threshold;
 	uint32_t syncpt_id_valid;
+	/* In-flight table entry while the request is outstanding */
+	uint32_t node_id;
+	uint32_t tag_slot;
+	uint32_t tag_gen;
+	/* Asynchronous skcipher completion */
+	struct dma_fence *fence;
+	struct dma_fence_cb fence_cb;
+	struct work_struct work;
 };
 
 struct tegra_virtual_se_addr {
@@ -572,6 +600,13 @@ struct tegra_virtual_se_aes_req_context {
 	u8 engine_id;
 };
 
+/* SHA operation queued to the crypto engine */
+enum tegra_virtual_se_sha_engine_op {
+	SHA_ENGINE_OP_UPDATE,
+	SHA_ENGINE_OP_FINAL,
+	SHA_ENGINE_OP_FINUP,
+};
+
 enum se_engine_id {
 	VIRTUAL_SE_AES0,
 	VIRTUAL_SE_AES1,
@@ -622,82 +657,152 @@ static int32_t validate_header(
 	return ret;
 }
 
-static int read_and_validate_dummy_msg(
-	struct tegra_virtual_se_dev *se_dev,
-	struct tegra_hv_ivc_cookie *pivck,
-	uint32_t node_id, bool *is_dummy)
+/*
+ * Claim a free in-flight slot for a request. Checked against the suspend
+ * state under inflight_lock so that the drain in shutdown either sees the
+ * request or the request sees the suspended engine.
+ *
+ * Returns 1 when a slot was claimed, 0 if the table is full and -ENODEV if
+ * the engine is suspended.
+ */
+static int tegra_vse_inflight_claim(struct tegra_virtual_se_dev *se_dev,
+				    struct crypto_dev_to_ivc_map *map,
+				    struct tegra_vse_priv_data *priv)
 {
-	int err = 0, read_size = -1;
-	struct tegra_virtual_se_ivc_msg_t *ivc_msg;
-	struct tegra_virtual_se_ivc_hdr_t *ivc_hdr;
-	size_t size_ivc_msg = sizeof(struct tegra_virtual_se_ivc_msg_t);
+	uint32_t i;
+	int ret = 0;
 
-	ivc_msg = devm_kzalloc(se_dev->dev, size_ivc_msg, GFP_KERNEL);
-	if (!ivc_msg)
-		return -ENOMEM;
+	spin_lock(&map->inflight_lock);
+	if (atomic_read(&se_dev->se_suspended)) {
+		ret = -ENODEV;
+		goto unlock;
+	}
 
-	read_size = tegra_hv_ivc_read(pivck, ivc_msg, size_ivc_msg);
-	if (read_size > 0 && read_size < size_ivc_msg) {
-		dev_err(se_dev->dev, "Wrong read msg len %d\n", read_size);
-		return -EINVAL;
+	for (i = 0; i < TEGRA_VSE_MAX_INFLIGHT; i++) {
+		if (map->inflight[i].priv)
+			continue;
+
+		map->inflight[i].priv = priv;
+		map->inflight[i].gen++;
+		priv->tag_slot = i;
+		priv->tag_gen = map->inflight[i].gen;
+		map->inflight_cnt++;
+		ret = 1;
+		break;
 	}
-	ivc_hdr = &(ivc_msg->ivc_hdr);
+unlock:
+	spin_unlock(&map->inflight_lock);
 
-	err = validate_header(se_dev, ivc_hdr, is_dummy);
+	return ret;
+}
 
-	devm_kfree(se_dev->dev, ivc_msg);
-	return err;
+/* Add a request to the node's in-flight table and tag the message with it */
+static int tegra_vse_inflight_add(struct tegra_virtual_se_dev *se_dev,
+				  uint32_t node_id, struct tegra_vse_priv_data *priv,
+				  struct tegra_virtual_se_ivc_msg_t *ivc_msg)
+{
+	struct crypto_dev_to_ivc_map *map = &g_crypto_to_ivc_map[node_id];
+	struct tegra_vse_tag *tag = (struct tegra_vse_tag *)ivc_msg->ivc_hdr.tag;
+	int ret = 0;
+
+	if (!wait_event_timeout(map->inflight_wq,
+				(ret = tegra_vse_inflight_claim(se_dev, map, priv)) != 0,
+				TEGRA_HV_VSE_TIMEOUT)) {
+		dev_err(se_dev->dev, "%s(): no free in-flight slot\n", __func__);
+		return -EBUSY;
+	}
+	if (ret < 0)
+		return ret;
+
+	priv->node_id = node_id;
+	tag->slot = priv->tag_slot;
+	tag->gen = priv->tag_gen;
+
+	return 0;
+}
+
+/* Release the in-flight slot, late responses for it are dropped from now on */
+static void tegra_vse_inflight_del(struct tegra_vse_priv_data *priv)
+{
+	struct crypto_dev_to_ivc_map *map = &g_crypto_to_ivc_map[priv->node_id];
+
+	spin_lock(&map->inflight_lock);
+	if (map->inflight[priv->tag_slot].priv == priv) {
+		map->inflight[priv->tag_slot].priv = NULL;
+		map->inflight_cnt--;
+	}
+	spin_unlock(&map->inflight_lock);
+
+	wake_up_all(&map->inflight_wq);
+}
+
+static bool tegra_vse_inflight_idle(struct crypto_dev_to_ivc_map *map)
+{
+	bool idle;
+
+	spin_lock(&map->inflight_lock);
+	idle = (map->inflight_cnt == 0U);
+	spin_unlock(&map->inflight_lock);
+
+	return idle;
+}
+
+/* Caller holds inflight_lock */
+static struct tegra_vse_priv_data *tegra_vse_inflight_lookup(
+	struct crypto_dev_to_ivc_map *map, const struct tegra_vse_tag *tag)
+{
+	struct tegra_vse_inflight_slot *slot;
+
+	if (tag->slot >= TEGRA_VSE_MAX_INFLIGHT)
+		return NULL;
+
+	slot = &map->inflight[tag->slot];
+	if (slot->gen != tag->gen)
+		return NULL;
+
+	return slot->priv;
 }
 
 static int read_and_validate_valid_msg(
 	struct tegra_virtual_se_dev *se_dev,
 	struct tegra_hv_ivc_cookie *pivck,
-	uint32_t node_id, bool *is_dummy, bool waited)
+	uint32_t node_id)
 {
+	struct crypto_dev_to_ivc_map *map = &g_crypto_to_ivc_map[node_id];
 	struct tegra_vse_tag *p_dat;
 	struct tegra_vse_priv_data *priv;
 	struct tegra_virtual_se_ivc_msg_t *ivc_msg;
 	struct tegra_virtual_se_ivc_hdr_t *ivc_hdr;
 	struct tegra_virtual_se_aes_req_context *req_ctx;
 	struct tegra_virtual_se_ivc_resp_msg_t *ivc_rx;
-	enum ivc_irq_state *irq_state;
-
-	int read_size = -1, err = 0;
-	size_t size_ivc_msg = sizeof(struct tegra_virtual_se_ivc_msg_t);
-
-	mutex_lock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
-	irq_state = &(g_crypto_to_ivc_map[node_id].wait_interrupt);
-	mutex_unlock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
-
-	if (!tegra_hv_ivc_can_read(pivck)) {
-		mutex_lock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
-		*irq_state = INTERMEDIATE_REQ_INTERRUPT;
-		mutex_unlock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
-		dev_info(se_dev->dev, "%s(): no valid message, await interrupt.\n", __func__);
-		return -EAGAIN;
-	}
-
-	ivc_msg = devm_kzalloc(se_dev->dev, size_ivc_msg, GFP_KERNEL);
-	if (!ivc_msg)
-		return -ENOMEM;
+	bool is_dummy = false;
+	bool known = true;
+	int err = 0;
 
-	read_size = tegra_hv_ivc_read(pivck, ivc_msg, size_ivc_msg);
-	if (read_size > 0 && read_size < size_ivc_msg) {
-		dev_err(se_dev->dev, "Wrong read msg len %d\n", read_size);
-		return -EINVAL;
+	/* Parse the response in place, the frame is released once the
+	 * results have been copied into the request private data.
+	 */
+	ivc_msg = tegra_hv_ivc_read_get_next_frame(pivck);
+	if (IS_ERR_OR_NULL(ivc_msg)) {
+		dev_err(se_dev->dev, "%s(): no frame to read\n", __func__);
+		return -EIO;
 	}
 	ivc_hdr = &(ivc_msg->ivc_hdr);
-	err = validate_header(se_dev, ivc_hdr, is_dummy);
-	if (err != 0)
+	err = validate_header(se_dev, ivc_hdr, &is_dummy);
+	/* The server sends a filler ahead of each response */
+	if (err != 0 || is_dummy)
 		goto deinit;
-	if (*is_dummy) {
-		dev_err(se_dev->dev, "%s(): Wrong response sequence\n", __func__);
-		goto deinit;
-	}
+
+	/* The request may have timed out and released its slot meanwhile,
+	 * hold inflight_lock until the results have been handed over.
+	 */
 	p_dat = (struct tegra_vse_tag *)ivc_msg->ivc_hdr.tag;
-	priv = (struct tegra_vse_priv_data *)p_dat->priv_data;
+	spin_lock(&map->inflight_lock);
+	priv = tegra_vse_inflight_lookup(map, p_dat);
 	if (!priv) {
-		pr_err("%s no call back info\n", __func__);
+		spin_unlock(&map->inflight_lock);
+		dev_err(se_dev->dev, "%s(): no request for tag %u/%u\n",
+			__func__, p_dat->slot, p_dat->gen);
 		goto deinit;
 	}
 	priv->syncpt_id = ivc_msg->rx[0].syncpt_id;
@@ -742,44 +847,67 @@ static int read_and_validate_valid_msg(
 		break;
 	default:
 		dev_err(se_dev->dev, "Unknown command\n");
-		waited = false;
+		known = false;
 	}
-	if (waited)
+
+	if (known)
 		complete(&priv->alg_complete);
+	spin_unlock(&map->inflight_lock);
 
 deinit:
-	devm_kfree(se_dev->dev, ivc_msg);
+	tegra_hv_ivc_read_advance(pivck);
+
 	return err;
 
 }
 
+/*
+ * Read every response pending on a node. Fillers are skipped and each
+ * response completes the request named by its tag, so any number of
+ * requests can be outstanding on the node.
+ *
+ * Caller holds se_ivc_lock.
+ */
+static void tegra_vse_read_responses(struct tegra_virtual_se_dev *se_dev,
+				     struct tegra_hv_ivc_cookie *pivck,
+				     uint32_t node_id)
+{
+	int err;
+
+	if (pivck->frame_size < sizeof(struct tegra_virtual_se_ivc_msg_t)) {
+		dev_err(se_dev->dev, "Wrong read msg len %d\n", pivck->frame_size);
+		return;
+	}
+
+	while (tegra_hv_ivc_can_read(pivck)) {
+		err = read_and_validate_valid_msg(se_dev, pivck, node_id);
+		if (err == -EIO)
+			break;
+	}
+}
+
 static int tegra_hv_vse_safety_send_ivc(
 	struct tegra_virtual_se_dev *se_dev,
 	struct tegra_hv_ivc_cookie *pivck,
 	void *pbuf,
 	int length)
 {
-	u32 timeout;
+	int val;
 	int err = 0;
 
-	timeout = TEGRA_VIRTUAL_SE_TIMEOUT_1S;
-	while (tegra_hv_ivc_channel_notified(pivck) != 0) {
-		if (!timeout) {
-			dev_err(se_dev->dev, "ivc reset timeout\n");
-			return -EINVAL;
-		}
-		udelay(1);
-		timeout--;
+	/* Sleep between polls instead of spinning the CPU for up to 1s */
+	if (read_poll_timeout(tegra_hv_ivc_channel_notified, val, (val == 0),
+			TEGRA_VIRTUAL_SE_IVC_POLL_US, TEGRA_VIRTUAL_SE_TIMEOUT_1S,
+			false, pivck)) {
+		dev_err(se_dev->dev, "ivc reset timeout\n");
+		return -EINVAL;
 	}
 
-	timeout = TEGRA_VIRTUAL_SE_TIMEOUT_1S;
-	while (tegra_hv_ivc_can_write(pivck) == 0) {
-		if (!timeout) {
-			dev_err(se_dev->dev, "ivc send message timeout\n");
-			return -EINVAL;
-		}
-		udelay(1);
-		timeout--;
+	if (read_poll_timeout(tegra_hv_ivc_can_write, val, (val != 0),
+			TEGRA_VIRTUAL_SE_IVC_POLL_US, TEGRA_VIRTUAL_SE_TIMEOUT_1S,
+			false, pivck)) {
+		dev_err(se_dev->dev, "ivc send message timeout\n");
+		return -EINVAL;
 	}
 
 	if (length > sizeof(struct tegra_virtual_se_ivc_msg_t)) {
@@ -796,94 +924,95 @@ static int tegra_hv_vse_safety_send_ivc(
 	return 0;
 }
 
-static int tegra_hv_vse_safety_send_ivc_wait(
+/*
+ * Send a request and wait for its response. On success the request keeps
+ * its in-flight slot until tegra_vse_inflight_del(), and is still
+ * executing on the engine if priv->syncpt_id_valid is set.
+ */
+static int tegra_hv_vse_safety_submit_ivc(
 	struct tegra_virtual_se_dev *se_dev,
 	struct tegra_hv_ivc_cookie *pivck,
 	struct tegra_vse_priv_data *priv,
 	void *pbuf, int length, uint32_t node_id)
 {
-	struct host1x_syncpt *sp;
-	struct host1x *host1x;
 	int err;
-	bool is_dummy = false;
-	u64 time_left;
-	enum ivc_irq_state *irq_state, local_irq_state;
 
+	err = tegra_vse_inflight_add(se_dev, node_id, priv, pbuf);
+	if (err)
+		return err;
+
+	/* se_ivc_lock only covers the channel, not the wait for the response,
+	 * so other requests on the node go out while this one is served.
+	 */
 	mutex_lock(&g_crypto_to_ivc_map[node_id].se_ivc_lock);
+	err = tegra_hv_vse_safety_send_ivc(se_dev, pivck, pbuf, length);
+	if (!err)
+		tegra_vse_read_responses(se_dev, pivck, node_id);
+	mutex_unlock(&g_crypto_to_ivc_map[node_id].se_ivc_lock);
+
+	if (err) {
+		dev_err(se_dev->dev,
+			"\n %s send ivc failed %d\n", __func__, err);
+		goto exit;
+	}
+
+	/* Completed by whoever reads the node next, this thread or the kthread */
+	if (!wait_for_completion_timeout(&priv->alg_complete,
+					 TEGRA_HV_VSE_TIMEOUT)) {
+		dev_err(se_dev->dev, "%s timeout\n", __func__);
+		err = -ETIMEDOUT;
+	}
+
+exit:
+	if (err)
+		tegra_vse_inflight_del(priv);
+
+	return err;
+}
+
+static struct host1x_syncpt *tegra_hv_vse_safety_get_syncpt(
+	struct tegra_virtual_se_dev *se_dev,
+	struct tegra_vse_priv_data *priv)
+{
+	struct host1x_syncpt *sp;
+	struct host1x *host1x;
 
 	if (!se_dev->host1x_pdev) {
 		dev_err(se_dev->dev, "host1x pdev not initialized\n");
-		err = -ENODATA;
-		goto exit;
+		return NULL;
 	}
 
 	host1x = platform_get_drvdata(se_dev->host1x_pdev);
 	if (!host1x) {
 		dev_err(se_dev->dev, "No platform data for host1x!\n");
-		err = -ENODATA;
-		goto exit;
+		return NULL;
 	}
 
-	/* Return error if engine is in suspended state */
-	if (atomic_read(&se_dev->se_suspended)) {
-		err = -ENODEV;
-		goto exit;
-	}
-	err = tegra_hv_vse_safety_send_ivc(se_dev, pivck, pbuf, length);
-	if (err) {
-		dev_err(se_dev->dev,
-			"\n %s send ivc failed %d\n", __func__, err);
-		goto exit;
-	}
+	sp = host1x_syncpt_get_by_id_noref(host1x, priv->syncpt_id);
+	if (!sp)
+		dev_err(se_dev->dev, "No syncpt for syncpt id %d\n", priv->syncpt_id);
 
-	mutex_lock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
-	irq_state = &(se_dev->crypto_to_ivc_map[node_id].wait_interrupt);
-	local_irq_state = *irq_state;
-	mutex_unlock(&(g_crypto_to_ivc_map[node_id].irq_state_lock));
-	if (local_irq_state == NO_INTERRUPT) {
-		err = read_and_validate_dummy_msg(se_dev, pivck, node_id, &is_dummy);
-		if (err != 0) {
-			dev_err(se_dev->dev, "Failed to read and validate dummy message.\n");
-			goto exit;
-		}
-		if (is_dummy) {
-			err = read_and_validate_valid_msg(se_dev, pivck, node_id, &is_dummy, false);
-			if (err != 0 && err != -EAGAIN) {
-				dev_err(se_dev->dev, "Failed to read & validate valid message.\n");
-				goto exit;
-			}
-			if (err == -EAGAIN) {
-				err = 0;
-				pr_debug("%s(): wait_interrupt = %u", __func__, local_irq_state);
-				time_left = wait_for_completion_timeout(&priv->alg_complete,
-						TEGRA_HV_VSE_TIMEOUT);
-				if (time_left == 0) {
-					dev_err(se_dev->dev, "%s timeout\n", __func__);
-					err = -ETIMEDOUT;
-					goto exit;
-				}
-			}
-			pr_debug("%s(): wait_interrupt = %u", __func__, local_irq_state);
-		} else {
-			dev_err(se_dev->dev,
-				"%s(): Invalid resonse sequence, expected dummy message.\n",
-				__func__);
-			goto exit;
-		}
-	} else {
-		time_left = wait_for_completion_timeout(&priv->alg_complete, TEGRA_HV_VSE_TIMEOUT);
-		if (time_left == 0) {
-			dev_err(se_dev->dev, "%s timeout\n", __func__);
-			err = -ETIMEDOUT;
-			goto exit;
-		}
-	}
+	return sp;
+}
+
+static int tegra_hv_vse_safety_send_ivc_wait(
+	struct tegra_virtual_se_dev *se_dev,
+	struct tegra_hv_ivc_cookie *pivck,
+	struct tegra_vse_priv_data *priv,
+	void *pbuf, int length, uint32_t node_id)
+{
+	struct host1x_syncpt *sp;
+	int err;
+
+	err = tegra_hv_vse_safety_submit_ivc(se_dev, pivck, priv, pbuf, length,
+					     node_id);
+	if (err)
+		return err;
 
 	/* If this is not last request then wait using nvhost API*/
 	if (priv->syncpt_id_valid) {
-		sp = host1x_syncpt_get_by_id_noref(host1x, priv->syncpt_id);
+		sp = tegra_hv_vse_safety_get_syncpt(se_dev, priv);
 		if (!sp) {
-			dev_err(se_dev->dev, "No syncpt for syncpt id %d\n", priv->syncpt_id);
 			err = -ENODATA;
 			goto exit;
 		}
@@ -893,12 +1022,12 @@ static int tegra_hv_vse_safety_send_ivc_wait(
 			dev_err(se_dev->dev, "timed out for syncpt %u threshold %u err %d\n",
 						 priv->syncpt_id, priv->syncpt_threshold, err);
 			err = -ETIMEDOUT;
-			goto exit;
 		}
 	}
 
 exit:
-	mutex_unlock(&g_crypto_to_ivc_map[node_id].se_ivc_lock);
+	tegra_vse_inflight_del(priv);
+
 	return err;
 }
 
@@ -997,7 +1126,6 @@ static int tegra_hv_vse_safety_send_sha_data(struct tegra_virtual_se_dev *se_dev
 	struct tegra_hv_ivc_cookie *pivck;
 	struct tegra_vse_priv_data *priv = NULL;
 	struct tegra_virtual_se_req_context *req_ctx;
-	struct tegra_vse_tag *priv_data_ptr;
 	union tegra_virtual_se_sha_args *psha = NULL;
 	int err = 0;
 	u64 total_count = 0, msg_len = 0;
@@ -1063,8 +1191,6 @@ static int tegra_hv_vse_safety_send_sha_data(struct tegra_virtual_se_dev *se_dev
 	ivc_hdr->header_magic[2] = 'D';
 	ivc_hdr->header_magic[3] = 'A';
 	ivc_hdr->num_reqs = 1;
-	priv_data_ptr = (struct tegra_vse_tag *)ivc_req_msg->ivc_hdr.tag;
-	priv_data_ptr->priv_data = (unsigned int *)priv;
 	priv->cmd = VIRTUAL_SE_PROCESS;
 	priv->se_dev = se_dev;
 
@@ -1687,11 +1813,59 @@ static void tegra_hv_vse_safety_sha_req_deinit(struct ahash_request *req)
 	req_ctx->req_context_initialized = false;
 }
 
+static int tegra_hv_vse_safety_sha_do_one_req(struct crypto_engine *engine, void *areq)
+{
+	struct ahash_request *req = ahash_request_cast(areq);
+	struct tegra_virtual_se_dev *se_dev = g_virtual_se_dev[VIRTUAL_SE_SHA];
+	struct tegra_virtual_se_req_context *req_ctx = ahash_request_ctx(req);
+	int ret;
+
+	switch (req_ctx->engine_op) {
+	case SHA_ENGINE_OP_UPDATE:
+		ret = tegra_hv_vse_safety_sha_op(req, false, false);
+		break;
+	case SHA_ENGINE_OP_FINAL:
+		/* Do not process data in given request */
+		ret = tegra_hv_vse_safety_sha_op(req, true, false);
+		tegra_hv_vse_safety_sha_req_deinit(req);
+		break;
+	case SHA_ENGINE_OP_FINUP:
+		ret = tegra_hv_vse_safety_sha_op(req, true, true);
+		tegra_hv_vse_safety_sha_req_deinit(req);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	if (ret)
+		dev_err(se_dev->dev, "%s: op %u failed - %d\n", __func__,
+			req_ctx->engine_op, ret);
+
+	/* Completion callbacks expect bottom halves to be disabled */
+	local_bh_disable();
+	crypto_finalize_hash_request(engine, req, ret);
+	local_bh_enable();
+
+	return 0;
+}
+
+static int tegra_hv_vse_safety_sha_enqueue(struct ahash_request *req, u8 op)
+{
+	struct tegra_virtual_se_sha_context *sha_ctx =
+			crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct tegra_virtual_se_req_context *req_ctx = ahash_request_ctx(req);
+
+	req_ctx->engine_op = op;
+
+	return crypto_transfer_hash_request_to_engine(
+			g_crypto_to_ivc_map[sha_ctx->node_id].engine, req);
+}
+
 static int tegra_hv_vse_safety_sha_update(struct ahash_request *req)
 {
 	struct tegra_virtual_se_dev *se_dev = g_virtual_se_dev[VIRTUAL_SE_SHA];
 	struct tegra_virtual_se_req_context *req_ctx;
-	int ret = 0;
 
 	if (!req) {
 		dev_err(se_dev->dev, "SHA request not valid\n");
@@ -1709,18 +1883,13 @@ static int tegra_hv_vse_safety_sha_update(struct ahash_request *req)
 		return -EINVAL;
 	}
 
-	ret = tegra_hv_vse_safety_sha_op(req, false, false);
-	if (ret)
-		dev_err(se_dev->dev, "tegra_se_sha_update failed - %d\n", ret);
-
-	return ret;
+	return tegra_hv_vse_safety_sha_enqueue(req, SHA_ENGINE_OP_UPDATE);
 }
 
 static int tegra_hv_vse_safety_sha_finup(struct ahash_request *req)
 {
 	struct tegra_virtual_se_dev *se_dev = g_virtual_se_dev[VIRTUAL_SE_SHA];
 	struct tegra_virtual_se_req_context *req_ctx;
-	int ret = 0;
 
 	if (!req) {
 		dev_err(se_dev->dev, "SHA request not valid\n");
@@ -1738,20 +1907,13 @@ static int tegra_hv_vse_safety_sha_finup(struct ahash_request *req)
 		return -EINVAL;
 	}
 
-	ret = tegra_hv_vse_safety_sha_op(req, true, true);
-	if (ret)
-		dev_err(se_dev->dev, "tegra_se_sha_finup failed - %d\n", ret);
-
-	tegra_hv_vse_safety_sha_req_deinit(req);
-
-	return ret;
+	return tegra_hv_vse_safety_sha_enqueue(req, SHA_ENGINE_OP_FINUP);
 }
 
 static int tegra_hv_vse_safety_sha_final(struct ahash_request *req)
 {
 	struct tegra_virtual_se_dev *se_dev = g_virtual_se_dev[VIRTUAL_SE_SHA];
 	struct tegra_virtual_se_req_context *req_ctx;
-	int ret = 0;
 
 	if (!req) {
 		dev_err(se_dev->dev, "SHA request not valid\n");
@@ -1769,14 +1931,7 @@ static int tegra_hv_vse_safety_sha_final(struct ahash_request *req)
 		return -EINVAL;
 	}
 
-	/* Do not process data in given request */
-	ret = tegra_hv_vse_safety_sha_op(req, true, false);
-	if (ret)
-		dev_err(se_dev->dev, "tegra_se_sha_final failed - %d\n", ret);
-
-	tegra_hv_vse_safety_sha_req_deinit(req);
-
-	return ret;
+	return tegra_hv_vse_safety_sha_enqueue(req, SHA_ENGINE_OP_FINAL);
 }
 
 static int tegra_hv_vse_safety_sha_digest(struct ahash_request *req)
@@ -1799,13 +1954,7 @@ static int tegra_hv_vse_safety_sha_digest(struct ahash_request *req)
 		return ret;
 	}
 
-	ret = tegra_hv_vse_safety_sha_op(req, true, true);
-	if (ret)
-		dev_err(se_dev->dev, "tegra_se_sha_digest failed - %d\n", ret);
-
-	tegra_hv_vse_safety_sha_req_deinit(req);
-
-	return ret;
+	return tegra_hv_vse_safety_sha_enqueue(req, SHA_ENGINE_OP_FINUP);
 }
 
 static int tegra_hv_vse_safety_sha_export(struct ahash_request *req, void *out)
@@ -1826,6 +1975,13 @@ static int tegra_hv_vse_safety_sha_import(struct ahash_request *req, const void
 
 static int tegra_hv_vse_safety_sha_cra_init(struct crypto_tfm *tfm)
 {
+#ifndef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+	struct tegra_virtual_se_sha_context *sha_ctx = crypto_tfm_ctx(tfm);
+
+	sha_ctx->enginectx.op.prepare_request = NULL;
+	sha_ctx->enginectx.op.unprepare_request = NULL;
+	sha_ctx->enginectx.op.do_one_request = tegra_hv_vse_safety_sha_do_one_req;
+#endif
 	crypto_ahash_set_reqsize(__crypto_ahash_cast(tfm),
 				 sizeof(struct tegra_virtual_se_req_context));
 
@@ -1928,6 +2084,127 @@ static int tegra_hv_vse_safety_aes_gen_random_iv(
 	return err;
 }
 
+static void tegra_hv_vse_safety_aes_finalize(struct skcipher_request *req, int err)
+{
+	struct tegra_virtual_se_aes_context *aes_ctx =
+			crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
+
+	/* Completion callbacks expect bottom halves to be disabled */
+	local_bh_disable();
+	crypto_finalize_skcipher_request(g_crypto_to_ivc_map[aes_ctx->node_id].engine,
+					 req, err);
+	local_bh_enable();
+}
+
+/* Copy the result out and release everything held by an AES request */
+static int tegra_hv_vse_safety_aes_complete(struct tegra_vse_priv_data *priv, int err)
+{
+	struct skcipher_request *req = priv->req;
+	struct tegra_virtual_se_aes_req_context *req_ctx = skcipher_request_ctx(req);
+	struct tegra_virtual_se_aes_context *aes_ctx =
+			crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
+	struct tegra_virtual_se_dev *se_dev = priv->se_dev;
+	int num_sgs;
+
+	if (err) {
+		dev_err(se_dev->dev, "%s: engine wait failed %d\n", __func__, err);
+	} else if (priv->rx_status == 0U) {
+		dma_sync_single_for_cpu(se_dev->dev, priv->buf_addr,
+			req->cryptlen, DMA_BIDIRECTIONAL);
+
+		num_sgs = tegra_hv_vse_safety_count_sgs(req->dst, req->cryptlen);
+		if (num_sgs == 1)
+			memcpy(sg_virt(req->dst), priv->buf, req->cryptlen);
+		else
+			sg_copy_from_buffer(req->dst, num_sgs,
+					priv->buf, req->cryptlen);
+
+		if (((req_ctx->op_mode == AES_CBC)
+				|| (req_ctx->op_mode == AES_CTR))
+				&& req_ctx->encrypt == true && aes_ctx->user_nonce == 0U)
+			memcpy(req->iv, priv->iv, TEGRA_VIRTUAL_SE_AES_IV_SIZE);
+
+		err = status_to_errno(priv->rx_status);
+	} else {
+		dev_err(se_dev->dev,
+				"%s: SE server returned error %u\n",
+				__func__, priv->rx_status);
+		err = status_to_errno(priv->rx_status);
+	}
+
+	if (priv->fence)
+		dma_fence_put(priv->fence);
+	tegra_vse_inflight_del(priv);
+
+	dma_unmap_sg(se_dev->dev, &priv->sg, 1, DMA_BIDIRECTIONAL);
+	kfree(priv->buf);
+	devm_kfree(se_dev->dev, priv);
+
+	return err;
+}
+
+static void tegra_hv_vse_safety_aes_work(struct work_struct *work)
+{
+	struct tegra_vse_priv_data *priv =
+			container_of(work, struct tegra_vse_priv_data, work);
+	struct skcipher_request *req = priv->req;
+	int err;
+
+	err = dma_fence_get_status(priv->fence);
+	err = tegra_hv_vse_safety_aes_complete(priv, err < 0 ? err : 0);
+	tegra_hv_vse_safety_aes_finalize(req, err);
+}
+
+static void tegra_hv_vse_safety_fence_cb(struct dma_fence *fence,
+					 struct dma_fence_cb *cb)
+{
+	struct tegra_vse_priv_data *priv =
+			container_of(cb, struct tegra_vse_priv_data, fence_cb);
+
+	schedule_work(&priv->work);
+}
+
+/*
+ * Arm completion of an AES request on the engine syncpoint. Returns
+ * -EINPROGRESS if the request is completed from tegra_hv_vse_safety_aes_work(),
+ * otherwise it has been completed here.
+ */
+static int tegra_hv_vse_safety_aes_wait_async(struct tegra_virtual_se_dev *se_dev,
+					      struct tegra_vse_priv_data *priv)
+{
+	struct host1x_syncpt *sp;
+	int err = 0;
+
+	if (!priv->syncpt_id_valid)
+		goto complete;
+
+	sp = tegra_hv_vse_safety_get_syncpt(se_dev, priv);
+	if (!sp) {
+		err = -ENODATA;
+		goto complete;
+	}
+
+	priv->fence = host1x_fence_create(sp, priv->syncpt_threshold, false);
+	if (IS_ERR(priv->fence)) {
+		err = PTR_ERR(priv->fence);
+		priv->fence = NULL;
+		goto complete;
+	}
+
+	INIT_WORK(&priv->work, tegra_hv_vse_safety_aes_work);
+	if (!dma_fence_add_callback(priv->fence, &priv->fence_cb,
+				    tegra_hv_vse_safety_fence_cb))
+		return -EINPROGRESS;
+
+	/* Already signaled */
+	err = dma_fence_get_status(priv->fence);
+	if (err > 0)
+		err = 0;
+
+complete:
+	return tegra_hv_vse_safety_aes_complete(priv, err);
+}
+
 static int tegra_hv_vse_safety_process_aes_req(struct tegra_virtual_se_dev *se_dev,
 		struct skcipher_request *req)
 {
@@ -1939,7 +2216,6 @@ static int tegra_hv_vse_safety_process_aes_req(struct tegra_virtual_se_dev *se_d
 	int err = 0;
 	struct tegra_virtual_se_ivc_msg_t *ivc_req_msg = NULL;
 	struct tegra_vse_priv_data *priv = NULL;
-	struct tegra_vse_tag *priv_data_ptr;
 	union tegra_virtual_se_aes_args *aes;
 	int num_sgs;
 	int dma_ents = 0;
@@ -1987,6 +2263,7 @@ static int tegra_hv_vse_safety_process_aes_req(struct tegra_virtual_se_dev *se_d
 	aes_ctx = crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
 	if (unlikely(!aes_ctx->is_key_slot_allocated)) {
 		dev_err(se_dev->dev, "AES Key slot not allocated\n");
+		err = -EINVAL;
 		goto exit;
 	}
 
@@ -2000,8 +2277,6 @@ static int tegra_hv_vse_safety_process_aes_req(struct tegra_virtual_se_dev *se_d
 	ivc_hdr->header_magic[3] = 'A';
 	ivc_hdr->engine = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 
-	priv_data_ptr = (struct tegra_vse_tag *)ivc_hdr->tag;
-	priv_data_ptr->priv_data = (unsigned int *)priv;
 	priv->se_dev = se_dev;
 	g_crypto_to_ivc_map[aes_ctx->node_id].vse_thread_start = true;
 
@@ -2031,35 +2306,17 @@ static int tegra_hv_vse_safety_process_aes_req(struct tegra_virtual_se_dev *se_d
 
 	init_completion(&priv->alg_complete);
 
-	err = tegra_hv_vse_safety_send_ivc_wait(se_dev, pivck, priv, ivc_req_msg,
+	err = tegra_hv_vse_safety_submit_ivc(se_dev, pivck, priv, ivc_req_msg,
 			sizeof(struct tegra_virtual_se_ivc_msg_t), aes_ctx->node_id);
 	if (err) {
 		dev_err(se_dev->dev, "failed to send data over ivc err %d\n", err);
 		goto exit;
 	}
 
-	if (priv->rx_status == 0U) {
-		dma_sync_single_for_cpu(priv->se_dev->dev, priv->buf_addr,
-			req->cryptlen, DMA_BIDIRECTIONAL);
-
-		num_sgs = tegra_hv_vse_safety_count_sgs(req->dst, req->cryptlen);
-		if (num_sgs == 1)
-			memcpy(sg_virt(req->dst), priv->buf, req->cryptlen);
-		else
-			sg_copy_from_buffer(req->dst, num_sgs,
-					priv->buf, req->cryptlen);
-
-		if (((req_ctx->op_mode == AES_CBC)
-				|| (req_ctx->op_mode == AES_CTR))
-				&& req_ctx->encrypt == true && aes_ctx->user_nonce == 0U)
-			memcpy(req->iv, priv->iv, TEGRA_VIRTUAL_SE_AES_IV_SIZE);
-	} else {
-		dev_err(se_dev->dev,
-				"%s: SE server returned error %u\n",
-				__func__, priv->rx_status);
-	}
+	devm_kfree(se_dev->dev, ivc_req_msg);
 
-	err = status_to_errno(priv->rx_status);
+	/* The engine may still be running, the rest happens on completion */
+	return tegra_hv_vse_safety_aes_wait_async(se_dev, priv);
 
 exit:
 	if (dma_ents > 0)
@@ -2077,8 +2334,34 @@ exit:
 	return err;
 }
 
+static int tegra_hv_vse_safety_aes_do_one_req(struct crypto_engine *engine, void *areq)
+{
+	struct skcipher_request *req = container_of(areq, struct skcipher_request, base);
+	struct tegra_virtual_se_aes_req_context *req_ctx = skcipher_request_ctx(req);
+	int err;
+
+	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
+	if (err == -EINPROGRESS)
+		return 0;
+
+	if (err)
+		dev_err(req_ctx->se_dev->dev, "%s failed with error %d\n",
+			__func__, err);
+
+	tegra_hv_vse_safety_aes_finalize(req, err);
+
+	return 0;
+}
+
 static int tegra_hv_vse_safety_aes_cra_init(struct crypto_skcipher *tfm)
 {
+#ifndef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+	struct tegra_virtual_se_aes_context *aes_ctx = crypto_skcipher_ctx(tfm);
+
+	aes_ctx->enginectx.op.prepare_request = NULL;
+	aes_ctx->enginectx.op.unprepare_request = NULL;
+	aes_ctx->enginectx.op.do_one_request = tegra_hv_vse_safety_aes_do_one_req;
+#endif
 	tfm->reqsize =
 		sizeof(struct tegra_virtual_se_aes_req_context);
 
@@ -2092,7 +2375,6 @@ static void tegra_hv_vse_safety_aes_cra_exit(struct crypto_skcipher *tfm)
 
 static int tegra_hv_vse_safety_aes_cbc_encrypt(struct skcipher_request *req)
 {
-	int err = 0;
 	struct tegra_virtual_se_aes_req_context *req_ctx = NULL;
 	struct tegra_virtual_se_aes_context *aes_ctx;
 
@@ -2114,16 +2396,13 @@ static int tegra_hv_vse_safety_aes_cbc_encrypt(struct skcipher_request *req)
 	req_ctx->op_mode = AES_CBC;
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
-	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
-		dev_err(req_ctx->se_dev->dev,
-				"%s failed with error %d\n", __func__, err);
-	return err;
+
+	return crypto_transfer_skcipher_request_to_engine(
+			g_crypto_to_ivc_map[aes_ctx->node_id].engine, req);
 }
 
 static int tegra_hv_vse_safety_aes_cbc_decrypt(struct skcipher_request *req)
 {
-	int err = 0;
 	struct tegra_virtual_se_aes_req_context *req_ctx = NULL;
 	struct tegra_virtual_se_aes_context *aes_ctx;
 
@@ -2138,16 +2417,13 @@ static int tegra_hv_vse_safety_aes_cbc_decrypt(struct skcipher_request *req)
 	req_ctx->op_mode = AES_CBC;
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
-	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
-		dev_err(req_ctx->se_dev->dev,
-				"%s failed with error %d\n", __func__, err);
-	return err;
+
+	return crypto_transfer_skcipher_request_to_engine(
+			g_crypto_to_ivc_map[aes_ctx->node_id].engine, req);
 }
 
 static int tegra_hv_vse_safety_aes_ecb_encrypt(struct skcipher_request *req)
 {
-	int err = 0;
 	struct tegra_virtual_se_aes_req_context *req_ctx = NULL;
 	struct tegra_virtual_se_aes_context *aes_ctx;
 
@@ -2162,16 +2438,13 @@ static int tegra_hv_vse_safety_aes_ecb_encrypt(struct skcipher_request *req)
 	req_ctx->op_mode = AES_ECB;
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
-	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
-		dev_err(req_ctx->se_dev->dev,
-				"%s failed with error %d\n", __func__, err);
-	return err;
+
+	return crypto_transfer_skcipher_request_to_engine(
+			g_crypto_to_ivc_map[aes_ctx->node_id].engine, req);
 }
 
 static int tegra_hv_vse_safety_aes_ecb_decrypt(struct skcipher_request *req)
 {
-	int err = 0;
 	struct tegra_virtual_se_aes_req_context *req_ctx = NULL;
 	struct tegra_virtual_se_aes_context *aes_ctx;
 
@@ -2186,16 +2459,13 @@ static int tegra_hv_vse_safety_aes_ecb_decrypt(struct skcipher_request *req)
 	req_ctx->op_mode = AES_ECB;
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
-	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
-		dev_err(req_ctx->se_dev->dev,
-				"%s failed with error %d\n", __func__, err);
-	return err;
+
+	return crypto_transfer_skcipher_request_to_engine(
+			g_crypto_to_ivc_map[aes_ctx->node_id].engine, req);
 }
 
 static int tegra_hv_vse_safety_aes_ctr_encrypt(struct skcipher_request *req)
 {
-	int err = 0;
 	struct tegra_virtual_se_aes_req_context *req_ctx = NULL;
 	struct tegra_virtual_se_aes_context *aes_ctx;
 
@@ -2217,16 +2487,13 @@ static int tegra_hv_vse_safety_aes_ctr_encrypt(struct skcipher_request *req)
 	req_ctx->op_mode = AES_CTR;
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
-	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
-		dev_err(req_ctx->se_dev->dev,
-				"%s failed with error %d\n", __func__, err);
-	return err;
+
+	return crypto_transfer_skcipher_request_to_engine(
+			g_crypto_to_ivc_map[aes_ctx->node_id].engine, req);
 }
 
 static int tegra_hv_vse_safety_aes_ctr_decrypt(struct skcipher_request *req)
 {
-	int err = 0;
 	struct tegra_virtual_se_aes_req_context *req_ctx = NULL;
 	struct tegra_virtual_se_aes_context *aes_ctx;
 
@@ -2241,11 +2508,9 @@ static int tegra_hv_vse_safety_aes_ctr_decrypt(struct skcipher_request *req)
 	req_ctx->op_mode = AES_CTR;
 	req_ctx->engine_id = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
 	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
-	err = tegra_hv_vse_safety_process_aes_req(req_ctx->se_dev, req);
-	if (err)
-		dev_err(req_ctx->se_dev->dev,
-				"%s failed with error %d\n", __func__, err);
-	return err;
+
+	return crypto_transfer_skcipher_request_to_engine(
+			g_crypto_to_ivc_map[aes_ctx->node_id].engine, req);
 }
 
 static int tegra_hv_vse_safety_cmac_op(struct ahash_request *req, bool is_last)
@@ -2269,7 +2534,6 @@ static int tegra_hv_vse_safety_cmac_op(struct ahash_request *req, bool is_last)
 	int err = 0;
 	int num_lists = 0;
 	struct tegra_vse_priv_data *priv = NULL;
-	struct tegra_vse_tag *priv_data_ptr;
 	unsigned int num_mapped_sgs = 0;
 
 	blocks_to_process = req->nbytes / TEGRA_VIRTUAL_SE_AES_BLOCK_SIZE;
@@ -2386,8 +2650,6 @@ static int tegra_hv_vse_safety_cmac_op(struct ahash_request *req, bool is_last)
 	memcpy(ivc_tx->aes.op_cmac_s.cmac_reg,
 		cmac_ctx->hash_result, cmac_ctx->digest_size);
 
-	priv_data_ptr = (struct tegra_vse_tag *)ivc_req_msg->ivc_hdr.tag;
-	priv_data_ptr->priv_data = (unsigned int *)priv;
 	if (is_last == true)
 		priv->cmd = VIRTUAL_CMAC_PROCESS;
 	else
@@ -2432,7 +2694,6 @@ static int tegra_hv_vse_safety_tsec_sv_op(struct ahash_request *req)
 	struct tegra_hv_ivc_cookie *pivck = g_crypto_to_ivc_map[cmac_ctx->node_id].ivck;
 	int err = 0;
 	struct tegra_vse_priv_data *priv = NULL;
-	struct tegra_vse_tag *priv_data_ptr;
 	dma_addr_t src_buf_addr;
 	void *src_buf = NULL;
 
@@ -2490,8 +2751,6 @@ static int tegra_hv_vse_safety_tsec_sv_op(struct ahash_request *req)
 				TEGRA_VIRTUAL_SE_AES_CMAC_DIGEST_SIZE);
 	}
 
-	priv_data_ptr = (struct tegra_vse_tag *)ivc_req_msg->ivc_hdr.tag;
-	priv_data_ptr->priv_data = (unsigned int *)priv;
 
 	priv->cmd = VIRTUAL_SE_PROCESS;
 	priv->se_dev = se_dev;
@@ -2576,7 +2835,6 @@ static int tegra_hv_vse_safety_cmac_sv_op(struct ahash_request *req, bool is_las
 	int err = 0;
 	int num_lists = 0;
 	struct tegra_vse_priv_data *priv = NULL;
-	struct tegra_vse_tag *priv_data_ptr;
 	unsigned int num_mapped_sgs = 0;
 
 	if ((req->nbytes == 0) || (req->nbytes > TEGRA_VIRTUAL_SE_MAX_SUPPORTED_BUFLEN)) {
@@ -2674,8 +2932,6 @@ static int tegra_hv_vse_safety_cmac_sv_op(struct ahash_request *req, bool is_las
 		cmac_ctx->is_first = false;
 	}
 
-	priv_data_ptr = (struct tegra_vse_tag *)ivc_req_msg->ivc_hdr.tag;
-	priv_data_ptr->priv_data = (unsigned int *)priv;
 	priv->cmd = VIRTUAL_SE_PROCESS;
 
 	priv->se_dev = se_dev;
@@ -2835,11 +3091,14 @@ static int tegra_hv_vse_safety_cmac_update(struct ahash_request *req)
 	/* Return error if engine is in suspended state */
 	if (atomic_read(&se_dev->se_suspended))
 		return -ENODEV;
+	/* The intermediate result lives in the tfm context */
+	mutex_lock(&cmac_ctx->lock);
 	/* Do not process data in given request */
 	if (se_dev->chipdata->cmac_hw_padding_supported)
 		ret = tegra_hv_vse_safety_cmac_sv_op(req, false);
 	else
 		ret = tegra_hv_vse_safety_cmac_op(req, false);
+	mutex_unlock(&cmac_ctx->lock);
 
 	if (ret)
 		dev_err(se_dev->dev, "tegra_se_cmac_update failed - %d\n", ret);
@@ -2895,6 +3154,7 @@ static int tegra_hv_vse_safety_cmac_finup(struct ahash_request *req)
 	/* Return error if engine is in suspended state */
 	if (atomic_read(&se_dev->se_suspended))
 		return -ENODEV;
+	mutex_lock(&cmac_ctx->lock);
 	/* Do not process data in given request */
 	if (se_dev->chipdata->cmac_hw_padding_supported)
 		ret = tegra_hv_vse_safety_cmac_sv_op(req, true);
@@ -2905,6 +3165,7 @@ static int tegra_hv_vse_safety_cmac_finup(struct ahash_request *req)
 		dev_err(se_dev->dev, "tegra_se_cmac_finup failed - %d\n", ret);
 
 	tegra_hv_vse_safety_cmac_req_deinit(req);
+	mutex_unlock(&cmac_ctx->lock);
 
 	return ret;
 }
@@ -2968,7 +3229,6 @@ int tegra_hv_vse_safety_tsec_get_keyload_status(uint32_t node_id, uint32_t *err_
 	struct tegra_hv_ivc_cookie *pivck = NULL;
 	struct tegra_virtual_se_ivc_msg_t *ivc_req_msg = NULL;
 	struct tegra_vse_priv_data *priv = NULL;
-	struct tegra_vse_tag *priv_data_ptr = NULL;
 	int err = 0;
 
 	if (node_id >= MAX_NUMBER_MISC_DEVICES)
@@ -3002,9 +3262,6 @@ int tegra_hv_vse_safety_tsec_get_keyload_status(uint32_t node_id, uint32_t *err_
 	ivc_hdr->engine = g_crypto_to_ivc_map[node_id].se_engine;
 	ivc_tx->cmd = TEGRA_VIRTUAL_TSEC_CMD_GET_KEYLOAD_STATUS;
 
-	priv_data_ptr =
-		(struct tegra_vse_tag *)ivc_req_msg->ivc_hdr.tag;
-	priv_data_ptr->priv_data = (unsigned int *)priv;
 	priv->cmd = VIRTUAL_SE_PROCESS;
 	priv->se_dev = se_dev;
 	init_completion(&priv->alg_complete);
@@ -3048,7 +3305,6 @@ static int tegra_hv_vse_safety_cmac_setkey(struct crypto_ahash *tfm, const u8 *k
 	struct tegra_hv_ivc_cookie *pivck;
 	struct tegra_virtual_se_ivc_msg_t *ivc_req_msg;
 	struct tegra_vse_priv_data *priv = NULL;
-	struct tegra_vse_tag *priv_data_ptr;
 	int err = 0;
 	s8 label[TEGRA_VIRTUAL_SE_AES_MAX_KEY_SIZE];
 	bool is_keyslot_label;
@@ -3104,9 +3360,6 @@ static int tegra_hv_vse_safety_cmac_setkey(struct crypto_ahash *tfm, const u8 *k
 		ivc_tx->cmd = TEGRA_VIRTUAL_SE_CMD_AES_CMAC_GEN_SUBKEY;
 		memcpy(ivc_tx->aes.op_cmac_subkey_s.keyslot, ctx->aes_keyslot, KEYSLOT_SIZE_BYTES);
 		ivc_tx->aes.op_cmac_subkey_s.key_length = ctx->keylen;
-		priv_data_ptr =
-			(struct tegra_vse_tag *)ivc_req_msg->ivc_hdr.tag;
-		priv_data_ptr->priv_data = (unsigned int *)priv;
 		priv->cmd = VIRTUAL_SE_PROCESS;
 		priv->se_dev = se_dev;
 		init_completion(&priv->alg_complete);
@@ -3128,6 +3381,9 @@ free_exit:
 
 static int tegra_hv_vse_safety_cmac_cra_init(struct crypto_tfm *tfm)
 {
+	struct tegra_virtual_se_aes_cmac_context *cmac_ctx = crypto_tfm_ctx(tfm);
+
+	mutex_init(&cmac_ctx->lock);
 	crypto_ahash_set_reqsize(__crypto_ahash_cast(tfm),
 			 sizeof(struct tegra_virtual_se_aes_cmac_context));
 
@@ -3185,6 +3441,7 @@ static int tegra_hv_vse_safety_rng_drbg_init(struct crypto_tfm *tfm)
 		return -ENODEV;
 
 	rng_ctx->se_dev = se_dev;
+	mutex_init(&rng_ctx->lock);
 	rng_ctx->rng_buf =
 		dma_alloc_coherent(rng_ctx->se_dev->dev,
 				TEGRA_VIRTUAL_SE_RNG_DT_SIZE,
@@ -3220,7 +3477,6 @@ static int tegra_hv_vse_safety_get_random(struct tegra_virtual_se_rng_context *r
 	struct tegra_virtual_se_ivc_msg_t *ivc_req_msg;
 	struct tegra_virtual_se_ivc_hdr_t *ivc_hdr = NULL;
 	struct tegra_vse_priv_data *priv = NULL;
-	struct tegra_vse_tag *priv_data_ptr;
 
 	if (dlen == 0) {
 		return -EINVAL;
@@ -3252,13 +3508,13 @@ static int tegra_hv_vse_safety_get_random(struct tegra_virtual_se_rng_context *r
 	ivc_hdr->header_magic[2] = 'D';
 	ivc_hdr->header_magic[3] = 'A';
 	ivc_hdr->engine = g_crypto_to_ivc_map[rng_ctx->node_id].se_engine;
-	priv_data_ptr = (struct tegra_vse_tag *)ivc_hdr->tag;
-	priv_data_ptr->priv_data = (unsigned int *)priv;
 	priv->cmd = VIRTUAL_SE_PROCESS;
 	priv->se_dev = se_dev;
 
 	ivc_tx->cmd = TEGRA_VIRTUAL_SE_CMD_AES_RNG_DBRG;
 
+	/* rng_buf is shared by all users of the context */
+	mutex_lock(&rng_ctx->lock);
 	for (j = 0; j <= num_blocks; j++) {
 		ivc_tx->aes.op_rng.dst_addr.lo = rng_ctx->rng_buf_adr & 0xFFFFFFFF;
 		ivc_tx->aes.op_rng.dst_addr.hi = (rng_ctx->rng_buf_adr >> 32)
@@ -3284,6 +3540,7 @@ static int tegra_hv_vse_safety_get_random(struct tegra_virtual_se_rng_context *r
 		}
 	}
 exit:
+	mutex_unlock(&rng_ctx->lock);
 	devm_kfree(se_dev->dev, priv);
 	devm_kfree(se_dev->dev, ivc_req_msg);
 	return dlen;
@@ -3353,8 +3610,19 @@ static int tegra_vse_aes_gcm_setauthsize(struct crypto_aead *tfm,
 	return 0;
 }
 
+static int tegra_vse_aes_gcm_do_one_req(struct crypto_engine *engine, void *areq);
+
 static int tegra_vse_aes_gcm_init(struct crypto_aead *tfm)
 {
+#ifndef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+	struct tegra_virtual_se_aes_context *aes_ctx = crypto_aead_ctx(tfm);
+
+	aes_ctx->enginectx.op.prepare_request = NULL;
+	aes_ctx->enginectx.op.unprepare_request = NULL;
+	aes_ctx->enginectx.op.do_one_request = tegra_vse_aes_gcm_do_one_req;
+#endif
+	crypto_aead_set_reqsize(tfm, sizeof(struct tegra_virtual_se_aes_req_context));
+
 	return 0;
 }
 
@@ -3427,7 +3695,6 @@ static int tegra_vse_aes_gcm_enc_dec(struct aead_request *req, bool encrypt)
 	struct tegra_virtual_se_ivc_tx_msg_t *ivc_tx;
 	struct tegra_hv_ivc_cookie *pivck = g_crypto_to_ivc_map[aes_ctx->node_id].ivck;
 	struct tegra_vse_priv_data *priv = NULL;
-	struct tegra_vse_tag *priv_data_ptr;
 	int err = 0;
 	uint32_t cryptlen = 0;
 	uint32_t buflen = 0;
@@ -3524,8 +3791,6 @@ static int tegra_vse_aes_gcm_enc_dec(struct aead_request *req, bool encrypt)
 	ivc_hdr->header_magic[2] = 'D';
 	ivc_hdr->header_magic[3] = 'A';
 	ivc_hdr->engine = g_crypto_to_ivc_map[aes_ctx->node_id].se_engine;
-	priv_data_ptr = (struct tegra_vse_tag *)ivc_hdr->tag;
-	priv_data_ptr->priv_data = (unsigned int *)priv;
 
 	priv->se_dev = se_dev;
 
@@ -3679,12 +3944,29 @@ free_exit:
 	return err;
 }
 
+static int tegra_vse_aes_gcm_do_one_req(struct crypto_engine *engine, void *areq)
+{
+	struct aead_request *req = container_of(areq, struct aead_request, base);
+	struct tegra_virtual_se_aes_req_context *req_ctx = aead_request_ctx(req);
+	int err;
+
+	err = tegra_vse_aes_gcm_enc_dec(req, req_ctx->encrypt);
+	if (err)
+		dev_err(req_ctx->se_dev->dev, "%s failed %d\n", __func__, err);
+
+	/* Completion callbacks expect bottom halves to be disabled */
+	local_bh_disable();
+	crypto_finalize_aead_request(engine, req, err);
+	local_bh_enable();
+
+	return 0;
+}
+
 static int tegra_vse_aes_gcm_encrypt(struct aead_request *req)
 {
 	struct crypto_aead *tfm;
 	struct tegra_virtual_se_aes_context *aes_ctx;
-	struct tegra_virtual_se_dev *se_dev;
-	int err = 0;
+	struct tegra_virtual_se_aes_req_context *req_ctx;
 
 	if (!req) {
 		pr_err("%s: req is invalid\n", __func__);
@@ -3693,7 +3975,6 @@ static int tegra_vse_aes_gcm_encrypt(struct aead_request *req)
 
 	tfm = crypto_aead_reqtfm(req);
 	aes_ctx = crypto_aead_ctx(tfm);
-	se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
 
 	if (unlikely(!req->iv)) {
 		/* If IV is not set we cannot determine whether
@@ -3703,17 +3984,19 @@ static int tegra_vse_aes_gcm_encrypt(struct aead_request *req)
 		return -EINVAL;
 	}
 
-	err = tegra_vse_aes_gcm_enc_dec(req, true);
-	if (err)
-		dev_err(se_dev->dev, "%s failed %d\n", __func__, err);
+	req_ctx = aead_request_ctx(req);
+	req_ctx->encrypt = true;
+	req_ctx->se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
 
-	return err;
+	return crypto_transfer_aead_request_to_engine(
+			g_crypto_to_ivc_map[aes_ctx->node_id].engine, req);
 }
 
 static int tegra_vse_aes_gcm_decrypt(struct aead_request *req)
 {
 	struct crypto_aead *tfm;
 	struct tegra_virtual_se_aes_context *aes_ctx;
+	struct tegra_virtual_se_aes_req_context *req_ctx;
 	struct tegra_virtual_se_dev *se_dev;
 	int err = 0;
 
@@ -3727,9 +4010,11 @@ static int tegra_vse_aes_gcm_decrypt(struct aead_request *req)
 	se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[aes_ctx->node_id].se_engine];
 
 	if (g_crypto_to_ivc_map[aes_ctx->node_id].gcm_dec_supported == GCM_DEC_OP_SUPPORTED) {
-		err = tegra_vse_aes_gcm_enc_dec(req, false);
-		if (err)
-			dev_err(se_dev->dev, "%s failed %d\n", __func__, err);
+		req_ctx = aead_request_ctx(req);
+		req_ctx->encrypt = false;
+		req_ctx->se_dev = se_dev;
+		err = crypto_transfer_aead_request_to_engine(
+				g_crypto_to_ivc_map[aes_ctx->node_id].engine, req);
 	} else {
 		err = -EACCES;
 		dev_err(se_dev->dev, "%s failed for node_id %u\n", __func__, aes_ctx->node_id);
@@ -3802,7 +4087,6 @@ static int tegra_hv_vse_aes_gmac_sv_init(struct ahash_request *req)
 	struct tegra_virtual_se_ivc_hdr_t *ivc_hdr = NULL;
 	struct tegra_virtual_se_ivc_tx_msg_t *ivc_tx = NULL;
 	struct tegra_hv_ivc_cookie *pivck;
-	struct tegra_vse_tag *priv_data_ptr = NULL;
 	struct tegra_vse_priv_data *priv = NULL;
 	int err = 0;
 
@@ -3873,8 +4157,6 @@ static int tegra_hv_vse_aes_gmac_sv_init(struct ahash_request *req)
 	ivc_hdr->header_magic[2] = 'D';
 	ivc_hdr->header_magic[3] = 'A';
 	ivc_hdr->engine = g_crypto_to_ivc_map[gmac_ctx->node_id].se_engine;
-	priv_data_ptr = (struct tegra_vse_tag *)ivc_hdr->tag;
-	priv_data_ptr->priv_data = (unsigned int *)priv;
 	priv->cmd = VIRTUAL_SE_PROCESS;
 	priv->se_dev = se_dev;
 
@@ -3966,7 +4248,6 @@ static int tegra_hv_vse_aes_gmac_sv_op(struct ahash_request *req, bool is_last)
 	struct tegra_virtual_se_ivc_tx_msg_t *ivc_tx;
 	struct tegra_hv_ivc_cookie *pivck;
 	struct tegra_vse_priv_data *priv = NULL;
-	struct tegra_vse_tag *priv_data_ptr;
 	void *aad_buf = NULL;
 	void *tag_buf = NULL;
 	dma_addr_t aad_buf_addr;
@@ -4029,8 +4310,6 @@ static int tegra_hv_vse_aes_gmac_sv_op(struct ahash_request *req, bool is_last)
 	ivc_hdr->header_magic[3] = 'A';
 	ivc_hdr->engine = g_crypto_to_ivc_map[gmac_ctx->node_id].se_engine;
 
-	priv_data_ptr = (struct tegra_vse_tag *)ivc_hdr->tag;
-	priv_data_ptr->priv_data = (unsigned int *)priv;
 	priv->cmd = VIRTUAL_SE_PROCESS;
 	priv->se_dev = se_dev;
 
@@ -4223,8 +4502,15 @@ static struct rng_alg rng_alg = {
 	}
 };
 
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+static struct aead_engine_alg aead_algs[] = {
+#else
 static struct aead_alg aead_algs[] = {
+#endif
 	{
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.setkey		= tegra_vse_aes_gcm_setkey,
 		.setauthsize	= tegra_vse_aes_gcm_setauthsize,
 		.encrypt	= tegra_vse_aes_gcm_encrypt,
@@ -4238,15 +4524,27 @@ static struct aead_alg aead_algs[] = {
 			.cra_name	= "gcm-vse(aes)",
 			.cra_driver_name = "gcm-aes-tegra-safety",
 			.cra_priority	= 1000,
+			.cra_flags	= CRYPTO_ALG_ASYNC,
 			.cra_blocksize	= TEGRA_VIRTUAL_SE_AES_BLOCK_SIZE,
 			.cra_ctxsize	= HV_SAFETY_AES_CTX_SIZE,
 			.cra_module	= THIS_MODULE,
 		}
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_vse_aes_gcm_do_one_req,
+#endif
 	}
 };
 
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+static struct skcipher_engine_alg aes_algs[] = {
+#else
 static struct skcipher_alg aes_algs[] = {
+#endif
 	{
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.base.cra_name		= "cbc-vse(aes)",
 		.base.cra_driver_name	= "cbc-aes-tegra",
 		.base.cra_priority	= 400,
@@ -4264,8 +4562,15 @@ static struct skcipher_alg aes_algs[] = {
 		.min_keysize		= TEGRA_VIRTUAL_SE_AES_MIN_KEY_SIZE,
 		.max_keysize		= TEGRA_VIRTUAL_SE_AES_MAX_KEY_SIZE,
 		.ivsize			= TEGRA_VIRTUAL_SE_AES_IV_SIZE,
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_aes_do_one_req,
+#endif
 	},
 	{
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.base.cra_name		= "ecb-vse(aes)",
 		.base.cra_driver_name	= "ecb-aes-tegra",
 		.base.cra_priority	= 400,
@@ -4283,8 +4588,15 @@ static struct skcipher_alg aes_algs[] = {
 		.min_keysize		= TEGRA_VIRTUAL_SE_AES_MIN_KEY_SIZE,
 		.max_keysize		= TEGRA_VIRTUAL_SE_AES_MAX_KEY_SIZE,
 		.ivsize			= TEGRA_VIRTUAL_SE_AES_IV_SIZE,
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_aes_do_one_req,
+#endif
 	},
 	{
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.base.cra_name		= "ctr-vse(aes)",
 		.base.cra_driver_name	= "ctr-aes-tegra-safety",
 		.base.cra_priority	= 400,
@@ -4302,6 +4614,10 @@ static struct skcipher_alg aes_algs[] = {
 		.min_keysize		= TEGRA_VIRTUAL_SE_AES_MIN_KEY_SIZE,
 		.max_keysize		= TEGRA_VIRTUAL_SE_AES_MAX_KEY_SIZE,
 		.ivsize			= TEGRA_VIRTUAL_SE_AES_IV_SIZE,
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_aes_do_one_req,
+#endif
 	},
 };
 
@@ -4373,8 +4689,15 @@ static struct ahash_alg gmac_alg = {
 	}
 };
 
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+static struct ahash_engine_alg sha_algs[] = {
+#else
 static struct ahash_alg sha_algs[] = {
+#endif
 	{
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.init = tegra_hv_vse_safety_sha_init,
 		.update = tegra_hv_vse_safety_sha_update,
 		.final = tegra_hv_vse_safety_sha_final,
@@ -4388,7 +4711,7 @@ static struct ahash_alg sha_algs[] = {
 			.cra_name = "sha1-vse",
 			.cra_driver_name = "tegra-hv-vse-sha1",
 			.cra_priority = 300,
-			.cra_flags = CRYPTO_ALG_TYPE_AHASH,
+			.cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
 			.cra_blocksize = SHA1_BLOCK_SIZE,
 			.cra_ctxsize =
 				sizeof(struct tegra_virtual_se_sha_context),
@@ -4397,7 +4720,14 @@ static struct ahash_alg sha_algs[] = {
 			.cra_init = tegra_hv_vse_safety_sha_cra_init,
 			.cra_exit = tegra_hv_vse_safety_sha_cra_exit,
 		}
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_sha_do_one_req,
+#endif
 	}, {
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.init = tegra_hv_vse_safety_sha_init,
 		.update = tegra_hv_vse_safety_sha_update,
 		.final = tegra_hv_vse_safety_sha_final,
@@ -4411,7 +4741,7 @@ static struct ahash_alg sha_algs[] = {
 			.cra_name = "sha224-vse",
 			.cra_driver_name = "tegra-hv-vse-sha224",
 			.cra_priority = 300,
-			.cra_flags = CRYPTO_ALG_TYPE_AHASH,
+			.cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
 			.cra_blocksize = SHA224_BLOCK_SIZE,
 			.cra_ctxsize =
 				sizeof(struct tegra_virtual_se_sha_context),
@@ -4420,7 +4750,14 @@ static struct ahash_alg sha_algs[] = {
 			.cra_init = tegra_hv_vse_safety_sha_cra_init,
 			.cra_exit = tegra_hv_vse_safety_sha_cra_exit,
 		}
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_sha_do_one_req,
+#endif
 	}, {
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.init = tegra_hv_vse_safety_sha_init,
 		.update = tegra_hv_vse_safety_sha_update,
 		.final = tegra_hv_vse_safety_sha_final,
@@ -4434,7 +4771,7 @@ static struct ahash_alg sha_algs[] = {
 			.cra_name = "sha256-vse",
 			.cra_driver_name = "tegra-hv-vse-safety-sha256",
 			.cra_priority = 300,
-			.cra_flags = CRYPTO_ALG_TYPE_AHASH,
+			.cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
 			.cra_blocksize = SHA256_BLOCK_SIZE,
 			.cra_ctxsize =
 				sizeof(struct tegra_virtual_se_sha_context),
@@ -4443,7 +4780,14 @@ static struct ahash_alg sha_algs[] = {
 			.cra_init = tegra_hv_vse_safety_sha_cra_init,
 			.cra_exit = tegra_hv_vse_safety_sha_cra_exit,
 		}
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_sha_do_one_req,
+#endif
 	}, {
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.init = tegra_hv_vse_safety_sha_init,
 		.update = tegra_hv_vse_safety_sha_update,
 		.final = tegra_hv_vse_safety_sha_final,
@@ -4457,7 +4801,7 @@ static struct ahash_alg sha_algs[] = {
 			.cra_name = "sha384-vse",
 			.cra_driver_name = "tegra-hv-vse-safety-sha384",
 			.cra_priority = 300,
-			.cra_flags = CRYPTO_ALG_TYPE_AHASH,
+			.cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
 			.cra_blocksize = SHA384_BLOCK_SIZE,
 			.cra_ctxsize =
 				sizeof(struct tegra_virtual_se_sha_context),
@@ -4466,7 +4810,14 @@ static struct ahash_alg sha_algs[] = {
 			.cra_init = tegra_hv_vse_safety_sha_cra_init,
 			.cra_exit = tegra_hv_vse_safety_sha_cra_exit,
 		}
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_sha_do_one_req,
+#endif
 	}, {
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.init = tegra_hv_vse_safety_sha_init,
 		.update = tegra_hv_vse_safety_sha_update,
 		.final = tegra_hv_vse_safety_sha_final,
@@ -4480,7 +4831,7 @@ static struct ahash_alg sha_algs[] = {
 			.cra_name = "sha512-vse",
 			.cra_driver_name = "tegra-hv-vse-safety-sha512",
 			.cra_priority = 300,
-			.cra_flags = CRYPTO_ALG_TYPE_AHASH,
+			.cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
 			.cra_blocksize = SHA512_BLOCK_SIZE,
 			.cra_ctxsize =
 				sizeof(struct tegra_virtual_se_sha_context),
@@ -4489,7 +4840,14 @@ static struct ahash_alg sha_algs[] = {
 			.cra_init = tegra_hv_vse_safety_sha_cra_init,
 			.cra_exit = tegra_hv_vse_safety_sha_cra_exit,
 		}
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_sha_do_one_req,
+#endif
 	}, {
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.init = tegra_hv_vse_safety_sha_init,
 		.update = tegra_hv_vse_safety_sha_update,
 		.final = tegra_hv_vse_safety_sha_final,
@@ -4503,7 +4861,7 @@ static struct ahash_alg sha_algs[] = {
 			.cra_name = "sha3-256-vse",
 			.cra_driver_name = "tegra-hv-vse-safety-sha3-256",
 			.cra_priority = 300,
-			.cra_flags = CRYPTO_ALG_TYPE_AHASH,
+			.cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
 			.cra_blocksize = SHA3_256_BLOCK_SIZE,
 			.cra_ctxsize =
 				sizeof(struct tegra_virtual_se_sha_context),
@@ -4512,7 +4870,14 @@ static struct ahash_alg sha_algs[] = {
 			.cra_init = tegra_hv_vse_safety_sha_cra_init,
 			.cra_exit = tegra_hv_vse_safety_sha_cra_exit,
 		}
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_sha_do_one_req,
+#endif
 	}, {
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.init = tegra_hv_vse_safety_sha_init,
 		.update = tegra_hv_vse_safety_sha_update,
 		.final = tegra_hv_vse_safety_sha_final,
@@ -4526,7 +4891,7 @@ static struct ahash_alg sha_algs[] = {
 			.cra_name = "sha3-384-vse",
 			.cra_driver_name = "tegra-hv-vse-safety-sha3-384",
 			.cra_priority = 300,
-			.cra_flags = CRYPTO_ALG_TYPE_AHASH,
+			.cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
 			.cra_blocksize = SHA3_384_BLOCK_SIZE,
 			.cra_ctxsize =
 				sizeof(struct tegra_virtual_se_sha_context),
@@ -4535,7 +4900,14 @@ static struct ahash_alg sha_algs[] = {
 			.cra_init = tegra_hv_vse_safety_sha_cra_init,
 			.cra_exit = tegra_hv_vse_safety_sha_cra_exit,
 		}
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_sha_do_one_req,
+#endif
 	}, {
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.init = tegra_hv_vse_safety_sha_init,
 		.update = tegra_hv_vse_safety_sha_update,
 		.final = tegra_hv_vse_safety_sha_final,
@@ -4549,7 +4921,7 @@ static struct ahash_alg sha_algs[] = {
 			.cra_name = "sha3-512-vse",
 			.cra_driver_name = "tegra-hv-vse-safety-sha3-512",
 			.cra_priority = 300,
-			.cra_flags = CRYPTO_ALG_TYPE_AHASH,
+			.cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
 			.cra_blocksize = SHA3_512_BLOCK_SIZE,
 			.cra_ctxsize =
 				sizeof(struct tegra_virtual_se_sha_context),
@@ -4558,7 +4930,14 @@ static struct ahash_alg sha_algs[] = {
 			.cra_init = tegra_hv_vse_safety_sha_cra_init,
 			.cra_exit = tegra_hv_vse_safety_sha_cra_exit,
 		}
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_sha_do_one_req,
+#endif
 	}, {
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.init = tegra_hv_vse_safety_sha_init,
 		.update = tegra_hv_vse_safety_sha_update,
 		.final = tegra_hv_vse_safety_sha_final,
@@ -4572,7 +4951,7 @@ static struct ahash_alg sha_algs[] = {
 			.cra_name = "shake128-vse",
 			.cra_driver_name = "tegra-hv-vse-safety-shake128",
 			.cra_priority = 300,
-			.cra_flags = CRYPTO_ALG_TYPE_AHASH,
+			.cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
 			.cra_blocksize = SHA3_512_BLOCK_SIZE,
 			.cra_ctxsize =
 				sizeof(struct tegra_virtual_se_sha_context),
@@ -4581,7 +4960,14 @@ static struct ahash_alg sha_algs[] = {
 			.cra_init = tegra_hv_vse_safety_sha_cra_init,
 			.cra_exit = tegra_hv_vse_safety_sha_cra_exit,
 		}
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_sha_do_one_req,
+#endif
 	}, {
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		.base = {
+#endif
 		.init = tegra_hv_vse_safety_sha_init,
 		.update = tegra_hv_vse_safety_sha_update,
 		.final = tegra_hv_vse_safety_sha_final,
@@ -4595,7 +4981,7 @@ static struct ahash_alg sha_algs[] = {
 			.cra_name = "shake256-vse",
 			.cra_driver_name = "tegra-hv-vse-safety-shake256",
 			.cra_priority = 300,
-			.cra_flags = CRYPTO_ALG_TYPE_AHASH,
+			.cra_flags = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
 			.cra_blocksize = SHA3_512_BLOCK_SIZE,
 			.cra_ctxsize =
 				sizeof(struct tegra_virtual_se_sha_context),
@@ -4604,6 +4990,10 @@ static struct ahash_alg sha_algs[] = {
 			.cra_init = tegra_hv_vse_safety_sha_cra_init,
 			.cra_exit = tegra_hv_vse_safety_sha_cra_exit,
 		}
+#ifdef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+		},
+		.op.do_one_request = tegra_hv_vse_safety_sha_do_one_req,
+#endif
 	},
 };
 
@@ -4639,20 +5029,12 @@ static int tegra_vse_kthread(void *data)
 	uint32_t node_id = *((uint32_t *)data);
 	struct tegra_virtual_se_dev *se_dev = NULL;
 	struct tegra_hv_ivc_cookie *pivck = g_crypto_to_ivc_map[node_id].ivck;
-	struct tegra_virtual_se_ivc_msg_t *ivc_msg;
 	int err = 0;
 	int timeout;
 	int ret;
-	bool is_dummy = false;
-	size_t size_ivc_msg = sizeof(struct tegra_virtual_se_ivc_msg_t);
-	enum ivc_irq_state *irq_state, local_irq_state;
 
 	se_dev = g_virtual_se_dev[g_crypto_to_ivc_map[node_id].se_engine];
 
-	ivc_msg = devm_kzalloc(se_dev->dev, size_ivc_msg, GFP_KERNEL);
-	if (!ivc_msg)
-		return -ENOMEM;
-
 	while (!kthread_should_stop()) {
 		err = 0;
 		ret = wait_for_completion_interruptible(
@@ -4686,59 +5068,11 @@ static int tegra_vse_kthread(void *data)
 			continue;
 		}
 
-		mutex_lock(&(se_dev->crypto_to_ivc_map[node_id].irq_state_lock));
-		irq_state = &(se_dev->crypto_to_ivc_map[node_id].wait_interrupt);
-		local_irq_state = *irq_state;
-		mutex_unlock(&(se_dev->crypto_to_ivc_map[node_id].irq_state_lock));
-		while (tegra_hv_ivc_can_read(pivck) && local_irq_state != NO_INTERRUPT) {
-			pr_debug("%s(): wait_interrupt = %u", __func__, local_irq_state);
-			if (local_irq_state == INTERMEDIATE_REQ_INTERRUPT) {
-				err = read_and_validate_valid_msg(se_dev, pivck, node_id,
-					&is_dummy, true);
-				if (err != 0) {
-					dev_err(se_dev->dev,
-						"%s(): Unable to read validate message",
-						__func__);
-				}
-				mutex_lock(&(se_dev->crypto_to_ivc_map[node_id].irq_state_lock));
-				*irq_state = NO_INTERRUPT;
-				local_irq_state = *irq_state;
-				mutex_unlock(&(se_dev->crypto_to_ivc_map[node_id].irq_state_lock));
-				pr_debug("%s():%d wait_interrupt = %u\n",
-						__func__, __LINE__, local_irq_state);
-				break;
-
-			} else if (local_irq_state == FIRST_REQ_INTERRUPT) {
-				err = read_and_validate_dummy_msg(se_dev, pivck, node_id,
-					&is_dummy);
-				if (err != 0) {
-					dev_err(se_dev->dev, "%s:%d Invalid response header\n",
-						__func__, __LINE__);
-					err = 0;
-					continue;
-				}
-				if (is_dummy == true) {
-					mutex_lock(
-					    &(se_dev->crypto_to_ivc_map[node_id].irq_state_lock));
-					*irq_state = INTERMEDIATE_REQ_INTERRUPT;
-					local_irq_state = *irq_state;
-					mutex_unlock(
-					    &(se_dev->crypto_to_ivc_map[node_id].irq_state_lock));
-					pr_debug("%s():%d Dummy message read. Read valid message.",
-						__func__, __LINE__);
-					continue;
-				} else {
-					dev_err(se_dev->dev, "Invalid response sequence");
-					break;
-				}
-			} else {
-				dev_err(se_dev->dev, "Invalid irq state - %u", local_irq_state);
-				return -EINVAL;
-			}
-		}
+		mutex_lock(&g_crypto_to_ivc_map[node_id].se_ivc_lock);
+		tegra_vse_read_responses(se_dev, pivck, node_id);
+		mutex_unlock(&g_crypto_to_ivc_map[node_id].se_ivc_lock);
 	}
 
-	devm_kfree(se_dev->dev, ivc_msg);
 	return 0;
 }
 
@@ -4775,6 +5109,7 @@ static int tegra_hv_vse_safety_register_hwrng(struct tegra_virtual_se_dev *se_de
 	}
 
 	rng_ctx->se_dev = se_dev;
+	mutex_init(&rng_ctx->lock);
 	rng_ctx->rng_buf =
 		dma_alloc_coherent(se_dev->dev, TEGRA_VIRTUAL_SE_RNG_DT_SIZE,
 			&rng_ctx->rng_buf_adr, GFP_KERNEL);
@@ -5019,7 +5354,27 @@ static int tegra_hv_vse_safety_probe(struct platform_device *pdev)
 		tegra_hv_ivc_channel_reset(crypto_dev->ivck);
 		init_completion(&crypto_dev->tegra_vse_complete);
 		mutex_init(&crypto_dev->se_ivc_lock);
-		mutex_init(&crypto_dev->irq_state_lock);
+		spin_lock_init(&crypto_dev->inflight_lock);
+		init_waitqueue_head(&crypto_dev->inflight_wq);
+
+		/* Let requests queue up behind the ones in flight */
+		crypto_dev->engine = crypto_engine_alloc_init_and_set(se_dev->dev, true,
+						NULL, false, TEGRA_HV_VSE_ENGINE_QLEN);
+		if (!crypto_dev->engine) {
+			dev_err(se_dev->dev,
+				"Couldn't create crypto engine for node id %u\n", node_id);
+			err = -ENOMEM;
+			goto exit;
+		}
+
+		err = crypto_engine_start(crypto_dev->engine);
+		if (err) {
+			dev_err(se_dev->dev,
+				"Couldn't start crypto engine for node id %u\n", node_id);
+			crypto_engine_exit(crypto_dev->engine);
+			crypto_dev->engine = NULL;
+			goto exit;
+		}
 
 		crypto_dev->tegra_vse_task = kthread_run(tegra_vse_kthread, &crypto_dev->node_id,
 								"tegra_vse_kthread-%u", node_id);
@@ -5037,7 +5392,6 @@ static int tegra_hv_vse_safety_probe(struct platform_device *pdev)
 			err = -EINVAL;
 			goto exit;
 		}
-		crypto_dev->wait_interrupt = FIRST_REQ_INTERRUPT;
 	}
 
 	if (pdev->dev.of_node) {
@@ -5088,7 +5442,7 @@ static int tegra_hv_vse_safety_probe(struct platform_device *pdev)
 
 	if (engine_id == VIRTUAL_SE_AES1) {
 
-		err = crypto_register_skciphers(aes_algs, ARRAY_SIZE(aes_algs));
+		err = CRYPTO_REGISTER(skciphers, aes_algs, ARRAY_SIZE(aes_algs));
 		if (err) {
 			dev_err(&pdev->dev, "aes alg register failed: %d\n",
 				err);
@@ -5097,7 +5451,7 @@ static int tegra_hv_vse_safety_probe(struct platform_device *pdev)
 
 
 		if (se_dev->chipdata->gcm_decrypt_supported) {
-			err = crypto_register_aeads(aead_algs, ARRAY_SIZE(aead_algs));
+			err = CRYPTO_REGISTER(aeads, aead_algs, ARRAY_SIZE(aead_algs));
 			if (err) {
 				dev_err(&pdev->dev, "aead alg register failed: %d\n",
 					err);
@@ -5108,7 +5462,7 @@ static int tegra_hv_vse_safety_probe(struct platform_device *pdev)
 
 	if (engine_id == VIRTUAL_SE_SHA) {
 		for (i = 0; i < ARRAY_SIZE(sha_algs); i++) {
-			err = crypto_register_ahash(&sha_algs[i]);
+			err = CRYPTO_REGISTER(ahash, &sha_algs[i]);
 			if (err) {
 				dev_err(&pdev->dev,
 					"sha alg register failed idx[%d]\n", i);
@@ -5155,22 +5509,46 @@ static void tegra_hv_vse_safety_shutdown(struct platform_device *pdev)
 	for (cnt = 0; cnt < MAX_NUMBER_MISC_DEVICES; cnt++) {
 		if (g_crypto_to_ivc_map[cnt].se_engine == se_dev->engine_id
 				&& g_crypto_to_ivc_map[cnt].ivck != NULL) {
-			/* Wait for  SE server to be free*/
-			while (mutex_is_locked(&g_crypto_to_ivc_map[cnt].se_ivc_lock)
-				|| mutex_is_locked(&g_crypto_to_ivc_map[cnt].irq_state_lock))
-				usleep_range(8, 10);
+			/* Wait for requests in flight on the node to complete */
+			if (!wait_event_timeout(g_crypto_to_ivc_map[cnt].inflight_wq,
+					tegra_vse_inflight_idle(&g_crypto_to_ivc_map[cnt]),
+					TEGRA_HV_VSE_TIMEOUT))
+				dev_err(se_dev->dev, "node %u: requests still in flight\n", cnt);
 		}
 	}
 }
 
 static int tegra_hv_vse_safety_remove(struct platform_device *pdev)
 {
+	struct tegra_virtual_se_dev *se_dev = platform_get_drvdata(pdev);
+	uint32_t cnt;
 	int i;
 
-	tegra_hv_vse_safety_unregister_hwrng(platform_get_drvdata(pdev));
+	/* The "nvidia,gcm-dma-support" node only provides the gpcdma device */
+	if (!se_dev)
+		return 0;
+
+	tegra_hv_vse_safety_unregister_hwrng(se_dev);
+
+	if (se_dev->engine_id == VIRTUAL_SE_AES1) {
+		CRYPTO_UNREGISTER(skciphers, aes_algs, ARRAY_SIZE(aes_algs));
+		if (se_dev->chipdata->gcm_decrypt_supported)
+			CRYPTO_UNREGISTER(aeads, aead_algs, ARRAY_SIZE(aead_algs));
+	}
 
-	for (i = 0; i < ARRAY_SIZE(sha_algs); i++)
-		crypto_unregister_ahash(&sha_algs[i]);
+	if (se_dev->engine_id == VIRTUAL_SE_SHA) {
+		for (i = 0; i < ARRAY_SIZE(sha_algs); i++)
+			CRYPTO_UNREGISTER(ahash, &sha_algs[i]);
+	}
+
+	/* No new requests can be queued once the algorithms are gone */
+	for (cnt = 0; cnt < MAX_NUMBER_MISC_DEVICES; cnt++) {
+		if (g_crypto_to_ivc_map[cnt].se_engine == se_dev->engine_id
+				&& g_crypto_to_ivc_map[cnt].engine != NULL) {
+			crypto_engine_exit(g_crypto_to_ivc_map[cnt].engine);
+			g_crypto_to_ivc_map[cnt].engine = NULL;
+		}
+	}
 
 	return 0;
 }
@@ -6,9 +6,16 @@
 #ifndef __TEGRA_HV_VSE_H
 #define __TEGRA_HV_VSE_H
 
+#include <crypto/engine.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
 #define KEYSLOT_SIZE_BYTES		16
 #define KEYSLOT_OFFSET_BYTES		8
 
+/* Requests that can be outstanding on one IVC node */
+#define TEGRA_VSE_MAX_INFLIGHT		32U
+
 struct tegra_vse_soc_info {
 	bool cmac_hw_padding_supported;
 	bool gcm_decrypt_supported;
@@ -20,10 +27,12 @@ enum tegra_gcm_dec_supported {
 	GCM_DEC_OP_SUPPORTED,
 };
 
-enum ivc_irq_state {
-	NO_INTERRUPT = 0U,
-	FIRST_REQ_INTERRUPT = 1U,
-	INTERMEDIATE_REQ_INTERRUPT = 2u,
+struct tegra_vse_priv_data;
+
+/* In-flight table entry, the IVC tag carries the slot index and generation */
+struct tegra_vse_inflight_slot {
+	struct tegra_vse_priv_data *priv;
+	uint32_t gen;
 };
 
 struct crypto_dev_to_ivc_map {
@@ -40,13 +49,13 @@ struct crypto_dev_to_ivc_map {
 	struct task_struct *tegra_vse_task;
 	bool vse_thread_start;
 	struct mutex se_ivc_lock;
-	/*Wait for interrupt
-	 * 0: No need to wait for interrupt
-	 * 1: First request, wait for interrupt
-	 * 2: awaiting actual message, wait for interrupt
-	 */
-	enum ivc_irq_state wait_interrupt;
-	struct mutex irq_state_lock;
+	/* Requests sent on this node and not yet completed */
+	spinlock_t inflight_lock;
+	struct tegra_vse_inflight_slot inflight[TEGRA_VSE_MAX_INFLIGHT];
+	uint32_t inflight_cnt;
+	wait_queue_head_t inflight_wq;
+	/* Queues skcipher, aead and SHA requests for this node */
+	struct crypto_engine *engine;
 };
 
 struct tegra_virtual_se_dev {
@@ -74,10 +83,15 @@ struct tegra_virtual_se_rng_context {
 	dma_addr_t rng_buf_adr;
 	/*Crypto dev instance*/
 	uint32_t node_id;
+	/* Serializes users of rng_buf */
+	struct mutex lock;
 };
 
 /* Security Engine AES context */
 struct tegra_virtual_se_aes_context {
+#ifndef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+	struct crypto_engine_ctx enginectx;
+#endif
 	/* Security Engine device */
 	struct tegra_virtual_se_dev *se_dev;
 	struct skcipher_request *req;
@@ -112,6 +126,8 @@ struct tegra_virtual_se_aes_cmac_context {
 	bool is_key_slot_allocated;
 	/*Crypto dev instance*/
 	uint32_t node_id;
+	/* Serializes users of hash_result */
+	struct mutex lock;
 };
 
 /* Security Engine AES GMAC context */
@@ -130,6 +146,9 @@ struct tegra_virtual_se_aes_gmac_context {
 
 /* Security Engine SHA context */
 struct tegra_virtual_se_sha_context {
+#ifndef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
+	struct crypto_engine_ctx enginectx;
+#endif
 	/* Security Engine device */
 	struct tegra_virtual_se_dev *se_dev;
 	/* SHA operation mode */
@@ -159,6 +178,7 @@ struct tegra_virtual_se_req_context {
 	bool force_align;		/* Enforce buffer alignment */
 	/*Crypto dev instance*/
 	uint32_t node_id;
+	u8 engine_op;			/* Operation queued to the engine */
 };
 
 /* API to get ivc db from hv_vse driver */
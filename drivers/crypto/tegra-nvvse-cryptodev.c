@@ -5,6 +5,8 @@
  * Tegra NVVSE crypto device for crypto operation to NVVSE linux library.
  *
  */
+#include <nvidia/conftest.h>
+
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/errno.h>
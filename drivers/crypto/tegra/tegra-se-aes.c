@@ -24,6 +24,10 @@
 
 #include "tegra-se.h"
 
+static bool zero_copy = true;
+module_param(zero_copy, bool, 0644);
+MODULE_PARM_DESC(zero_copy, "Map AES source and destination buffers directly when possible");
+
 struct tegra_aes_ctx {
 #ifndef NV_CONFTEST_REMOVE_STRUCT_CRYPTO_ENGINE_CTX
 	struct crypto_engine_ctx enginectx;
@@ -36,12 +40,20 @@ struct tegra_aes_ctx {
 };
 
 struct tegra_aes_reqctx {
+	struct tegra_se_req sreq;
+	struct skcipher_request *req;
 	struct tegra_se_datbuf datbuf;
+	dma_addr_t src_addr;
+	dma_addr_t dst_addr;
+	int src_nents;
+	int dst_nents;
+	bool direct;
 	bool encrypt;
 	u32 config;
 	u32 crypto_config;
 	u32 len;
 	u32 *iv;
+	u8 last_blk[AES_BLOCK_SIZE];
 	u32 *cmdbuf;
 };
 
@@ -117,9 +129,9 @@ static void tegra_cbc_iv_copyback(struct skcipher_request *req, struct tegra_aes
 	offset = req->cryptlen - ctx->ivsize;
 
 	if (rctx->encrypt)
-		memcpy(req->iv, rctx->datbuf.buf + offset, ctx->ivsize);
+		scatterwalk_map_and_copy(req->iv, req->dst, offset, ctx->ivsize, 0);
 	else
-		scatterwalk_map_and_copy(req->iv, req->src, offset, ctx->ivsize, 0);
+		memcpy(req->iv, rctx->last_blk, ctx->ivsize);
 }
 
 static void tegra_aes_update_iv(struct skcipher_request *req, struct tegra_aes_ctx *ctx)
@@ -217,7 +229,6 @@ static unsigned int tegra_aes_prep_cmd(struct tegra_se *se, struct tegra_aes_req
 {
 	unsigned int data_count, res_bits, i = 0, j;
 	u32 *cpuvaddr = rctx->cmdbuf;
-	dma_addr_t addr = rctx->datbuf.addr;
 
 	data_count = rctx->len / AES_BLOCK_SIZE;
 	res_bits = (rctx->len % AES_BLOCK_SIZE) * 8;
@@ -245,12 +256,13 @@ static unsigned int tegra_aes_prep_cmd(struct tegra_se *se, struct tegra_aes_req
 	cpuvaddr[i++] = rctx->crypto_config;
 
 	/* Source address setting */
-	cpuvaddr[i++] = lower_32_bits(addr);
-	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(addr)) | SE_ADDR_HI_SZ(rctx->len);
+	cpuvaddr[i++] = lower_32_bits(rctx->src_addr);
+	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(rctx->src_addr)) |
+			SE_ADDR_HI_SZ(rctx->len);
 
 	/* Destination address setting */
-	cpuvaddr[i++] = lower_32_bits(addr);
-	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(addr)) |
+	cpuvaddr[i++] = lower_32_bits(rctx->dst_addr);
+	cpuvaddr[i++] = SE_ADDR_HI_MSB(upper_32_bits(rctx->dst_addr)) |
 			SE_ADDR_HI_SZ(rctx->len);
 
 	cpuvaddr[i++] = se_host1x_opcode_nonincr(se->hw->regs->op, 1);
@@ -266,6 +278,99 @@ static unsigned int tegra_aes_prep_cmd(struct tegra_se *se, struct tegra_aes_req
 	return i;
 }
 
+/*
+ * Map the scatterlist for the engine. Only succeeds if it ends up as a
+ * single contiguous DMA range, which is the case behind an IOMMU.
+ */
+static int tegra_aes_map_sg(struct device *dev, struct scatterlist *sg,
+			    unsigned int len, enum dma_data_direction dir,
+			    dma_addr_t *addr)
+{
+	int nents, mapped;
+
+	nents = sg_nents_for_len(sg, len);
+	if (nents < 0)
+		return nents;
+
+	mapped = dma_map_sg(dev, sg, nents, dir);
+	if (!mapped)
+		return -ENOMEM;
+
+	if (mapped != 1) {
+		dma_unmap_sg(dev, sg, nents, dir);
+		return -EINVAL;
+	}
+
+	*addr = sg_dma_address(sg);
+
+	return nents;
+}
+
+static bool tegra_aes_map_direct(struct tegra_se *se, struct skcipher_request *req,
+				 struct tegra_aes_reqctx *rctx)
+{
+	/* Padded requests need a bounce buffer to hold the extra bytes */
+	if (!zero_copy || rctx->len != req->cryptlen)
+		return false;
+
+	if (req->src == req->dst) {
+		rctx->src_nents = tegra_aes_map_sg(se->dev, req->src, req->cryptlen,
+						   DMA_BIDIRECTIONAL, &rctx->src_addr);
+		if (rctx->src_nents < 0)
+			return false;
+
+		rctx->dst_addr = rctx->src_addr;
+		return true;
+	}
+
+	rctx->src_nents = tegra_aes_map_sg(se->dev, req->src, req->cryptlen,
+					   DMA_TO_DEVICE, &rctx->src_addr);
+	if (rctx->src_nents < 0)
+		return false;
+
+	rctx->dst_nents = tegra_aes_map_sg(se->dev, req->dst, req->cryptlen,
+					   DMA_FROM_DEVICE, &rctx->dst_addr);
+	if (rctx->dst_nents < 0) {
+		dma_unmap_sg(se->dev, req->src, rctx->src_nents, DMA_TO_DEVICE);
+		return false;
+	}
+
+	return true;
+}
+
+static void tegra_aes_unmap_direct(struct tegra_se *se, struct skcipher_request *req,
+				   struct tegra_aes_reqctx *rctx)
+{
+	if (req->src == req->dst) {
+		dma_unmap_sg(se->dev, req->src, rctx->src_nents, DMA_BIDIRECTIONAL);
+		return;
+	}
+
+	dma_unmap_sg(se->dev, req->src, rctx->src_nents, DMA_TO_DEVICE);
+	dma_unmap_sg(se->dev, req->dst, rctx->dst_nents, DMA_FROM_DEVICE);
+}
+
+static void tegra_aes_complete(struct tegra_se_req *sreq, int err)
+{
+	struct tegra_aes_reqctx *rctx = container_of(sreq, struct tegra_aes_reqctx, sreq);
+	struct skcipher_request *req = rctx->req;
+	struct tegra_aes_ctx *ctx = crypto_skcipher_ctx(crypto_skcipher_reqtfm(req));
+	struct tegra_se *se = ctx->se;
+
+	if (rctx->direct) {
+		tegra_aes_unmap_direct(se, req, rctx);
+	} else {
+		/* Copy the result and free the buffer */
+		scatterwalk_map_and_copy(rctx->datbuf.buf, req->dst, 0, req->cryptlen, 1);
+		tegra_se_datbuf_free(se, &rctx->datbuf);
+	}
+
+	tegra_aes_update_iv(req, ctx);
+
+	kfree(rctx->cmdbuf);
+	crypto_finalize_skcipher_request(se->engine, req, err);
+}
+
 static int tegra_aes_do_one_req(struct crypto_engine *engine, void *areq)
 {
 	struct skcipher_request *req = container_of(areq, struct skcipher_request, base);
@@ -275,13 +380,6 @@ static int tegra_aes_do_one_req(struct crypto_engine *engine, void *areq)
 	unsigned int cmdlen;
 	int ret;
 
-	/* Set buffer size as a multiple of AES_BLOCK_SIZE*/
-	rctx->datbuf.size = ((req->cryptlen / AES_BLOCK_SIZE) + 1) * AES_BLOCK_SIZE;
-	rctx->datbuf.buf = dma_alloc_coherent(se->dev, rctx->datbuf.size,
-					      &rctx->datbuf.addr, GFP_KERNEL);
-	if (!rctx->datbuf.buf)
-		return -ENOMEM;
-
 	rctx->iv = (u32 *)req->iv;
 	rctx->len = req->cryptlen;
 
@@ -291,22 +389,33 @@ static int tegra_aes_do_one_req(struct crypto_engine *engine, void *areq)
 			rctx->len += AES_BLOCK_SIZE - (rctx->len % AES_BLOCK_SIZE);
 	}
 
-	scatterwalk_map_and_copy(rctx->datbuf.buf, req->src, 0, req->cryptlen, 0);
+	/* Save the next IV, the source may be overwritten in place */
+	if (ctx->alg == SE_ALG_CBC && !rctx->encrypt)
+		scatterwalk_map_and_copy(rctx->last_blk, req->src,
+					 req->cryptlen - ctx->ivsize, ctx->ivsize, 0);
 
-	/* Prepare the command and submit for execution */
-	cmdlen = tegra_aes_prep_cmd(se, rctx);
-	ret = tegra_se_host1x_submit(se, rctx->cmdbuf, cmdlen);
-
-	/* Copy the result */
-	tegra_aes_update_iv(req, ctx);
-	scatterwalk_map_and_copy(rctx->datbuf.buf, req->dst, 0, req->cryptlen, 1);
+	rctx->direct = tegra_aes_map_direct(se, req, rctx);
+	if (!rctx->direct) {
+		/* Size the buffer for the padded length so 64K requests fit the pool */
+		ret = tegra_se_datbuf_alloc(se, &rctx->datbuf,
+					    ALIGN(req->cryptlen, AES_BLOCK_SIZE));
+		if (ret)
+			return ret;
 
-	/* Free the buffer */
-	dma_free_coherent(se->dev, rctx->datbuf.size,
-			  rctx->datbuf.buf, rctx->datbuf.addr);
+		scatterwalk_map_and_copy(rctx->datbuf.buf, req->src, 0, req->cryptlen, 0);
+		rctx->src_addr = rctx->datbuf.addr;
+		rctx->dst_addr = rctx->datbuf.addr;
+	}
 
-	kfree(rctx->cmdbuf);
-	crypto_finalize_skcipher_request(se->engine, req, ret);
+	/*
+	 * Prepare the command and queue it for execution, the request is
+	 * finalized from tegra_aes_complete() once the job is done.
+	 */
+	cmdlen = tegra_aes_prep_cmd(se, rctx);
+	rctx->req = req;
+	rctx->sreq.complete = tegra_aes_complete;
+	tegra_se_host1x_submit_async(se, &rctx->sreq, rctx->cmdbuf, cmdlen,
+				     ctx->key1_id);
 
 	return 0;
 }
@@ -1180,6 +1289,7 @@ static int tegra_ccm_do_one_req(struct crypto_engine *engine, void *areq)
 	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
 	struct tegra_aead_ctx *ctx = crypto_aead_ctx(tfm);
 	struct tegra_se *se = ctx->se;
+	ssize_t bufsize;
 	int ret;
 
 	rctx->src_sg = req->src;
@@ -1192,20 +1302,15 @@ static int tegra_ccm_do_one_req(struct crypto_engine *engine, void *areq)
 	else
 		rctx->cryptlen = req->cryptlen - ctx->authsize;
 
-	rctx->inbuf.size = rctx->assoclen + rctx->authsize + rctx->cryptlen + 100;
 	/* Allocate buffers required */
-	rctx->inbuf.buf = dma_alloc_coherent(ctx->se->dev, rctx->inbuf.size,
-					     &rctx->inbuf.addr, GFP_KERNEL);
-	if (!rctx->inbuf.buf)
-		return -ENOMEM;
+	bufsize = rctx->assoclen + rctx->authsize + rctx->cryptlen + 100;
+	ret = tegra_se_datbuf_alloc(se, &rctx->inbuf, bufsize);
+	if (ret)
+		return ret;
 
-	rctx->outbuf.size = rctx->assoclen + rctx->authsize + rctx->cryptlen + 100;
-	rctx->outbuf.buf = dma_alloc_coherent(ctx->se->dev, rctx->outbuf.size,
-					      &rctx->outbuf.addr, GFP_KERNEL);
-	if (!rctx->outbuf.buf) {
-		ret = -ENOMEM;
+	ret = tegra_se_datbuf_alloc(se, &rctx->outbuf, bufsize);
+	if (ret)
 		goto outbuf_err;
-	}
 
 	ret = tegra_ccm_crypt_init(req, se, rctx);
 	if (ret)
@@ -1235,12 +1340,12 @@ static int tegra_ccm_do_one_req(struct crypto_engine *engine, void *areq)
 	}
 
 out:
-	dma_free_coherent(ctx->se->dev, rctx->outbuf.size,
-			  rctx->outbuf.buf, rctx->outbuf.addr);
+	tegra_se_datbuf_free(se, &rctx->outbuf);
 
 outbuf_err:
-	dma_free_coherent(ctx->se->dev, rctx->inbuf.size,
-			  rctx->inbuf.buf, rctx->inbuf.addr);
+	/* The CCM steps shrink inbuf.size to the data actually used */
+	rctx->inbuf.size = bufsize;
+	tegra_se_datbuf_free(se, &rctx->inbuf);
 
 	kfree(rctx->cmdbuf);
 	crypto_finalize_aead_request(ctx->se->engine, req, ret);
@@ -1267,20 +1372,15 @@ static int tegra_gcm_do_one_req(struct crypto_engine *engine, void *areq)
 		rctx->cryptlen = req->cryptlen - ctx->authsize;
 
 	/* Allocate buffers required */
-	rctx->inbuf.size = rctx->assoclen + rctx->authsize + rctx->cryptlen;
-	rctx->inbuf.buf = dma_alloc_coherent(ctx->se->dev, rctx->inbuf.size,
-					     &rctx->inbuf.addr, GFP_KERNEL);
-	if (!rctx->inbuf.buf)
-		return -ENOMEM;
-
+	ret = tegra_se_datbuf_alloc(ctx->se, &rctx->inbuf,
+				    rctx->assoclen + rctx->authsize + rctx->cryptlen);
+	if (ret)
+		return ret;
 
-	rctx->outbuf.size = rctx->assoclen + rctx->authsize + rctx->cryptlen;
-	rctx->outbuf.buf = dma_alloc_coherent(ctx->se->dev, rctx->outbuf.size,
-					      &rctx->outbuf.addr, GFP_KERNEL);
-	if (!rctx->outbuf.buf) {
-		ret = -ENOMEM;
+	ret = tegra_se_datbuf_alloc(ctx->se, &rctx->outbuf,
+				    rctx->assoclen + rctx->authsize + rctx->cryptlen);
+	if (ret)
 		goto outbuf_err;
-	}
 
 	memcpy(rctx->iv, req->iv, GCM_AES_IV_SIZE);
 	rctx->iv[3] = (1 << 24);
@@ -1308,12 +1408,10 @@ static int tegra_gcm_do_one_req(struct crypto_engine *engine, void *areq)
 		ret = tegra_gcm_do_verify(ctx->se, rctx);
 
 out:
-	dma_free_coherent(ctx->se->dev, rctx->outbuf.size,
-			  rctx->outbuf.buf, rctx->outbuf.addr);
+	tegra_se_datbuf_free(ctx->se, &rctx->outbuf);
 
 outbuf_err:
-	dma_free_coherent(ctx->se->dev, rctx->inbuf.size,
-			  rctx->inbuf.buf, rctx->inbuf.addr);
+	tegra_se_datbuf_free(ctx->se, &rctx->inbuf);
 
 	/* Finalize the request if there are no errors */
 	kfree(rctx->cmdbuf);
@@ -1999,6 +2097,7 @@ int tegra_init_aes(struct tegra_se *se)
 	int i, ret;
 
 	se->manifest = tegra_aes_kac_manifest;
+	tegra_se_bounce_pool_init(se);
 
 	for (i = 0; i < ARRAY_SIZE(tegra_aes_algs); i++) {
 		sk_alg = &tegra_aes_algs[i].alg.skcipher;
@@ -2049,6 +2148,8 @@ err_aes:
 	for (--i; i >= 0; i--)
 		CRYPTO_UNREGISTER(skcipher, &tegra_aes_algs[i].alg.skcipher);
 
+	tegra_se_bounce_pool_free(se);
+
 	return ret;
 }
 
@@ -2062,6 +2163,7 @@ int tegra_init_aes(struct tegra_se *se)
 	int i, ret;
 
 	se->manifest = tegra_aes_kac_manifest;
+	tegra_se_bounce_pool_init(se);
 
 	for (i = 0; i < ARRAY_SIZE(tegra_aes_algs); i++) {
 		sk_alg = &tegra_aes_algs[i].alg.skcipher;
@@ -2112,6 +2214,8 @@ err_aes:
 	for (--i; i >= 0; i--)
 		CRYPTO_UNREGISTER(skcipher, &tegra_aes_algs[i].alg.skcipher);
 
+	tegra_se_bounce_pool_free(se);
+
 	return ret;
 }
 #endif
@@ -2129,4 +2233,5 @@ void tegra_deinit_aes(struct tegra_se *se)
 	for (i = 0; i < ARRAY_SIZE(tegra_cmac_algs); i++)
 		CRYPTO_UNREGISTER(ahash, &tegra_cmac_algs[i].alg.ahash);
 
+	tegra_se_bounce_pool_free(se);
 }
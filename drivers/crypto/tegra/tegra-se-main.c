@@ -6,6 +6,7 @@
 
 #include <nvidia/conftest.h>
 
+#include <linux/bitmap.h>
 #include <linux/clk.h>
 #include <linux/dma-mapping.h>
 #include <linux/module.h>
@@ -16,6 +17,10 @@
 
 #include "tegra-se.h"
 
+static unsigned int bounce_bufs = 16;
+module_param(bounce_bufs, uint, 0444);
+MODULE_PARM_DESC(bounce_bufs, "Number of 64K bounce buffers preallocated per engine");
+
 static struct host1x_bo *tegra_se_cmdbuf_get(struct host1x_bo *host_bo)
 {
 	struct tegra_se_cmdbuf *cmdbuf = container_of(host_bo, struct tegra_se_cmdbuf, bo);
@@ -143,6 +148,103 @@ static struct tegra_se_cmdbuf *tegra_se_host1x_bo_alloc(struct tegra_se *se, ssi
 	return cmdbuf;
 }
 
+void tegra_se_bounce_pool_init(struct tegra_se *se)
+{
+	struct tegra_se_bounce_pool *pool = &se->bounce;
+
+	spin_lock_init(&pool->lock);
+	pool->nr_bufs = 0;
+
+	if (!bounce_bufs)
+		return;
+
+	pool->map = bitmap_zalloc(bounce_bufs, GFP_KERNEL);
+	if (!pool->map)
+		goto err;
+
+	pool->buf = dma_alloc_coherent(se->dev, (size_t)bounce_bufs * SE_BOUNCE_BUF_SIZE,
+				       &pool->addr, GFP_KERNEL);
+	if (!pool->buf) {
+		bitmap_free(pool->map);
+		pool->map = NULL;
+		goto err;
+	}
+
+	pool->nr_bufs = bounce_bufs;
+
+	return;
+
+err:
+	/* Not fatal, every buffer is then allocated on demand */
+	dev_warn(se->dev, "failed to allocate %u bounce buffers\n", bounce_bufs);
+}
+
+void tegra_se_bounce_pool_free(struct tegra_se *se)
+{
+	struct tegra_se_bounce_pool *pool = &se->bounce;
+
+	if (!pool->nr_bufs)
+		return;
+
+	dma_free_coherent(se->dev, (size_t)pool->nr_bufs * SE_BOUNCE_BUF_SIZE,
+			  pool->buf, pool->addr);
+	bitmap_free(pool->map);
+	pool->buf = NULL;
+	pool->map = NULL;
+	pool->nr_bufs = 0;
+}
+
+/*
+ * Get a DMA buffer for the engine, from the bounce pool when a slot is
+ * free and large enough, with a coherent allocation as fallback.
+ */
+int tegra_se_datbuf_alloc(struct tegra_se *se, struct tegra_se_datbuf *datbuf,
+			  ssize_t size)
+{
+	struct tegra_se_bounce_pool *pool = &se->bounce;
+	unsigned int slot = pool->nr_bufs;
+
+	if (size <= SE_BOUNCE_BUF_SIZE && pool->nr_bufs) {
+		spin_lock(&pool->lock);
+		slot = find_first_zero_bit(pool->map, pool->nr_bufs);
+		if (slot < pool->nr_bufs)
+			__set_bit(slot, pool->map);
+		spin_unlock(&pool->lock);
+	}
+
+	datbuf->size = size;
+
+	if (slot < pool->nr_bufs) {
+		datbuf->buf = pool->buf + slot * SE_BOUNCE_BUF_SIZE;
+		datbuf->addr = pool->addr + slot * SE_BOUNCE_BUF_SIZE;
+		return 0;
+	}
+
+	datbuf->buf = dma_alloc_coherent(se->dev, size, &datbuf->addr, GFP_KERNEL);
+	if (!datbuf->buf)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void tegra_se_datbuf_free(struct tegra_se *se, struct tegra_se_datbuf *datbuf)
+{
+	struct tegra_se_bounce_pool *pool = &se->bounce;
+	size_t pool_size = (size_t)pool->nr_bufs * SE_BOUNCE_BUF_SIZE;
+	unsigned int slot;
+
+	if (pool->nr_bufs && datbuf->buf >= pool->buf &&
+	    datbuf->buf < pool->buf + pool_size) {
+		slot = (datbuf->buf - pool->buf) / SE_BOUNCE_BUF_SIZE;
+		spin_lock(&pool->lock);
+		__clear_bit(slot, pool->map);
+		spin_unlock(&pool->lock);
+		return;
+	}
+
+	dma_free_coherent(se->dev, datbuf->size, datbuf->buf, datbuf->addr);
+}
+
 int tegra_se_host1x_submit(struct tegra_se *se, u32 *cpuvaddr, u32 size)
 {
 	struct host1x_job *job;
@@ -207,6 +309,238 @@ job_put:
 	return ret;
 }
 
+static void tegra_se_submit_fence_cb(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct tegra_se_submit *submit = container_of(cb, struct tegra_se_submit, fence_cb);
+
+	schedule_work(&submit->work);
+}
+
+/*
+ * Submit the batch collected in the head slot. The requests are completed
+ * from the job fence, or right away with an error if the job could not be
+ * submitted.
+ */
+static void tegra_se_submit_flush_locked(struct tegra_se *se)
+{
+	struct tegra_se_submit *submit = &se->submit[se->submit_head];
+	struct host1x_job *job;
+	int ret;
+
+	if (!submit->nr_reqs || submit->busy)
+		return;
+
+	submit->busy = true;
+	se->submit_inflight++;
+	se->submit_head = (se->submit_head + 1) % SE_SUBMIT_RING_SIZE;
+
+	job = host1x_job_alloc(se->channel, 1, 0, true);
+	if (!job) {
+		dev_err(se->dev, "failed to allocate host1x job\n");
+		ret = -ENOMEM;
+		goto complete;
+	}
+
+	/* Each request increments the syncpoint once */
+	job->syncpt = host1x_syncpt_get(se->syncpt);
+	job->syncpt_incrs = submit->nr_reqs;
+	job->client = &se->client;
+	job->class = se->client.class;
+	job->serialize = true;
+	job->engine_fallback_streamid = se->stream_id;
+	job->engine_streamid_offset = SE_STREAM_ID;
+	/* Ring buffers live until deinit, keep them pinned */
+	job->cache_mappings = true;
+
+	host1x_job_add_gather(job, &submit->cmdbuf->bo, submit->words, 0);
+
+	ret = host1x_job_pin(job, se->dev);
+	if (ret) {
+		dev_err(se->dev, "failed to pin host1x job\n");
+		goto job_put;
+	}
+
+	ret = host1x_job_submit(job);
+	if (ret) {
+		dev_err(se->dev, "failed to submit host1x job\n");
+		goto job_unpin;
+	}
+
+	if (!job->fence) {
+		ret = host1x_syncpt_wait(job->syncpt, job->syncpt_end,
+					 MAX_SCHEDULE_TIMEOUT, NULL);
+		host1x_job_put(job);
+		goto complete;
+	}
+
+	submit->fence = dma_fence_get(job->fence);
+	host1x_job_put(job);
+
+	if (dma_fence_add_callback(submit->fence, &submit->fence_cb,
+				   tegra_se_submit_fence_cb))
+		schedule_work(&submit->work);
+
+	return;
+
+job_unpin:
+	host1x_job_unpin(job);
+job_put:
+	host1x_job_put(job);
+complete:
+	submit->error = ret;
+	schedule_work(&submit->work);
+}
+
+static void tegra_se_submit_work(struct work_struct *work)
+{
+	struct tegra_se_submit *submit = container_of(work, struct tegra_se_submit, work);
+	struct tegra_se *se = submit->se;
+	struct tegra_se_req *sreq, *tmp;
+	LIST_HEAD(reqs);
+	int err = submit->error;
+	int status;
+
+	if (submit->fence) {
+		status = dma_fence_get_status(submit->fence);
+		if (status < 0)
+			err = status;
+		dma_fence_put(submit->fence);
+		submit->fence = NULL;
+	}
+
+	if (err)
+		dev_err(se->dev, "host1x job failed: %d\n", err);
+
+	mutex_lock(&se->submit_lock);
+	list_splice_init(&submit->reqs, &reqs);
+	submit->nr_reqs = 0;
+	submit->words = 0;
+	submit->error = 0;
+	submit->busy = false;
+	se->submit_inflight--;
+	/* Submit what was collected while this job was running */
+	tegra_se_submit_flush_locked(se);
+	mutex_unlock(&se->submit_lock);
+
+	wake_up(&se->submit_wq);
+
+	list_for_each_entry_safe(sreq, tmp, &reqs, list) {
+		list_del(&sreq->list);
+		sreq->complete(sreq, err);
+	}
+}
+
+/*
+ * Queue a command stream ending in a single syncpoint increment.
+ * Requests are submitted right away while the engine is idle. Otherwise
+ * they are coalesced with other requests for the same key slot and
+ * submitted once a job completes or the batch is full. sreq->complete()
+ * is always called, also on error.
+ */
+void tegra_se_host1x_submit_async(struct tegra_se *se, struct tegra_se_req *sreq,
+				  u32 *cpuvaddr, u32 size, u32 key_id)
+{
+	struct tegra_se_submit *submit;
+
+	mutex_lock(&se->submit_lock);
+
+	submit = &se->submit[se->submit_head];
+	if (submit->nr_reqs && !submit->busy &&
+	    (submit->key_id != key_id || submit->nr_reqs == SE_SUBMIT_BATCH_MAX ||
+	     (submit->words + size) * 4 > SE_SUBMIT_CMDBUF_SIZE)) {
+		tegra_se_submit_flush_locked(se);
+		submit = &se->submit[se->submit_head];
+	}
+
+	/* Ring is full, wait for the oldest job to complete */
+	while (submit->busy) {
+		mutex_unlock(&se->submit_lock);
+		wait_event(se->submit_wq, !READ_ONCE(submit->busy));
+		mutex_lock(&se->submit_lock);
+		submit = &se->submit[se->submit_head];
+	}
+
+	memcpy(submit->cmdbuf->addr + submit->words, cpuvaddr, size * 4);
+	submit->words += size;
+	submit->key_id = key_id;
+	list_add_tail(&sreq->list, &submit->reqs);
+	submit->nr_reqs++;
+
+	if (!se->submit_inflight || submit->nr_reqs == SE_SUBMIT_BATCH_MAX)
+		tegra_se_submit_flush_locked(se);
+
+	mutex_unlock(&se->submit_lock);
+}
+
+static void tegra_se_submit_kick(struct tegra_se *se)
+{
+	mutex_lock(&se->submit_lock);
+	tegra_se_submit_flush_locked(se);
+	mutex_unlock(&se->submit_lock);
+}
+
+static void tegra_se_submit_ring_free(struct tegra_se *se)
+{
+	struct host1x_bo_mapping *mapping, *tmp;
+	struct tegra_se_cmdbuf *cmdbuf;
+	unsigned int i;
+
+	for (i = 0; i < SE_SUBMIT_RING_SIZE; i++) {
+		cmdbuf = se->submit[i].cmdbuf;
+		if (!cmdbuf)
+			continue;
+
+		/* Drop the mappings kept in the host1x cache */
+		list_for_each_entry_safe(mapping, tmp, &cmdbuf->bo.mappings, list) {
+			if (mapping->cache)
+				host1x_bo_unpin(mapping);
+		}
+
+		tegra_se_cmdbuf_put(&cmdbuf->bo);
+		se->submit[i].cmdbuf = NULL;
+	}
+}
+
+static int tegra_se_submit_ring_init(struct tegra_se *se)
+{
+	struct tegra_se_submit *submit;
+	unsigned int i;
+
+	se->submit_head = 0;
+	se->submit_inflight = 0;
+
+	for (i = 0; i < SE_SUBMIT_RING_SIZE; i++) {
+		submit = &se->submit[i];
+		submit->se = se;
+		INIT_LIST_HEAD(&submit->reqs);
+		INIT_WORK(&submit->work, tegra_se_submit_work);
+
+		submit->cmdbuf = tegra_se_host1x_bo_alloc(se, SE_SUBMIT_CMDBUF_SIZE);
+		if (!submit->cmdbuf) {
+			tegra_se_submit_ring_free(se);
+			return -ENOMEM;
+		}
+
+		/* Map the whole buffer, gathers only cover the used part */
+		submit->cmdbuf->words = SE_SUBMIT_CMDBUF_SIZE / 4;
+	}
+
+	return 0;
+}
+
+static void tegra_se_submit_ring_deinit(struct tegra_se *se)
+{
+	unsigned int i;
+
+	tegra_se_submit_kick(se);
+	wait_event(se->submit_wq, !READ_ONCE(se->submit_inflight));
+
+	for (i = 0; i < SE_SUBMIT_RING_SIZE; i++)
+		flush_work(&se->submit[i].work);
+
+	tegra_se_submit_ring_free(se);
+}
+
 static int tegra_se_client_init(struct host1x_client *client)
 {
 	struct tegra_se *se = container_of(client, struct tegra_se, client);
@@ -227,14 +561,22 @@ static int tegra_se_client_init(struct host1x_client *client)
 
 	se->syncpt_id =  host1x_syncpt_id(se->syncpt);
 
+	ret = tegra_se_submit_ring_init(se);
+	if (ret) {
+		dev_err(se->dev, "failed to allocate submission ring\n");
+		goto syncpt_put;
+	}
+
 	ret = se->hw->init_alg(se);
 	if (ret) {
 		dev_err(se->dev, "failed to register algorithms\n");
-		goto syncpt_put;
+		goto ring_free;
 	}
 
 	return 0;
 
+ring_free:
+	tegra_se_submit_ring_free(se);
 syncpt_put:
 	host1x_syncpt_put(se->syncpt);
 channel_put:
@@ -248,6 +590,7 @@ static int tegra_se_client_deinit(struct host1x_client *client)
 	struct tegra_se *se = container_of(client, struct tegra_se, client);
 
 	se->hw->deinit_alg(se);
+	tegra_se_submit_ring_deinit(se);
 	host1x_syncpt_put(se->syncpt);
 	host1x_channel_put(se->channel);
 
@@ -291,6 +634,7 @@ static int tegra_se_probe(struct platform_device *pdev)
 		return PTR_ERR(se->base);
 
 	dma_set_mask_and_coherent(dev, DMA_BIT_MASK(39));
+	dma_set_max_seg_size(dev, SE_MAX_DMA_SEG_SIZE);
 	platform_set_drvdata(pdev, se);
 
 	se->clk = devm_clk_get_enabled(se->dev, NULL);
@@ -304,7 +648,12 @@ static int tegra_se_probe(struct platform_device *pdev)
 
 	writel(se->stream_id, se->base + SE_STREAM_ID);
 
-	se->engine = crypto_engine_alloc_init(dev, 0);
+	mutex_init(&se->submit_lock);
+	init_waitqueue_head(&se->submit_wq);
+
+	/* Let requests queue up behind the ones in flight */
+	se->engine = crypto_engine_alloc_init_and_set(dev, true, NULL, false,
+						      SE_ENGINE_QLEN);
 	if (!se->engine)
 		return dev_err_probe(dev, -ENOMEM, "failed to init crypto engine\n");
 
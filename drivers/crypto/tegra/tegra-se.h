@@ -24,6 +24,16 @@
 #define TEGRA_GPSE_ID					3
 
 #define SE_MAX_CMDLEN					(100 * 4) /* max 100 commands of 4 bytes each */
+
+/* Asynchronous submission ring */
+#define SE_SUBMIT_RING_SIZE				8
+#define SE_SUBMIT_BATCH_MAX				8
+#define SE_SUBMIT_CMDBUF_SIZE				SZ_4K
+#define SE_ENGINE_QLEN					(SE_SUBMIT_RING_SIZE * SE_SUBMIT_BATCH_MAX)
+
+/* Bounce buffer pool and direct mapping limits */
+#define SE_BOUNCE_BUF_SIZE				SZ_64K
+#define SE_MAX_DMA_SEG_SIZE				GENMASK(23, 0)
 #define SE_STREAM_ID					0x90
 
 #define SE_SHA_CFG					0x4004
@@ -437,6 +447,41 @@ struct tegra_se_hw {
 	u32 kac_ver;
 };
 
+/* Request queued on the asynchronous submission ring */
+struct tegra_se_req {
+	struct list_head list;
+	void (*complete)(struct tegra_se_req *sreq, int err);
+};
+
+/*
+ * One slot of the submission ring: a pinned command buffer that collects
+ * the commands of up to SE_SUBMIT_BATCH_MAX requests and is submitted as
+ * a single host1x job.
+ */
+struct tegra_se_submit {
+	struct tegra_se *se;
+	struct tegra_se_cmdbuf *cmdbuf;
+	struct list_head reqs;
+	unsigned int nr_reqs;
+	u32 words;
+	u32 key_id;
+	bool busy;
+	int error;
+	struct dma_fence *fence;
+	struct dma_fence_cb fence_cb;
+	struct work_struct work;
+};
+
+/* Preallocated bounce buffers, slots are SE_BOUNCE_BUF_SIZE bytes each */
+struct tegra_se_bounce_pool {
+	u8 *buf;
+	dma_addr_t addr;
+	unsigned int nr_bufs;
+	unsigned long *map;
+	/* Protects map */
+	spinlock_t lock;
+};
+
 struct tegra_se {
 	int (*manifest)(u32 user, u32 alg, u32 keylen);
 	const struct tegra_se_hw *hw;
@@ -451,6 +496,13 @@ struct tegra_se {
 	unsigned int syncpt_id;
 	void __iomem *base;
 	u32 owner;
+	struct tegra_se_submit submit[SE_SUBMIT_RING_SIZE];
+	/* Protects the submission ring */
+	struct mutex submit_lock;
+	wait_queue_head_t submit_wq;
+	unsigned int submit_head;
+	unsigned int submit_inflight;
+	struct tegra_se_bounce_pool bounce;
 };
 
 struct tegra_se_cmdbuf {
@@ -525,6 +577,13 @@ int tegra_key_submit(struct tegra_se *se, const u8 *key,
 		     u32 keylen, u32 alg, u32 *keyid);
 void tegra_key_invalidate(struct tegra_se *se, u32 keyid, u32 alg);
 int tegra_se_host1x_submit(struct tegra_se *se, u32 *cpuvaddr, u32 size);
+void tegra_se_host1x_submit_async(struct tegra_se *se, struct tegra_se_req *sreq,
+				  u32 *cpuvaddr, u32 size, u32 key_id);
+void tegra_se_bounce_pool_init(struct tegra_se *se);
+void tegra_se_bounce_pool_free(struct tegra_se *se);
+int tegra_se_datbuf_alloc(struct tegra_se *se, struct tegra_se_datbuf *datbuf,
+			  ssize_t size);
+void tegra_se_datbuf_free(struct tegra_se *se, struct tegra_se_datbuf *datbuf);
 
 /* HOST1x OPCODES */
 static inline u32 host1x_opcode_setpayload(unsigned int payload)
@@ -450,6 +450,268 @@ uint32_t tegra_ivc_frames_available(struct tegra_ivc *ivc, struct tegra_ivc_head
 #endif
 EXPORT_SYMBOL(tegra_ivc_frames_available);
 
+static inline void tegra_ivc_flush(struct tegra_ivc *ivc, dma_addr_t phys,
+				   size_t size)
+{
+	if (!ivc->peer)
+		return;
+
+	dma_sync_single_for_device(ivc->peer, phys, size, DMA_TO_DEVICE);
+}
+
+/*
+ * Frames the caller may advance over: pending frames on rx, free frames on tx.
+ * The counters were synchronized by tegra_ivc_check_read()/check_write().
+ */
+static u32 tegra_ivc_batch_limit(struct tegra_ivc *ivc, bool rx)
+{
+	u32 avail;
+
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	avail = tegra_ivc_available(ivc, rx ? &ivc->rx.map : &ivc->tx.map);
+#else
+	avail = tegra_ivc_available(ivc, rx ? ivc->rx.channel : ivc->tx.channel);
+#endif
+	if (avail > ivc->num_frames)
+		return 0;
+
+	return rx ? avail : ivc->num_frames - avail;
+}
+
+int tegra_ivc_read_advance_n(struct tegra_ivc *ivc, u32 n)
+{
+	unsigned int rx = offsetof(struct tegra_ivc_header, rx.count);
+	unsigned int tx = offsetof(struct tegra_ivc_header, tx.count);
+	u32 count;
+	int err;
+
+	err = tegra_ivc_check_read(ivc);
+	if (err < 0)
+		return err;
+
+	if (n > tegra_ivc_batch_limit(ivc, true))
+		return -EINVAL;
+
+	if (n == 0)
+		return 0;
+
+	/*
+	 * Release all frames with a single counter update, and thus a single
+	 * flush and barrier sequence.
+	 */
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	count = tegra_ivc_header_read_field(&ivc->rx.map, rx.count);
+	tegra_ivc_header_write_field(&ivc->rx.map, rx.count, count + n);
+#else
+	count = READ_ONCE(ivc->rx.channel->rx.count);
+	WRITE_ONCE(ivc->rx.channel->rx.count, count + n);
+#endif
+	ivc->rx.position = (ivc->rx.position + n) % ivc->num_frames;
+	tegra_ivc_flush(ivc, ivc->rx.phys + rx, TEGRA_IVC_ALIGN);
+
+	/*
+	 * Ensure our write to rx.count occurs before our read from tx.count,
+	 * see tegra_ivc_read_advance().
+	 */
+	smp_mb();
+
+	tegra_ivc_invalidate(ivc, ivc->rx.phys + tx);
+
+	/* Notify the peer if the queue may have been full before the batch. */
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	if (tegra_ivc_available(ivc, &ivc->rx.map) + n >= ivc->num_frames)
+#else
+	if (tegra_ivc_available(ivc, ivc->rx.channel) + n >= ivc->num_frames)
+#endif
+		ivc->notify(ivc, ivc->notify_data);
+
+	return 0;
+}
+EXPORT_SYMBOL(tegra_ivc_read_advance_n);
+
+int tegra_ivc_write_advance_n(struct tegra_ivc *ivc, u32 n)
+{
+	unsigned int rx = offsetof(struct tegra_ivc_header, rx.count);
+	unsigned int tx = offsetof(struct tegra_ivc_header, tx.count);
+	u32 count, frame, i;
+	int err;
+
+	err = tegra_ivc_check_write(ivc);
+	if (err < 0)
+		return err;
+
+	if (n > tegra_ivc_batch_limit(ivc, false))
+		return -EINVAL;
+
+	if (n == 0)
+		return 0;
+
+	for (i = 0, frame = ivc->tx.position; i < n; i++) {
+		tegra_ivc_flush(ivc, ivc->tx.phys + sizeof(struct tegra_ivc_header) +
+				(dma_addr_t)ivc->frame_size * frame,
+				ivc->frame_size);
+		frame = (frame + 1) % ivc->num_frames;
+	}
+
+	/*
+	 * Ensure that the frames are updated before the peer sees the new
+	 * tx.count.
+	 */
+	smp_wmb();
+
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	count = tegra_ivc_header_read_field(&ivc->tx.map, tx.count);
+	tegra_ivc_header_write_field(&ivc->tx.map, tx.count, count + n);
+#else
+	count = READ_ONCE(ivc->tx.channel->tx.count);
+	WRITE_ONCE(ivc->tx.channel->tx.count, count + n);
+#endif
+	ivc->tx.position = frame;
+	tegra_ivc_flush(ivc, ivc->tx.phys + tx, TEGRA_IVC_ALIGN);
+
+	/*
+	 * Ensure our write to tx.count occurs before our read from rx.count,
+	 * see tegra_ivc_write_advance().
+	 */
+	smp_mb();
+
+	tegra_ivc_invalidate(ivc, ivc->tx.phys + rx);
+
+	/* Notify the peer if the queue may have been empty before the batch. */
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	if (tegra_ivc_available(ivc, &ivc->tx.map) <= n)
+#else
+	if (tegra_ivc_available(ivc, ivc->tx.channel) <= n)
+#endif
+		ivc->notify(ivc, ivc->notify_data);
+
+	return 0;
+}
+EXPORT_SYMBOL(tegra_ivc_write_advance_n);
+
+static inline void tegra_ivc_invalidate_frame(struct tegra_ivc *ivc,
+					      dma_addr_t phys, u32 frame,
+					      size_t size)
+{
+	if (!ivc->peer)
+		return;
+
+	phys += sizeof(struct tegra_ivc_header) +
+		(dma_addr_t)ivc->frame_size * frame;
+	dma_sync_single_for_cpu(ivc->peer, phys, size, DMA_FROM_DEVICE);
+}
+
+/*
+ * Copy up to @max pending frames, @size bytes of each, to @buf without
+ * releasing them. Returns the number of frames copied.
+ */
+static int tegra_ivc_read_frames(struct tegra_ivc *ivc, void *buf,
+				 size_t size, u32 max)
+{
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	struct iosys_map map;
+#endif
+	u32 i, n, frame;
+	int err;
+
+	if (size > ivc->frame_size)
+		return -E2BIG;
+
+	err = tegra_ivc_check_read(ivc);
+	if (err < 0)
+		return err;
+
+	n = min(max, tegra_ivc_batch_limit(ivc, true));
+
+	/*
+	 * Order observation of tx.count before the frame contents, see
+	 * tegra_ivc_read_get_next_frame().
+	 */
+	smp_rmb();
+
+	for (i = 0, frame = ivc->rx.position; i < n; i++) {
+		tegra_ivc_invalidate_frame(ivc, ivc->rx.phys, frame, size);
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+		map = IOSYS_MAP_INIT_OFFSET(&ivc->rx.map,
+				sizeof(struct tegra_ivc_header) +
+				ivc->frame_size * frame);
+		iosys_map_memcpy_from(buf + i * size, &map, 0, size);
+#else
+		memcpy(buf + i * size, (void *)(ivc->rx.channel + 1) +
+		       ivc->frame_size * frame, size);
+#endif
+		frame = (frame + 1) % ivc->num_frames;
+	}
+
+	return n;
+}
+
+int tegra_ivc_read_peek_batch(struct tegra_ivc *ivc, void *buf, size_t size,
+			      u32 max)
+{
+	return tegra_ivc_read_frames(ivc, buf, size, max);
+}
+EXPORT_SYMBOL(tegra_ivc_read_peek_batch);
+
+int tegra_ivc_read_batch(struct tegra_ivc *ivc, void *buf, size_t size,
+			 u32 max)
+{
+	int n, err;
+
+	n = tegra_ivc_read_frames(ivc, buf, size, max);
+	if (n <= 0)
+		return n;
+
+	err = tegra_ivc_read_advance_n(ivc, n);
+	if (err < 0)
+		return err;
+
+	return n;
+}
+EXPORT_SYMBOL(tegra_ivc_read_batch);
+
+int tegra_ivc_write_batch(struct tegra_ivc *ivc, const void *buf, size_t size,
+			  u32 count)
+{
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	struct iosys_map map;
+#endif
+	u32 i, n, frame;
+	int err;
+
+	if (size > ivc->frame_size)
+		return -E2BIG;
+
+	err = tegra_ivc_check_write(ivc);
+	if (err < 0)
+		return err;
+
+	n = min(count, tegra_ivc_batch_limit(ivc, false));
+	if (n == 0)
+		return 0;
+
+	for (i = 0, frame = ivc->tx.position; i < n; i++) {
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+		map = IOSYS_MAP_INIT_OFFSET(&ivc->tx.map,
+				sizeof(struct tegra_ivc_header) +
+				ivc->frame_size * frame);
+		iosys_map_memcpy_to(&map, 0, buf + i * size, size);
+#else
+		memcpy((void *)(ivc->tx.channel + 1) + ivc->frame_size * frame,
+		       buf + i * size, size);
+#endif
+		frame = (frame + 1) % ivc->num_frames;
+	}
+
+	/* Flushes the frames, publishes them and notifies the peer once */
+	err = tegra_ivc_write_advance_n(ivc, n);
+	if (err < 0)
+		return err;
+
+	return n;
+}
+EXPORT_SYMBOL(tegra_ivc_write_batch);
+
 /* Inserting this driver as module to export
  * extended IVC driver APIs
  */
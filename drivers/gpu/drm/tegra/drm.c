@@ -209,6 +209,11 @@ int tegra_drm_submit(struct tegra_drm_context *context,
 	job->class = client->class;
 	job->serialize = true;
 	job->syncpt_recovery = true;
+	/*
+	 * Cached mappings do not hold a GEM reference, tegra_bo_free_object()
+	 * evicts them when the object goes away.
+	 */
+	job->cache_mappings = true;
 
 	/*
 	 * Track referenced BOs so that they can be unreferenced after the
@@ -763,6 +768,8 @@ static const struct drm_ioctl_desc tegra_drm_ioctls[] = {
 			  DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(TEGRA_SYNCPOINT_WAIT, tegra_drm_ioctl_syncpoint_wait,
 			  DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(TEGRA_SYNCPOINT_WAIT_MANY, tegra_drm_ioctl_syncpoint_wait_many,
+			  DRM_RENDER_ALLOW),
 
 	DRM_IOCTL_DEF_DRV(TEGRA_GEM_CREATE, tegra_gem_create, DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(TEGRA_GEM_MMAP, tegra_gem_mmap, DRM_RENDER_ALLOW),
@@ -70,8 +70,13 @@ static struct host1x_bo_mapping *tegra_bo_pin(struct device *dev, struct host1x_
 	if (!map)
 		return ERR_PTR(-ENOMEM);
 
+	/*
+	 * The mapping does not hold a reference to the buffer object. Users of
+	 * a mapping hold their own, and cached mappings are removed from their
+	 * cache by tegra_bo_free_object(), which could otherwise never run.
+	 */
 	kref_init(&map->ref);
-	map->bo = host1x_bo_get(bo);
+	map->bo = bo;
 	map->direction = direction;
 	map->dev = dev;
 
@@ -171,7 +176,6 @@ static void tegra_bo_unpin(struct host1x_bo_mapping *map)
 		kfree(map->sgt);
 	}
 
-	host1x_bo_put(map->bo);
 	kfree(map);
 }
 
@@ -1066,6 +1066,65 @@ struct drm_tegra_syncpoint_wait {
 	__u64 timestamp;
 };
 
+struct drm_tegra_syncpoint_wait_entry {
+	/**
+	 * @id: [in]
+	 *
+	 * ID of syncpoint to wait on.
+	 */
+	__u32 id;
+
+	/**
+	 * @threshold: [in]
+	 *
+	 * Threshold to wait for.
+	 */
+	__u32 threshold;
+
+	/**
+	 * @value: [out]
+	 *
+	 * Value of the syncpoint upon wait completion.
+	 */
+	__u32 value;
+
+	__u32 padding;
+
+	/**
+	 * @timestamp: [out]
+	 *
+	 * CLOCK_MONOTONIC timestamp in nanoseconds taken when the threshold
+	 * was reached.
+	 */
+	__u64 timestamp;
+};
+
+struct drm_tegra_syncpoint_wait_many {
+	/**
+	 * @timeout: [in]
+	 *
+	 * Absolute timestamp at which the wait will time out.
+	 */
+	__s64 timeout_ns;
+
+	/**
+	 * @waits_ptr: [in]
+	 *
+	 * Pointer to an array of struct drm_tegra_syncpoint_wait_entry. The
+	 * call returns once all syncpoints have reached their thresholds.
+	 */
+	__u64 waits_ptr;
+
+	/**
+	 * @num_waits: [in]
+	 *
+	 * Number of elements in the `waits_ptr` array.
+	 */
+	__u32 num_waits;
+
+	__u32 padding;
+};
+
 #define DRM_IOCTL_TEGRA_CHANNEL_OPEN DRM_IOWR(DRM_COMMAND_BASE + 0x10, struct drm_tegra_channel_open)
 #define DRM_IOCTL_TEGRA_CHANNEL_CLOSE DRM_IOWR(DRM_COMMAND_BASE + 0x11, struct drm_tegra_channel_close)
 #define DRM_IOCTL_TEGRA_CHANNEL_MAP DRM_IOWR(DRM_COMMAND_BASE + 0x12, struct drm_tegra_channel_map)
@@ -1075,6 +1134,7 @@ struct drm_tegra_syncpoint_wait {
 #define DRM_IOCTL_TEGRA_SYNCPOINT_ALLOCATE DRM_IOWR(DRM_COMMAND_BASE + 0x20, struct drm_tegra_syncpoint_allocate)
 #define DRM_IOCTL_TEGRA_SYNCPOINT_FREE DRM_IOWR(DRM_COMMAND_BASE + 0x21, struct drm_tegra_syncpoint_free)
 #define DRM_IOCTL_TEGRA_SYNCPOINT_WAIT DRM_IOWR(DRM_COMMAND_BASE + 0x22, struct drm_tegra_syncpoint_wait)
+#define DRM_IOCTL_TEGRA_SYNCPOINT_WAIT_MANY DRM_IOWR(DRM_COMMAND_BASE + 0x23, struct drm_tegra_syncpoint_wait_many)
 
 #if defined(__cplusplus)
 }
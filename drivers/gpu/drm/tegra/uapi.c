@@ -12,6 +12,9 @@
 #include "drm.h"
 #include "uapi.h"
 
+/* Upper bound on syncpoint/threshold pairs in one WAIT_MANY call */
+#define TEGRA_DRM_MAX_SYNCPOINT_WAITS 64
+
 static void tegra_drm_mapping_release(struct kref *ref)
 {
 	struct tegra_drm_mapping *mapping =
@@ -378,3 +381,70 @@ int tegra_drm_ioctl_syncpoint_wait(struct drm_device *drm, void *data, struct dr
 
 	return 0;
 }
+
+int tegra_drm_ioctl_syncpoint_wait_many(struct drm_device *drm, void *data,
+					struct drm_file *file)
+{
+	struct host1x *host1x = tegra_drm_to_host1x(drm->dev_private);
+	struct drm_tegra_syncpoint_wait_many *args = data;
+	struct drm_tegra_syncpoint_wait_entry __user *user_waits;
+	struct drm_tegra_syncpoint_wait_entry *entries;
+	struct host1x_syncpt_wait_entry *waits;
+	signed long timeout_jiffies;
+	unsigned int i;
+	int err;
+
+	if (args->padding != 0)
+		return -EINVAL;
+
+	if (args->num_waits == 0 || args->num_waits > TEGRA_DRM_MAX_SYNCPOINT_WAITS)
+		return -EINVAL;
+
+	user_waits = u64_to_user_ptr(args->waits_ptr);
+	entries = memdup_user(user_waits, array_size(args->num_waits, sizeof(*entries)));
+	if (IS_ERR(entries))
+		return PTR_ERR(entries);
+
+	waits = kcalloc(args->num_waits, sizeof(*waits), GFP_KERNEL);
+	if (!waits) {
+		err = -ENOMEM;
+		goto free_entries;
+	}
+
+	for (i = 0; i < args->num_waits; i++) {
+		if (entries[i].padding != 0) {
+			err = -EINVAL;
+			goto free_waits;
+		}
+
+		waits[i].sp = host1x_syncpt_get_by_id_noref(host1x, entries[i].id);
+		if (!waits[i].sp) {
+			err = -EINVAL;
+			goto free_waits;
+		}
+
+		waits[i].threshold = entries[i].threshold;
+	}
+
+	timeout_jiffies = drm_timeout_abs_to_jiffies(args->timeout_ns);
+
+	err = host1x_syncpt_wait_many(waits, args->num_waits, timeout_jiffies);
+	if (err)
+		goto free_waits;
+
+	for (i = 0; i < args->num_waits; i++) {
+		entries[i].value = waits[i].value;
+		entries[i].timestamp = ktime_to_ns(waits[i].ts);
+	}
+
+	if (copy_to_user(user_waits, entries,
+			 array_size(args->num_waits, sizeof(*entries))))
+		err = -EFAULT;
+
+free_waits:
+	kfree(waits);
+free_entries:
+	kfree(entries);
+
+	return err;
+}
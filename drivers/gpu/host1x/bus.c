@@ -20,6 +20,11 @@
 static DEFINE_MUTEX(clients_lock);
 static LIST_HEAD(clients);
 
+/* Size above which idle mappings are evicted from buffer object caches */
+static unsigned int bo_cache_budget_mb = 256;
+module_param(bo_cache_budget_mb, uint, 0644);
+MODULE_PARM_DESC(bo_cache_budget_mb, "Buffer object mapping cache budget in MiB (0 = unbounded)");
+
 static DEFINE_MUTEX(drivers_lock);
 static LIST_HEAD(drivers);
 
@@ -916,6 +921,29 @@ unlock:
 }
 EXPORT_SYMBOL(host1x_client_resume);
 
+static void __host1x_bo_unpin(struct kref *ref);
+
+/*
+ * Drop the cache's reference to the least recently used mappings that are
+ * not pinned by anyone else, until the cache fits in its budget again.
+ */
+static void host1x_bo_cache_evict(struct host1x_bo_cache *cache)
+{
+	size_t budget = (size_t)READ_ONCE(bo_cache_budget_mb) << 20;
+	struct host1x_bo_mapping *mapping, *tmp;
+
+	if (budget == 0)
+		return;
+
+	list_for_each_entry_safe(mapping, tmp, &cache->mappings, entry) {
+		if (cache->size <= budget)
+			break;
+
+		if (kref_read(&mapping->ref) == 1)
+			kref_put(&mapping->ref, __host1x_bo_unpin);
+	}
+}
+
 struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo,
 					enum dma_data_direction dir,
 					struct host1x_bo_cache *cache)
@@ -926,11 +954,16 @@ struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo
 		mutex_lock(&cache->lock);
 
 		list_for_each_entry(mapping, &cache->mappings, entry) {
-			if (mapping->bo == bo && mapping->direction == dir) {
+			if (mapping->bo == bo && mapping->dev == dev &&
+			    mapping->direction == dir) {
 				kref_get(&mapping->ref);
+				list_move_tail(&mapping->entry, &cache->mappings);
+				cache->hits++;
 				goto unlock;
 			}
 		}
+
+		cache->misses++;
 	}
 
 	mapping = bo->ops->pin(dev, bo, dir);
@@ -946,9 +979,12 @@ struct host1x_bo_mapping *host1x_bo_pin(struct device *dev, struct host1x_bo *bo
 		mapping->cache = cache;
 
 		list_add_tail(&mapping->entry, &cache->mappings);
+		cache->size += mapping->size;
 
 		/* bump reference count to track the copy in the cache */
 		kref_get(&mapping->ref);
+
+		host1x_bo_cache_evict(cache);
 	}
 
 unlock:
@@ -967,8 +1003,15 @@ static void __host1x_bo_unpin(struct kref *ref)
 	 * When the last reference of the mapping goes away, make sure to remove the mapping from
 	 * the cache.
 	 */
-	if (mapping->cache)
+	if (mapping->cache) {
 		list_del(&mapping->entry);
+		mapping->cache->size -= mapping->size;
+	}
+
+	if (mapping->host1x_iova_size)
+		host1x_job_unmap_gather(dev_get_drvdata(mapping->dev),
+					mapping->host1x_iova,
+					mapping->host1x_iova_size);
 
 	spin_lock(&mapping->bo->lock);
 	list_del(&mapping->list);
@@ -78,7 +78,6 @@ static int show_channel(struct host1x_channel *ch, void *data, bool show_fifo)
 static void show_syncpts(struct host1x *m, struct output *o, bool show_all)
 {
 	unsigned long irqflags;
-	struct list_head *pos;
 	unsigned int i;
 	int err;
 
@@ -94,8 +93,7 @@ static void show_syncpts(struct host1x *m, struct output *o, bool show_all)
 		unsigned int waiters = 0;
 
 		spin_lock_irqsave(&m->syncpt[i].fences.lock, irqflags);
-		list_for_each(pos, &m->syncpt[i].fences.list)
-			waiters++;
+		waiters = m->syncpt[i].fences.count;
 		spin_unlock_irqrestore(&m->syncpt[i].fences.lock, irqflags);
 
 		if (!kref_read(&m->syncpt[i].ref))
@@ -189,6 +187,31 @@ static const struct file_operations host1x_debug_fops = {
 	.release = single_release,
 };
 
+static int host1x_debug_bo_cache_show(struct seq_file *s, void *unused)
+{
+	struct host1x *host1x = s->private;
+	struct host1x_bo_cache *cache = &host1x->cache;
+
+	mutex_lock(&cache->lock);
+	seq_printf(s, "hits %lu misses %lu size %zu\n", cache->hits,
+		   cache->misses, cache->size);
+	mutex_unlock(&cache->lock);
+
+	return 0;
+}
+
+static int host1x_debug_bo_cache_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, host1x_debug_bo_cache_show, inode->i_private);
+}
+
+static const struct file_operations host1x_debug_bo_cache_fops = {
+	.open = host1x_debug_bo_cache_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static void host1x_debugfs_init(struct host1x *host1x)
 {
 	struct dentry *de = debugfs_create_dir("tegra-host1x", NULL);
@@ -201,6 +224,8 @@ static void host1x_debugfs_init(struct host1x *host1x)
 	debugfs_create_file("status", S_IRUGO, de, host1x, &host1x_debug_fops);
 	debugfs_create_file("status_all", S_IRUGO, de, host1x,
 			    &host1x_debug_all_fops);
+	debugfs_create_file("bo_cache", S_IRUGO, de, host1x,
+			    &host1x_debug_bo_cache_fops);
 
 	debugfs_create_u32("trace_cmdbuf", S_IRUGO|S_IWUSR, de,
 			   &host1x_debug_trace_cmdbuf);
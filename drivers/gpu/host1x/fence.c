@@ -142,6 +142,7 @@ struct dma_fence *host1x_fence_create(struct host1x_syncpt *sp, u32 threshold,
 	fence->sp = sp;
 	fence->threshold = threshold;
 	fence->timeout = timeout;
+	RB_CLEAR_NODE(&fence->node);
 
 	dma_fence_init(&fence->base, &host1x_syncpt_fence_ops, &sp->fences.lock,
 		       dma_fence_context_alloc(1), 0);
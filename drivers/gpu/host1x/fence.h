@@ -6,6 +6,8 @@
 #ifndef HOST1X_FENCE_H
 #define HOST1X_FENCE_H
 
+#include <linux/rbtree.h>
+
 struct host1x_syncpt_fence {
 	struct dma_fence base;
 
@@ -17,12 +19,18 @@ struct host1x_syncpt_fence {
 
 	struct delayed_work timeout_work;
 
-	struct list_head list;
+	/* Node in the syncpoint's fence tree, cleared when not queued */
+	struct rb_node node;
 };
 
+/*
+ * Pending fences of a syncpoint, ordered by threshold (wraparound aware)
+ * so that insertion is O(log n) and the earliest threshold is at hand.
+ */
 struct host1x_fence_list {
 	spinlock_t lock;
-	struct list_head list;
+	struct rb_root_cached root;
+	unsigned int count;
 };
 
 void host1x_fence_signal(struct host1x_syncpt_fence *fence, ktime_t ts);
@@ -43,23 +43,33 @@ u64 host1x_get_dma_mask(struct host1x *host1x);
 
 /**
  * struct host1x_bo_cache - host1x buffer object cache
- * @mappings: list of mappings
+ * @mappings: list of mappings, least recently used first
  * @lock: synchronizes accesses to the list of mappings
+ * @size: total size of the cached mappings
+ * @hits: number of pins served from the cache
+ * @misses: number of pins that had to create a new mapping
  *
  * Note that entries are not periodically evicted from this cache and instead need to be
  * explicitly released. This is used primarily for DRM/KMS where the cache's reference is
  * released when the last reference to a buffer object represented by a mapping in this
- * cache is dropped.
+ * cache is dropped. Mappings only referenced by the cache are also evicted, least
+ * recently used first, once the cache grows beyond its size budget.
  */
 struct host1x_bo_cache {
 	struct list_head mappings;
 	struct mutex lock;
+	size_t size;
+	unsigned long hits;
+	unsigned long misses;
 };
 
 static inline void host1x_bo_cache_init(struct host1x_bo_cache *cache)
 {
 	INIT_LIST_HEAD(&cache->mappings);
 	mutex_init(&cache->lock);
+	cache->size = 0;
+	cache->hits = 0;
+	cache->misses = 0;
 }
 
 static inline void host1x_bo_cache_destroy(struct host1x_bo_cache *cache)
@@ -152,6 +162,10 @@ struct host1x_bo_mapping {
 	dma_addr_t phys;
 	size_t size;
 
+	/* host1x IOVA of a cached gather, kept until the mapping is released */
+	dma_addr_t host1x_iova;
+	size_t host1x_iova_size;
+
 	struct host1x_bo_cache *cache;
 	struct list_head entry;
 };
@@ -235,6 +249,23 @@ int host1x_syncpt_wait_ts(struct host1x_syncpt *sp, u32 thresh, long timeout,
 			  u32 *value, ktime_t *ts);
 int host1x_syncpt_wait(struct host1x_syncpt *sp, u32 thresh, long timeout,
 		       u32 *value);
+
+/**
+ * struct host1x_syncpt_wait_entry - syncpoint/threshold pair of a multi-wait
+ * @sp: syncpoint to wait on
+ * @threshold: value to wait for
+ * @value: syncpoint value upon wait completion
+ * @ts: timestamp taken when the threshold was reached
+ */
+struct host1x_syncpt_wait_entry {
+	struct host1x_syncpt *sp;
+	u32 threshold;
+	u32 value;
+	ktime_t ts;
+};
+
+int host1x_syncpt_wait_many(struct host1x_syncpt_wait_entry *waits,
+			    unsigned int num_waits, long timeout);
 struct host1x_syncpt *host1x_syncpt_request(struct host1x_client *client,
 					    unsigned long flags);
 void host1x_syncpt_put(struct host1x_syncpt *sp);
@@ -363,6 +394,12 @@ struct host1x_job {
 	/* Whether host1x-side firewall should be ran for this job or not */
 	bool enable_firewall;
 
+	/*
+	 * Keep buffer mappings pinned for the job cached for later jobs. Only
+	 * valid if all buffer objects drop their cached mappings on release.
+	 */
+	bool cache_mappings;
+
 	/* Options for configuring engine data stream ID */
 	/* Context device to use for job */
 	struct host1x_memory_context *memory_context;
@@ -14,27 +14,55 @@
 static void host1x_intr_add_fence_to_list(struct host1x_fence_list *list,
 					  struct host1x_syncpt_fence *fence)
 {
+	struct rb_node **link = &list->root.rb_root.rb_node;
+	struct rb_node *parent = NULL;
 	struct host1x_syncpt_fence *fence_in_list;
-
-	list_for_each_entry_reverse(fence_in_list, &list->list, list) {
-		if ((s32)(fence_in_list->threshold - fence->threshold) <= 0) {
-			/* Fence in list is before us, we can insert here */
-			list_add(&fence->list, &fence_in_list->list);
-			return;
+	bool leftmost = true;
+
+	/*
+	 * Thresholds pending on a syncpoint are within half the counter range
+	 * of each other, so the signed difference orders them across wrap.
+	 * Equal thresholds keep their insertion order.
+	 */
+	while (*link) {
+		parent = *link;
+		fence_in_list = rb_entry(parent, struct host1x_syncpt_fence, node);
+
+		if ((s32)(fence->threshold - fence_in_list->threshold) < 0) {
+			link = &parent->rb_left;
+		} else {
+			link = &parent->rb_right;
+			leftmost = false;
 		}
 	}
 
-	/* Add as first in list */
-	list_add(&fence->list, &list->list);
+	rb_link_node(&fence->node, parent, link);
+	rb_insert_color_cached(&fence->node, &list->root, leftmost);
+	list->count++;
+}
+
+static void host1x_intr_del_fence_from_list(struct host1x_fence_list *list,
+					    struct host1x_syncpt_fence *fence)
+{
+	rb_erase_cached(&fence->node, &list->root);
+	RB_CLEAR_NODE(&fence->node);
+	list->count--;
+}
+
+static struct host1x_syncpt_fence *
+host1x_intr_first_fence(struct host1x_fence_list *list)
+{
+	struct rb_node *node = rb_first_cached(&list->root);
+
+	return node ? rb_entry(node, struct host1x_syncpt_fence, node) : NULL;
 }
 
 static void host1x_intr_update_hw_state(struct host1x *host, struct host1x_syncpt *sp)
 {
 	struct host1x_syncpt_fence *fence;
 
-	if (!list_empty(&sp->fences.list)) {
-		fence = list_first_entry(&sp->fences.list, struct host1x_syncpt_fence, list);
-
+	fence = host1x_intr_first_fence(&sp->fences);
+	if (fence) {
 		host1x_hw_intr_set_syncpt_threshold(host, sp->id, fence->threshold);
 		host1x_hw_intr_enable_syncpt_intr(host, sp->id);
 	} else {
@@ -46,10 +74,11 @@ void host1x_intr_add_fence_locked(struct host1x *host, struct host1x_syncpt_fenc
 {
 	struct host1x_fence_list *fence_list = &fence->sp->fences;
 
-	INIT_LIST_HEAD(&fence->list);
-
 	host1x_intr_add_fence_to_list(fence_list, fence);
-	host1x_intr_update_hw_state(host, fence->sp);
+
+	/* The armed threshold only changes if this is the new earliest fence */
+	if (host1x_intr_first_fence(fence_list) == fence)
+		host1x_intr_update_hw_state(host, fence->sp);
 }
 
 bool host1x_intr_remove_fence(struct host1x *host, struct host1x_syncpt_fence *fence)
@@ -59,12 +88,12 @@ bool host1x_intr_remove_fence(struct host1x *host, struct host1x_syncpt_fence *f
 
 	spin_lock_irqsave(&fence_list->lock, irqflags);
 
-	if (list_empty(&fence->list)) {
+	if (RB_EMPTY_NODE(&fence->node)) {
 		spin_unlock_irqrestore(&fence_list->lock, irqflags);
 		return false;
 	}
 
-	list_del_init(&fence->list);
+	host1x_intr_del_fence_from_list(fence_list, fence);
 	host1x_intr_update_hw_state(host, fence->sp);
 
 	spin_unlock_irqrestore(&fence_list->lock, irqflags);
@@ -75,20 +104,21 @@ bool host1x_intr_remove_fence(struct host1x *host, struct host1x_syncpt_fence *f
 void host1x_intr_handle_interrupt(struct host1x *host, unsigned int id, ktime_t ts)
 {
 	struct host1x_syncpt *sp = &host->syncpt[id];
-	struct host1x_syncpt_fence *fence, *tmp;
+	struct host1x_syncpt_fence *fence;
 	unsigned int value;
 
 	value = host1x_syncpt_load(sp);
 
 	spin_lock(&sp->fences.lock);
 
-	list_for_each_entry_safe(fence, tmp, &sp->fences.list, list) {
+	/* Only the expired fences at the front of the tree are visited */
+	while ((fence = host1x_intr_first_fence(&sp->fences)) != NULL) {
 		if (((value - fence->threshold) & 0x80000000U) != 0U) {
 			/* Fence is not yet expired, we are done */
 			break;
 		}
 
-		list_del_init(&fence->list);
+		host1x_intr_del_fence_from_list(&sp->fences, fence);
 		host1x_fence_signal(fence, ts);
 	}
 
@@ -108,7 +138,8 @@ int host1x_intr_init(struct host1x *host)
 		struct host1x_syncpt *syncpt = &host->syncpt[id];
 
 		spin_lock_init(&syncpt->fences.lock);
-		INIT_LIST_HEAD(&syncpt->fences.list);
+		syncpt->fences.root = RB_ROOT_CACHED;
+		syncpt->fences.count = 0;
 	}
 
 	return 0;
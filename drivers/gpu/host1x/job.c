@@ -154,6 +154,49 @@ void host1x_job_add_reg_write(struct host1x_job *job, u32 reg, u32 value)
 }
 EXPORT_SYMBOL(host1x_job_add_reg_write);
 
+/*
+ * Map a gather into the host1x IOMMU domain. Returns the IOVA and the size
+ * to pass to host1x_job_unmap_gather() later.
+ */
+static int host1x_job_map_gather(struct host1x *host,
+				 struct host1x_bo_mapping *map,
+				 dma_addr_t *addr, size_t *size)
+{
+	size_t gather_size = 0;
+	struct scatterlist *sg;
+	unsigned long shift;
+	struct iova *alloc;
+	unsigned int j;
+
+	for_each_sgtable_sg(map->sgt, sg, j)
+		gather_size += sg->length;
+
+	gather_size = iova_align(&host->iova, gather_size);
+
+	shift = iova_shift(&host->iova);
+	alloc = alloc_iova(&host->iova, gather_size >> shift,
+			   host->iova_end >> shift, true);
+	if (!alloc)
+		return -ENOMEM;
+
+	if (iommu_map_sgtable(host->domain, iova_dma_addr(&host->iova, alloc),
+			      map->sgt, IOMMU_READ) == 0) {
+		__free_iova(&host->iova, alloc);
+		return -EINVAL;
+	}
+
+	*addr = iova_dma_addr(&host->iova, alloc);
+	*size = gather_size;
+
+	return 0;
+}
+
+void host1x_job_unmap_gather(struct host1x *host, dma_addr_t addr, size_t size)
+{
+	iommu_unmap(host->domain, addr, size);
+	free_iova(&host->iova, iova_pfn(&host->iova, addr));
+}
+
 static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 {
 	unsigned long mask = HOST1X_RELOC_READ | HOST1X_RELOC_WRITE;
@@ -197,7 +240,8 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 			goto unpin;
 		}
 
-		map = host1x_bo_pin(dev, bo, direction, NULL);
+		map = host1x_bo_pin(dev, bo, direction,
+				    job->cache_mappings ? &host->cache : NULL);
 		if (IS_ERR(map)) {
 			err = PTR_ERR(map);
 			goto unpin;
@@ -215,6 +259,7 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 
 		job->addr_phys[job->num_unpins] = map->phys;
 		job->unpins[job->num_unpins].map = map;
+		job->unpins[job->num_unpins].size = 0;
 		job->num_unpins++;
 	}
 
@@ -227,11 +272,8 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 
 	for (i = 0; i < job->num_cmds; i++) {
 		struct host1x_bo_mapping *map;
-		size_t gather_size = 0;
-		struct scatterlist *sg;
-		unsigned long shift;
-		struct iova *alloc;
-		unsigned int j;
+		size_t gather_size;
+		dma_addr_t addr;
 
 		if (job->cmds[i].type != HOST1X_JOB_CMD_GATHER)
 			continue;
@@ -244,43 +286,48 @@ static unsigned int pin_job(struct host1x *host, struct host1x_job *job)
 			goto unpin;
 		}
 
-		map = host1x_bo_pin(host->dev, g->bo, DMA_TO_DEVICE, NULL);
+		map = host1x_bo_pin(host->dev, g->bo, DMA_TO_DEVICE,
+				    job->cache_mappings ? &host->cache : NULL);
 		if (IS_ERR(map)) {
 			err = PTR_ERR(map);
 			goto unpin;
 		}
 
-		if (host->domain) {
-			for_each_sgtable_sg(map->sgt, sg, j)
-				gather_size += sg->length;
-
-			gather_size = iova_align(&host->iova, gather_size);
+		addr = map->phys;
+		gather_size = 0;
+		err = 0;
 
-			shift = iova_shift(&host->iova);
-			alloc = alloc_iova(&host->iova, gather_size >> shift,
-					   host->iova_end >> shift, true);
-			if (!alloc) {
-				err = -ENOMEM;
-				goto put;
-			}
-
-			err = iommu_map_sgtable(host->domain, iova_dma_addr(&host->iova, alloc),
-						map->sgt, IOMMU_READ);
-			if (err == 0) {
-				__free_iova(&host->iova, alloc);
-				err = -EINVAL;
-				goto put;
-			}
+		if (host->domain && map->cache) {
+			/*
+			 * Cached mappings keep their host1x IOVA until they are
+			 * evicted, so only the first job maps the gather.
+			 */
+			mutex_lock(&map->cache->lock);
+			if (!map->host1x_iova_size)
+				err = host1x_job_map_gather(host, map,
+							    &map->host1x_iova,
+							    &map->host1x_iova_size);
+			addr = map->host1x_iova;
+			mutex_unlock(&map->cache->lock);
+		} else if (host->domain) {
+			/*
+			 * The mapping is private to this job, its host1x IOVA is
+			 * released by host1x_job_unpin().
+			 */
+			err = host1x_job_map_gather(host, map, &addr, &gather_size);
+		}
 
-			map->phys = iova_dma_addr(&host->iova, alloc);
-			map->size = gather_size;
+		if (err < 0) {
+			host1x_bo_unpin(map);
+			goto put;
 		}
 
-		job->addr_phys[job->num_unpins] = map->phys;
+		job->addr_phys[job->num_unpins] = addr;
 		job->unpins[job->num_unpins].map = map;
+		job->unpins[job->num_unpins].size = gather_size;
 		job->num_unpins++;
 
-		job->gather_addr_phys[i] = map->phys;
+		job->gather_addr_phys[i] = addr;
 	}
 
 	return 0;
@@ -673,12 +720,11 @@ void host1x_job_unpin(struct host1x_job *job)
 
 	for (i = 0; i < job->num_unpins; i++) {
 		struct host1x_bo_mapping *map = job->unpins[i].map;
+		size_t size = job->unpins[i].size;
 		struct host1x_bo *bo = map->bo;
 
-		if (!job->enable_firewall && map->size && host->domain) {
-			iommu_unmap(host->domain, job->addr_phys[i], map->size);
-			free_iova(&host->iova, iova_pfn(&host->iova, job->addr_phys[i]));
-		}
+		if (!job->enable_firewall && size && host->domain)
+			host1x_job_unmap_gather(host, job->addr_phys[i], size);
 
 		host1x_bo_unpin(map);
 		host1x_bo_put(bo);
@@ -10,6 +10,8 @@
 
 #include <linux/dma-direction.h>
 
+struct host1x;
+
 struct host1x_job_gather {
 	unsigned int words;
 	dma_addr_t base;
@@ -48,8 +50,15 @@ struct host1x_job_cmd {
 
 struct host1x_job_unpin_data {
 	struct host1x_bo_mapping *map;
+	/* Size of the host1x IOVA mapping made for a gather, if any */
+	size_t size;
 };
 
+/*
+ * Release the host1x IOVA of a gather mapped by host1x_job_pin().
+ */
+void host1x_job_unmap_gather(struct host1x *host, dma_addr_t addr, size_t size);
+
 /*
  * Dump contents of job to debug output.
  */
@@ -22,6 +22,14 @@
 #define SYNCPT_CHECK_PERIOD (2 * HZ)
 #define MAX_STUCK_CHECK_COUNT 15
 
+/*
+ * Wait policy thresholds on the expected completion latency: up to
+ * SYNCPT_SPIN_MAX_US busy-wait, up to SYNCPT_POLL_MAX_US poll with short
+ * sleeps, beyond that go straight to the interrupt driven fence wait.
+ */
+#define SYNCPT_SPIN_MAX_US 50
+#define SYNCPT_POLL_MAX_US 1000
+
 static struct host1x_syncpt_base *
 host1x_syncpt_base_request(struct host1x *host)
 {
@@ -229,6 +237,49 @@ int host1x_syncpt_incr(struct host1x_syncpt *sp)
 }
 EXPORT_SYMBOL(host1x_syncpt_incr);
 
+/*
+ * Fold the latency of a completed wait into the syncpoint's moving average,
+ * giving the new sample a weight of 1/8.
+ */
+static void host1x_syncpt_update_latency(struct host1x_syncpt *sp,
+					 ktime_t start, ktime_t end)
+{
+	u32 avg = READ_ONCE(sp->wait_latency_us);
+	s64 sample = ktime_us_delta(end, start);
+
+	sample = clamp_t(s64, sample, 0, USEC_PER_SEC);
+	WRITE_ONCE(sp->wait_latency_us, (u32)((avg * 7ULL + sample) / 8));
+}
+
+/*
+ * Pick how long to wait before falling back to a fence wait, and whether to
+ * poll with sleeps (returned in @poll_us) or busy-wait in between checks.
+ */
+static u32 host1x_syncpt_wait_budget(struct host1x_syncpt *sp, long timeout,
+				     u32 *poll_us)
+{
+	u32 latency = READ_ONCE(sp->wait_latency_us);
+
+	*poll_us = 0;
+
+	/*
+	 * Even 1 jiffy is longer than 50us, so assume timeout is over 50us
+	 * always except for polls (timeout=0)
+	 */
+	if (timeout == 0)
+		return 0;
+
+	if (latency <= SYNCPT_SPIN_MAX_US)
+		return clamp_t(u32, 2 * latency, 5, SYNCPT_SPIN_MAX_US);
+
+	if (latency <= SYNCPT_POLL_MAX_US) {
+		*poll_us = latency / 8;
+		return 2 * latency;
+	}
+
+	return 0;
+}
+
 /**
  * host1x_syncpt_wait_ts() - wait for a syncpoint to reach a given value
  * @sp: host1x syncpoint
@@ -241,17 +292,17 @@ int host1x_syncpt_wait_ts(struct host1x_syncpt *sp, u32 thresh, long timeout, u3
 			  ktime_t *ts)
 {
 	struct dma_fence *fence;
-	ktime_t spin_timeout, time;
+	ktime_t start, spin_timeout, time;
+	bool waited = false;
 	long wait_err;
+	u32 poll_us;
 
 	if (timeout < 0)
 		timeout = LONG_MAX;
 
-	/*
-	 * Even 1 jiffy is longer than 50us, so assume timeout is over 50us
-	 * always except for polls (timeout=0)
-	 */
-	spin_timeout = ktime_add_us(ktime_get(), timeout > 0 ? 50 : 0);
+	start = ktime_get();
+	spin_timeout = ktime_add_us(start,
+				    host1x_syncpt_wait_budget(sp, timeout, &poll_us));
 	for (;;) {
 		host1x_hw_syncpt_load(sp->host, sp);
 		time = ktime_get();
@@ -259,11 +310,18 @@ int host1x_syncpt_wait_ts(struct host1x_syncpt *sp, u32 thresh, long timeout, u3
 			*value = host1x_syncpt_load(sp);
 		if (ts)
 			*ts = time;
-		if (host1x_syncpt_is_expired(sp, thresh))
+		if (host1x_syncpt_is_expired(sp, thresh)) {
+			if (waited)
+				host1x_syncpt_update_latency(sp, start, time);
 			return 0;
+		}
 		if (ktime_compare(time, spin_timeout) > 0)
 			break;
-		udelay(5);
+		if (poll_us)
+			usleep_range(poll_us, 2 * poll_us);
+		else
+			udelay(5);
+		waited = true;
 	}
 
 	if (timeout == 0)
@@ -276,6 +334,8 @@ int host1x_syncpt_wait_ts(struct host1x_syncpt *sp, u32 thresh, long timeout, u3
 	wait_err = dma_fence_wait_timeout(fence, true, timeout);
 	if (wait_err == 0)
 		host1x_fence_cancel(fence);
+	else if (wait_err > 0)
+		host1x_syncpt_update_latency(sp, start, fence->timestamp);
 
 	if (value)
 		*value = host1x_syncpt_load(sp);
@@ -312,6 +372,134 @@ int host1x_syncpt_wait(struct host1x_syncpt *sp, u32 thresh, long timeout, u32 *
 }
 EXPORT_SYMBOL(host1x_syncpt_wait);
 
+struct host1x_syncpt_multi_wait {
+	atomic_t pending;
+	struct completion done;
+};
+
+struct host1x_syncpt_multi_wait_cb {
+	struct dma_fence_cb cb;
+	struct dma_fence *fence;
+	struct host1x_syncpt_multi_wait *wait;
+};
+
+static void host1x_syncpt_multi_wait_signal(struct dma_fence *f,
+					    struct dma_fence_cb *cb)
+{
+	struct host1x_syncpt_multi_wait_cb *wcb =
+		container_of(cb, struct host1x_syncpt_multi_wait_cb, cb);
+
+	/* Only the last syncpoint to complete wakes up the waiter */
+	if (atomic_dec_and_test(&wcb->wait->pending))
+		complete(&wcb->wait->done);
+}
+
+/**
+ * host1x_syncpt_wait_many() - wait for several syncpoints to reach given values
+ * @waits: syncpoint/threshold pairs, value and timestamp are filled on return
+ * @num_waits: number of entries in @waits
+ * @timeout: maximum time to wait for all pairs to complete
+ *
+ * Pairs that have not completed yet share a single completion, so the
+ * caller is woken up once when the last of them is reached rather than
+ * once per syncpoint.
+ */
+int host1x_syncpt_wait_many(struct host1x_syncpt_wait_entry *waits,
+			    unsigned int num_waits, long timeout)
+{
+	struct host1x_syncpt_multi_wait_cb *cbs;
+	struct host1x_syncpt_multi_wait wait;
+	struct host1x_syncpt_wait_entry *w;
+	struct dma_fence *fence;
+	ktime_t start;
+	long wait_err = 1;
+	unsigned int i;
+	int err = 0;
+
+	if (timeout < 0)
+		timeout = LONG_MAX;
+
+	cbs = kcalloc(num_waits, sizeof(*cbs), GFP_KERNEL);
+	if (!cbs)
+		return -ENOMEM;
+
+	/* Hold one extra count so the completion cannot fire during setup */
+	atomic_set(&wait.pending, 1);
+	init_completion(&wait.done);
+
+	start = ktime_get();
+	for (i = 0; i < num_waits; i++) {
+		w = &waits[i];
+
+		host1x_hw_syncpt_load(w->sp->host, w->sp);
+		if (host1x_syncpt_is_expired(w->sp, w->threshold))
+			continue;
+
+		if (timeout == 0) {
+			err = -EAGAIN;
+			break;
+		}
+
+		fence = host1x_fence_create(w->sp, w->threshold, false);
+		if (IS_ERR(fence)) {
+			err = PTR_ERR(fence);
+			break;
+		}
+
+		cbs[i].fence = fence;
+		cbs[i].wait = &wait;
+		atomic_inc(&wait.pending);
+		if (dma_fence_add_callback(fence, &cbs[i].cb,
+					   host1x_syncpt_multi_wait_signal))
+			atomic_dec(&wait.pending);
+	}
+
+	if (!err && !atomic_dec_and_test(&wait.pending))
+		wait_err = wait_for_completion_interruptible_timeout(&wait.done,
+								     timeout);
+
+	for (i = 0; i < num_waits; i++) {
+		w = &waits[i];
+		fence = cbs[i].fence;
+
+		w->value = host1x_syncpt_load(w->sp);
+		w->ts = ktime_get();
+
+		if (!fence)
+			continue;
+
+		/* Still queued means the threshold was not reached in time */
+		if (dma_fence_remove_callback(fence, &cbs[i].cb))
+			host1x_fence_cancel(fence);
+		else if (test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &fence->flags))
+			w->ts = fence->timestamp;
+
+		if (!fence->error)
+			host1x_syncpt_update_latency(w->sp, start, w->ts);
+
+		dma_fence_put(fence);
+	}
+
+	kfree(cbs);
+
+	if (err)
+		return err;
+	if (wait_err < 0)
+		return wait_err;
+
+	/* Same as for a single wait, don't trust a zero wait result alone */
+	for (i = 0; i < num_waits; i++) {
+		w = &waits[i];
+
+		host1x_hw_syncpt_load(w->sp->host, w->sp);
+		if (!host1x_syncpt_is_expired(w->sp, w->threshold))
+			return -EAGAIN;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(host1x_syncpt_wait_many);
+
 /*
  * Returns true if syncpoint is expired, false if we may need to wait
  */
@@ -345,6 +533,7 @@ int host1x_syncpt_init(struct host1x *host)
 	for (i = 0; i < host->info->nb_pts; i++) {
 		syncpt[i].id = i;
 		syncpt[i].host = host;
+		syncpt[i].wait_latency_us = SYNCPT_SPIN_MAX_US;
 
 		/*
 		 * Make syncpoints client managed by default, so that
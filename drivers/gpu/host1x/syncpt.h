@@ -43,6 +43,9 @@ struct host1x_syncpt {
 	/* interrupt data */
 	struct host1x_fence_list fences;
 
+	/* Moving average of recent wait completion latency, in microseconds */
+	u32 wait_latency_us;
+
 	/*
 	 * If a submission incrementing this syncpoint fails, lock it so that
 	 * further submission cannot be made until application has handled the
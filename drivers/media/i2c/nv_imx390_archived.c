@@ -60,6 +60,8 @@ struct imx390 {
 	u32	frame_length;
 	struct camera_common_data	*s_data;
 	struct tegracam_device		*tc_dev;
+	struct regmap_util_prog		*mode_progs[ARRAY_SIZE(mode_table)];
+	struct regmap_util_shadow	*shadow;
 };
 
 static const struct regmap_config sensor_regmap_config = {
@@ -144,25 +146,44 @@ static int imx390_write_reg(struct camera_common_data *s_data,
 {
 	int err;
 	struct device *dev = s_data->dev;
+	struct imx390 *priv = (struct imx390 *)s_data->priv;
 
 	err = regmap_write(s_data->regmap, addr, val);
 	if (err)
 		dev_err(dev, "%s:i2c write failed, 0x%x = %x\n",
 			__func__, addr, val);
+	else if (priv)
+		regmap_util_shadow_update(priv->shadow, addr, val);
 
 	return err;
 }
 
-static int imx390_write_table(struct imx390 *priv,
-				const imx390_reg table[])
+static int imx390_write_mode(struct imx390 *priv, int mode)
 {
 	struct camera_common_data *s_data = priv->s_data;
 
-	return regmap_util_write_table_8(s_data->regmap,
-					 table,
-					 NULL, 0,
-					 IMX390_TABLE_WAIT_MS,
-					 IMX390_TABLE_END);
+	/* Only registers differing from the current state are written */
+	return regmap_util_write_prog(s_data->regmap, priv->mode_progs[mode],
+				      priv->shadow);
+}
+
+static int imx390_compile_tables(struct imx390 *priv, struct device *dev)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mode_table); i++) {
+		priv->mode_progs[i] = regmap_util_compile_table_8(dev,
+					mode_table[i], NULL, 0,
+					IMX390_TABLE_WAIT_MS,
+					IMX390_TABLE_END,
+					REGMAP_UTIL_MAX_BURST);
+		if (IS_ERR(priv->mode_progs[i]))
+			return PTR_ERR(priv->mode_progs[i]);
+	}
+
+	priv->shadow = regmap_util_shadow_alloc(dev);
+
+	return PTR_ERR_OR_ZERO(priv->shadow);
 }
 
 static struct mutex serdes_lock__;
@@ -227,8 +248,14 @@ static int imx390_power_on(struct camera_common_data *s_data)
 	struct camera_common_power_rail *pw = s_data->power;
 	struct camera_common_pdata *pdata = s_data->pdata;
 	struct device *dev = s_data->dev;
+	struct imx390 *priv = (struct imx390 *)s_data->priv;
 
 	dev_dbg(dev, "%s: power on\n", __func__);
+
+	/* Register contents are not retained across power cycles */
+	if (priv)
+		regmap_util_shadow_invalidate(priv->shadow);
+
 	if (pdata && pdata->power_on) {
 		err = pdata->power_on(pw);
 		if (err)
@@ -249,6 +276,7 @@ static int imx390_power_off(struct camera_common_data *s_data)
 	struct camera_common_power_rail *pw = s_data->power;
 	struct camera_common_pdata *pdata = s_data->pdata;
 	struct device *dev = s_data->dev;
+	struct imx390 *priv = (struct imx390 *)s_data->priv;
 
 	dev_dbg(dev, "%s:\n", __func__);
 
@@ -262,6 +290,8 @@ static int imx390_power_off(struct camera_common_data *s_data)
 	}
 
 power_off_done:
+	if (priv)
+		regmap_util_shadow_invalidate(priv->shadow);
 	pw->state = SWITCH_OFF;
 
 	return 0;
@@ -478,7 +508,7 @@ static int imx390_set_mode(struct tegracam_device *tc_dev)
 	if (s_data->mode_prop_idx < 0)
 		return -EINVAL;
 
-	return imx390_write_table(priv, mode_table[s_data->mode_prop_idx]);
+	return imx390_write_mode(priv, s_data->mode_prop_idx);
 }
 
 static int imx390_start_streaming(struct tegracam_device *tc_dev)
@@ -498,8 +528,7 @@ static int imx390_start_streaming(struct tegracam_device *tc_dev)
 	if (err)
 		goto exit;
 
-	err = imx390_write_table(priv,
-		mode_table[IMX390_MODE_START_STREAM]);
+	err = imx390_write_mode(priv, IMX390_MODE_START_STREAM);
 	if (err)
 		return err;
 
@@ -521,7 +550,7 @@ static int imx390_stop_streaming(struct tegracam_device *tc_dev)
 	/* disable serdes streaming */
 	max9296_stop_streaming(priv->dser_dev, dev);
 
-	return imx390_write_table(priv, mode_table[IMX390_MODE_STOP_STREAM]);
+	return imx390_write_mode(priv, IMX390_MODE_STOP_STREAM);
 }
 
 static struct camera_common_sensor_ops imx390_common_ops = {
@@ -776,6 +805,12 @@ static int imx390_probe(struct i2c_client *client,
 	if (!priv)
 		return -ENOMEM;
 
+	err = imx390_compile_tables(priv, dev);
+	if (err) {
+		dev_err(dev, "failed to compile register tables\n");
+		return err;
+	}
+
 	tc_dev = devm_kzalloc(dev,
 			sizeof(struct tegracam_device), GFP_KERNEL);
 	if (!tc_dev)
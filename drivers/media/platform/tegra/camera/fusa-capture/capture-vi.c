@@ -305,6 +305,9 @@ static void vi_capture_ivc_status_callback(
 					buffer_index,
 					capture->progress_status_buffer_depth,
 					PROGRESS_STATUS_DONE);
+		} else if (capture->status_cb != NULL) {
+			capture->status_cb(chan, capture->status_cb_priv,
+					buffer_index);
 		} else {
 			/*
 			 * Only fire completions if not using
@@ -1467,6 +1470,27 @@ int vi_capture_status(
 }
 EXPORT_SYMBOL_GPL(vi_capture_status);
 
+int vi_capture_set_status_callback(
+	struct tegra_vi_channel *chan,
+	vi_capture_status_cb cb,
+	void *priv)
+{
+	struct vi_capture *capture = chan->capture_data;
+
+	if (capture == NULL) {
+		dev_err(chan->dev,
+			 "%s: vi capture uninitialized\n", __func__);
+		return -ENODEV;
+	}
+
+	/* must be called before the first vi_capture_request() */
+	capture->status_cb_priv = priv;
+	capture->status_cb = cb;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(vi_capture_set_status_callback);
+
 int vi_capture_set_progress_status_notifier(
 	struct tegra_vi_channel *chan,
 	struct vi_capture_progress_status_req *req)
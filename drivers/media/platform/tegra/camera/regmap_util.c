@@ -5,10 +5,48 @@
  * Copyright (c) 2013-2022, NVIDIA Corporation. All Rights Reserved.
  */
 
+#include <linux/bitmap.h>
+#include <linux/device.h>
+#include <linux/limits.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
 #include <linux/regmap.h>
+#include <linux/slab.h>
 #include <linux/module.h>
 #include <media/camera_common.h>
 
+/*
+ * Unchanged registers between two changed ones are rewritten rather than
+ * starting a new transfer, as long as the gap is below the i2c overhead
+ */
+#define REGMAP_UTIL_DIFF_GAP	3
+
+#define REGMAP_UTIL_OP_WAIT	BIT(0)
+#define REGMAP_UTIL_OP_FORCE	BIT(1)
+
+/* Burst write of len registers from addr, or a delay of arg ms */
+struct regmap_util_op {
+	u16 addr;
+	u8 len;
+	u8 flags;
+	u32 arg;
+};
+
+struct regmap_util_prog {
+	struct regmap_util_op *ops;
+	unsigned int num_ops;
+	u8 *vals;
+	unsigned int num_vals;
+};
+
+/* Last value written to each register since the sensor was powered up */
+struct regmap_util_shadow {
+	/* Protects vals and valid */
+	struct mutex lock;
+	u8 vals[U16_MAX + 1];
+	DECLARE_BITMAP(valid, U16_MAX + 1);
+};
+
 int
 regmap_util_write_table_8(struct regmap *regmap,
 			  const struct reg_8 table[],
@@ -165,5 +203,310 @@ regmap_util_write_table_16_as_8(struct regmap *regmap,
 }
 
 EXPORT_SYMBOL_GPL(regmap_util_write_table_16_as_8);
+
+/*
+ * Walk the table the way regmap_util_write_table_8() does and emit one
+ * op per burst. Only counts the ops and values when prog->ops is NULL.
+ */
+static void regmap_util_emit_table_8(struct regmap_util_prog *prog,
+				     const struct reg_8 table[],
+				     const struct reg_8 override_list[],
+				     int num_override_regs, u16 wait_ms_addr,
+				     u16 end_addr, unsigned int max_burst)
+{
+	struct regmap_util_op *op = NULL;
+	const struct reg_8 *next;
+	unsigned int num_ops = 0, num_vals = 0;
+	unsigned int range_count = 0;
+	int range_start = -1;
+	int i;
+	u8 val;
+
+	for (next = table; next->addr != end_addr; next++) {
+		if (next->addr == wait_ms_addr) {
+			/* Registers written right before a delay are usually triggers */
+			if (op && !(op->flags & REGMAP_UTIL_OP_WAIT))
+				op->flags |= REGMAP_UTIL_OP_FORCE;
+
+			op = prog->ops ? &prog->ops[num_ops] : NULL;
+			if (op) {
+				op->flags = REGMAP_UTIL_OP_WAIT;
+				op->arg = next->val;
+			}
+			num_ops++;
+
+			range_start = -1;
+			range_count = 0;
+			continue;
+		}
+
+		val = next->val;
+		if (override_list) {
+			for (i = 0; i < num_override_regs; i++) {
+				if (next->addr == override_list[i].addr) {
+					val = override_list[i].val;
+					break;
+				}
+			}
+		}
+
+		if (next->addr != range_start + range_count ||
+		    range_count == max_burst) {
+			op = prog->ops ? &prog->ops[num_ops] : NULL;
+			if (op) {
+				op->addr = next->addr;
+				op->len = 0;
+				op->flags = 0;
+				op->arg = num_vals;
+			}
+			num_ops++;
+
+			range_start = next->addr;
+			range_count = 0;
+		}
+
+		if (op) {
+			op->len++;
+			prog->vals[num_vals] = val;
+		}
+		num_vals++;
+		range_count++;
+	}
+
+	prog->num_ops = num_ops;
+	prog->num_vals = num_vals;
+}
+
+/**
+ * regmap_util_compile_table_8 - turn a register table into a write program
+ * @dev: device owning the program, it is freed along with it
+ * @table: table terminated by @end_addr
+ * @override_list: register values replacing the ones in @table, or NULL
+ * @num_override_regs: number of entries in @override_list
+ * @wait_ms_addr: address marking a delay entry
+ * @end_addr: address marking the end of the table
+ * @max_burst: largest number of registers written in one transfer
+ *
+ * The overrides and the burst coalescing are resolved once here instead of
+ * on every regmap_util_write_table_8() call.
+ */
+struct regmap_util_prog *
+regmap_util_compile_table_8(struct device *dev,
+			    const struct reg_8 table[],
+			    const struct reg_8 override_list[],
+			    int num_override_regs,
+			    u16 wait_ms_addr, u16 end_addr,
+			    unsigned int max_burst)
+{
+	struct regmap_util_prog *prog;
+
+	if (!max_burst || max_burst > U8_MAX)
+		return ERR_PTR(-EINVAL);
+
+	prog = devm_kzalloc(dev, sizeof(*prog), GFP_KERNEL);
+	if (!prog)
+		return ERR_PTR(-ENOMEM);
+
+	regmap_util_emit_table_8(prog, table, override_list, num_override_regs,
+				 wait_ms_addr, end_addr, max_burst);
+
+	prog->ops = devm_kcalloc(dev, max(prog->num_ops, 1U),
+				 sizeof(*prog->ops), GFP_KERNEL);
+	prog->vals = devm_kzalloc(dev, max(prog->num_vals, 1U), GFP_KERNEL);
+	if (!prog->ops || !prog->vals)
+		return ERR_PTR(-ENOMEM);
+
+	regmap_util_emit_table_8(prog, table, override_list, num_override_regs,
+				 wait_ms_addr, end_addr, max_burst);
+
+	return prog;
+}
+EXPORT_SYMBOL_GPL(regmap_util_compile_table_8);
+
+static void regmap_util_shadow_free(void *data)
+{
+	struct regmap_util_shadow *shadow = data;
+
+	mutex_destroy(&shadow->lock);
+	kvfree(shadow);
+}
+
+/**
+ * regmap_util_shadow_alloc - allocate an empty shadow register cache
+ * @dev: device owning the cache, it is freed along with it
+ */
+struct regmap_util_shadow *regmap_util_shadow_alloc(struct device *dev)
+{
+	struct regmap_util_shadow *shadow;
+	int err;
+
+	shadow = kvzalloc(sizeof(*shadow), GFP_KERNEL);
+	if (!shadow)
+		return ERR_PTR(-ENOMEM);
+
+	mutex_init(&shadow->lock);
+
+	err = devm_add_action_or_reset(dev, regmap_util_shadow_free, shadow);
+	if (err)
+		return ERR_PTR(err);
+
+	return shadow;
+}
+EXPORT_SYMBOL_GPL(regmap_util_shadow_alloc);
+
+/*
+ * Forget the whole register state, must be called whenever the sensor
+ * loses it, e.g. on power off or reset.
+ */
+void regmap_util_shadow_invalidate(struct regmap_util_shadow *shadow)
+{
+	if (!shadow)
+		return;
+
+	mutex_lock(&shadow->lock);
+	bitmap_zero(shadow->valid, U16_MAX + 1);
+	mutex_unlock(&shadow->lock);
+}
+EXPORT_SYMBOL_GPL(regmap_util_shadow_invalidate);
+
+/* Record a register write done outside of regmap_util_write_prog() */
+void regmap_util_shadow_update(struct regmap_util_shadow *shadow,
+			       u16 addr, u8 val)
+{
+	if (!shadow)
+		return;
+
+	mutex_lock(&shadow->lock);
+	shadow->vals[addr] = val;
+	__set_bit(addr, shadow->valid);
+	mutex_unlock(&shadow->lock);
+}
+EXPORT_SYMBOL_GPL(regmap_util_shadow_update);
+
+static bool regmap_util_shadow_match(struct regmap_util_shadow *shadow,
+				     u16 addr, u8 val)
+{
+	return test_bit(addr, shadow->valid) && shadow->vals[addr] == val;
+}
+
+static int regmap_util_write_range(struct regmap *regmap,
+				   struct regmap_util_shadow *shadow,
+				   u16 addr, const u8 *vals, unsigned int count)
+{
+	unsigned int i;
+	int err;
+
+	if (count == 1)
+		err = regmap_write(regmap, addr, vals[0]);
+	else
+		err = regmap_bulk_write(regmap, addr, vals, count);
+
+	if (!shadow)
+		return err;
+
+	/* A failed transfer leaves the registers in an unknown state */
+	if (err) {
+		bitmap_clear(shadow->valid, addr, count);
+		return err;
+	}
+
+	for (i = 0; i < count; i++)
+		shadow->vals[addr + i] = vals[i];
+	bitmap_set(shadow->valid, addr, count);
+
+	return 0;
+}
+
+static int regmap_util_write_op_diff(struct regmap *regmap,
+				     struct regmap_util_shadow *shadow,
+				     const struct regmap_util_op *op,
+				     const u8 *vals, bool *written)
+{
+	unsigned int i = 0, j, last;
+	int err;
+
+	while (i < op->len) {
+		if (regmap_util_shadow_match(shadow, op->addr + i, vals[i])) {
+			i++;
+			continue;
+		}
+
+		/* Extend the run over short gaps of unchanged registers */
+		last = i;
+		for (j = i + 1; j < op->len; j++) {
+			if (!regmap_util_shadow_match(shadow, op->addr + j, vals[j]))
+				last = j;
+			else if (j - last > REGMAP_UTIL_DIFF_GAP)
+				break;
+		}
+
+		err = regmap_util_write_range(regmap, shadow, op->addr + i,
+					      &vals[i], last - i + 1);
+		if (err)
+			return err;
+
+		*written = true;
+		i = last + 1;
+	}
+
+	return 0;
+}
+
+/**
+ * regmap_util_write_prog - write a program built by regmap_util_compile_table_8()
+ * @regmap: sensor register map
+ * @prog: program to write
+ * @shadow: shadow register cache, or NULL to write the whole program
+ *
+ * With a shadow cache only the registers whose value differs from the one
+ * last written are sent to the sensor, bursts flagged as triggers are
+ * always written. Delays are skipped when nothing was written since the
+ * previous one.
+ */
+int regmap_util_write_prog(struct regmap *regmap,
+			   const struct regmap_util_prog *prog,
+			   struct regmap_util_shadow *shadow)
+{
+	const struct regmap_util_op *op;
+	bool written = false;
+	unsigned int i;
+	int err = 0;
+
+	if (shadow)
+		mutex_lock(&shadow->lock);
+
+	for (i = 0; i < prog->num_ops; i++) {
+		op = &prog->ops[i];
+
+		if (op->flags & REGMAP_UTIL_OP_WAIT) {
+			if (!shadow || written)
+				msleep_range(op->arg);
+			written = false;
+			continue;
+		}
+
+		if (shadow && !(op->flags & REGMAP_UTIL_OP_FORCE)) {
+			err = regmap_util_write_op_diff(regmap, shadow, op,
+							&prog->vals[op->arg],
+							&written);
+		} else {
+			err = regmap_util_write_range(regmap, shadow, op->addr,
+						      &prog->vals[op->arg],
+						      op->len);
+			written = true;
+		}
+
+		if (err) {
+			pr_err("%s:regmap_util_write_prog:%d", __func__, err);
+			break;
+		}
+	}
+
+	if (shadow)
+		mutex_unlock(&shadow->lock);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(regmap_util_write_prog);
 MODULE_LICENSE("GPL");
 
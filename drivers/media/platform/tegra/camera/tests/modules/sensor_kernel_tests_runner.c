@@ -36,6 +36,11 @@ static struct skt_test skt_available_tests[] = {
 		.description = "Asserts compliance of sensor DT",
 		.run = sensor_verify_dt,
 	},
+	{
+		.name = "Regmap Table Test",
+		.description = "Asserts compiled register tables and differential writes",
+		.run = regmap_util_verify_prog,
+	},
 };
 
 int skt_runner_num_tests(void)
@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * regmap_util_test - compiled register table test
+ *
+ * Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ */
+
+#include <linux/device.h>
+#include <linux/err.h>
+#include <linux/regmap.h>
+#include <linux/slab.h>
+
+#include <media/camera_common.h>
+
+#include "tegracam_tests.h"
+#include "utils/tegracam_log.h"
+
+#define RU_TEST_NREGS    (0x100U)
+#define RU_TEST_WAIT_MS  (0xFFFEU)
+#define RU_TEST_END      (0xFFFFU)
+
+/*
+ * Two modes differing in one register of three bursts. 0x40 is written
+ * right before a delay and must go out on every mode switch.
+ */
+static const struct reg_8 ru_test_mode_a[] = {
+	{0x10, 0x01}, {0x11, 0x02}, {0x12, 0x03}, {0x13, 0x04},
+	{0x14, 0x05}, {0x15, 0x06}, {0x16, 0x07}, {0x17, 0x08},
+	{0x20, 0x10}, {0x21, 0x11}, {0x22, 0x12}, {0x23, 0x13},
+	{0x40, 0x01},
+	{RU_TEST_WAIT_MS, 1},
+	{0x50, 0xaa}, {0x51, 0xbb},
+	{RU_TEST_END, 0x00},
+};
+
+static const struct reg_8 ru_test_mode_b[] = {
+	{0x10, 0x01}, {0x11, 0x02}, {0x12, 0x33}, {0x13, 0x04},
+	{0x14, 0x05}, {0x15, 0x06}, {0x16, 0x07}, {0x17, 0x08},
+	{0x20, 0x10}, {0x21, 0x44}, {0x22, 0x12}, {0x23, 0x13},
+	{0x40, 0x01},
+	{RU_TEST_WAIT_MS, 1},
+	{0x50, 0xaa}, {0x51, 0xcc},
+	{RU_TEST_END, 0x00},
+};
+
+static const struct reg_8 ru_test_override[] = {
+	{0x11, 0x77},
+};
+
+#define RU_TEST_MODE_REGS    (15U)
+#define RU_TEST_MODE_CHANGED (3U)
+#define RU_TEST_MODE_FORCED  (1U)
+
+/**
+ * ru_test_mock - register file standing in for a sensor
+ *
+ * @regs:    register values
+ * @nwrites: number of register writes seen
+ */
+struct ru_test_mock {
+	u8 regs[RU_TEST_NREGS];
+	unsigned int nwrites;
+};
+
+static int ru_test_reg_write(void *context, unsigned int reg, unsigned int val)
+{
+	struct ru_test_mock *mock = context;
+
+	if (reg >= RU_TEST_NREGS)
+		return -EINVAL;
+
+	mock->regs[reg] = val;
+	mock->nwrites++;
+
+	return 0;
+}
+
+static int ru_test_reg_read(void *context, unsigned int reg, unsigned int *val)
+{
+	struct ru_test_mock *mock = context;
+
+	if (reg >= RU_TEST_NREGS)
+		return -EINVAL;
+
+	*val = mock->regs[reg];
+
+	return 0;
+}
+
+static const struct regmap_config ru_test_regmap_config = {
+	.reg_bits = 16,
+	.val_bits = 8,
+	.max_register = RU_TEST_NREGS - 1,
+	.reg_read = ru_test_reg_read,
+	.reg_write = ru_test_reg_write,
+	.cache_type = REGCACHE_NONE,
+};
+
+/**
+ * ru_test_check_regs - compare the mock register file against a table
+ *
+ * @mock:  mock register file
+ * @table: expected register values
+ * @name:  step name for the log
+ */
+static int ru_test_check_regs(const struct ru_test_mock *mock,
+		const struct reg_8 table[], const char *name)
+{
+	const struct reg_8 *next;
+
+	for (next = table; next->addr != RU_TEST_END; next++) {
+		if (next->addr == RU_TEST_WAIT_MS)
+			continue;
+
+		if (mock->regs[next->addr] != next->val) {
+			camtest_log(KERN_ERR
+				"  %s: reg 0x%04x is 0x%02x, expected 0x%02x\n",
+				name, next->addr, mock->regs[next->addr],
+				next->val);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * ru_test_write - write a program and check the number of register writes
+ *
+ * @regmap:  mock register map
+ * @mock:    mock register file
+ * @prog:    program to write
+ * @shadow:  shadow register cache or NULL
+ * @nwrites: expected number of register writes
+ * @name:    step name for the log
+ */
+static int ru_test_write(struct regmap *regmap, struct ru_test_mock *mock,
+		const struct regmap_util_prog *prog,
+		struct regmap_util_shadow *shadow,
+		const unsigned int nwrites, const char *name)
+{
+	int err;
+
+	mock->nwrites = 0;
+	err = regmap_util_write_prog(regmap, prog, shadow);
+	if (err != 0) {
+		camtest_log(KERN_ERR "  %s: write failed (%d)\n", name, err);
+		return -1;
+	}
+
+	if (mock->nwrites != nwrites) {
+		camtest_log(KERN_ERR "  %s: %u register writes, expected %u\n",
+				name, mock->nwrites, nwrites);
+		return -1;
+	}
+
+	camtest_log(KERN_INFO "  %s: %u register writes\n", name, nwrites);
+
+	return 0;
+}
+
+/**
+ * regmap_util_verify_prog - exercise compiled tables and differential writes
+ *
+ * Free-standing, the sensor node is not used. A mock register map takes
+ * the place of the sensor so that the number of writes of a mode switch
+ * can be checked without hardware.
+ *
+ * @node:         sensor node (unused)
+ * @tvcf_version: TVCF version (unused)
+ */
+int regmap_util_verify_prog(struct device_node *node, const u32 tvcf_version)
+{
+	struct regmap_util_prog *prog_a, *prog_b, *prog_o;
+	struct regmap_util_shadow *shadow;
+	struct ru_test_mock *mock;
+	struct regmap *regmap;
+	struct device *dev;
+	int res = -1;
+
+	dev = root_device_register("skt_regmap_util");
+	if (IS_ERR(dev))
+		return -1;
+
+	mock = kzalloc(sizeof(*mock), GFP_KERNEL);
+	if (mock == NULL)
+		goto unregister;
+
+	regmap = regmap_init(dev, NULL, mock, &ru_test_regmap_config);
+	if (IS_ERR(regmap))
+		goto free_mock;
+
+	prog_a = regmap_util_compile_table_8(dev, ru_test_mode_a, NULL, 0,
+			RU_TEST_WAIT_MS, RU_TEST_END, REGMAP_UTIL_MAX_BURST);
+	prog_b = regmap_util_compile_table_8(dev, ru_test_mode_b, NULL, 0,
+			RU_TEST_WAIT_MS, RU_TEST_END, REGMAP_UTIL_MAX_BURST);
+	prog_o = regmap_util_compile_table_8(dev, ru_test_mode_a,
+			ru_test_override, ARRAY_SIZE(ru_test_override),
+			RU_TEST_WAIT_MS, RU_TEST_END, REGMAP_UTIL_MAX_BURST);
+	shadow = regmap_util_shadow_alloc(dev);
+	if (IS_ERR(prog_a) || IS_ERR(prog_b) || IS_ERR(prog_o) ||
+			IS_ERR(shadow)) {
+		camtest_log(KERN_ERR "  unable to compile test tables\n");
+		goto exit_regmap;
+	}
+
+	/* Without a shadow cache every register goes out */
+	if (ru_test_write(regmap, mock, prog_a, NULL,
+			RU_TEST_MODE_REGS, "full write") != 0 ||
+			ru_test_check_regs(mock, ru_test_mode_a,
+				"full write") != 0)
+		goto exit_regmap;
+
+	/* A cold shadow cache knows nothing about the sensor */
+	if (ru_test_write(regmap, mock, prog_a, shadow,
+			RU_TEST_MODE_REGS, "cold shadow") != 0)
+		goto exit_regmap;
+
+	/* Same mode again, only the register before the delay */
+	if (ru_test_write(regmap, mock, prog_a, shadow,
+			RU_TEST_MODE_FORCED, "same mode") != 0)
+		goto exit_regmap;
+
+	/* Mode switch, only what differs plus the register before the delay */
+	if (ru_test_write(regmap, mock, prog_b, shadow,
+			RU_TEST_MODE_CHANGED + RU_TEST_MODE_FORCED,
+			"mode switch") != 0 ||
+			ru_test_check_regs(mock, ru_test_mode_b,
+				"mode switch") != 0)
+		goto exit_regmap;
+
+	/* Sensor lost its state, e.g. on power off */
+	regmap_util_shadow_invalidate(shadow);
+	if (ru_test_write(regmap, mock, prog_a, shadow,
+			RU_TEST_MODE_REGS, "invalidated shadow") != 0 ||
+			ru_test_check_regs(mock, ru_test_mode_a,
+				"invalidated shadow") != 0)
+		goto exit_regmap;
+
+	/* Overrides are resolved at compile time */
+	if (ru_test_write(regmap, mock, prog_o, NULL,
+			RU_TEST_MODE_REGS, "override") != 0)
+		goto exit_regmap;
+
+	if (mock->regs[ru_test_override[0].addr] != ru_test_override[0].val) {
+		camtest_log(KERN_ERR "  override: reg 0x%04x not overridden\n",
+				ru_test_override[0].addr);
+		goto exit_regmap;
+	}
+
+	res = 0;
+
+exit_regmap:
+	regmap_exit(regmap);
+free_mock:
+	kfree(mock);
+unregister:
+	/* Releases the programs and the shadow cache */
+	root_device_unregister(dev);
+
+	return res;
+}
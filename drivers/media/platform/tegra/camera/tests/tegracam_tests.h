@@ -12,5 +12,6 @@
  * Tegra Camera Kernel Tests
  */
 int sensor_verify_dt(struct device_node *node, const u32 tvcf_version);
+int regmap_util_verify_prog(struct device_node *node, const u32 tvcf_version);
 
 #endif // __TEGRACAM_TESTS_H__
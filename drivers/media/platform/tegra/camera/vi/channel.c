@@ -2645,7 +2645,6 @@ int tegra_channel_init(struct tegra_channel *chan)
 	spin_lock_init(&chan->start_lock);
 	spin_lock_init(&chan->release_lock);
 	INIT_LIST_HEAD(&chan->dequeue);
-	init_waitqueue_head(&chan->dequeue_wait);
 	spin_lock_init(&chan->dequeue_lock);
 	mutex_init(&chan->stop_kthread_lock);
 	init_rwsem(&chan->reset_lock);
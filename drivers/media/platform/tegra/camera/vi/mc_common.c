@@ -9,6 +9,7 @@
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/of_platform.h>
+#include <linux/workqueue.h>
 
 #include <media/tegra_v4l2_camera.h>
 #include <media/camera_common.h>
@@ -366,7 +367,20 @@ EXPORT_SYMBOL(tegra_vi_media_controller_init);
 int tegra_capture_vi_media_controller_init(struct tegra_mc_vi *mc_vi,
 				   struct platform_device *pdev)
 {
-	return tegra_vi_media_controller_init_int(mc_vi, pdev);
+	int err;
+
+	mc_vi->capture_wq = alloc_workqueue("vi-capture",
+			WQ_UNBOUND | WQ_HIGHPRI, 0);
+	if (!mc_vi->capture_wq)
+		return -ENOMEM;
+
+	err = tegra_vi_media_controller_init_int(mc_vi, pdev);
+	if (err) {
+		destroy_workqueue(mc_vi->capture_wq);
+		mc_vi->capture_wq = NULL;
+	}
+
+	return err;
 }
 EXPORT_SYMBOL(tegra_capture_vi_media_controller_init);
 
@@ -376,6 +390,10 @@ void tegra_vi_media_controller_cleanup(struct tegra_mc_vi *mc_vi)
 	tegra_vi_graph_cleanup(mc_vi);
 	tegra_vi_channels_cleanup(mc_vi);
 	tegra_vi_v4l2_cleanup(mc_vi);
+	if (mc_vi->capture_wq) {
+		destroy_workqueue(mc_vi->capture_wq);
+		mc_vi->capture_wq = NULL;
+	}
 	tegra_mcvi = NULL;
 }
 EXPORT_SYMBOL(tegra_vi_media_controller_cleanup);
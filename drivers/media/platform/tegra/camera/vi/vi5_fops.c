@@ -19,6 +19,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/semaphore.h>
 #include <linux/syscalls.h>
+#include <linux/workqueue.h>
 #include <media/fusa-capture/capture-vi-channel.h>
 #include <media/fusa-capture/capture-vi.h>
 #include <media/mc_common.h>
@@ -326,6 +327,60 @@ static struct tegra_csi_channel *find_linked_csi_channel(
 	return csi_chan;
 }
 
+/*
+ * Capture completion is event driven: status indications from RCE bump a
+ * per-port counter and kick the channel's status work on the VI-wide
+ * workqueue, which retires buffers from the head of the dequeue list once
+ * every port has reported. Channels never block each other, and no thread
+ * sleeps per buffer.
+ */
+static void vi5_capture_status_cb(struct tegra_vi_channel *vi_chan,
+	void *priv, uint32_t buffer_index)
+{
+	struct tegra_channel *chan = priv;
+	unsigned int vi_port;
+
+	for (vi_port = 0; vi_port < chan->valid_ports; vi_port++) {
+		if (chan->tegra_vi_channel[vi_port] == vi_chan) {
+			atomic_inc(&chan->capture_status_cnt[vi_port]);
+			break;
+		}
+	}
+
+	queue_work(chan->vi->capture_wq, &chan->status_work);
+}
+
+static void vi5_capture_error(struct tegra_channel *chan)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->capture_state_lock, flags);
+	chan->capture_state = CAPTURE_ERROR;
+	spin_unlock_irqrestore(&chan->capture_state_lock, flags);
+
+	queue_work(chan->vi->capture_wq, &chan->error_work);
+}
+
+/* The timeout covers the head of the dequeue list only */
+static void vi5_capture_arm_timeout(struct tegra_channel *chan)
+{
+	bool pending;
+
+	if (chan->capture_timeout_ms < 0)
+		return;
+
+	spin_lock(&chan->dequeue_lock);
+	pending = !list_empty(&chan->dequeue);
+	spin_unlock(&chan->dequeue_lock);
+
+	if (pending)
+		mod_delayed_work(chan->vi->capture_wq,
+			&chan->capture_timeout_work,
+			msecs_to_jiffies(chan->capture_timeout_ms));
+	else
+		cancel_delayed_work(&chan->capture_timeout_work);
+}
+
 static int tegra_channel_capture_setup(struct tegra_channel *chan, unsigned int vi_port)
 {
 	struct vi_capture_setup setup = default_setup;
@@ -381,6 +436,14 @@ static int tegra_channel_capture_setup(struct tegra_channel *chan, unsigned int
 		return err;
 	}
 
+	atomic_set(&chan->capture_status_cnt[vi_port], 0);
+	err = vi_capture_set_status_callback(chan->tegra_vi_channel[vi_port],
+			vi5_capture_status_cb, chan);
+	if (err) {
+		dev_err(chan->vi->dev, "vi capture status callback failed\n");
+		return err;
+	}
+
 	return 0;
 }
 
@@ -463,6 +526,7 @@ static void vi5_capture_enqueue(struct tegra_channel *chan,
 	int err = 0;
 	unsigned int vi_port;
 	unsigned long flags;
+	bool first;
 	struct tegra_mc_vi *vi = chan->vi;
 	struct vi_capture_req request[2] = {{
 		.buffer_index = 0,
@@ -470,6 +534,18 @@ static void vi5_capture_enqueue(struct tegra_channel *chan,
 		.buffer_index = 0,
 	}};
 
+	for (vi_port = 0; vi_port < chan->valid_ports; vi_port++)
+		buf->capture_descr_index[vi_port] = chan->capture_descr_index;
+
+	/*
+	 * The status of a request may be reported before vi_capture_request()
+	 * returns, so the buffer has to be on the dequeue list first.
+	 */
+	spin_lock(&chan->dequeue_lock);
+	first = list_empty(&chan->dequeue);
+	list_add_tail(&buf->queue, &chan->dequeue);
+	spin_unlock(&chan->dequeue_lock);
+
 	for (vi_port = 0; vi_port < chan->valid_ports; vi_port++) {
 		vi5_setup_surface(chan, buf, chan->capture_descr_index, vi_port);
 		request[vi_port].buffer_index = chan->capture_descr_index;
@@ -487,36 +563,38 @@ static void vi5_capture_enqueue(struct tegra_channel *chan,
 			chan->capture_reqs_enqueued += 1;
 		}
 		spin_unlock_irqrestore(&chan->capture_state_lock, flags);
-		buf->capture_descr_index[vi_port] = chan->capture_descr_index;
 	}
 	chan->capture_descr_index = ((chan->capture_descr_index + 1)
 					% (chan->capture_queue_depth));
 
-	spin_lock(&chan->dequeue_lock);
-	list_add_tail(&buf->queue, &chan->dequeue);
-	spin_unlock(&chan->dequeue_lock);
-
-	wake_up_interruptible(&chan->dequeue_wait);
+	if (first)
+		vi5_capture_arm_timeout(chan);
 
 	return;
 
 uncorr_err:
-	spin_lock_irqsave(&chan->capture_state_lock, flags);
-	chan->capture_state = CAPTURE_ERROR;
-	spin_unlock_irqrestore(&chan->capture_state_lock, flags);
+	/* not (fully) submitted, hand the buffer back to vb2 */
+	spin_lock(&chan->dequeue_lock);
+	list_del_init(&buf->queue);
+	spin_unlock(&chan->dequeue_lock);
+	vb2_buffer_done(&buf->buf.vb2_buf, VB2_BUF_STATE_ERROR);
+
+	vi5_capture_error(chan);
 }
 
+/*
+ * Retire a buffer whose status has been reported on every port, or release
+ * it with an error if it is no longer active.
+ */
 static void vi5_capture_dequeue(struct tegra_channel *chan,
 	struct tegra_channel_buffer *buf)
 {
-	int err = 0;
 	bool frame_err = false;
 	int vi_port = 0;
 	int gang_prev_frame_id = 0;
 	unsigned long flags;
 	struct tegra_mc_vi *vi = chan->vi;
 	struct vb2_v4l2_buffer *vb = &buf->buf;
-	int timeout_ms = CAPTURE_TIMEOUT_MS;
 	struct timespec64 ts;
 	struct capture_descriptor *descr = NULL;
 
@@ -526,27 +604,7 @@ static void vi5_capture_dequeue(struct tegra_channel *chan,
 		if (buf->vb2_state != VB2_BUF_STATE_ACTIVE)
 			goto rel_buf;
 
-		/* Dequeue a frame and check its capture status */
-		timeout_ms = chan->capture_timeout_ms;
-		err = vi_capture_status(chan->tegra_vi_channel[vi_port], timeout_ms);
-		if (err) {
-			if (err == -ETIMEDOUT) {
-				if (timeout_ms < 0) {
-					spin_lock_irqsave(&chan->capture_state_lock, flags);
-					chan->capture_state = CAPTURE_ERROR_TIMEOUT;
-					spin_unlock_irqrestore(&chan->capture_state_lock, flags);
-					buf->vb2_state = VB2_BUF_STATE_ERROR;
-					goto rel_buf;
-				} else {
-					dev_err(vi->dev,
-						"uncorr_err: request timed out after %d ms\n",
-						timeout_ms);
-				}
-			} else {
-				dev_err(vi->dev, "uncorr_err: request err %d\n", err);
-			}
-			goto uncorr_err;
-		} else if (descr->status.status != CAPTURE_STATUS_SUCCESS) {
+		if (descr->status.status != CAPTURE_STATUS_SUCCESS) {
 			if ((descr->status.flags
 					& CAPTURE_STATUS_FLAG_CHANNEL_IN_ERROR) != 0) {
 				chan->queue_error = true;
@@ -593,9 +651,7 @@ static void vi5_capture_dequeue(struct tegra_channel *chan,
 	goto rel_buf;
 
 uncorr_err:
-	spin_lock_irqsave(&chan->capture_state_lock, flags);
-	chan->capture_state = CAPTURE_ERROR;
-	spin_unlock_irqrestore(&chan->capture_state_lock, flags);
+	vi5_capture_error(chan);
 
 	buf->vb2_state = VB2_BUF_STATE_ERROR;
 
@@ -625,6 +681,9 @@ static int vi5_channel_error_recover(struct tegra_channel *chan,
 		chan->tegra_vi_channel[vi_port] = NULL;
 	}
 
+	/* no more status indications, drop whatever was in flight */
+	cancel_work_sync(&chan->status_work);
+	cancel_delayed_work_sync(&chan->capture_timeout_work);
 
 	/* release all previously-enqueued capture buffers to v4l2 */
 	while (!list_empty(&chan->capture)) {
@@ -723,64 +782,96 @@ static int tegra_channel_kthread_capture_enqueue(void *data)
 	return 0;
 }
 
-static int tegra_channel_kthread_capture_dequeue(void *data)
+static void vi5_capture_status_work(struct work_struct *work)
 {
-	int err = 0;
-	unsigned long flags;
-	struct tegra_channel *chan = data;
+	struct tegra_channel *chan = container_of(work, struct tegra_channel,
+		status_work);
 	struct tegra_channel_buffer *buf;
-
-	set_freezable();
-	allow_signal(SIGINT);
+	unsigned int vi_port;
+	unsigned long flags;
 
 	while (1) {
-		try_to_freeze();
-
-		wait_event_interruptible(chan->dequeue_wait,
-			(kthread_should_stop()
-				|| !list_empty(&chan->dequeue)
-				|| (chan->capture_state == CAPTURE_ERROR)));
-
-		while (!(kthread_should_stop() || list_empty(&chan->dequeue)
-				|| (chan->capture_state == CAPTURE_ERROR))) {
-
-			buf = dequeue_dequeue_buffer(chan);
-			if (!buf)
-				break;
-
-			vi5_capture_dequeue(chan, buf);
-		}
-
 		spin_lock_irqsave(&chan->capture_state_lock, flags);
-		if (chan->capture_state == CAPTURE_ERROR_TIMEOUT) {
+		if (chan->capture_state == CAPTURE_ERROR) {
 			spin_unlock_irqrestore(&chan->capture_state_lock,
 				flags);
-			break;
+			return;
 		}
+		spin_unlock_irqrestore(&chan->capture_state_lock, flags);
 
-		if (chan->capture_state == CAPTURE_ERROR) {
-			spin_unlock_irqrestore(&chan->capture_state_lock,
-				flags);
-			err = tegra_channel_error_recover(chan, false);
-			if (err) {
-				dev_err(chan->vi->dev,
-					"fatal: error recovery failed\n");
-				break;
-			}
-		} else
-			spin_unlock_irqrestore(&chan->capture_state_lock,
-				flags);
-		if (kthread_should_stop())
+		spin_lock(&chan->dequeue_lock);
+		buf = list_first_entry_or_null(&chan->dequeue,
+			struct tegra_channel_buffer, queue);
+		for (vi_port = 0; buf && vi_port < chan->valid_ports; vi_port++)
+			if (atomic_read(&chan->capture_status_cnt[vi_port]) == 0)
+				buf = NULL;
+		if (buf)
+			list_del_init(&buf->queue);
+		spin_unlock(&chan->dequeue_lock);
+
+		if (!buf)
 			break;
+
+		for (vi_port = 0; vi_port < chan->valid_ports; vi_port++)
+			atomic_dec(&chan->capture_status_cnt[vi_port]);
+
+		vi5_capture_dequeue(chan, buf);
 	}
 
-	return 0;
+	vi5_capture_arm_timeout(chan);
+}
+
+static void vi5_capture_timeout_work(struct work_struct *work)
+{
+	struct tegra_channel *chan = container_of(to_delayed_work(work),
+		struct tegra_channel, capture_timeout_work);
+	bool stalled = false;
+	unsigned int vi_port;
+
+	/* the head may have completed while status work is still queued */
+	spin_lock(&chan->dequeue_lock);
+	if (!list_empty(&chan->dequeue))
+		for (vi_port = 0; vi_port < chan->valid_ports; vi_port++)
+			if (atomic_read(&chan->capture_status_cnt[vi_port]) == 0)
+				stalled = true;
+	spin_unlock(&chan->dequeue_lock);
+
+	if (!stalled)
+		return;
+
+	dev_err(chan->vi->dev, "uncorr_err: request timed out after %d ms\n",
+		chan->capture_timeout_ms);
+	vi5_capture_error(chan);
+}
+
+static void vi5_capture_error_work(struct work_struct *work)
+{
+	struct tegra_channel *chan = container_of(work, struct tegra_channel,
+		error_work);
+	int err;
+
+	/* the enqueue kthread is only around while the channel is streaming */
+	mutex_lock(&chan->stop_kthread_lock);
+	if (chan->kthread_capture_start) {
+		err = tegra_channel_error_recover(chan, false);
+		if (err)
+			dev_err(chan->vi->dev,
+				"fatal: error recovery failed\n");
+		else
+			wake_up_interruptible(&chan->start_wait);
+	}
+	mutex_unlock(&chan->stop_kthread_lock);
 }
 
 static int vi5_channel_start_kthreads(struct tegra_channel *chan)
 {
 	int err = 0;
 
+	INIT_WORK(&chan->status_work, vi5_capture_status_work);
+	INIT_WORK(&chan->error_work, vi5_capture_error_work);
+	INIT_DELAYED_WORK(&chan->capture_timeout_work,
+		vi5_capture_timeout_work);
+
 	/* Start the kthread for capture enqueue */
 	if (chan->kthread_capture_start) {
 		dev_err(chan->vi->dev, "enqueue kthread already initialized\n");
@@ -796,21 +887,6 @@ static int vi5_channel_start_kthreads(struct tegra_channel *chan)
 		goto done;
 	}
 
-	/* Start the kthread for capture dequeue */
-	if (chan->kthread_capture_dequeue) {
-		dev_err(chan->vi->dev, "dequeue kthread already initialized\n");
-		err = -1;
-		goto done;
-	}
-	chan->kthread_capture_dequeue = kthread_run(
-		tegra_channel_kthread_capture_dequeue, chan, chan->video->name);
-	if (IS_ERR(chan->kthread_capture_dequeue)) {
-		dev_err(&chan->video->dev,
-			"failed to run kthread for capture dequeue\n");
-		err = PTR_ERR(chan->kthread_capture_dequeue);
-		goto done;
-	}
-
 done:
 	return err;
 }
@@ -825,16 +901,20 @@ static void vi5_channel_stop_kthreads(struct tegra_channel *chan)
 		chan->kthread_capture_start = NULL;
 	}
 
-	/* Stop the kthread for capture dequeue */
-	if (chan->kthread_capture_dequeue) {
-		send_sig(SIGINT, chan->kthread_capture_dequeue, 1);
-		kthread_stop(chan->kthread_capture_dequeue);
-		chan->kthread_capture_dequeue = NULL;
-	}
-
 	mutex_unlock(&chan->stop_kthread_lock);
 }
 
+/*
+ * Call once the VI channels have been released, so that no new status
+ * indication can requeue the completion work.
+ */
+static void vi5_channel_flush_completions(struct tegra_channel *chan)
+{
+	cancel_work_sync(&chan->status_work);
+	cancel_work_sync(&chan->error_work);
+	cancel_delayed_work_sync(&chan->capture_timeout_work);
+}
+
 static void vi5_unit_get_device_handle(struct platform_device *pdev,
 		uint32_t csi_stream_id, struct device **dev)
 {
@@ -966,10 +1046,12 @@ err_set_stream:
 		vi5_channel_stop_kthreads(chan);
 
 err_start_kthreads:
-	if (!chan->bypass)
+	if (!chan->bypass) {
 		for (vi_port = 0; vi_port < chan->valid_ports; vi_port++)
 			vi_capture_release(chan->tegra_vi_channel[vi_port],
 				CAPTURE_CHANNEL_RESET_FLAG_IMMEDIATE);
+		vi5_channel_flush_completions(chan);
+	}
 
 err_setup:
 	if (!chan->bypass)
@@ -1005,7 +1087,12 @@ static int vi5_channel_stop_streaming(struct vb2_queue *vq)
 			if (err)
 				dev_err(&chan->video->dev,
 					"vi capture release failed\n");
+		}
 
+		/* completion work reads the descriptors freed below */
+		vi5_channel_flush_completions(chan);
+
+		for (vi_port = 0; vi_port < chan->valid_ports; vi_port++) {
 			/* Release capture requests */
 			if (chan->request[vi_port] != NULL) {
 				dma_free_coherent(chan->tegra_vi_channel[vi_port]->rtcpu_dev,
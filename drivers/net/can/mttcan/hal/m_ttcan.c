@@ -500,6 +500,11 @@ void ttcan_tx_trigger_msg_transmit(struct ttcan_controller *ttcan, u8 index)
 	ttcan_write32(ttcan, ADR_MTTCAN_TXBAR, (1 << index));
 }
 
+void ttcan_tx_trigger_msgs_transmit(struct ttcan_controller *ttcan, u32 mask)
+{
+	ttcan_write32(ttcan, ADR_MTTCAN_TXBAR, mask);
+}
+
 int ttcan_tx_msg_buffer_write(struct ttcan_controller *ttcan,
 			      struct ttcanfd_frame *ttcanfd)
 {
@@ -608,11 +613,20 @@ int ttcan_tx_fifo_full(struct ttcan_controller *ttcan)
 	return (txfqs_reg & MTT_TXFQS_TFQF_MASK) >> MTT_TXFQS_TFQF_SHIFT;
 }
 
-static int process_rx_mesg(struct ttcan_controller *ttcan, u32 addr)
+/* Copy one element of message RAM straight into the next free ring slot */
+static int process_rx_mesg(struct ttcan_controller *ttcan,
+			   struct ttcan_rx_ring *ring, u32 addr)
 {
-	struct ttcanfd_frame ttcanfd = {0};
-	ttcan_read_rx_msg_ram(ttcan, addr, &ttcanfd);
-	return add_msg_controller_list(ttcan, &ttcanfd, &ttcan->rx_b, BUFFER);
+	struct ttcanfd_frame *ttcanfd = ttcan_rx_ring_prod(ring);
+
+	if (ttcanfd == NULL)
+		return -ENOMEM;
+
+	memset(ttcanfd, 0, sizeof(*ttcanfd));
+	ttcan_read_rx_msg_ram(ttcan, addr, ttcanfd);
+	ttcan_rx_ring_push(ring);
+
+	return 0;
 }
 
 int ttcan_read_rx_buffer(struct ttcan_controller *ttcan)
@@ -630,7 +644,7 @@ int ttcan_read_rx_buffer(struct ttcan_controller *ttcan)
 		if (ndat1) {
 			read_addr = ttcan->mram_cfg[MRAM_RXB].off + (bit_set1 *
 				ttcan->e_size.rx_buffer);
-			if (process_rx_mesg(ttcan, read_addr))
+			if (process_rx_mesg(ttcan, ttcan->rx_b, read_addr))
 				return msgs_read;
 			ttcan_write32(ttcan, ADR_MTTCAN_NDAT1,
 				(1 << (bit_set1)));
@@ -640,7 +654,7 @@ int ttcan_read_rx_buffer(struct ttcan_controller *ttcan)
 		if (ndat2) {
 			read_addr = ttcan->mram_cfg[MRAM_RXB].off + (bit_set2 *
 				ttcan->e_size.rx_buffer);
-			if (process_rx_mesg(ttcan, read_addr))
+			if (process_rx_mesg(ttcan, ttcan->rx_b, read_addr))
 				return msgs_read;
 			ttcan_write32(ttcan, ADR_MTTCAN_NDAT2,
 				(1 << (bit_set2)));
@@ -657,7 +671,7 @@ int ttcan_read_rx_buffer(struct ttcan_controller *ttcan)
 
 unsigned int ttcan_read_txevt_fifo(struct ttcan_controller *ttcan)
 {
-	struct mttcan_tx_evt_element txevt;
+	struct mttcan_tx_evt_element *txevt;
 	u32 txefs;
 	u32 read_addr;
 	int q_read = 0;
@@ -681,12 +695,13 @@ unsigned int ttcan_read_txevt_fifo(struct ttcan_controller *ttcan)
 		pr_debug("%s:txevt: read_addr %x EFGI %x\n", __func__,
 			 read_addr, get_idx);
 
-		ttcan_read_txevt_ram(ttcan, read_addr, &txevt);
-		if (add_event_controller_list(ttcan, &txevt,
-					      &ttcan->tx_evt) < 0) {
-			pr_err("%s: failed to add to list\n", __func__);
+		txevt = ttcan_txevt_ring_prod(ttcan->tx_evt);
+		if (txevt == NULL) {
+			pr_debug("%s: tx event ring full\n", __func__);
 			return msgs_read;
 		}
+		ttcan_read_txevt_ram(ttcan, read_addr, txevt);
+		ttcan_txevt_ring_push(ttcan->tx_evt);
 		ttcan_write32(ttcan, ADR_MTTCAN_TXEFA, get_idx);
 		txefs = ttcan_read32(ttcan, ADR_MTTCAN_TXEFS);
 		msgs_read++;
@@ -699,7 +714,6 @@ unsigned int ttcan_read_txevt_fifo(struct ttcan_controller *ttcan)
 unsigned int ttcan_read_rx_fifo0(struct ttcan_controller *ttcan)
 {
 	u32 rxf0s_reg;
-	struct ttcanfd_frame ttcanfd = {0};
 	u32 read_addr;
 	int q_read = 0;
 	unsigned int msgs_read = 0;
@@ -730,12 +744,9 @@ unsigned int ttcan_read_rx_fifo0(struct ttcan_controller *ttcan)
 		pr_debug("%s:fifo0: read_addr %x FOGI %x\n", __func__,
 			 read_addr, get_idx);
 
-		ttcan_read_rx_msg_ram(ttcan, read_addr, &ttcanfd);
-		if (add_msg_controller_list(ttcan, &ttcanfd,
-					    &ttcan->rx_q0, FIFO_0) < 0) {
-			pr_err("%s: failed to add to list\n", __func__);
+		/* Leave the element in the FIFO until the ring drains */
+		if (process_rx_mesg(ttcan, ttcan->rx_q0, read_addr))
 			return msgs_read;
-		}
 		ttcan_write32(ttcan, ADR_MTTCAN_RXF0A, get_idx);
 		rxf0s_reg = ttcan_read32(ttcan, ADR_MTTCAN_RXF0S);
 		msgs_read++;
@@ -746,7 +757,6 @@ unsigned int ttcan_read_rx_fifo0(struct ttcan_controller *ttcan)
 unsigned int ttcan_read_rx_fifo1(struct ttcan_controller *ttcan)
 {
 	u32 rxf1s_reg;
-	struct ttcanfd_frame ttcanfd = {0};
 	u32 read_addr;
 	int q_read = 0;
 	int msgs_read = 0;
@@ -776,12 +786,8 @@ unsigned int ttcan_read_rx_fifo1(struct ttcan_controller *ttcan)
 		pr_debug("%s:fifo1: read_addr %x FOGI %x\n", __func__,
 			 read_addr, get_idx);
 
-		ttcan_read_rx_msg_ram(ttcan, read_addr, &ttcanfd);
-		if (add_msg_controller_list(ttcan, &ttcanfd,
-					    &ttcan->rx_q1, FIFO_1) < 0) {
-			pr_err("%s: failed to add to list\n", __func__);
+		if (process_rx_mesg(ttcan, ttcan->rx_q1, read_addr))
 			return msgs_read;
-		}
 		ttcan_write32(ttcan, ADR_MTTCAN_RXF1A, get_idx);
 		rxf1s_reg = ttcan_read32(ttcan, ADR_MTTCAN_RXF1S);
 		msgs_read++;
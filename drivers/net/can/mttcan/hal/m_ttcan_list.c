@@ -5,98 +5,75 @@
 
 #include "../include/m_ttcan.h"
 
-#define TTCAN_MAX_LIST_MEMBERS 128
+#define TTCAN_RING_MASK (TTCAN_RING_SIZE - 1)
 
-inline int is_msg_list_full(struct ttcan_controller *ttcan,
-		enum ttcan_rx_type rxtype)
+/*
+ * The producer side returns the next free slot, or NULL when the ring is
+ * full, and publishes it with *_push() once filled. The acquire on tail
+ * orders the slot reuse after the consumer is done reading it.
+ */
+struct ttcanfd_frame *ttcan_rx_ring_prod(struct ttcan_rx_ring *ring)
 {
-	return ttcan->list_status & rxtype & 0xFF;
+	u32 head = ring->head;
+
+	if (head - smp_load_acquire(&ring->tail) >= TTCAN_RING_SIZE)
+		return NULL;
+
+	return &ring->msg[head & TTCAN_RING_MASK];
 }
 
-int add_msg_controller_list(struct ttcan_controller *ttcan,
-			    struct ttcanfd_frame *ttcanfd,
-			    struct list_head *rx_q,
-			    enum ttcan_rx_type rxtype)
+void ttcan_rx_ring_push(struct ttcan_rx_ring *ring)
 {
-
-	struct ttcan_rx_msg_list *msg_list;
-
-	msg_list = (struct ttcan_rx_msg_list *)
-		kzalloc(sizeof(struct ttcan_rx_msg_list), GFP_ATOMIC);
-	if (msg_list == NULL) {
-		pr_err("%s: memory allocation failed\n", __func__);
-		return -ENOMEM;
-	}
-
-	INIT_LIST_HEAD(&msg_list->recv_list);
-
-	memcpy(&msg_list->msg, ttcanfd, sizeof(struct ttcanfd_frame));
-
-	spin_lock(&ttcan->lock);
-
-	if (is_msg_list_full(ttcan, rxtype)) {
-		pr_err("%s: mesg list is full\n", __func__);
-		kfree(msg_list);
-		spin_unlock(&ttcan->lock);
-		return -ENOMEM;
-	}
-
-	list_add_tail(&msg_list->recv_list, rx_q);
-
-	switch (rxtype) {
-	case BUFFER:
-		if (++ttcan->rxb_mem >= TTCAN_MAX_LIST_MEMBERS)
-			ttcan->list_status |= BUFFER;
-		break;
-	case FIFO_0:
-		if (++ttcan->rxq0_mem >= TTCAN_MAX_LIST_MEMBERS)
-			ttcan->list_status |= FIFO_0;
-		break;
-	case FIFO_1:
-		if (++ttcan->rxq1_mem >= TTCAN_MAX_LIST_MEMBERS)
-			ttcan->list_status |= FIFO_1;
-	default:
-		break;
-	}
-	spin_unlock(&ttcan->lock);
-
-	return 0;
+	smp_store_release(&ring->head, ring->head + 1);
 }
 
-int add_event_controller_list(struct ttcan_controller *ttcan,
-			    struct mttcan_tx_evt_element *txevt,
-			    struct list_head *evt_q)
+/*
+ * The consumer side returns the oldest filled slot, or NULL when the ring
+ * is empty, and hands it back with *_pop() once consumed.
+ */
+struct ttcanfd_frame *ttcan_rx_ring_peek(struct ttcan_rx_ring *ring)
 {
+	u32 tail = ring->tail;
 
-	struct ttcan_txevt_msg_list *evt_list;
+	if (smp_load_acquire(&ring->head) == tail)
+		return NULL;
+
+	return &ring->msg[tail & TTCAN_RING_MASK];
+}
 
-	evt_list =
-	    (struct ttcan_txevt_msg_list *)
-	    kzalloc(sizeof(struct ttcan_txevt_msg_list), GFP_ATOMIC);
-	if (evt_list == NULL) {
-		pr_err("%s: memory allocation failed\n", __func__);
-		return -ENOMEM;
-	}
+void ttcan_rx_ring_pop(struct ttcan_rx_ring *ring)
+{
+	smp_store_release(&ring->tail, ring->tail + 1);
+}
 
-	INIT_LIST_HEAD(&evt_list->txevt_list);
+struct mttcan_tx_evt_element *ttcan_txevt_ring_prod(
+	struct ttcan_txevt_ring *ring)
+{
+	u32 head = ring->head;
 
-	memcpy(&evt_list->txevt, txevt, sizeof(struct mttcan_tx_evt_element));
+	if (head - smp_load_acquire(&ring->tail) >= TTCAN_RING_SIZE)
+		return NULL;
 
-	spin_lock(&ttcan->lock);
+	return &ring->txevt[head & TTCAN_RING_MASK];
+}
 
-	if (is_msg_list_full(ttcan, TX_EVT)) {
-		pr_err("%s: mesg list is full\n", __func__);
-		kfree(evt_list);
-		spin_unlock(&ttcan->lock);
-		return -1;
-	}
+void ttcan_txevt_ring_push(struct ttcan_txevt_ring *ring)
+{
+	smp_store_release(&ring->head, ring->head + 1);
+}
 
-	list_add_tail(&evt_list->txevt_list, evt_q);
+struct mttcan_tx_evt_element *ttcan_txevt_ring_peek(
+	struct ttcan_txevt_ring *ring)
+{
+	u32 tail = ring->tail;
 
-	if (++ttcan->evt_mem >= TTCAN_MAX_LIST_MEMBERS)
-		ttcan->list_status |= TX_EVT;
+	if (smp_load_acquire(&ring->head) == tail)
+		return NULL;
 
-	spin_unlock(&ttcan->lock);
+	return &ring->txevt[tail & TTCAN_RING_MASK];
+}
 
-	return 0;
+void ttcan_txevt_ring_pop(struct ttcan_txevt_ring *ring)
+{
+	smp_store_release(&ring->tail, ring->tail + 1);
 }
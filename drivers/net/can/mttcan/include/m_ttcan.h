@@ -265,14 +265,24 @@ struct ttcan_filter_config {
 	u32 xtd_fltr_size;
 };
 
-struct ttcan_rx_msg_list {
-	struct ttcanfd_frame msg;
-	struct list_head recv_list;
+/* Must be a power of two */
+#define TTCAN_RING_SIZE 128
+
+/*
+ * Single-producer/single-consumer rings between the HAL, which copies
+ * elements out of message RAM, and the NAPI poll handing them to the stack.
+ * head is only written by the producer and tail only by the consumer.
+ */
+struct ttcan_rx_ring {
+	u32 head;
+	u32 tail;
+	struct ttcanfd_frame msg[TTCAN_RING_SIZE];
 };
 
-struct ttcan_txevt_msg_list {
-	struct mttcan_tx_evt_element txevt;
-	struct list_head txevt_list;
+struct ttcan_txevt_ring {
+	u32 head;
+	u32 tail;
+	struct mttcan_tx_evt_element txevt[TTCAN_RING_SIZE];
 };
 
 struct ttcan_controller {
@@ -283,10 +293,10 @@ struct ttcan_controller {
 	struct ttcan_rxbuff_config rx_config;
 	struct ttcan_filter_config fltr_config;
 	struct ttcan_mram_elem mram_cfg[MRAM_ELEMS];
-	struct list_head rx_q0;
-	struct list_head rx_q1;
-	struct list_head rx_b;
-	struct list_head tx_evt;
+	struct ttcan_rx_ring *rx_q0;
+	struct ttcan_rx_ring *rx_q1;
+	struct ttcan_rx_ring *rx_b;
+	struct ttcan_txevt_ring *tx_evt;
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 16, 0)
 	struct tegra_prod *prod_list;
 #else
@@ -308,12 +318,6 @@ struct ttcan_controller {
 	u32 tdc_offset;
 	unsigned long tx_object;
 	unsigned long tx_obj_cancelled;
-	int rxq0_mem;
-	int rxq1_mem;
-	int rxb_mem;
-	int evt_mem;
-	u16 list_status;	/* bit 0: 1=Full; */
-	u16 resv0;
 };
 
 struct ttcan_ivc_msg {
@@ -457,6 +461,7 @@ void ttcan_tx_ded_msg_write(struct ttcan_controller *ttcan,
 			    struct ttcanfd_frame *ttcanfd,
 			    u8 index);
 void ttcan_tx_trigger_msg_transmit(struct ttcan_controller *ttcan, u8 index);
+void ttcan_tx_trigger_msgs_transmit(struct ttcan_controller *ttcan, u32 mask);
 int ttcan_tx_msg_buffer_write(struct ttcan_controller *ttcan,
 				struct ttcanfd_frame *ttcanfd);
 
@@ -555,14 +560,18 @@ int ttcan_set_tur_config(struct ttcan_controller *ttcan, u16 denominator,
 
 void ttcan_prog_trigger_mem(struct ttcan_controller *ttcan, void *tmc_shadow);
 
-/* list APIs */
-int add_msg_controller_list(struct ttcan_controller *ttcan,
-	struct ttcanfd_frame *ttcanfd, struct list_head *rx_q,
-	enum ttcan_rx_type rxtype);
-
-int add_event_controller_list(struct ttcan_controller *ttcan,
-				struct mttcan_tx_evt_element *txevt,
-				struct list_head *evt_q);
+/* ring APIs */
+struct ttcanfd_frame *ttcan_rx_ring_prod(struct ttcan_rx_ring *ring);
+void ttcan_rx_ring_push(struct ttcan_rx_ring *ring);
+struct ttcanfd_frame *ttcan_rx_ring_peek(struct ttcan_rx_ring *ring);
+void ttcan_rx_ring_pop(struct ttcan_rx_ring *ring);
+
+struct mttcan_tx_evt_element *ttcan_txevt_ring_prod(
+	struct ttcan_txevt_ring *ring);
+void ttcan_txevt_ring_push(struct ttcan_txevt_ring *ring);
+struct mttcan_tx_evt_element *ttcan_txevt_ring_peek(
+	struct ttcan_txevt_ring *ring);
+void ttcan_txevt_ring_pop(struct ttcan_txevt_ring *ring);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
 u64 ttcan_read_ts_cntr(const struct cyclecounter *ccnt);
 #else
@@ -100,6 +100,7 @@ struct mttcan_priv {
 	raw_spinlock_t tc_lock; /* lock to protect timecounter infra */
 	spinlock_t tslock; /* lock to protect ioctl */
 	spinlock_t tx_lock; /* lock to protect transmit path */
+	u32 tx_pending; /* Tx buffers staged for the next TXBAR write */
 	void __iomem *regs;
 	void __iomem *mres;
 	void *std_shadow;
@@ -367,86 +367,63 @@ static int mttcan_hpm_do_receive(struct net_device *dev,
 	return 1;
 }
 
+/*
+ * Drain up to @quota frames from @ring and hand them to the stack as one
+ * list, so the protocol layers run once per NAPI batch.
+ */
 static int mttcan_read_rcv_list(struct net_device *dev,
-				struct list_head *rcv,
-				enum ttcan_rx_type rx_type,
-				int rec_msgs, int quota)
+				struct ttcan_rx_ring *ring, int quota)
 {
-	unsigned int pushed;
-	unsigned long flags;
+	int pushed = 0;
 	struct mttcan_priv *priv = netdev_priv(dev);
-	struct ttcan_rx_msg_list *rx;
+	struct ttcanfd_frame *msg;
 	struct net_device_stats *stats = &dev->stats;
-	struct list_head *cur, *next, rx_q;
-
-	if (list_empty(rcv))
-		return 0;
-
-	INIT_LIST_HEAD(&rx_q);
+	LIST_HEAD(rx_q);
 
-	spin_lock_irqsave(&priv->ttcan->lock, flags);
-	switch (rx_type) {
-	case BUFFER:
-		priv->ttcan->rxb_mem = 0;
-		priv->ttcan->list_status &= ~(BUFFER & 0xFF);
-		break;
-	case FIFO_0:
-		priv->ttcan->rxq0_mem = 0;
-		priv->ttcan->list_status &= ~(FIFO_0 & 0xFF);
-		break;
-	case FIFO_1:
-		priv->ttcan->rxq1_mem = 0;
-		priv->ttcan->list_status &= ~(FIFO_1 & 0xFF);
-	default:
-		break;
-	}
-	list_splice_init(rcv, &rx_q);
-	spin_unlock_irqrestore(&priv->ttcan->lock, flags);
-
-	pushed = rec_msgs;
-	list_for_each_safe(cur, next, &rx_q) {
+	while (pushed < quota && (msg = ttcan_rx_ring_peek(ring)) != NULL) {
 		struct sk_buff *skb;
 		struct canfd_frame *fd_frame;
 		struct can_frame *frame;
-		if (!quota--)
-			break;
-		list_del_init(cur);
 
-		rx = list_entry(cur, struct ttcan_rx_msg_list, recv_list);
-		if (rx->msg.flags & CAN_FD_FLAG) {
+		if (msg->flags & CAN_FD_FLAG) {
 			skb = alloc_canfd_skb(dev, &fd_frame);
 			if (!skb) {
-				stats->rx_dropped += pushed;
-				return 0;
+				stats->rx_dropped++;
+				ttcan_rx_ring_pop(ring);
+				continue;
 			}
-			memcpy(fd_frame, &rx->msg, sizeof(struct canfd_frame));
+			memcpy(fd_frame, msg, sizeof(struct canfd_frame));
 			stats->rx_bytes += fd_frame->len;
 		} else {
 			skb = alloc_can_skb(dev, &frame);
 			if (!skb) {
-				stats->rx_dropped += pushed;
-				return 0;
+				stats->rx_dropped++;
+				ttcan_rx_ring_pop(ring);
+				continue;
 			}
-			frame->can_id =  rx->msg.can_id;
-			if (rx->msg.d_len > CAN_MAX_DLEN) {
+			frame->can_id =  msg->can_id;
+			if (msg->d_len > CAN_MAX_DLEN) {
 				netdev_warn(dev, "invalid datalen %d\n",
-					    rx->msg.d_len);
+					    msg->d_len);
 				frame->can_dlc = CAN_MAX_DLEN;
 			} else {
-				frame->can_dlc = rx->msg.d_len;
+				frame->can_dlc = msg->d_len;
 			}
-			memcpy(frame->data, &rx->msg.data, frame->can_dlc);
+			memcpy(frame->data, &msg->data, frame->can_dlc);
 			stats->rx_bytes += frame->can_dlc;
 		}
 
 		if (priv->hwts_rx_en)
-			mttcan_rx_hwtstamp(priv, skb, &rx->msg);
-		kfree(rx);
-		netif_receive_skb(skb);
+			mttcan_rx_hwtstamp(priv, skb, msg);
+		ttcan_rx_ring_pop(ring);
+		list_add_tail(&skb->list, &rx_q);
 		stats->rx_packets++;
-		pushed--;
+		pushed++;
 	}
-	return rec_msgs - pushed;
+
+	netif_receive_skb_list(&rx_q);
+
+	return pushed;
 }
 
 static int mttcan_state_change(struct net_device *dev,
@@ -504,6 +481,7 @@ static int mttcan_state_change(struct net_device *dev,
 		ttcan_set_intrpts(priv->ttcan, 0);
 		priv->can.can_stats.bus_off++;
 		priv->ttcan->tx_object = 0;
+		priv->tx_pending = 0;
 		netif_stop_queue(dev);
 		netif_carrier_off(dev);
 
@@ -584,33 +562,13 @@ static int mttcan_handle_bus_err(struct net_device *dev,
 static void mttcan_tx_event(struct net_device *dev)
 {
 	struct mttcan_priv *priv = netdev_priv(dev);
-	struct ttcan_txevt_msg_list *evt;
-	struct list_head *cur, *next, evt_q;
+	struct mttcan_tx_evt_element *evt;
 	struct mttcan_tx_evt_element txevt;
 	u32 xtd, id;
-	unsigned long flags;
-
-	INIT_LIST_HEAD(&evt_q);
-
-	spin_lock_irqsave(&priv->ttcan->lock, flags);
 
-	if (list_empty(&priv->ttcan->tx_evt)) {
-		spin_unlock_irqrestore(&priv->ttcan->lock, flags);
-		return;
-	}
-
-	priv->ttcan->evt_mem = 0;
-	priv->ttcan->list_status &= ~(TX_EVT & 0xFF);
-	list_splice_init(&priv->ttcan->tx_evt, &evt_q);
-	spin_unlock_irqrestore(&priv->ttcan->lock, flags);
-
-	list_for_each_safe(cur, next, &evt_q) {
-		list_del_init(cur);
-
-		evt = list_entry(cur, struct ttcan_txevt_msg_list, txevt_list);
-		memcpy(&txevt, &evt->txevt,
-			sizeof(struct mttcan_tx_evt_element));
-		kfree(evt);
+	while ((evt = ttcan_txevt_ring_peek(priv->ttcan->tx_evt)) != NULL) {
+		txevt = *evt;
+		ttcan_txevt_ring_pop(priv->ttcan->tx_evt);
 		xtd = (txevt.f0 & MTT_TXEVT_ELE_F0_XTD_MASK) >>
 			MTT_TXEVT_ELE_F0_XTD_SHIFT;
 		id = (txevt.f0 & MTT_TXEVT_ELE_F0_ID_MASK) >>
@@ -627,13 +585,14 @@ static void mttcan_tx_event(struct net_device *dev)
 	}
 }
 
-static void mttcan_tx_complete(struct net_device *dev)
+static int mttcan_tx_complete(struct net_device *dev, int budget)
 {
 	struct mttcan_priv *priv = netdev_priv(dev);
 	struct ttcan_controller *ttcan = priv->ttcan;
 	struct net_device_stats *stats = &dev->stats;
 	u32 msg_no;
 	u32 completed_tx;
+	int work = 0;
 
 	spin_lock(&priv->tx_lock);
 	completed_tx = ttcan_read_tx_complete_reg(ttcan);
@@ -641,7 +600,7 @@ static void mttcan_tx_complete(struct net_device *dev)
 	/* apply mask to consider only active CAN Tx transactions */
 	completed_tx &= ttcan->tx_object;
 
-	while (completed_tx) {
+	while (completed_tx && work < budget) {
 		msg_no = ffs(completed_tx) - 1;
 #if defined(CONFIG_CAN_LEDS)
 		can_led_event(dev, CAN_LED_EVENT_TX);
@@ -650,11 +609,14 @@ static void mttcan_tx_complete(struct net_device *dev)
 		stats->tx_packets++;
 		stats->tx_bytes += can_get_echo_skb(dev, msg_no, NULL);
 		completed_tx &= ~(1U << msg_no);
+		work++;
 	}
 
-	if (netif_queue_stopped(dev))
+	if (work && netif_queue_stopped(dev))
 		netif_wake_queue(dev);
 	spin_unlock(&priv->tx_lock);
+
+	return work;
 }
 
 static void mttcan_tx_cancelled(struct net_device *dev)
@@ -695,7 +657,6 @@ static void mttcan_tx_cancelled(struct net_device *dev)
 static int mttcan_poll_ir(struct napi_struct *napi, int quota)
 {
 	int work_done = 0;
-	int rec_msgs = 0;
 	struct net_device *dev = napi->dev;
 	struct mttcan_priv *priv = netdev_priv(dev);
 	u32 ir, ack, ttir, ttack, psr;
@@ -800,10 +761,9 @@ static int mttcan_poll_ir(struct napi_struct *napi, int quota)
 		if (ir & MTT_IR_DRX_MASK) {
 			ack = MTT_IR_DRX_MASK;
 			ttcan_ir_write(priv->ttcan, ack);
-			rec_msgs = ttcan_read_rx_buffer(priv->ttcan);
+			ttcan_read_rx_buffer(priv->ttcan);
 			work_done +=
-			    mttcan_read_rcv_list(dev, &priv->ttcan->rx_b,
-						 BUFFER, rec_msgs,
+			    mttcan_read_rcv_list(dev, priv->ttcan->rx_b,
 						 quota - work_done);
 			pr_debug("%s: buffer mesg received\n", __func__);
 
@@ -835,11 +795,10 @@ static int mttcan_poll_ir(struct napi_struct *napi, int quota)
 					MTT_IR_RF1N_MASK);
 				ttcan_ir_write(priv->ttcan, ack);
 
-				rec_msgs = ttcan_read_rx_fifo1(priv->ttcan);
+				ttcan_read_rx_fifo1(priv->ttcan);
 				work_done +=
 				    mttcan_read_rcv_list(dev,
-							 &priv->ttcan->rx_q1,
-							 FIFO_1, rec_msgs,
+							 priv->ttcan->rx_q1,
 							 quota - work_done);
 				pr_debug("%s: msg received in Q1\n", __func__);
 			}
@@ -849,11 +808,10 @@ static int mttcan_poll_ir(struct napi_struct *napi, int quota)
 					MTT_IR_RF0W_MASK |
 					MTT_IR_RF0N_MASK);
 				ttcan_ir_write(priv->ttcan, ack);
-				rec_msgs = ttcan_read_rx_fifo0(priv->ttcan);
+				ttcan_read_rx_fifo0(priv->ttcan);
 				work_done +=
 				    mttcan_read_rcv_list(dev,
-							 &priv->ttcan->rx_q0,
-							 FIFO_0, rec_msgs,
+							 priv->ttcan->rx_q0,
 							 quota - work_done);
 				pr_debug("%s: msg received in Q0\n", __func__);
 			}
@@ -885,7 +843,8 @@ static int mttcan_poll_ir(struct napi_struct *napi, int quota)
 		if (ir & MTT_IR_TC_MASK) {
 			ack = MTT_IR_TC_MASK;
 			ttcan_ir_write(priv->ttcan, ack);
-			mttcan_tx_complete(dev);
+			/* Buffers left over stay set in TXBTO for the next poll */
+			work_done += mttcan_tx_complete(dev, quota - work_done);
 		}
 
 		if (ir & MTT_IR_TFE_MASK) {
@@ -1366,6 +1325,7 @@ static int mttcan_close(struct net_device *dev)
 	 * We also then need to clear the internal states of driver.
 	 */
 	priv->ttcan->tx_object = 0;
+	priv->tx_pending = 0;
 	priv->hwts_rx_en = false;
 
 	close_candev(dev);
@@ -1378,6 +1338,15 @@ static int mttcan_close(struct net_device *dev)
 	return 0;
 }
 
+/* Add all staged Tx buffers to the transmit queue with one TXBAR write */
+static void mttcan_tx_flush(struct mttcan_priv *priv)
+{
+	if (priv->tx_pending) {
+		ttcan_tx_trigger_msgs_transmit(priv->ttcan, priv->tx_pending);
+		priv->tx_pending = 0;
+	}
+}
+
 static netdev_tx_t mttcan_start_xmit(struct sk_buff *skb,
 				     struct net_device *dev)
 {
@@ -1396,20 +1365,24 @@ static netdev_tx_t mttcan_start_xmit(struct sk_buff *skb,
 	/* Write Tx message to controller */
 	msg_no = ttcan_tx_msg_buffer_write(priv->ttcan,
 			(struct ttcanfd_frame *)frame);
-	if (msg_no < 0)
+	if (msg_no < 0) {
+		/* FIFO put index only advances once staged elements are added */
+		mttcan_tx_flush(priv);
 		msg_no = ttcan_tx_fifo_queue_msg(priv->ttcan,
 				(struct ttcanfd_frame *)frame);
+	}
 
 	if (msg_no < 0) {
 		netif_stop_queue(dev);
+		mttcan_tx_flush(priv);
 		spin_unlock_bh(&priv->tx_lock);
 		return NETDEV_TX_BUSY;
 	}
 	can_put_echo_skb(skb, dev, msg_no, 0);
 
-	/* Set go bit for non-TTCAN messages */
+	/* Stage go bit for non-TTCAN messages */
 	if (!priv->tt_param[0])
-		ttcan_tx_trigger_msg_transmit(priv->ttcan, msg_no);
+		priv->tx_pending |= 1U << msg_no;
 
 	/* State management for Tx complete/cancel processing */
 	if (test_and_set_bit(msg_no, &priv->ttcan->tx_object) &&
@@ -1417,6 +1390,9 @@ static netdev_tx_t mttcan_start_xmit(struct sk_buff *skb,
 		netdev_err(dev, "Writing to occupied echo_skb buffer\n");
 	clear_bit(msg_no, &priv->ttcan->tx_obj_cancelled);
 
+	if (!netdev_xmit_more() || netif_queue_stopped(dev))
+		mttcan_tx_flush(priv);
+
 	spin_unlock_bh(&priv->tx_lock);
 
 	return NETDEV_TX_OK;
@@ -1855,10 +1831,22 @@ static int mttcan_probe(struct platform_device *pdev)
 	priv->ttcan->mram_size = mesg_ram->end - mesg_ram->start + 1;
 	priv->ttcan->id = priv->instance;
 	priv->ttcan->mram_vbase = mram_addr;
-	INIT_LIST_HEAD(&priv->ttcan->rx_q0);
-	INIT_LIST_HEAD(&priv->ttcan->rx_q1);
-	INIT_LIST_HEAD(&priv->ttcan->rx_b);
-	INIT_LIST_HEAD(&priv->ttcan->tx_evt);
+
+	/* RX and Tx event rings are filled and drained from NAPI poll */
+	priv->ttcan->rx_q0 = devm_kzalloc(priv->device,
+		sizeof(*priv->ttcan->rx_q0), GFP_KERNEL);
+	priv->ttcan->rx_q1 = devm_kzalloc(priv->device,
+		sizeof(*priv->ttcan->rx_q1), GFP_KERNEL);
+	priv->ttcan->rx_b = devm_kzalloc(priv->device,
+		sizeof(*priv->ttcan->rx_b), GFP_KERNEL);
+	priv->ttcan->tx_evt = devm_kzalloc(priv->device,
+		sizeof(*priv->ttcan->tx_evt), GFP_KERNEL);
+	if (!priv->ttcan->rx_q0 || !priv->ttcan->rx_q1 ||
+	    !priv->ttcan->rx_b || !priv->ttcan->tx_evt) {
+		dev_err(priv->device, "cannot allocate memory for rx rings\n");
+		ret = -ENOMEM;
+		goto exit_free_device;
+	}
 
 	platform_set_drvdata(pdev, dev);
 	SET_NETDEV_DEV(dev, &pdev->dev);
@@ -1838,6 +1838,8 @@ static void free_rx_dma_resources(struct osi_dma_priv_data *osi_dma,
 		}
 #ifdef ETHER_PAGE_POOL
 		if (chan != ETHER_INVALID_CHAN_NUM && pdata->page_pool[chan]) {
+			if (xdp_rxq_info_is_reg(&pdata->rx_napi[chan]->xdp_rxq))
+				xdp_rxq_info_unreg(&pdata->rx_napi[chan]->xdp_rxq);
 			page_pool_destroy(pdata->page_pool[chan]);
 			pdata->page_pool[chan] = NULL;
 		}
@@ -1947,7 +1949,8 @@ static int ether_allocate_rx_buffers(struct ether_priv_data *pdata,
 				return -ENOMEM;
 			}
 
-			dma_addr = page_pool_get_dma_addr(page);
+			dma_addr = page_pool_get_dma_addr(page) +
+				   pdata->rx_headroom;
 			rx_swcx->buf_virt_addr = page;
 		}
 #else
@@ -1978,7 +1981,10 @@ static int ether_allocate_rx_buffers(struct ether_priv_data *pdata,
 /**
  * @brief Create Rx buffer page pool per channel
  *
- * Algorithm: Invokes page pool API to create Rx buffer pool.
+ * Algorithm: Invokes page pool API to create Rx buffer pool. With an XDP
+ * program attached, buffers also hold the XDP headroom and skb_shared_info
+ * tailroom, are mapped bidirectional for XDP_TX and the pool is registered
+ * as memory model of the channel XDP Rx queue.
  *
  * @param[in] pdata: OSD private data.
  * @param[chan] chan: Rx DMA channel number.
@@ -1990,17 +1996,23 @@ static int ether_page_pool_create_per_chan(struct ether_priv_data *pdata,
 					   unsigned int chan)
 {
 	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct ether_rx_napi *rx_napi = pdata->rx_napi[chan];
 	struct page_pool_params pp_params = { 0 };
 	unsigned int num_pages, pool_size = 1024;
+	unsigned int buf_len = osi_dma->rx_buf_len + pdata->rx_headroom;
 	int ret = 0;
 
+	if (pdata->xdp_prog)
+		buf_len += SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+
 	pp_params.flags = PP_FLAG_DMA_MAP;
 	pp_params.pool_size = pool_size;
-	num_pages = DIV_ROUND_UP(osi_dma->rx_buf_len, PAGE_SIZE);
+	num_pages = DIV_ROUND_UP(buf_len, PAGE_SIZE);
 	pp_params.order = ilog2(roundup_pow_of_two(num_pages));
 	pp_params.nid = dev_to_node(pdata->dev);
 	pp_params.dev = pdata->dev;
-	pp_params.dma_dir = DMA_FROM_DEVICE;
+	pp_params.dma_dir = pdata->xdp_prog ? DMA_BIDIRECTIONAL :
+			    DMA_FROM_DEVICE;
 
 	pdata->page_pool[chan] = page_pool_create(&pp_params);
 	if (IS_ERR(pdata->page_pool[chan])) {
@@ -2009,6 +2021,26 @@ static int ether_page_pool_create_per_chan(struct ether_priv_data *pdata,
 		return ret;
 	}
 
+	pdata->rx_frame_sz = PAGE_SIZE << pp_params.order;
+
+	ret = xdp_rxq_info_reg(&rx_napi->xdp_rxq, pdata->ndev, chan,
+			       rx_napi->napi.napi_id);
+	if (ret < 0)
+		goto err_destroy;
+
+	ret = xdp_rxq_info_reg_mem_model(&rx_napi->xdp_rxq,
+					 MEM_TYPE_PAGE_POOL,
+					 pdata->page_pool[chan]);
+	if (ret < 0) {
+		xdp_rxq_info_unreg(&rx_napi->xdp_rxq);
+		goto err_destroy;
+	}
+
+	return ret;
+
+err_destroy:
+	page_pool_destroy(pdata->page_pool[chan]);
+	pdata->page_pool[chan] = NULL;
 	return ret;
 }
 #endif
@@ -2248,6 +2280,10 @@ static void free_dma_resources(struct ether_priv_data *pdata)
 	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
 	struct device *dev = pdata->dev;
 
+#ifdef ETHER_PAGE_POOL
+	/* XDP_TX frames go back to the page pools freed below */
+	ether_xdp_free_tx_resources(pdata);
+#endif
 	free_tx_dma_resources(osi_dma, dev);
 	free_rx_dma_resources(osi_dma, pdata);
 
@@ -2311,8 +2347,19 @@ static int ether_allocate_dma_resources(struct ether_priv_data *pdata)
 		goto error_alloc;
 	}
 
+#ifdef ETHER_PAGE_POOL
+	ret = ether_xdp_alloc_tx_resources(pdata);
+	if (ret != 0) {
+		free_tx_dma_resources(osi_dma, pdata->dev);
+		goto error_alloc;
+	}
+#endif
+
 	ret = ether_allocate_rx_dma_resources(osi_dma, pdata);
 	if (ret != 0) {
+#ifdef ETHER_PAGE_POOL
+		ether_xdp_free_tx_resources(pdata);
+#endif
 		free_tx_dma_resources(osi_dma, pdata->dev);
 		goto error_alloc;
 	}
@@ -2645,6 +2692,9 @@ static int ether_open(struct net_device *dev)
 	}
 
 	osi_set_rx_buf_len(pdata->osi_dma);
+#ifdef ETHER_PAGE_POOL
+	pdata->rx_headroom = pdata->xdp_prog ? XDP_PACKET_HEADROOM : 0U;
+#endif
 
 	ret = ether_allocate_dma_resources(pdata);
 	if (ret < 0) {
@@ -2765,11 +2815,6 @@ static int ether_open(struct net_device *dev)
 			      msecs_to_jiffies(osi_core->hsi.err_time_threshold));
 #endif
 
-#ifdef ETHER_NVGRO
-	/* start NVGRO timer for purging */
-	mod_timer(&pdata->nvgro_timer,
-		  jiffies + msecs_to_jiffies(pdata->nvgro_timer_intrvl));
-#endif
 	return ret;
 
 err_r_irq:
@@ -2948,11 +2993,6 @@ static int ether_close(struct net_device *ndev)
 	unsigned int chan = 0x0;
 	int i;
 
-#ifdef ETHER_NVGRO
-	del_timer_sync(&pdata->nvgro_timer);
-	/* TODO: purge the queues */
-#endif
-
 #ifdef CONFIG_TEGRA_NVPPS
 	/* Unregister broadcasting MAC timestamp to clients */
 	tegra_unregister_hwtime_source(ndev);
@@ -3010,6 +3050,13 @@ static int ether_close(struct net_device *ndev)
 
 	ether_napi_disable(pdata);
 
+#ifdef ETHER_NVGRO
+	for (i = 0; i < pdata->osi_dma->num_dma_chans; i++) {
+		chan = pdata->osi_dma->dma_chans[i];
+		ether_nvgro_flush(pdata->rx_napi[chan]);
+	}
+#endif
+
 	/* free DMA resources after DMA stop */
 	free_dma_resources(pdata);
 
@@ -3382,6 +3429,10 @@ static unsigned short ether_select_queue(struct net_device *dev,
 		}
 	}
 
+	/* The last queue is reserved for XDP while a program is attached */
+	if (txqueue_select >= dev->real_num_tx_queues)
+		txqueue_select = 0;
+
 	return txqueue_select;
 }
 
@@ -4289,6 +4340,10 @@ static const struct net_device_ops ether_netdev_ops = {
 	.ndo_vlan_rx_kill_vid = ether_vlan_rx_kill_vid,
 #endif /* ETHER_VLAN_VID_SUPPORT */
 	.ndo_setup_tc = ether_setup_tc,
+#ifdef ETHER_PAGE_POOL
+	.ndo_bpf = ether_xdp,
+	.ndo_xdp_xmit = ether_xdp_xmit,
+#endif
 };
 
 /**
@@ -4317,6 +4372,12 @@ static int ether_napi_poll_rx(struct napi_struct *napi, int budget)
 
 	received = osi_process_rx_completions(osi_dma, chan, budget,
 					      &more_data_avail);
+#ifdef ETHER_NVGRO
+	ether_nvgro_expire(rx_napi);
+#endif
+#ifdef ETHER_PAGE_POOL
+	ether_xdp_rx_flush(pdata, rx_napi);
+#endif
 	if (received < budget) {
 		napi_complete(napi);
 		raw_spin_lock_irqsave(&pdata->rlock, flags);
@@ -6634,6 +6695,16 @@ static int ether_probe(struct platform_device *pdev)
 
 	ndev->netdev_ops = &ether_netdev_ops;
 	ether_set_ethtool_ops(ndev);
+#ifdef ETHER_PAGE_POOL
+	spin_lock_init(&pdata->xdp_tx_lock);
+#if defined(NV_XDP_SET_FEATURES_FLAG_PRESENT)
+	/* XDP_TX needs a DMA channel of its own, ndo_xdp_xmit is
+	 * advertised once its resources are set up in open.
+	 */
+	if (osi_dma->num_dma_chans > 1U)
+		xdp_set_features_flag(ndev, ETHER_XDP_ACT_BASE);
+#endif
+#endif
 
 	ret = ether_alloc_napi(pdata);
 	if (ret < 0) {
@@ -6720,12 +6791,11 @@ static int ether_probe(struct platform_device *pdev)
 	tasklet_setup(&pdata->lane_restart_task,
 		      ether_restart_lane_bringup_task);
 #ifdef ETHER_NVGRO
-	__skb_queue_head_init(&pdata->mq);
-	__skb_queue_head_init(&pdata->fq);
 	pdata->pkt_age_msec = NVGRO_AGE_THRESHOLD;
-	pdata->nvgro_timer_intrvl = NVGRO_PURGE_TIMER_THRESHOLD;
-	pdata->nvgro_dropped = 0;
-	timer_setup(&pdata->nvgro_timer, ether_nvgro_purge_timer, 0);
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		chan = osi_dma->dma_chans[i];
+		ether_nvgro_init(pdata->rx_napi[chan]);
+	}
 #endif
 
 #ifdef HSI_SUPPORT
@@ -45,6 +45,8 @@
 #include <net/page_pool/types.h>
 #include <net/page_pool/helpers.h>
 #endif
+#include <linux/filter.h>
+#include <net/xdp.h>
 #define ETHER_PAGE_POOL
 #endif
 #include <osi_core.h>
@@ -59,6 +61,8 @@
 #include <net/inet_common.h>
 #include <uapi/linux/ip.h>
 #include <net/udp.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
 #endif /* ETHER_NVGRO */
 
 /**
@@ -214,9 +218,11 @@
 #ifdef ETHER_NVGRO
 /* NVGRO packets purge threshold in msec */
 #define NVGRO_AGE_THRESHOLD		500
-#define NVGRO_PURGE_TIMER_THRESHOLD	5000
-#define NVGRO_RX_RUNNING		OSI_BIT(0)
-#define NVGRO_PURGE_TIMER_RUNNING	OSI_BIT(1)
+/* NVGRO flows tracked per Rx channel */
+#define NVGRO_MAX_FLOWS			16
+#define NVGRO_HASH_BITS			5
+/* NVGRO segments buffered per flow and queue, power of 2 */
+#define NVGRO_MAX_SEGS			64
 #endif
 
 /**
@@ -331,6 +337,102 @@ struct ether_tx_napi {
 	atomic_t tx_usecs_timer_armed;
 };
 
+#ifdef ETHER_NVGRO
+/**
+ * @brief NVGRO per flow statistics
+ *
+ * Reset when the slot is taken by another flow, cumulative counts are
+ * kept per channel in struct ether_nvgro.
+ */
+struct ether_nvgro_flow_stats {
+	/** Segments received */
+	u64 segs;
+	/** Segment sequences merged and handed to GRO */
+	u64 merged;
+	/** Segments dropped */
+	u64 dropped;
+	/** Reassemblies aborted on timeout */
+	u64 timeouts;
+};
+
+/**
+ * @brief NVGRO reassembly state of one UDP flow
+ */
+struct ether_nvgro_flow {
+	/** Flow hash table linkage */
+	struct hlist_node node;
+	/** Flow LRU linkage, least recently used first */
+	struct list_head lru;
+	/** Pending list linkage while segments are held, oldest first */
+	struct list_head pend;
+	/** IPv4 source address */
+	__be32 saddr;
+	/** IPv4 destination address */
+	__be32 daddr;
+	/** UDP source port */
+	__be16 sport;
+	/** UDP destination port */
+	__be16 dport;
+	/** Slot holds a flow */
+	bool active;
+	/** In sequence segments starting with the first segment */
+	struct sk_buff_head fq;
+	/** Out of order segments indexed by IP ID */
+	struct sk_buff *ooo[NVGRO_MAX_SEGS];
+	/** Number of out of order segments */
+	unsigned int ooo_cnt;
+	/** IP ID expected next in fq */
+	u16 expected_ip_id;
+	/** Held segments are dropped at this time in jiffies */
+	unsigned long deadline;
+	/** Flow statistics */
+	struct ether_nvgro_flow_stats stats;
+};
+
+/**
+ * @brief NVGRO flow table of one Rx channel, only accessed from its NAPI
+ */
+struct ether_nvgro {
+	/** Active flows hashed by UDP/IPv4 tuple */
+	DECLARE_HASHTABLE(hash, NVGRO_HASH_BITS);
+	/** Active flows, least recently used first */
+	struct list_head lru;
+	/** Flows holding segments, earliest deadline first */
+	struct list_head pend;
+	/** Flow slots */
+	struct ether_nvgro_flow flows[NVGRO_MAX_FLOWS];
+	/** Number of active flows */
+	unsigned int nr_flows;
+	/** Flows evicted to make room for new ones */
+	u64 evicted;
+	/** Segments dropped on all flows of the channel */
+	u64 dropped;
+	/** Segment sequences merged on all flows of the channel */
+	u64 merged;
+	/** Reassemblies aborted on timeout on all flows of the channel */
+	u64 timeouts;
+	/** Schedules NAPI at the earliest deadline */
+	struct timer_list timer;
+};
+#endif /* ETHER_NVGRO */
+
+#ifdef ETHER_PAGE_POOL
+/** XDP frames held back before they are handed to the XDP Tx channel */
+#define ETHER_XDP_TX_BULK	16U
+/** XDP actions supported whether or not the XDP Tx channel is set up */
+#define ETHER_XDP_ACT_BASE	(NETDEV_XDP_ACT_BASIC | NETDEV_XDP_ACT_REDIRECT)
+
+/**
+ * @brief XDP frames waiting for the next flush to the XDP Tx channel
+ */
+struct ether_xdp_tx_bulk {
+	/** Frames in submission order */
+	struct xdp_frame *frames[ETHER_XDP_TX_BULK];
+	/** Number of frames held */
+	unsigned int count;
+};
+#endif
+
 /**
  *@brief DMA Receive Channel NAPI
  */
@@ -341,7 +443,31 @@ struct ether_rx_napi {
 	struct ether_priv_data *pdata;
 	/** NAPI instance associated with transmit channel */
 	struct napi_struct napi;
+#ifdef ETHER_NVGRO
+	/** NVGRO flow table owned by this NAPI instance */
+	struct ether_nvgro nvgro;
+#endif
+#ifdef ETHER_PAGE_POOL
+	/** XDP Rx queue info registered against the channel page pool */
+	struct xdp_rxq_info xdp_rxq;
+	/** Set when XDP_REDIRECT was used in the current poll */
+	bool xdp_flush;
+	/** XDP_TX frames of the current poll */
+	struct ether_xdp_tx_bulk xdp_tx_bulk;
+#endif
+};
+
+#ifdef ETHER_PAGE_POOL
+/**
+ * @brief Tx bookkeeping for a descriptor of the XDP Tx channel
+ */
+struct ether_xdp_tx_buf {
+	/** Frame owned by the descriptor, NULL if free */
+	struct xdp_frame *xdpf;
+	/** Frame was mapped by ndo_xdp_xmit and not taken from the page pool */
+	bool mapped;
 };
+#endif
 
 /**
  * @brief VM Based IRQ data
@@ -577,6 +703,20 @@ struct ether_priv_data {
 #ifdef ETHER_PAGE_POOL
 	/** Pointer to page pool */
 	struct page_pool *page_pool[OSI_MGBE_MAX_NUM_CHANS];
+	/** Attached XDP program */
+	struct bpf_prog *xdp_prog;
+	/** Headroom reserved in front of each Rx buffer */
+	unsigned int rx_headroom;
+	/** Size of the Rx page pool buffer, used as XDP frame size */
+	unsigned int rx_frame_sz;
+	/** DMA channel used for XDP_TX and ndo_xdp_xmit */
+	unsigned int xdp_tx_chan;
+	/** Serializes XDP transmits from all Rx channels */
+	spinlock_t xdp_tx_lock;
+	/** Per descriptor state of the XDP Tx channel */
+	struct ether_xdp_tx_buf *xdp_tx_bufs;
+	/** ndo_xdp_xmit frames waiting for XDP_XMIT_FLUSH, under xdp_tx_lock */
+	struct ether_xdp_tx_bulk xdp_xmit_bulk;
 #endif
 #ifdef CONFIG_DEBUG_FS
 	/** Debug fs directory pointer */
@@ -617,24 +757,8 @@ struct ether_priv_data {
 	/** PHY reset duration delay */
 	int phy_reset_duration;
 #ifdef ETHER_NVGRO
-	/** Master queue */
-	struct sk_buff_head mq;
-	/** Master queue */
-	struct sk_buff_head fq;
-	/** expected IP ID */
-	u16 expected_ip_id;
-	/** Timer for purginging the packets in FQ and MQ based on threshold */
-	struct timer_list nvgro_timer;
-	/** Rx processing state for NVGRO */
-	atomic_t rx_state;
-	/** Purge timer state for NVGRO */
-	atomic_t timer_state;
 	/** NVGRO packet age threshold in milseconds */
 	u32 pkt_age_msec;
-	/** NVGRO purge timer interval */
-	u32 nvgro_timer_intrvl;
-	/** NVGRO packet dropped count */
-	u64 nvgro_dropped;
 #endif
 	/** Platform MDIO address */
 	unsigned int mdio_addr;
@@ -856,6 +980,45 @@ int ether_tc_setup_cbs(struct ether_priv_data *pdata,
 int ether_get_tx_ts(struct ether_priv_data *pdata);
 void ether_restart_lane_bringup_task(struct tasklet_struct *t);
 #ifdef ETHER_NVGRO
-void ether_nvgro_purge_timer(struct timer_list *t);
+void ether_nvgro_init(struct ether_rx_napi *rx_napi);
+void ether_nvgro_expire(struct ether_rx_napi *rx_napi);
+void ether_nvgro_flush(struct ether_rx_napi *rx_napi);
 #endif /* ETHER_NVGRO */
+#ifdef ETHER_PAGE_POOL
+/**
+ * @brief ndo_bpf handler, only program attach/detach is supported.
+ *
+ * @param[in] ndev: Network device structure.
+ * @param[in] bpf: BPF command.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+int ether_xdp(struct net_device *ndev, struct netdev_bpf *bpf);
+
+/**
+ * @brief ndo_xdp_xmit handler, queues redirected frames on the XDP channel.
+ *
+ * @param[in] ndev: Network device structure.
+ * @param[in] n: Number of frames.
+ * @param[in] frames: Frames to transmit.
+ * @param[in] flags: XDP_XMIT_* flags.
+ *
+ * @retval number of frames queued
+ * @retval "negative value" on failure.
+ */
+int ether_xdp_xmit(struct net_device *ndev, int n, struct xdp_frame **frames,
+		   u32 flags);
+bool ether_xdp_run(struct ether_priv_data *pdata, struct bpf_prog *prog,
+		   struct ether_rx_napi *rx_napi, struct page *page,
+		   void **data, unsigned int *len);
+void ether_xdp_rx_flush(struct ether_priv_data *pdata,
+			struct ether_rx_napi *rx_napi);
+bool ether_xdp_is_tx_swcx(struct ether_priv_data *pdata,
+			  const struct osi_tx_swcx *swcx);
+void ether_xdp_tx_complete(struct ether_priv_data *pdata,
+			   const struct osi_tx_swcx *swcx);
+int ether_xdp_alloc_tx_resources(struct ether_priv_data *pdata);
+void ether_xdp_free_tx_resources(struct ether_priv_data *pdata);
+#endif /* ETHER_PAGE_POOL */
 #endif /* ETHER_LINUX_H */
@@ -0,0 +1,422 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/* Copyright (c) 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved */
+
+#include <nvidia/conftest.h>
+#include "ether_linux.h"
+
+#ifdef ETHER_PAGE_POOL
+#include <linux/bpf_trace.h>
+
+/**
+ * @brief Attach, replace or detach the XDP program.
+ *
+ * Algorithm:
+ * 1) XDP_TX uses the last DMA channel, so at least two are needed.
+ * 2) Attaching or detaching changes the Rx buffer layout and the Tx queues,
+ * so like an MTU change it is only allowed while the interface is down.
+ * Replacing a program is allowed at any time.
+ *
+ * @param[in] ndev: Network device structure.
+ * @param[in] prog: New program, NULL to detach.
+ * @param[in] extack: Netlink extended ack.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_xdp_setup(struct net_device *ndev, struct bpf_prog *prog,
+			   struct netlink_ext_ack *extack)
+{
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct bpf_prog *old_prog;
+	bool attach = (prog != NULL);
+
+	if (osi_dma->num_dma_chans < 2U) {
+		NL_SET_ERR_MSG_MOD(extack, "XDP needs a DMA channel for XDP_TX");
+		return -EOPNOTSUPP;
+	}
+
+	if (netif_running(ndev) && (attach != (pdata->xdp_prog != NULL))) {
+		NL_SET_ERR_MSG_MOD(extack,
+				   "interface must be down to attach or detach XDP");
+		return -EBUSY;
+	}
+
+	old_prog = xchg(&pdata->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (!netif_running(ndev))
+		netif_set_real_num_tx_queues(ndev, attach ?
+					     osi_dma->num_dma_chans - 1U :
+					     osi_dma->num_dma_chans);
+
+	return 0;
+}
+
+int ether_xdp(struct net_device *ndev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return ether_xdp_setup(ndev, bpf->prog, bpf->extack);
+	default:
+		return -EINVAL;
+	}
+}
+
+/**
+ * @brief Queue one XDP frame on the XDP Tx channel.
+ *
+ * Frames from our own page pool are already mapped, only frames redirected
+ * from other devices need a mapping.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] xdpf: Frame to transmit.
+ * @param[in] dma_map: Map the frame for DMA.
+ *
+ * @note Caller holds xdp_tx_lock.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+static int ether_xdp_xmit_frame(struct ether_priv_data *pdata,
+				struct xdp_frame *xdpf, bool dma_map)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct osi_tx_ring *tx_ring = osi_dma->tx_ring[pdata->xdp_tx_chan];
+	struct osi_tx_pkt_cx *tx_pkt_cx = &tx_ring->tx_pkt_cx;
+	unsigned int idx = tx_ring->cur_tx_idx;
+	struct osi_tx_swcx *tx_swcx = tx_ring->tx_swcx + idx;
+	struct ether_xdp_tx_buf *buf = &pdata->xdp_tx_bufs[idx];
+	struct page *page;
+	dma_addr_t dma;
+
+	if (unlikely(xdpf->len > ETHER_TX_MAX_BUFF_SIZE))
+		return -EINVAL;
+
+	if (unlikely(tx_swcx->len ||
+		     ether_avail_txdesc_cnt(osi_dma, tx_ring) == 0))
+		return -ENOSPC;
+
+	if (dma_map) {
+		dma = dma_map_single(pdata->dev, xdpf->data, xdpf->len,
+				     DMA_TO_DEVICE);
+		if (unlikely(dma_mapping_error(pdata->dev, dma)))
+			return -ENOMEM;
+	} else {
+		page = virt_to_head_page(xdpf->data);
+		dma = page_pool_get_dma_addr(page) +
+		      (xdpf->data - page_address(page));
+		dma_sync_single_for_device(pdata->dev, dma, xdpf->len,
+					   DMA_BIDIRECTIONAL);
+	}
+
+	buf->xdpf = xdpf;
+	buf->mapped = dma_map;
+
+	memset(tx_pkt_cx, 0, sizeof(*tx_pkt_cx));
+	tx_pkt_cx->flags |= OSI_PKT_CX_LEN;
+	tx_pkt_cx->payload_len = xdpf->len;
+	tx_pkt_cx->desc_cnt = 1;
+
+	tx_swcx->buf_phy_addr = dma;
+	tx_swcx->buf_virt_addr = xdpf;
+	tx_swcx->flags &= ~OSI_PKT_CX_PAGED_BUF;
+	tx_swcx->len = xdpf->len;
+
+	if (unlikely(osi_hw_transmit(osi_dma, pdata->xdp_tx_chan) < 0)) {
+		if (dma_map)
+			dma_unmap_single(pdata->dev, dma, xdpf->len,
+					 DMA_TO_DEVICE);
+		tx_swcx->buf_phy_addr = 0;
+		tx_swcx->buf_virt_addr = NULL;
+		tx_swcx->len = 0;
+		buf->xdpf = NULL;
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Hand held back XDP frames to the XDP Tx channel.
+ *
+ * Frames are only handed over at flush points so that a burst is pushed
+ * to HW back to back under a single lock hold. Frames that no longer fit
+ * in the ring are dropped.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] bulk: Frames to submit.
+ * @param[in] dma_map: Frames come from ndo_xdp_xmit and need a mapping.
+ *
+ * @note Caller holds xdp_tx_lock.
+ */
+static void ether_xdp_tx_bulk_flush(struct ether_priv_data *pdata,
+				    struct ether_xdp_tx_bulk *bulk,
+				    bool dma_map)
+{
+	struct xdp_frame *xdpf;
+	unsigned int i;
+
+	for (i = 0; i < bulk->count; i++) {
+		xdpf = bulk->frames[i];
+		if (likely(ether_xdp_xmit_frame(pdata, xdpf, dma_map) == 0))
+			continue;
+
+		pdata->ndev->stats.tx_dropped++;
+		if (dma_map)
+			xdp_return_frame(xdpf);
+		else
+			xdp_return_frame_rx_napi(xdpf);
+	}
+
+	bulk->count = 0;
+}
+
+int ether_xdp_xmit(struct net_device *ndev, int n, struct xdp_frame **frames,
+		   u32 flags)
+{
+	struct ether_priv_data *pdata = netdev_priv(ndev);
+	struct ether_xdp_tx_bulk *bulk = &pdata->xdp_xmit_bulk;
+	int i;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(ndev) || !pdata->xdp_tx_bufs))
+		return -ENETDOWN;
+
+	/* Frames are accepted here and owned by the driver from now on,
+	 * HW only sees them on XDP_XMIT_FLUSH or once the bulk is full.
+	 */
+	spin_lock(&pdata->xdp_tx_lock);
+	for (i = 0; i < n; i++) {
+		if (bulk->count == ETHER_XDP_TX_BULK)
+			ether_xdp_tx_bulk_flush(pdata, bulk, true);
+		bulk->frames[bulk->count++] = frames[i];
+	}
+
+	if (flags & XDP_XMIT_FLUSH)
+		ether_xdp_tx_bulk_flush(pdata, bulk, true);
+	spin_unlock(&pdata->xdp_tx_lock);
+
+	return n;
+}
+
+/**
+ * @brief Run the XDP program on a received frame.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] prog: XDP program.
+ * @param[in] rx_napi: Rx NAPI instance of the channel.
+ * @param[in] page: Page pool buffer holding the frame.
+ * @param[in, out] data: Start of the frame, updated for XDP_PASS.
+ * @param[in, out] len: Length of the frame, updated for XDP_PASS.
+ *
+ * @retval true if the frame was consumed
+ * @retval false if it has to be passed to the stack
+ */
+bool ether_xdp_run(struct ether_priv_data *pdata, struct bpf_prog *prog,
+		   struct ether_rx_napi *rx_napi, struct page *page,
+		   void **data, unsigned int *len)
+{
+	struct net_device *ndev = pdata->ndev;
+	struct ether_xdp_tx_bulk *bulk;
+	struct xdp_frame *xdpf;
+	struct xdp_buff xdp;
+	u32 act;
+
+	xdp_init_buff(&xdp, pdata->rx_frame_sz, &rx_napi->xdp_rxq);
+	xdp_prepare_buff(&xdp, page_address(page), pdata->rx_headroom, *len,
+			 false);
+
+	act = bpf_prog_run_xdp(prog, &xdp);
+	switch (act) {
+	case XDP_PASS:
+		*data = xdp.data;
+		*len = xdp.data_end - xdp.data;
+		return false;
+	case XDP_TX:
+		xdpf = xdp_convert_buff_to_frame(&xdp);
+		if (unlikely(!xdpf))
+			goto drop;
+
+		/* Submitted by ether_xdp_rx_flush() at the end of the poll */
+		bulk = &rx_napi->xdp_tx_bulk;
+		if (unlikely(bulk->count == ETHER_XDP_TX_BULK)) {
+			spin_lock(&pdata->xdp_tx_lock);
+			ether_xdp_tx_bulk_flush(pdata, bulk, false);
+			spin_unlock(&pdata->xdp_tx_lock);
+		}
+		bulk->frames[bulk->count++] = xdpf;
+		break;
+	case XDP_REDIRECT:
+		if (unlikely(xdp_do_redirect(ndev, &xdp, prog) < 0))
+			goto drop;
+		rx_napi->xdp_flush = true;
+		break;
+	default:
+	case XDP_ABORTED:
+		trace_xdp_exception(ndev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+drop:
+		ndev->stats.rx_dropped++;
+		page_pool_recycle_direct(pdata->page_pool[rx_napi->chan], page);
+		return true;
+	}
+
+	ndev->stats.rx_bytes += *len;
+
+	return true;
+}
+
+/**
+ * @brief Flush XDP work queued during an Rx poll.
+ *
+ * XDP_TX frames of the poll are handed to the XDP Tx channel in one go and
+ * redirected frames are flushed to their target devices.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] rx_napi: Rx NAPI instance of the channel.
+ */
+void ether_xdp_rx_flush(struct ether_priv_data *pdata,
+			struct ether_rx_napi *rx_napi)
+{
+	struct ether_xdp_tx_bulk *bulk = &rx_napi->xdp_tx_bulk;
+
+	if (bulk->count) {
+		spin_lock(&pdata->xdp_tx_lock);
+		ether_xdp_tx_bulk_flush(pdata, bulk, false);
+		spin_unlock(&pdata->xdp_tx_lock);
+	}
+
+	if (rx_napi->xdp_flush) {
+		rx_napi->xdp_flush = false;
+		xdp_do_flush();
+	}
+}
+
+/**
+ * @brief Check whether a Tx software context belongs to the XDP channel.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] swcx: Tx software context.
+ */
+bool ether_xdp_is_tx_swcx(struct ether_priv_data *pdata,
+			  const struct osi_tx_swcx *swcx)
+{
+	struct osi_tx_ring *tx_ring;
+
+	if (!pdata->xdp_tx_bufs)
+		return false;
+
+	tx_ring = pdata->osi_dma->tx_ring[pdata->xdp_tx_chan];
+
+	return (swcx >= tx_ring->tx_swcx) &&
+	       (swcx < tx_ring->tx_swcx + pdata->osi_dma->tx_ring_sz);
+}
+
+/**
+ * @brief Release an XDP frame once HW is done with it.
+ *
+ * @param[in] pdata: OSD private data.
+ * @param[in] swcx: Tx software context of the XDP channel.
+ */
+void ether_xdp_tx_complete(struct ether_priv_data *pdata,
+			   const struct osi_tx_swcx *swcx)
+{
+	struct osi_tx_ring *tx_ring = pdata->osi_dma->tx_ring[pdata->xdp_tx_chan];
+	struct ether_xdp_tx_buf *buf;
+
+	buf = &pdata->xdp_tx_bufs[swcx - tx_ring->tx_swcx];
+	if (!buf->xdpf)
+		return;
+
+	if (buf->mapped)
+		dma_unmap_single(pdata->dev, swcx->buf_phy_addr,
+				 buf->xdpf->len, DMA_TO_DEVICE);
+
+	pdata->ndev->stats.tx_bytes += buf->xdpf->len;
+	pdata->ndev->stats.tx_packets++;
+
+	xdp_return_frame(buf->xdpf);
+	buf->xdpf = NULL;
+}
+
+/**
+ * @brief Allocate XDP Tx bookkeeping if a program is attached.
+ *
+ * ndo_xdp_xmit is only advertised while the bookkeeping exists.
+ *
+ * @param[in] pdata: OSD private data.
+ *
+ * @retval 0 on success
+ * @retval "negative value" on failure.
+ */
+int ether_xdp_alloc_tx_resources(struct ether_priv_data *pdata)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+
+	if (!pdata->xdp_prog)
+		return 0;
+
+	pdata->xdp_tx_chan = osi_dma->dma_chans[osi_dma->num_dma_chans - 1U];
+	pdata->xdp_tx_bufs = kcalloc(osi_dma->tx_ring_sz,
+				     sizeof(*pdata->xdp_tx_bufs), GFP_KERNEL);
+	if (!pdata->xdp_tx_bufs)
+		return -ENOMEM;
+
+#if defined(NV_XDP_SET_FEATURES_FLAG_PRESENT)
+	xdp_set_features_flag(pdata->ndev, ETHER_XDP_ACT_BASE |
+			      NETDEV_XDP_ACT_NDO_XMIT);
+#endif
+	return 0;
+}
+
+/**
+ * @brief Drop XDP frames still queued on the XDP channel.
+ *
+ * Stops advertising ndo_xdp_xmit until the resources are set up again.
+ *
+ * Must run before the page pools are destroyed so that XDP_TX pages make
+ * it back to their pool.
+ *
+ * @param[in] pdata: OSD private data.
+ */
+void ether_xdp_free_tx_resources(struct ether_priv_data *pdata)
+{
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct osi_tx_ring *tx_ring;
+	struct ether_xdp_tx_buf *buf;
+	unsigned int i;
+
+	if (!pdata->xdp_tx_bufs)
+		return;
+
+#if defined(NV_XDP_SET_FEATURES_FLAG_PRESENT)
+	xdp_set_features_flag(pdata->ndev, ETHER_XDP_ACT_BASE);
+#endif
+	/* Accepted by ndo_xdp_xmit but never flushed */
+	for (i = 0; i < pdata->xdp_xmit_bulk.count; i++)
+		xdp_return_frame(pdata->xdp_xmit_bulk.frames[i]);
+	pdata->xdp_xmit_bulk.count = 0;
+
+	tx_ring = osi_dma->tx_ring[pdata->xdp_tx_chan];
+	for (i = 0; i < osi_dma->tx_ring_sz; i++) {
+		buf = &pdata->xdp_tx_bufs[i];
+		if (!buf->xdpf)
+			continue;
+
+		if (buf->mapped && tx_ring)
+			dma_unmap_single(pdata->dev,
+					 tx_ring->tx_swcx[i].buf_phy_addr,
+					 buf->xdpf->len, DMA_TO_DEVICE);
+
+		xdp_return_frame(buf->xdpf);
+	}
+
+	kfree(pdata->xdp_tx_bufs);
+	pdata->xdp_tx_bufs = NULL;
+}
+#endif /* ETHER_PAGE_POOL */
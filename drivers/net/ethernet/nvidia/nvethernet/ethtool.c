@@ -486,6 +486,33 @@ static const struct ether_stats ether_tstrings_stats[] = {
 #endif /* OSI_STRIPPED_LIB */
 };
 
+#ifdef ETHER_NVGRO
+/**
+ * @brief Name of NVGRO per flow stats, prefixed with Rx channel and flow slot
+ */
+#define ETHER_NVGRO_FLOW_STAT(f) \
+{ (#f), sizeof_field(struct ether_nvgro_flow_stats, f), \
+	offsetof(struct ether_nvgro_flow_stats, f)}
+
+/**
+ * @brief NVGRO per flow statistics
+ */
+static const struct ether_stats ether_nvgro_fstrings_stats[] = {
+	ETHER_NVGRO_FLOW_STAT(segs),
+	ETHER_NVGRO_FLOW_STAT(merged),
+	ETHER_NVGRO_FLOW_STAT(dropped),
+	ETHER_NVGRO_FLOW_STAT(timeouts),
+};
+
+/**
+ * @brief NVGRO statistics length, one set per flow slot of each Rx channel
+ */
+#define ETHER_NVGRO_FLOW_STAT_LEN OSI_ARRAY_SIZE(ether_nvgro_fstrings_stats)
+#define ETHER_NVGRO_STAT_LEN(pdata) \
+	((int)(pdata)->osi_dma->num_dma_chans * NVGRO_MAX_FLOWS * \
+	 ETHER_NVGRO_FLOW_STAT_LEN)
+#endif /* ETHER_NVGRO */
+
 /**
  * @brief This function is invoked by kernel when user requests to get the
  *  extended statistics about the device.
@@ -585,6 +612,23 @@ static void ether_get_ethtool_stats(struct net_device *dev,
 				     sizeof(u64)) ? (*(u64 *)p) : (*(u32 *)p);
 		}
 	}
+
+#ifdef ETHER_NVGRO
+	for (i = 0; i < (int)pdata->osi_dma->num_dma_chans; i++) {
+		struct ether_nvgro *nvgro =
+			&pdata->rx_napi[pdata->osi_dma->dma_chans[i]]->nvgro;
+		int f, k;
+
+		for (f = 0; f < NVGRO_MAX_FLOWS; f++) {
+			for (k = 0; k < ETHER_NVGRO_FLOW_STAT_LEN; k++) {
+				char *p = (char *)&nvgro->flows[f].stats +
+					  ether_nvgro_fstrings_stats[k].stat_offset;
+
+				data[j++] = *(u64 *)p;
+			}
+		}
+	}
+#endif /* ETHER_NVGRO */
 }
 
 /**
@@ -641,6 +685,13 @@ static int ether_get_sset_count(struct net_device *dev, int sset)
 		} else {
 			len += ETHER_CORE_STAT_LEN;
 		}
+#ifdef ETHER_NVGRO
+		if (INT_MAX - ETHER_NVGRO_STAT_LEN(pdata) < len) {
+			/* do nothing */
+		} else {
+			len += ETHER_NVGRO_STAT_LEN(pdata);
+		}
+#endif /* ETHER_NVGRO */
 	} else if (sset == ETH_SS_TEST) {
 		len = ether_selftest_get_count(pdata);
 	} else {
@@ -726,6 +777,21 @@ static void ether_get_strings(struct net_device *dev, u32 stringset, u8 *data)
 				p += ETH_GSTRING_LEN;
 			}
 		}
+#ifdef ETHER_NVGRO
+		for (i = 0; i < (int)pdata->osi_dma->num_dma_chans; i++) {
+			int f, k;
+
+			for (f = 0; f < NVGRO_MAX_FLOWS; f++) {
+				for (k = 0; k < ETHER_NVGRO_FLOW_STAT_LEN; k++) {
+					snprintf(p, ETH_GSTRING_LEN,
+						 "nvgro_q%u_f%d_%s",
+						 pdata->osi_dma->dma_chans[i], f,
+						 ether_nvgro_fstrings_stats[k].stat_string);
+					p += ETH_GSTRING_LEN;
+				}
+			}
+		}
+#endif /* ETHER_NVGRO */
 	} else if (stringset == (u32)ETH_SS_TEST) {
 		ether_selftest_get_strings(pdata, p);
 	} else {
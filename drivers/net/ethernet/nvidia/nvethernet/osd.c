@@ -253,7 +253,8 @@ static inline int ether_alloc_skb(struct ether_priv_data *pdata,
 		return 0;
 	}
 
-	rx_swcx->buf_phy_addr = page_pool_get_dma_addr(rx_swcx->buf_virt_addr);
+	rx_swcx->buf_phy_addr = page_pool_get_dma_addr(rx_swcx->buf_virt_addr) +
+				pdata->rx_headroom;
 #endif
 #ifndef ETHER_PAGE_POOL
 	rx_swcx->buf_virt_addr = skb;
@@ -377,158 +378,356 @@ static inline void ether_gro_merge_complete(struct sk_buff_head *nvgro_q,
 }
 
 /**
- * @brief ether_update_fq_with_fs - Populates final queue with TTL = 1 packet
+ * @brief ether_nvgro_flow_purge - Drop all segments held by a flow.
  *
- * @param[in] pdata: Ethernet driver private data
- * @param[in] skb: Socket buffer.
+ * @param[in] nvgro: NVGRO flow table.
+ * @param[in] flow: NVGRO flow.
  */
-static inline void ether_update_fq_with_fs(struct ether_priv_data *pdata,
-					   struct sk_buff *skb)
+static void ether_nvgro_flow_purge(struct ether_nvgro *nvgro,
+				   struct ether_nvgro_flow *flow)
 {
-	if (!skb_queue_empty(&pdata->fq)) {
-		pdata->nvgro_dropped += pdata->fq.qlen;
-		__skb_queue_purge(&pdata->fq);
+	unsigned int dropped = skb_queue_len(&flow->fq) + flow->ooo_cnt;
+	unsigned int i;
+
+	__skb_queue_purge(&flow->fq);
+
+	for (i = 0; flow->ooo_cnt && i < NVGRO_MAX_SEGS; i++) {
+		if (flow->ooo[i]) {
+			kfree_skb(flow->ooo[i]);
+			flow->ooo[i] = NULL;
+			flow->ooo_cnt--;
+		}
 	}
 
-	/* queue skb to fq which has TTL = 1 */
-	__skb_queue_tail(&pdata->fq, skb);
+	flow->stats.dropped += dropped;
+	nvgro->dropped += dropped;
+}
+
+/**
+ * @brief ether_nvgro_flow_pend - Track the deadline of a flow.
+ *
+ * Algorithm: A flow is on the pending list while it holds segments. Its
+ * deadline is pkt_age_msec after it started holding segments, so the
+ * pending list stays sorted by deadline and only its head needs a timer.
+ *
+ * @param[in] pdata: Ethernet private data.
+ * @param[in] nvgro: NVGRO flow table.
+ * @param[in] flow: NVGRO flow.
+ */
+static void ether_nvgro_flow_pend(struct ether_priv_data *pdata,
+				  struct ether_nvgro *nvgro,
+				  struct ether_nvgro_flow *flow)
+{
+	bool held = !skb_queue_empty(&flow->fq) || flow->ooo_cnt;
 
-	pdata->expected_ip_id = NAPI_GRO_CB(skb)->flush_id + 1;
+	if (!held) {
+		list_del_init(&flow->pend);
+		return;
+	}
+
+	if (!list_empty(&flow->pend))
+		return;
+
+	flow->deadline = jiffies + msecs_to_jiffies(pdata->pkt_age_msec);
+	list_add_tail(&flow->pend, &nvgro->pend);
+	if (list_is_first(&flow->pend, &nvgro->pend))
+		mod_timer(&nvgro->timer, flow->deadline);
 }
 
 /**
- * @brief ether_get_skb_from_ip_id - Get SKB from MQ based on IPID.
+ * @brief ether_nvgro_flow_get - Look up or allocate the flow of a segment.
+ *
+ * Algorithm: Flows are hashed on the UDP/IPv4 tuple. When all slots are in
+ * use the least recently used flow is evicted.
  *
- * @param[in] mq: NVGRO packet out of order queue.
+ * @param[in] nvgro: NVGRO flow table.
+ * @param[in] iph: IPv4 header of the segment.
+ * @param[in] uh: UDP header of the segment.
+ *
+ * @retval NVGRO flow
+ */
+static struct ether_nvgro_flow *ether_nvgro_flow_get(struct ether_nvgro *nvgro,
+						     const struct iphdr *iph,
+						     const struct udphdr *uh)
+{
+	u32 key = jhash_3words((__force u32)iph->saddr,
+			       (__force u32)iph->daddr,
+			       ((__force u32)uh->source << 16) |
+			       (__force u32)uh->dest, 0);
+	struct ether_nvgro_flow *flow;
+	unsigned int i;
+
+	hash_for_each_possible(nvgro->hash, flow, node, key) {
+		if (flow->saddr == iph->saddr && flow->daddr == iph->daddr &&
+		    flow->sport == uh->source && flow->dport == uh->dest)
+			return flow;
+	}
+
+	if (nvgro->nr_flows < NVGRO_MAX_FLOWS) {
+		for (i = 0; i < NVGRO_MAX_FLOWS; i++) {
+			if (!nvgro->flows[i].active)
+				break;
+		}
+		flow = &nvgro->flows[i];
+		nvgro->nr_flows++;
+	} else {
+		flow = list_first_entry(&nvgro->lru, struct ether_nvgro_flow,
+					lru);
+		ether_nvgro_flow_purge(nvgro, flow);
+		hash_del(&flow->node);
+		list_del(&flow->lru);
+		list_del_init(&flow->pend);
+		nvgro->evicted++;
+	}
+
+	flow->saddr = iph->saddr;
+	flow->daddr = iph->daddr;
+	flow->sport = uh->source;
+	flow->dport = uh->dest;
+	flow->active = true;
+	memset(&flow->stats, 0, sizeof(flow->stats));
+	hash_add(nvgro->hash, &flow->node, key);
+	list_add_tail(&flow->lru, &nvgro->lru);
+
+	return flow;
+}
+
+/**
+ * @brief ether_nvgro_flow_ooo_add - Hold an out of order segment.
+ *
+ * @param[in] nvgro: NVGRO flow table.
+ * @param[in] flow: NVGRO flow.
+ * @param[in] skb: Segment, IP ID stored in flush_id.
+ */
+static void ether_nvgro_flow_ooo_add(struct ether_nvgro *nvgro,
+				     struct ether_nvgro_flow *flow,
+				     struct sk_buff *skb)
+{
+	struct sk_buff **slot;
+
+	slot = &flow->ooo[NAPI_GRO_CB(skb)->flush_id & (NVGRO_MAX_SEGS - 1)];
+	if (*slot) {
+		/* Window wrapped, the older segment can't complete anymore */
+		kfree_skb(*slot);
+		flow->stats.dropped++;
+		nvgro->dropped++;
+	} else {
+		flow->ooo_cnt++;
+	}
+
+	*slot = skb;
+}
+
+/**
+ * @brief ether_nvgro_flow_ooo_take - Take the out of order segment with IP ID.
+ *
+ * @param[in] flow: NVGRO flow.
  * @param[in] ip_id: IPv4 packet ID.
  *
  * @retval skb on Success
- * @retval NULL on failure.
+ * @retval NULL if the segment has not been received.
  */
-static inline struct sk_buff *ether_get_skb_from_ip_id(struct sk_buff_head *mq,
-						       u16 ip_id)
+static struct sk_buff *ether_nvgro_flow_ooo_take(struct ether_nvgro_flow *flow,
+						 u16 ip_id)
 {
-	struct sk_buff *p, *pp;
+	struct sk_buff **slot = &flow->ooo[ip_id & (NVGRO_MAX_SEGS - 1)];
+	struct sk_buff *skb = *slot;
 
-	skb_queue_walk_safe(mq, p, pp) {
-		if ((NAPI_GRO_CB(p)->flush_id) == ip_id) {
-			__skb_unlink(p, mq);
-			return p;
-		}
+	if (!skb || NAPI_GRO_CB(skb)->flush_id != ip_id)
+		return NULL;
+
+	*slot = NULL;
+	flow->ooo_cnt--;
+
+	return skb;
+}
+
+/**
+ * @brief ether_nvgro_flow_restart - Start a new sequence on a flow.
+ *
+ * Algorithm: Drop the in sequence queue of the old sequence. Out of order
+ * segments that follow the new first segment within the window may belong
+ * to the new sequence and are kept for ether_nvgro_flow_gro(), all others
+ * are dropped.
+ *
+ * @param[in] nvgro: NVGRO flow table.
+ * @param[in] flow: NVGRO flow.
+ * @param[in] ip_id: IPv4 packet ID of the first segment.
+ */
+static void ether_nvgro_flow_restart(struct ether_nvgro *nvgro,
+				     struct ether_nvgro_flow *flow, u16 ip_id)
+{
+	unsigned int dropped = skb_queue_len(&flow->fq);
+	struct sk_buff *p;
+	unsigned int i;
+	u16 dist;
+
+	__skb_queue_purge(&flow->fq);
+
+	for (i = 0; flow->ooo_cnt && i < NVGRO_MAX_SEGS; i++) {
+		p = flow->ooo[i];
+		if (!p)
+			continue;
+
+		dist = (u16)(NAPI_GRO_CB(p)->flush_id - ip_id);
+		if (dist >= 1U && dist <= NVGRO_MAX_SEGS - 1U)
+			continue;
+
+		kfree_skb(p);
+		flow->ooo[i] = NULL;
+		flow->ooo_cnt--;
+		dropped++;
 	}
 
-	return NULL;
+	flow->stats.dropped += dropped;
+	nvgro->dropped += dropped;
 }
 
 /**
- * @brief ether_gro - Perform NVGRO packet merging.
+ * @brief ether_nvgro_flow_gro - Complete the sequence of a flow if possible.
+ *
+ * Algorithm: Extend the in sequence queue with held out of order segments
+ * and merge it once the last segment is in place.
  *
- * @param[in] fq: NVGRO packets sequence queue.
- * @param[in] mq: NVGRO packet out of order queue.
+ * @param[in] nvgro: NVGRO flow table.
+ * @param[in] flow: NVGRO flow.
  * @param[in] napi: Driver NAPI instance.
  */
-static inline void ether_gro(struct sk_buff_head *fq, struct sk_buff_head *mq,
-			     struct napi_struct *napi)
+static void ether_nvgro_flow_gro(struct ether_nvgro *nvgro,
+				 struct ether_nvgro_flow *flow,
+				 struct napi_struct *napi)
 {
-	struct sk_buff *f_skb, *p;
-	u32 s_ip_id;
+	struct sk_buff *p = skb_peek_tail(&flow->fq);
 
-	if (skb_queue_empty(fq))
+	if (!p)
 		return;
 
-	f_skb = skb_peek_tail(fq);
-
-	s_ip_id = NAPI_GRO_CB(f_skb)->flush_id;
-
-	do {
-		s_ip_id++;
-		p = ether_get_skb_from_ip_id(mq, s_ip_id);
+	while (NAPI_GRO_CB(p)->free != 2) {
+		p = ether_nvgro_flow_ooo_take(flow, flow->expected_ip_id);
 		if (!p)
 			return;
 
-		__skb_queue_tail(fq, p);
-
-		if (NAPI_GRO_CB(p)->free == 2)
-			break;
-	} while (1);
+		__skb_queue_tail(&flow->fq, p);
+		flow->expected_ip_id++;
+	}
 
-	ether_gro_merge_complete(fq, napi);
+	ether_gro_merge_complete(&flow->fq, napi);
+	flow->stats.merged++;
+	nvgro->merged++;
 }
 
 /**
- * @brief ether_purge_q - Purge master queue based on packet age.
+ * @brief ether_nvgro_expire - Drop segments of flows past their deadline.
  *
- * @param[in] pdata: Ethernet private data.
+ * @param[in] rx_napi: Rx NAPI instance owning the flow table.
+ *
+ * @note Runs in the NAPI context of rx_napi.
  */
-static inline void ether_purge_q(struct ether_priv_data *pdata)
+void ether_nvgro_expire(struct ether_rx_napi *rx_napi)
 {
-	struct sk_buff *p, *pp;
-
-	skb_queue_walk_safe(&pdata->mq, p, pp) {
-		if ((jiffies - NAPI_GRO_CB(p)->age) >
-		    msecs_to_jiffies(pdata->pkt_age_msec)) {
-			__skb_unlink(p, &pdata->mq);
-			dev_consume_skb_any(p);
-			pdata->nvgro_dropped++;
-		} else {
+	struct ether_nvgro *nvgro = &rx_napi->nvgro;
+	struct ether_nvgro_flow *flow, *tmp;
+
+	list_for_each_entry_safe(flow, tmp, &nvgro->pend, pend) {
+		if (time_before(jiffies, flow->deadline)) {
+			mod_timer(&nvgro->timer, flow->deadline);
 			return;
 		}
+
+		ether_nvgro_flow_purge(nvgro, flow);
+		flow->stats.timeouts++;
+		nvgro->timeouts++;
+		list_del_init(&flow->pend);
 	}
 }
 
 /**
- * @brief ether_nvgro_purge_timer - NVGRO purge timer handler.
+ * @brief ether_nvgro_timer - NVGRO deadline timer handler.
+ *
+ * Algorithm: The flow table belongs to the NAPI instance, so the timer
+ * only schedules NAPI which expires the flows.
  *
  * @param[in] t: Pointer to the timer.
  */
-void ether_nvgro_purge_timer(struct timer_list *t)
+static void ether_nvgro_timer(struct timer_list *t)
 {
-	struct ether_priv_data *pdata = from_timer(pdata, t, nvgro_timer);
-	struct sk_buff *f_skb;
-
-	if (atomic_read(&pdata->rx_state) == OSI_ENABLE)
-		return;
+	struct ether_rx_napi *rx_napi = from_timer(rx_napi, t, nvgro.timer);
 
-	atomic_set(&pdata->timer_state, OSI_ENABLE);
-
-	ether_purge_q(pdata);
+	napi_schedule(&rx_napi->napi);
+}
 
-	f_skb = skb_peek(&pdata->fq);
-	if (!f_skb)
-		goto exit;
+/**
+ * @brief ether_nvgro_init - Initialize the NVGRO flow table of a channel.
+ *
+ * @param[in] rx_napi: Rx NAPI instance.
+ */
+void ether_nvgro_init(struct ether_rx_napi *rx_napi)
+{
+	struct ether_nvgro *nvgro = &rx_napi->nvgro;
+	unsigned int i;
 
-	if ((jiffies - NAPI_GRO_CB(f_skb)->age) >
-	    msecs_to_jiffies(pdata->pkt_age_msec)) {
-		pdata->nvgro_dropped += pdata->fq.qlen;
-		__skb_queue_purge(&pdata->fq);
+	hash_init(nvgro->hash);
+	INIT_LIST_HEAD(&nvgro->lru);
+	INIT_LIST_HEAD(&nvgro->pend);
+	for (i = 0; i < NVGRO_MAX_FLOWS; i++) {
+		__skb_queue_head_init(&nvgro->flows[i].fq);
+		INIT_LIST_HEAD(&nvgro->flows[i].pend);
 	}
+	timer_setup(&nvgro->timer, ether_nvgro_timer, 0);
+}
 
-exit:
-	atomic_set(&pdata->timer_state, OSI_DISABLE);
+/**
+ * @brief ether_nvgro_flush - Drop all flows of a channel.
+ *
+ * @param[in] rx_napi: Rx NAPI instance.
+ *
+ * @note NAPI must be disabled.
+ */
+void ether_nvgro_flush(struct ether_rx_napi *rx_napi)
+{
+	struct ether_nvgro *nvgro = &rx_napi->nvgro;
+	struct ether_nvgro_flow *flow, *tmp;
 
-	mod_timer(&pdata->nvgro_timer,
-		  jiffies + msecs_to_jiffies(pdata->nvgro_timer_intrvl));
+	del_timer_sync(&nvgro->timer);
+
+	list_for_each_entry_safe(flow, tmp, &nvgro->lru, lru) {
+		ether_nvgro_flow_purge(nvgro, flow);
+		hash_del(&flow->node);
+		list_del(&flow->lru);
+		list_del_init(&flow->pend);
+		flow->active = false;
+	}
+	nvgro->nr_flows = 0;
 }
 
 /**
  * @brief ether_do_nvgro - Perform NVGRO processing.
  *
+ * Algorithm:
+ * 1) Only UDP/IPv4 segments for sockets with UDP GRO enabled are taken.
+ * 2) TTL bits 7:6 mark the first (1) and last (2) segment of a sequence,
+ * the IP ID numbers the segments.
+ * 3) Segments are collected per flow, in sequence in fq and out of order
+ * in a window indexed by IP ID, and merged once the sequence is complete.
+ *
  * @param[in] pdata: Ethernet private data.
- * @param[in] napi: Ethernet driver NAPI instance.
+ * @param[in] rx_napi: Rx NAPI instance owning the flow table.
  * @param[in] skb: socket buffer
  *
- * @retval true on Success
- * @retval false on failure.
+ * @retval true if skb was consumed
+ * @retval false if skb has to take the regular path.
  */
 static bool ether_do_nvgro(struct ether_priv_data *pdata,
-			   struct napi_struct *napi,
+			   struct ether_rx_napi *rx_napi,
 			   struct sk_buff *skb)
 {
 	struct udphdr *uh = (struct udphdr *)(skb->data + sizeof(struct iphdr));
 	struct iphdr *iph = (struct iphdr *)skb->data;
-	struct sk_buff_head *mq = &pdata->mq;
+	struct ether_nvgro *nvgro = &rx_napi->nvgro;
 	struct ethhdr *ethh = eth_hdr(skb);
+	struct ether_nvgro_flow *flow;
 	struct sock *sk = NULL;
+	u16 ip_id;
 
 	if (ethh->h_proto != htons(ETH_P_IP))
 		return false;
@@ -536,7 +735,6 @@ static bool ether_do_nvgro(struct ether_priv_data *pdata,
 	if (iph->protocol != IPPROTO_UDP)
 		return false;
 
-	/* TODO: Hash based based queues selection */
 	/* Socket look up with IPv4/UDP source/destination */
 	sk = __udp4_lib_lookup(dev_net(skb->dev), iph->saddr, uh->source,
 			       iph->daddr, uh->dest, inet_iif(skb),
@@ -548,44 +746,41 @@ static bool ether_do_nvgro(struct ether_priv_data *pdata,
 	if (!udp_sk(sk)->gro_enabled)
 		return false;
 
+	flow = ether_nvgro_flow_get(nvgro, iph, uh);
+	list_move_tail(&flow->lru, &nvgro->lru);
+
 	/* Store IPID, TTL and age of skb inside per skb control block */
-	NAPI_GRO_CB(skb)->flush_id = ntohs(iph->id);
+	ip_id = ntohs(iph->id);
+	NAPI_GRO_CB(skb)->flush_id = ip_id;
 	NAPI_GRO_CB(skb)->free = (iph->ttl & (BIT(6) | BIT(7))) >> 6;
 	NAPI_GRO_CB(skb)->age = jiffies;
-
-	while (atomic_read(&pdata->timer_state) == OSI_ENABLE) {
-		/* busyloop */
-	};
-
-	atomic_set(&pdata->rx_state, OSI_ENABLE);
+	flow->stats.segs++;
 
 	if (NAPI_GRO_CB(skb)->free == 1) {
-		/* Update final queue with first segment */
-		ether_update_fq_with_fs(pdata, skb);
-		goto exit;
+		/* First segment restarts the sequence, the flow is pended
+		 * again at the tail with a fresh deadline.
+		 */
+		ether_nvgro_flow_restart(nvgro, flow, ip_id);
+		list_del_init(&flow->pend);
+		__skb_queue_tail(&flow->fq, skb);
+		flow->expected_ip_id = ip_id + 1;
+	} else if (!skb_queue_empty(&flow->fq) &&
+		   flow->expected_ip_id == ip_id &&
+		   skb_queue_len(&flow->fq) < NVGRO_MAX_SEGS) {
+		__skb_queue_tail(&flow->fq, skb);
+		flow->expected_ip_id++;
 	} else {
-		if (pdata->expected_ip_id == NAPI_GRO_CB(skb)->flush_id) {
-			__skb_queue_tail(&pdata->fq, skb);
-			pdata->expected_ip_id = NAPI_GRO_CB(skb)->flush_id + 1;
-
-			if (NAPI_GRO_CB(skb)->free == 2)
-				ether_gro_merge_complete(&pdata->fq, napi);
-
-			goto exit;
-		}
+		ether_nvgro_flow_ooo_add(nvgro, flow, skb);
 	}
 
-	/* Add skb to the queue */
-	__skb_queue_tail(mq, skb);
+	ether_nvgro_flow_gro(nvgro, flow, &rx_napi->napi);
 
-	/* Queue the packets until last segment received */
-	if (NAPI_GRO_CB(skb)->free != 2)
-		goto exit;
+	/* Sequence can't complete within the window */
+	if (skb_queue_len(&flow->fq) >= NVGRO_MAX_SEGS)
+		ether_nvgro_flow_purge(nvgro, flow);
 
-	ether_gro(&pdata->fq, &pdata->mq, napi);
+	ether_nvgro_flow_pend(pdata, nvgro, flow);
 
-exit:
-	atomic_set(&pdata->rx_state, OSI_DISABLE);
 	return true;
 }
 #endif
@@ -618,7 +813,10 @@ static void osd_receive_packet(void *priv, struct osi_rx_ring *rx_ring,
 	struct ether_rx_napi *rx_napi = pdata->rx_napi[chan];
 #ifdef ETHER_PAGE_POOL
 	struct page *page = (struct page *)rx_swcx->buf_virt_addr;
+	struct bpf_prog *xdp_prog = READ_ONCE(pdata->xdp_prog);
+	unsigned int pkt_len = rx_pkt_cx->pkt_len;
 	struct sk_buff *skb = NULL;
+	void *data;
 #else
 	struct sk_buff *skb = (struct sk_buff *)rx_swcx->buf_virt_addr;
 #endif
@@ -647,8 +845,17 @@ static void osd_receive_packet(void *priv, struct osi_rx_ring *rx_ring,
 	if (likely((rx_pkt_cx->flags & OSI_PKT_CX_VALID) ==
 		   OSI_PKT_CX_VALID)) {
 #ifdef ETHER_PAGE_POOL
-		skb = netdev_alloc_skb_ip_align(pdata->ndev,
-						rx_pkt_cx->pkt_len);
+		dma_sync_single_for_cpu(pdata->dev, dma_addr, pkt_len,
+					page_pool_get_dma_dir(pdata->page_pool[chan]));
+		data = page_address(page) + pdata->rx_headroom;
+
+		/* PTP frames keep the timestamp path through the stack */
+		if (xdp_prog && ((rx_pkt_cx->flags & OSI_PKT_CX_PTP) == 0U) &&
+		    ether_xdp_run(pdata, xdp_prog, rx_napi, page, &data,
+				  &pkt_len))
+			goto done;
+
+		skb = netdev_alloc_skb_ip_align(pdata->ndev, pkt_len);
 		if (unlikely(!skb)) {
 			pdata->ndev->stats.rx_dropped++;
 			dev_err(pdata->dev,
@@ -658,11 +865,8 @@ static void osd_receive_packet(void *priv, struct osi_rx_ring *rx_ring,
 			return;
 		}
 
-		dma_sync_single_for_cpu(pdata->dev, dma_addr,
-					rx_pkt_cx->pkt_len, DMA_FROM_DEVICE);
-		skb_copy_to_linear_data(skb, page_address(page),
-					rx_pkt_cx->pkt_len);
-		skb_put(skb, rx_pkt_cx->pkt_len);
+		skb_copy_to_linear_data(skb, data, pkt_len);
+		skb_put(skb, pkt_len);
 		page_pool_recycle_direct(pdata->page_pool[chan], page);
 #else
 		skb_put(skb, rx_pkt_cx->pkt_len);
@@ -701,7 +905,7 @@ static void osd_receive_packet(void *priv, struct osi_rx_ring *rx_ring,
 		ndev->stats.rx_bytes += skb->len;
 #ifdef ETHER_NVGRO
 		if ((ndev->features & NETIF_F_GRO) &&
-		    ether_do_nvgro(pdata, &rx_napi->napi, skb))
+		    ether_do_nvgro(pdata, rx_napi, skb))
 			goto done;
 #endif
 		if (likely(ndev->features & NETIF_F_GRO)) {
@@ -722,7 +926,7 @@ static void osd_receive_packet(void *priv, struct osi_rx_ring *rx_ring,
 		dev_kfree_skb_any(skb);
 	}
 
-#ifdef ETHER_NVGRO
+#if defined(ETHER_NVGRO) || defined(ETHER_PAGE_POOL)
 done:
 #endif
 	ndev->stats.rx_packets++;
@@ -766,6 +970,12 @@ static void osd_transmit_complete(void *priv, const struct osi_tx_swcx *swcx,
 	unsigned int chan, qinx;
 	unsigned int len = swcx->len;
 
+#ifdef ETHER_PAGE_POOL
+	if (unlikely(ether_xdp_is_tx_swcx(pdata, swcx))) {
+		ether_xdp_tx_complete(pdata, swcx);
+		return;
+	}
+#endif
 	ndev->stats.tx_bytes += len;
 
 	if ((txdone_pkt_cx->flags & OSI_TXDONE_CX_TS) == OSI_TXDONE_CX_TS) {
@@ -347,6 +347,125 @@ static int ether_test_mmc_counters(struct ether_priv_data *pdata)
 	return 0;
 }
 
+#ifdef ETHER_PAGE_POOL
+/**
+ * @brief ether_test_xdp_prog - Build an XDP program returning a fixed verdict
+ *
+ * @param[in] act: XDP verdict returned by the program
+ *
+ * @retval program pointer on success
+ * @retval ERR_PTR on failure.
+ */
+static struct bpf_prog *ether_test_xdp_prog(u32 act)
+{
+	struct bpf_insn insns[] = {
+		BPF_MOV64_IMM(BPF_REG_0, act),
+		BPF_EXIT_INSN(),
+	};
+	struct bpf_prog *prog;
+	int err = 0;
+
+	prog = bpf_prog_alloc(bpf_prog_size(ARRAY_SIZE(insns)), 0);
+	if (!prog)
+		return ERR_PTR(-ENOMEM);
+
+	prog->len = ARRAY_SIZE(insns);
+	prog->type = BPF_PROG_TYPE_XDP;
+	memcpy(prog->insnsi, insns, sizeof(insns));
+
+	prog = bpf_prog_select_runtime(prog, &err);
+	if (err) {
+		bpf_prog_free(prog);
+		return ERR_PTR(err);
+	}
+
+	return prog;
+}
+
+/**
+ * @brief ether_test_xdp - Ethernet selftest for XDP verdicts
+ *
+ * Algorithm:
+ * 1) Only runs with an XDP program attached, the Rx buffer layout and the
+ * XDP Tx channel only exist then. The attached program is swapped for
+ * programs returning a fixed verdict and restored at the end.
+ * 2) XDP_PASS: the loopback frame reaches the stack.
+ * 3) XDP_DROP: the frame never reaches the stack and is counted as dropped.
+ * 4) XDP_TX: the frame never reaches the stack and is sent back out of the
+ * XDP Tx channel. MAC loopback keeps it bouncing until XDP_DROP is put
+ * back in place.
+ *
+ * @param[in] pdata: Ethernet OSD private data
+ *
+ * @retval zero on success
+ * @retval negative value on failure.
+ */
+static int ether_test_xdp(struct ether_priv_data *pdata)
+{
+	static const u32 acts[] = { XDP_PASS, XDP_DROP, XDP_TX };
+	struct bpf_prog *prog[ARRAY_SIZE(acts)] = { };
+	struct net_device *ndev = pdata->ndev;
+	struct bpf_prog *old_prog = pdata->xdp_prog;
+	unsigned long rx_dropped, tx_packets;
+	unsigned int i;
+	int ret = 0;
+
+	if (!old_prog)
+		return -EOPNOTSUPP;
+
+	for (i = 0; i < ARRAY_SIZE(acts); i++) {
+		prog[i] = ether_test_xdp_prog(acts[i]);
+		if (IS_ERR(prog[i])) {
+			ret = PTR_ERR(prog[i]);
+			prog[i] = NULL;
+			goto free;
+		}
+	}
+
+	/* XDP_PASS */
+	WRITE_ONCE(pdata->xdp_prog, prog[0]);
+	ret = ether_test_mac_loopback(pdata);
+	if (ret)
+		goto restore;
+
+	/* XDP_DROP */
+	WRITE_ONCE(pdata->xdp_prog, prog[1]);
+	rx_dropped = ndev->stats.rx_dropped;
+	ret = ether_test_mac_loopback(pdata);
+	if ((ret != -ETIMEDOUT) || (ndev->stats.rx_dropped == rx_dropped)) {
+		ret = -EIO;
+		goto restore;
+	}
+
+	/* XDP_TX, the original frame plus at least one bounce */
+	WRITE_ONCE(pdata->xdp_prog, prog[2]);
+	tx_packets = ndev->stats.tx_packets;
+	ret = ether_test_mac_loopback(pdata);
+
+	rx_dropped = ndev->stats.rx_dropped;
+	WRITE_ONCE(pdata->xdp_prog, prog[1]);
+	for (i = 0; (i < 20U) && (ndev->stats.rx_dropped == rx_dropped); i++)
+		msleep(10);
+
+	if ((ret != -ETIMEDOUT) || (ndev->stats.tx_packets < tx_packets + 2U))
+		ret = -EIO;
+	else
+		ret = 0;
+
+restore:
+	WRITE_ONCE(pdata->xdp_prog, old_prog);
+	/* Rx NAPI may still be running a test program */
+	synchronize_net();
+free:
+	for (i = 0; i < ARRAY_SIZE(acts); i++) {
+		if (prog[i])
+			bpf_prog_free(prog[i]);
+	}
+
+	return ret;
+}
+#endif /* ETHER_PAGE_POOL */
+
 #define ETHER_LOOPBACK_NONE	0
 #define ETHER_LOOPBACK_MAC	1
 #define ETHER_LOOPBACK_PHY	2
@@ -369,6 +488,13 @@ static const struct ether_test {
 		.lb = ETHER_LOOPBACK_MAC,
 		.fn = ether_test_mmc_counters,
 	},
+#ifdef ETHER_PAGE_POOL
+	{
+		.name = "XDP Loopback		",
+		.lb = ETHER_LOOPBACK_MAC,
+		.fn = ether_test_xdp,
+	},
+#endif
 };
 
 /**
@@ -2424,59 +2424,6 @@ static DEVICE_ATTR(nvgro_pkt_age_msec, 0644,
 		   ether_nvgro_pkt_age_msec_show,
 		   ether_nvgro_pkt_age_msec_store);
 
-/**
- * @brief Shows the current setting of NVGRO purge timer interval..
- *
- * @param[in] dev: Device data.
- * @param[in] attr: Device attribute
- * @param[in] buf: Buffer to store the current ptp sync method
- */
-static ssize_t ether_nvgro_timer_interval_show(struct device *dev,
-					       struct device_attribute *attr,
-					       char *buf)
-{
-	struct net_device *ndev = (struct net_device *)dev_get_drvdata(dev);
-	struct ether_priv_data *pdata = netdev_priv(ndev);
-
-	return scnprintf(buf, PAGE_SIZE, "%u\n", pdata->nvgro_timer_intrvl);
-}
-
-/**
- * @brief Set the user setting of NVGRO purge timer interval.
- *
- * @param[in] dev: Device data.
- * @param[in] attr: Device attribute
- * @param[in] buf: Buffer which contains the user settings of MAC loopback
- * @param[in] size: size of buffer
- *
- * @return size of buffer.
- */
-static ssize_t ether_nvgro_timer_interval_store(struct device *dev,
-						struct device_attribute *attr,
-						const char *buf, size_t size)
-{
-	struct net_device *ndev = (struct net_device *)dev_get_drvdata(dev);
-	struct ether_priv_data *pdata = netdev_priv(ndev);
-	int ret;
-
-	ret = kstrtou32(buf, 0, &pdata->nvgro_timer_intrvl);
-	if (ret < 0) {
-		dev_err(pdata->dev,
-			"Invalid nvgro timer interval input\n");
-		return -EINVAL;
-	}
-
-	return size;
-}
-
-/**
- * @brief Sysfs attribute for NVGRO purge timer interval
- *
- */
-static DEVICE_ATTR(nvgro_timer_interval, 0644,
-		   ether_nvgro_timer_interval_show,
-		   ether_nvgro_timer_interval_store);
-
 /**
  * @brief Shows NVGRO stats
  *
@@ -2490,9 +2437,21 @@ static ssize_t ether_nvgro_stats_show(struct device *dev,
 {
 	struct net_device *ndev = (struct net_device *)dev_get_drvdata(dev);
 	struct ether_priv_data *pdata = netdev_priv(ndev);
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	u64 dropped = 0, evicted = 0, merged = 0, timeouts = 0;
+	unsigned int i, chan;
+
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		chan = osi_dma->dma_chans[i];
+		dropped += pdata->rx_napi[chan]->nvgro.dropped;
+		evicted += pdata->rx_napi[chan]->nvgro.evicted;
+		merged += pdata->rx_napi[chan]->nvgro.merged;
+		timeouts += pdata->rx_napi[chan]->nvgro.timeouts;
+	}
 
-	return scnprintf(buf, PAGE_SIZE, "dropped = %llu\n",
-			 pdata->nvgro_dropped);
+	return scnprintf(buf, PAGE_SIZE,
+			 "dropped = %llu\nevicted = %llu\nmerged = %llu\ntimeouts = %llu\n",
+			 dropped, evicted, merged, timeouts);
 }
 
 /**
@@ -2503,7 +2462,7 @@ static DEVICE_ATTR(nvgro_stats, 0644,
 		   ether_nvgro_stats_show, NULL);
 
 /**
- * @brief Dumps NVGRO queues.
+ * @brief Dumps NVGRO flows.
  *
  * @param[in] dev: Device data.
  * @param[in] attr: Device attribute
@@ -2515,24 +2474,32 @@ static ssize_t ether_nvgro_dump_show(struct device *dev,
 {
 	struct net_device *ndev = (struct net_device *)dev_get_drvdata(dev);
 	struct ether_priv_data *pdata = netdev_priv(ndev);
-	struct sk_buff *p, *pp;
-	char *start = buf;
+	struct osi_dma_priv_data *osi_dma = pdata->osi_dma;
+	struct ether_nvgro_flow *flow;
+	unsigned int i, j, chan;
+	ssize_t len = 0;
 
-	buf += scnprintf(buf, PAGE_SIZE, "MQ: ");
-	skb_queue_walk_safe(&pdata->mq, p, pp) {
-		buf += scnprintf(buf, PAGE_SIZE, "skb %p TTL %d IPID %u\n",
-				 p, NAPI_GRO_CB(p)->free,
-				 NAPI_GRO_CB(p)->flush_id);
-	}
+	for (i = 0; i < osi_dma->num_dma_chans; i++) {
+		chan = osi_dma->dma_chans[i];
+		for (j = 0; j < NVGRO_MAX_FLOWS; j++) {
+			flow = &pdata->rx_napi[chan]->nvgro.flows[j];
+			if (!flow->active)
+				continue;
 
-	buf += scnprintf(buf, PAGE_SIZE, "FQ: ");
-	skb_queue_walk_safe(&pdata->fq, p, pp) {
-		buf += scnprintf(buf, PAGE_SIZE, "skb %p TTL %d IPID %u\n",
-				 p, NAPI_GRO_CB(p)->free,
-				 NAPI_GRO_CB(p)->flush_id);
+			len += scnprintf(buf + len, PAGE_SIZE - len,
+					 "q%u f%u %pI4:%u -> %pI4:%u fq %u ooo %u segs %llu merged %llu dropped %llu timeouts %llu\n",
+					 chan, j, &flow->saddr,
+					 ntohs(flow->sport), &flow->daddr,
+					 ntohs(flow->dport),
+					 skb_queue_len(&flow->fq),
+					 flow->ooo_cnt, flow->stats.segs,
+					 flow->stats.merged,
+					 flow->stats.dropped,
+					 flow->stats.timeouts);
+		}
 	}
 
-	return (buf - start);
+	return len;
 }
 
 /**
@@ -2716,7 +2683,6 @@ static struct attribute *ether_sysfs_attrs[] = {
 	&dev_attr_phy_iface_mode.attr,
 #ifdef ETHER_NVGRO
 	&dev_attr_nvgro_pkt_age_msec.attr,
-	&dev_attr_nvgro_timer_interval.attr,
 	&dev_attr_nvgro_stats.attr,
 	&dev_attr_nvgro_dump.attr,
 #endif
@@ -2743,7 +2709,6 @@ static struct attribute *ether_sysfs_attrs_without_macsec[] = {
 	&dev_attr_phy_iface_mode.attr,
 #ifdef ETHER_NVGRO
 	&dev_attr_nvgro_pkt_age_msec.attr,
-	&dev_attr_nvgro_timer_interval.attr,
 	&dev_attr_nvgro_stats.attr,
 	&dev_attr_nvgro_dump.attr,
 #endif
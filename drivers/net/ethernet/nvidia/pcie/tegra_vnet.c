@@ -48,6 +48,9 @@ struct tvnet_priv {
 	/* Flag to track ndo_stop done by suspend */
 	bool pm_closed;
 
+	/* Both sides advertised TVNET_FEATURE_OFFLOAD */
+	bool offload;
+
 	/* To synchronize network link state machine*/
 	struct mutex link_state_lock;
 	wait_queue_head_t link_state_wq;
@@ -168,7 +171,9 @@ static void tvnet_host_alloc_empty_buffers(struct tvnet_priv *tvnet)
 	while (!tvnet_ivc_full(&tvnet->ep2h_empty)) {
 		struct sk_buff *skb;
 		dma_addr_t iova;
-		int len = ndev->mtu + ETH_HLEN;
+		/* Without offloads the EP never sends more than an MTU */
+		int len = tvnet->offload ? TVNET_RX_BUF_LEN :
+					   ndev->mtu + ETH_HLEN;
 		u32 idx;
 
 		skb = netdev_alloc_skb(ndev, len);
@@ -416,22 +421,20 @@ static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 	struct ep_ring_buf *ep_mem = &tvnet->ep_mem;
 	struct data_msg *h2ep_empty_msg = ep_mem->h2ep_empty_msgs;
 	struct device *d = &tvnet->pdev->dev;
+	struct tvnet_skb_map map;
 #if ENABLE_DMA
 	struct tvnet_dma_desc *dma_desc = tvnet->dma_desc;
 	struct dma_desc_cnt *desc_cnt = &tvnet->desc_cnt;
 	u32 desc_widx, desc_ridx, val;
-	u32 ctrl_d;
+	u32 ctrl_d, dst_off;
 	unsigned long timeout;
+	int i;
 #endif
-	dma_addr_t src_iova;
 	dma_addr_t dst_iova;
 	u32 rd_idx;
 	u32 wr_idx;
 	void *dst_virt;
-	int len;
-
-	/* TODO Not expecting skb frags, remove this after testing */
-	WARN_ON(info->nr_frags);
+	u32 dst_len;
 
 	/* Check if H2EP_EMPTY_BUF available to read */
 	if (!tvnet_ivc_rd_available(&tvnet->h2ep_empty)) {
@@ -450,28 +453,49 @@ static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 	}
 
 #if ENABLE_DMA
-	/* Check if dma desc available */
-	if ((desc_cnt->wr_cnt - desc_cnt->rd_cnt) >= DMA_DESC_COUNT) {
+	/* Check if dma descs are available for the whole chain */
+	if ((desc_cnt->wr_cnt - desc_cnt->rd_cnt) + info->nr_frags + 1 >
+	    DMA_DESC_COUNT) {
 		pr_debug("%s: dma descriptors are not available\n", __func__);
 		netif_stop_queue(ndev);
 		return NETDEV_TX_BUSY;
 	}
 #endif
 
-	len = skb_headlen(skb);
+	/* Get H2EP empty msg */
+	rd_idx = tvnet_ivc_get_rd_cnt(&tvnet->h2ep_empty) %
+				RING_COUNT;
+	dst_iova = h2ep_empty_msg[rd_idx].u.empty_buffer.pcie_address;
+	dst_len = h2ep_empty_msg[rd_idx].u.empty_buffer.buffer_len;
+	dst_virt = (__force void *)tvnet->mmio_base + (dst_iova - tvnet->bar_md->bar0_base_phy);
 
-	src_iova = dma_map_single(d, skb->data, len, DMA_TO_DEVICE);
-	if (dma_mapping_error(d, src_iova)) {
-		pr_err("%s: dma_map_single failed\n", __func__);
+	if (skb->len > dst_len) {
+		pr_debug("%s: skb len %u exceeds EP buffer %u, drop\n",
+			 __func__, skb->len, dst_len);
 		dev_kfree_skb_any(skb);
 		return NETDEV_TX_OK;
 	}
 
-	/* Get H2EP empty msg */
-	rd_idx = tvnet_ivc_get_rd_cnt(&tvnet->h2ep_empty) %
+	/* Push dst to H2EP full ring */
+	wr_idx = tvnet_ivc_get_wr_cnt(&tvnet->h2ep_full) %
 				RING_COUNT;
-	dst_iova = h2ep_empty_msg[rd_idx].u.empty_buffer.pcie_address;
-	dst_virt = (__force void *)tvnet->mmio_base + (dst_iova - tvnet->bar_md->bar0_base_phy);
+	if (tvnet_skb_to_data_msg(skb, &h2ep_full_msg[wr_idx])) {
+		pr_debug("%s: unsupported gso type 0x%x, drop\n", __func__,
+			 info->gso_type);
+		dev_kfree_skb_any(skb);
+		return NETDEV_TX_OK;
+	}
+
+#if ENABLE_DMA
+	if (tvnet_map_skb(d, skb, &map)) {
+		pr_err("%s: dma map of skb failed\n", __func__);
+		dev_kfree_skb_any(skb);
+		return NETDEV_TX_OK;
+	}
+#else
+	map.nr_segs = 0;
+#endif
+
 	/* Advance read count after all failure cases complated, to avoid
 	 * dangling buffer at endpoint.
 	 */
@@ -480,20 +504,33 @@ static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 	tvnet_host_raise_ep_ctrl_irq(tvnet);
 
 #if ENABLE_DMA
-	/* Trigger DMA write from src_iova to dst_iova */
-	desc_widx = desc_cnt->wr_cnt % DMA_DESC_COUNT;
-	dma_desc[desc_widx].size = len;
-	dma_desc[desc_widx].sar_low = lower_32_bits(src_iova);
-	dma_desc[desc_widx].sar_high = upper_32_bits(src_iova);
-	dma_desc[desc_widx].dar_low = lower_32_bits(dst_iova);
-	dma_desc[desc_widx].dar_high = upper_32_bits(dst_iova);
+	/*
+	 * Trigger DMA write from skb segments to dst_iova, one chained desc
+	 * per segment packed back to back in dst. Only the last desc raises
+	 * the done interrupt.
+	 */
+	dst_off = 0;
+	for (i = 0; i < map.nr_segs; i++) {
+		desc_widx = (desc_cnt->wr_cnt + i) % DMA_DESC_COUNT;
+		dma_desc[desc_widx].size = map.len[i];
+		dma_desc[desc_widx].sar_low = lower_32_bits(map.iova[i]);
+		dma_desc[desc_widx].sar_high = upper_32_bits(map.iova[i]);
+		dma_desc[desc_widx].dar_low = lower_32_bits(dst_iova + dst_off);
+		dma_desc[desc_widx].dar_high = upper_32_bits(dst_iova + dst_off);
+		dst_off += map.len[i];
+	}
 	/* CB bit should be set at the end */
 	mb();
-	/* RIE is not required for polling mode */
-	ctrl_d = DMA_CH_CONTROL1_OFF_RDCH_RIE;
-	ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_LIE;
-	ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_CB;
-	dma_desc[desc_widx].ctrl_reg.ctrl_d = ctrl_d;
+	for (i = 0; i < map.nr_segs; i++) {
+		desc_widx = (desc_cnt->wr_cnt + i) % DMA_DESC_COUNT;
+		ctrl_d = DMA_CH_CONTROL1_OFF_RDCH_CB;
+		/* RIE is not required for polling mode */
+		if (i == map.nr_segs - 1) {
+			ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_RIE;
+			ctrl_d |= DMA_CH_CONTROL1_OFF_RDCH_LIE;
+		}
+		dma_desc[desc_widx].ctrl_reg.ctrl_d = ctrl_d;
+	}
 	/*
 	 * Read after write to avoid EP DMA reading LLE before CB is written to
 	 * EP's system memory.
@@ -506,7 +543,7 @@ static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 	timeout = jiffies + msecs_to_jiffies(1000);
 	dma_common_wr(tvnet->dma_base, DMA_RD_DATA_CH, DMA_READ_DOORBELL_OFF);
 
-	desc_cnt->wr_cnt++;
+	desc_cnt->wr_cnt += map.nr_segs;
 
 	while (true) {
 		val = dma_common_rd(tvnet->dma_base, DMA_READ_INT_STATUS_OFF);
@@ -524,31 +561,37 @@ static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 			dma_common_wr(tvnet->dma_base,
 				      DMA_READ_ENGINE_EN_OFF_ENABLE,
 				      DMA_READ_ENGINE_EN_OFF);
-			desc_cnt->wr_cnt--;
-			dma_unmap_single(d, src_iova, len, DMA_TO_DEVICE);
+			desc_cnt->wr_cnt -= map.nr_segs;
+			/* Don't leave a stale tail of the chain armed */
+			for (i = 0; i < map.nr_segs; i++) {
+				desc_widx = (desc_cnt->wr_cnt + i) %
+					    DMA_DESC_COUNT;
+				dma_desc[desc_widx].ctrl_reg.ctrl_e.cb = 0;
+			}
+			mb();
+			tvnet_unmap_skb(d, &map);
 			return NETDEV_TX_BUSY;
 		}
 	}
 
-	desc_ridx = tvnet->desc_cnt.rd_cnt % DMA_DESC_COUNT;
-	/* Clear DMA cycle bit and increment rd_cnt */
-	dma_desc[desc_ridx].ctrl_reg.ctrl_e.cb = 0;
+	/* Clear DMA cycle bits and advance rd_cnt past the chain */
+	for (i = 0; i < map.nr_segs; i++) {
+		desc_ridx = (desc_cnt->rd_cnt + i) % DMA_DESC_COUNT;
+		dma_desc[desc_ridx].ctrl_reg.ctrl_e.cb = 0;
+	}
 	mb();
 
-	tvnet->desc_cnt.rd_cnt++;
+	desc_cnt->rd_cnt += map.nr_segs;
 #else
-	/* Copy skb->data to endpoint dst address, use CPU virt addr */
-	memcpy(dst_virt, skb->data, len);
+	/* Copy skb data and frags to endpoint dst address, use CPU virt addr */
+	skb_copy_bits(skb, 0, dst_virt, skb->len);
 	/* BAR0 mmio address is wc mem, add mb to make sure that complete
 	 * skb->data is written before updating counters.
 	 */
 	mb();
 #endif
 
-	/* Push dst to H2EP full ring */
-	wr_idx = tvnet_ivc_get_wr_cnt(&tvnet->h2ep_full) %
-				RING_COUNT;
-	h2ep_full_msg[wr_idx].u.full_buffer.packet_size = len;
+	h2ep_full_msg[wr_idx].u.full_buffer.packet_size = skb->len;
 	h2ep_full_msg[wr_idx].u.full_buffer.pcie_address = dst_iova;
 	h2ep_full_msg[wr_idx].msg_id = DATA_MSG_FULL_BUF;
 	/* BAR0 mmio address is wc mem, add mb to make sure that full
@@ -559,7 +602,7 @@ static netdev_tx_t tvnet_host_start_xmit(struct sk_buff *skb,
 	tvnet_host_raise_ep_data_irq(tvnet);
 
 	/* Free skb */
-	dma_unmap_single(d, src_iova, len, DMA_TO_DEVICE);
+	tvnet_unmap_skb(d, &map);
 	dev_kfree_skb_any(skb);
 
 	return NETDEV_TX_OK;
@@ -579,6 +622,18 @@ static void tvnet_host_setup_bar0_md(struct tvnet_priv *tvnet)
 
 	tvnet->bar_md = (__force struct bar_md *)tvnet->mmio_base;
 
+	/*
+	 * Offload info is only exchanged if the EP handles it as well. The
+	 * feature words are not there at all for an older EP.
+	 */
+	if (tvnet->bar_md->features_magic == TVNET_FEATURES_MAGIC) {
+		tvnet->bar_md->host_features = TVNET_SUPPORTED_FEATURES;
+		tvnet->offload = !!(tvnet->bar_md->ep_features &
+				    TVNET_FEATURE_OFFLOAD);
+	} else {
+		tvnet->offload = false;
+	}
+
 	ep_mem->ep_cnt = (__force struct ep_own_cnt *)(tvnet->mmio_base +
 					tvnet->bar_md->ep_own_cnt_offset);
 	ep_mem->ep2h_ctrl_msgs = (__force struct ctrl_msg *)(tvnet->mmio_base +
@@ -643,7 +698,7 @@ static int tvnet_host_process_ep2h_msg(struct tvnet_priv *tvnet)
 		struct sk_buff *skb;
 		u64 pcie_address;
 		u32 len;
-		int idx, found = 0;
+		int idx, found = 0, ret;
 		unsigned long flags;
 
 		/* Read EP2H full msg */
@@ -663,21 +718,39 @@ static int tvnet_host_process_ep2h_msg(struct tvnet_priv *tvnet)
 		}
 		spin_unlock_irqrestore(&tvnet->ep2h_empty_lock, flags);
 
-		/* Advance H2EP full buffer after search in local list */
-		tvnet_ivc_advance_rd(&tvnet->ep2h_full);
-		if (WARN_ON(!found))
+		if (!found) {
+			/* Advance H2EP full buffer after search in local list */
+			tvnet_ivc_advance_rd(&tvnet->ep2h_full);
+			WARN_ON(1);
 			continue;
+		}
+
+		dma_unmap_single(d, pcie_address, ep2h_empty_ptr->len,
+				 DMA_FROM_DEVICE);
+		skb = ep2h_empty_ptr->skb;
+		if (len <= ep2h_empty_ptr->len) {
+			skb_put(skb, len);
+			ret = tvnet->offload ?
+			      tvnet_data_msg_to_skb(&data_msg[idx], skb) : 0;
+		} else {
+			ret = -EINVAL;
+		}
+
+		/* Advance once the offload info of the msg is consumed */
+		tvnet_ivc_advance_rd(&tvnet->ep2h_full);
 
 		/* If EP2H network queue is stopped due to lack of EP2H_FULL
 		 * queue, raising ctrl irq will help.
 		 */
 		tvnet_host_raise_ep_ctrl_irq(tvnet);
 
-		dma_unmap_single(d, pcie_address, ndev->mtu + ETH_HLEN, DMA_FROM_DEVICE);
-		skb = ep2h_empty_ptr->skb;
-		skb_put(skb, len);
-		skb->protocol = eth_type_trans(skb, ndev);
-		napi_gro_receive(&tvnet->napi, skb);
+		if (ret) {
+			pr_debug("%s: malformed EP2H msg, drop\n", __func__);
+			dev_kfree_skb_any(skb);
+		} else {
+			skb->protocol = eth_type_trans(skb, ndev);
+			napi_gro_receive(&tvnet->napi, skb);
+		}
 
 		/* Free EP2H empty list element */
 		kfree(ep2h_empty_ptr);
@@ -757,6 +830,13 @@ static int tvnet_host_probe(struct pci_dev *pdev,
 	eth_hw_addr_random(ndev);
 	SET_NETDEV_DEV(ndev, &pdev->dev);
 	ndev->netdev_ops = &tvnet_host_netdev_ops;
+	ndev->hw_features = TVNET_FEATURES;
+	ndev->features = TVNET_FEATURES;
+#if defined(NV_NETIF_SET_TSO_MAX_SIZE_PRESENT) /* Linux v5.19 */
+	netif_set_tso_max_size(ndev, TVNET_MAX_MTU);
+#else
+	netif_set_gso_max_size(ndev, TVNET_MAX_MTU);
+#endif
 	tvnet = netdev_priv(ndev);
 	tvnet->ndev = ndev;
 	tvnet->pdev = pdev;
@@ -814,6 +894,11 @@ static int tvnet_host_probe(struct pci_dev *pdev,
 
 	/* Setup BAR0 meta data */
 	tvnet_host_setup_bar0_md(tvnet);
+	if (!tvnet->offload) {
+		dev_info(&pdev->dev, "EP has no offload support\n");
+		ndev->hw_features &= ~TVNET_OFFLOAD_FEATURES;
+		ndev->features &= ~TVNET_OFFLOAD_FEATURES;
+	}
 
 #if defined(NV_NETIF_NAPI_ADD_WEIGHT_PRESENT) /* Linux v6.1 */
 	netif_napi_add_weight(ndev, &tvnet->napi, tvnet_host_poll, TVNET_NAPI_WEIGHT);
@@ -901,6 +986,10 @@ static void tvnet_host_remove(struct pci_dev *pdev)
 		tvnet->rx_link_state = DIR_LINK_STATE_UP;
 	}
 
+	/* A host driver loaded later may not handle offload info */
+	if (tvnet->bar_md->features_magic == TVNET_FEATURES_MAGIC)
+		tvnet->bar_md->host_features = 0;
+
 	free_irq(pci_irq_vector(pdev, 0), tvnet->ndev);
 	free_irq(pci_irq_vector(pdev, 1), tvnet->ndev);
 	pci_free_irq_vectors(pdev);
@@ -6,6 +6,7 @@
 #include <linux/etherdevice.h>
 #include <linux/module.h>
 #include <linux/netdevice.h>
+#include <linux/rtnetlink.h>
 #include <linux/of_platform.h>
 #include <linux/pci-epc.h>
 #include <linux/pci-epf.h>
@@ -133,6 +134,10 @@ struct pci_epf_tvnet {
 	struct irqsp_data *ctrl_irqsp;
 	struct irqsp_data *data_irqsp;
 	struct work_struct raise_irq_work;
+	/* Both sides advertised TVNET_FEATURE_OFFLOAD at the last link up */
+	bool offload;
+	/* Reevaluates the netdev features once offload changes */
+	struct work_struct features_work;
 
 	struct tvnet_counter h2ep_ctrl;
 	struct tvnet_counter ep2h_ctrl;
@@ -265,6 +270,35 @@ static void tvnet_ep_iova_dealloc(struct pci_epf_tvnet *tvnet, dma_addr_t iova)
 }
 #endif
 
+/* The host fills in and honours the offload info of data msgs */
+static bool tvnet_ep_host_offload(struct pci_epf_tvnet *tvnet)
+{
+	return !!(READ_ONCE(tvnet->bar_md->host_features) &
+		  TVNET_FEATURE_OFFLOAD);
+}
+
+static void tvnet_ep_features_work(struct work_struct *work)
+{
+	struct pci_epf_tvnet *tvnet =
+		container_of(work, struct pci_epf_tvnet, features_work);
+
+	rtnl_lock();
+	netdev_update_features(tvnet->ndev);
+	rtnl_unlock();
+}
+
+static netdev_features_t tvnet_ep_fix_features(struct net_device *ndev,
+					       netdev_features_t features)
+{
+	struct device *fdev = ndev->dev.parent;
+	struct pci_epf_tvnet *tvnet = dev_get_drvdata(fdev);
+
+	if (!tvnet || !READ_ONCE(tvnet->offload))
+		features &= ~TVNET_OFFLOAD_FEATURES;
+
+	return features;
+}
+
 static void tvnet_ep_alloc_empty_buffers(struct pci_epf_tvnet *tvnet)
 {
 	struct ep_ring_buf *ep_ring_buf = &tvnet->ep_ring_buf;
@@ -286,7 +320,9 @@ static void tvnet_ep_alloc_empty_buffers(struct pci_epf_tvnet *tvnet)
 		dma_addr_t iova;
 #if ENABLE_DMA
 		struct sk_buff *skb;
-		int len = ndev->mtu + ETH_HLEN;
+		/* Without offloads the host never sends more than an MTU */
+		int len = tvnet_ep_host_offload(tvnet) ? TVNET_RX_BUF_LEN :
+			  ndev->mtu + ETH_HLEN;
 #else
 		struct page *page;
 		void *virt;
@@ -381,7 +417,8 @@ static void tvnet_ep_alloc_empty_buffers(struct pci_epf_tvnet *tvnet)
 
 		idx = tvnet_ivc_get_wr_cnt(&tvnet->h2ep_empty) % RING_COUNT;
 		h2ep_empty_msg[idx].u.empty_buffer.pcie_address = iova;
-		h2ep_empty_msg[idx].u.empty_buffer.buffer_len = PAGE_SIZE;
+		h2ep_empty_msg[idx].u.empty_buffer.buffer_len =
+							h2ep_empty_ptr->size;
 		tvnet_ivc_advance_wr(&tvnet->h2ep_empty);
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
@@ -509,6 +546,14 @@ static void tvnet_ep_user_link_down_req(struct pci_epf_tvnet *tvnet)
 
 static void tvnet_ep_rcv_link_up_msg(struct pci_epf_tvnet *tvnet)
 {
+	bool offload = tvnet_ep_host_offload(tvnet);
+
+	/* The host driver, and with it its features, may have changed */
+	if (offload != tvnet->offload) {
+		WRITE_ONCE(tvnet->offload, offload);
+		schedule_work(&tvnet->features_work);
+	}
+
 	tvnet->tx_link_state = DIR_LINK_STATE_UP;
 	tvnet_ep_update_link_sm(tvnet);
 }
@@ -622,18 +667,16 @@ static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
 	struct dma_desc_cnt *desc_cnt = &tvnet->desc_cnt;
 	struct tvnet_dma_desc *ep_dma_virt =
 				(struct tvnet_dma_desc *)tvnet->ep_dma_virt;
-	u32 desc_widx, desc_ridx, val, ctrl_d;
+	u32 desc_widx, desc_ridx, val, ctrl_d, seg_off;
 	unsigned long timeout;
+	int i;
 #else
 	int ret;
 #endif
-	dma_addr_t src_iova;
+	struct tvnet_skb_map map;
 	u32 rd_idx, wr_idx;
 	u64 dst_masked, dst_off, dst_iova;
-	int dst_len, len;
-
-	/*TODO Not expecting skb frags, remove this after testing */
-	WARN_ON(info->nr_frags);
+	u32 dst_len;
 
 	/* Check if EP2H_EMPTY_BUF available to read */
 	if (!tvnet_ivc_rd_available(&tvnet->ep2h_empty)) {
@@ -668,27 +711,44 @@ static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
 	}
 
 #if ENABLE_DMA
-	/* Check if dma desc available */
-	if ((desc_cnt->wr_cnt - desc_cnt->rd_cnt) >= DMA_DESC_COUNT) {
+	/* Check if dma descs are available for the whole chain */
+	if ((desc_cnt->wr_cnt - desc_cnt->rd_cnt) + info->nr_frags + 1 >
+	    DMA_DESC_COUNT) {
 		dev_dbg(fdev, "%s: dma descs are not available\n", __func__);
 		netif_stop_queue(ndev);
 		return NETDEV_TX_BUSY;
 	}
 #endif
 
-	len = skb_headlen(skb);
+	/* Get EP2H empty msg */
+	rd_idx = tvnet_ivc_get_rd_cnt(&tvnet->ep2h_empty) % RING_COUNT;
+	dst_iova = ep2h_empty_msg[rd_idx].u.empty_buffer.pcie_address;
+	dst_len = ep2h_empty_msg[rd_idx].u.empty_buffer.buffer_len;
 
-	src_iova = dma_map_single(cdev, skb->data, len, DMA_TO_DEVICE);
-	if (dma_mapping_error(cdev, src_iova)) {
-		dev_err(fdev, "%s: dma_map_single failed\n", __func__);
+	if (skb->len > dst_len) {
+		dev_dbg(fdev, "%s: skb len %u exceeds host buffer %u, drop\n",
+			__func__, skb->len, dst_len);
 		dev_kfree_skb_any(skb);
 		return NETDEV_TX_OK;
 	}
 
-	/* Get EP2H empty msg */
-	rd_idx = tvnet_ivc_get_rd_cnt(&tvnet->ep2h_empty) % RING_COUNT;
-	dst_iova = ep2h_empty_msg[rd_idx].u.empty_buffer.pcie_address;
-	dst_len = ep2h_empty_msg[rd_idx].u.empty_buffer.buffer_len;
+	wr_idx = tvnet_ivc_get_wr_cnt(&tvnet->ep2h_full) % RING_COUNT;
+	if (tvnet_skb_to_data_msg(skb, &ep2h_full_msg[wr_idx])) {
+		dev_dbg(fdev, "%s: unsupported gso type 0x%x, drop\n",
+			__func__, info->gso_type);
+		dev_kfree_skb_any(skb);
+		return NETDEV_TX_OK;
+	}
+
+#if ENABLE_DMA
+	if (tvnet_map_skb(cdev, skb, &map)) {
+		dev_err(fdev, "%s: dma map of skb failed\n", __func__);
+		dev_kfree_skb_any(skb);
+		return NETDEV_TX_OK;
+	}
+#else
+	map.nr_segs = 0;
+#endif
 
 	/*
 	 * Map host dst mem to local PCIe address range.
@@ -707,7 +767,6 @@ static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
 #endif
 	if (ret < 0) {
 		dev_err(fdev, "failed to map dst addr to PCIe addr range\n");
-		dma_unmap_single(cdev, src_iova, len, DMA_TO_DEVICE);
 		dev_kfree_skb_any(skb);
 		return NETDEV_TX_OK;
 	}
@@ -719,25 +778,39 @@ static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
 	tvnet_ivc_advance_rd(&tvnet->ep2h_empty);
 
 #if ENABLE_DMA
-	/* Trigger DMA write from src_iova to dst_iova */
-	desc_widx = desc_cnt->wr_cnt % DMA_DESC_COUNT;
-	ep_dma_virt[desc_widx].size = len;
-	ep_dma_virt[desc_widx].sar_low = lower_32_bits(src_iova);
-	ep_dma_virt[desc_widx].sar_high = upper_32_bits(src_iova);
-	ep_dma_virt[desc_widx].dar_low = lower_32_bits(dst_iova);
-	ep_dma_virt[desc_widx].dar_high = upper_32_bits(dst_iova);
+	/*
+	 * Trigger DMA write from skb segments to dst_iova, one chained desc
+	 * per segment packed back to back in dst. Only the last desc raises
+	 * the done interrupt.
+	 */
+	seg_off = 0;
+	for (i = 0; i < map.nr_segs; i++) {
+		desc_widx = (desc_cnt->wr_cnt + i) % DMA_DESC_COUNT;
+		ep_dma_virt[desc_widx].size = map.len[i];
+		ep_dma_virt[desc_widx].sar_low = lower_32_bits(map.iova[i]);
+		ep_dma_virt[desc_widx].sar_high = upper_32_bits(map.iova[i]);
+		ep_dma_virt[desc_widx].dar_low =
+					lower_32_bits(dst_iova + seg_off);
+		ep_dma_virt[desc_widx].dar_high =
+					upper_32_bits(dst_iova + seg_off);
+		seg_off += map.len[i];
+	}
 	/* CB bit should be set at the end */
 	mb();
-	ctrl_d = DMA_CH_CONTROL1_OFF_WRCH_LIE;
-	ctrl_d |= DMA_CH_CONTROL1_OFF_WRCH_CB;
-	ep_dma_virt[desc_widx].ctrl_reg.ctrl_d = ctrl_d;
+	for (i = 0; i < map.nr_segs; i++) {
+		desc_widx = (desc_cnt->wr_cnt + i) % DMA_DESC_COUNT;
+		ctrl_d = DMA_CH_CONTROL1_OFF_WRCH_CB;
+		if (i == map.nr_segs - 1)
+			ctrl_d |= DMA_CH_CONTROL1_OFF_WRCH_LIE;
+		ep_dma_virt[desc_widx].ctrl_reg.ctrl_d = ctrl_d;
+	}
 
 	/* DMA write should not go out of order wrt CB bit set */
 	mb();
 
 	timeout = jiffies + msecs_to_jiffies(1000);
 	dma_common_wr8(tvnet->dma_base, DMA_WR_DATA_CH, DMA_WRITE_DOORBELL_OFF);
-	desc_cnt->wr_cnt++;
+	desc_cnt->wr_cnt += map.nr_segs;
 
 	while (true) {
 		val = dma_common_rd(tvnet->dma_base, DMA_WRITE_INT_STATUS_OFF);
@@ -755,26 +828,36 @@ static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
 			dma_common_wr(tvnet->dma_base,
 				      DMA_WRITE_ENGINE_EN_OFF_ENABLE,
 				      DMA_WRITE_ENGINE_EN_OFF);
-			desc_cnt->wr_cnt--;
+			desc_cnt->wr_cnt -= map.nr_segs;
+			/* Don't leave a stale tail of the chain armed */
+			for (i = 0; i < map.nr_segs; i++) {
+				desc_widx = (desc_cnt->wr_cnt + i) %
+					    DMA_DESC_COUNT;
+				ep_dma_virt[desc_widx].ctrl_reg.ctrl_e.cb = 0;
+			}
+			mb();
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(4, 15, 0))
 			lpci_epc_unmap_addr(epc, epf->func_no, tvnet->tx_dst_pci_addr);
 #else
 			pci_epc_unmap_addr(epc, tvnet->tx_dst_pci_addr);
 #endif
-			dma_unmap_single(cdev, src_iova, len, DMA_TO_DEVICE);
+			tvnet_unmap_skb(cdev, &map);
 			return NETDEV_TX_BUSY;
 		}
 	}
 
-	desc_ridx = tvnet->desc_cnt.rd_cnt % DMA_DESC_COUNT;
-	/* Clear DMA cycle bit and increment rd_cnt */
-	ep_dma_virt[desc_ridx].ctrl_reg.ctrl_e.cb = 0;
+	/* Clear DMA cycle bits and advance rd_cnt past the chain */
+	for (i = 0; i < map.nr_segs; i++) {
+		desc_ridx = (desc_cnt->rd_cnt + i) % DMA_DESC_COUNT;
+		ep_dma_virt[desc_ridx].ctrl_reg.ctrl_e.cb = 0;
+	}
 	mb();
 
-	tvnet->desc_cnt.rd_cnt++;
+	desc_cnt->rd_cnt += map.nr_segs;
 #else
-	/* Copy skb->data to host dst address, use CPU virt addr */
-	memcpy((void *)(tvnet->tx_dst_va + dst_off), skb->data, len);
+	/* Copy skb data and frags to host dst address, use CPU virt addr */
+	skb_copy_bits(skb, 0, (__force void *)(tvnet->tx_dst_va + dst_off),
+		      skb->len);
 	/*
 	 * tx_dst_va is ioremap_wc() mem, add mb to make sure complete skb->data
 	 * written to dst before adding it to full buffer
@@ -783,8 +866,7 @@ static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
 #endif
 
 	/* Push dst to EP2H full ring */
-	wr_idx = tvnet_ivc_get_wr_cnt(&tvnet->ep2h_full) % RING_COUNT;
-	ep2h_full_msg[wr_idx].u.full_buffer.packet_size = len;
+	ep2h_full_msg[wr_idx].u.full_buffer.packet_size = skb->len;
 	ep2h_full_msg[wr_idx].u.full_buffer.pcie_address = dst_iova;
 	tvnet_ivc_advance_wr(&tvnet->ep2h_full);
 
@@ -796,7 +878,7 @@ static netdev_tx_t tvnet_ep_start_xmit(struct sk_buff *skb,
 	pci_epc_unmap_addr(epc, tvnet->tx_dst_pci_addr);
 #endif
 #endif
-	dma_unmap_single(cdev, src_iova, len, DMA_TO_DEVICE);
+	tvnet_unmap_skb(cdev, &map);
 	dev_kfree_skb_any(skb);
 	schedule_work(&tvnet->raise_irq_work);
 
@@ -808,6 +890,7 @@ static const struct net_device_ops tvnet_netdev_ops = {
 	.ndo_stop = tvnet_ep_close,
 	.ndo_start_xmit = tvnet_ep_start_xmit,
 	.ndo_change_mtu = tvnet_ep_change_mtu,
+	.ndo_fix_features = tvnet_ep_fix_features,
 };
 
 static void tvnet_ep_process_ctrl_msg(struct pci_epf_tvnet *tvnet)
@@ -842,7 +925,7 @@ static int tvnet_ep_process_h2ep_msg(struct pci_epf_tvnet *tvnet)
 	while ((count < TVNET_NAPI_WEIGHT) &&
 	       tvnet_ivc_rd_available(&tvnet->h2ep_full)) {
 		struct sk_buff *skb;
-		int idx, found = 0;
+		int idx, found = 0, ret;
 		u32 len;
 		u64 pcie_address;
 		unsigned long flags;
@@ -864,25 +947,43 @@ static int tvnet_ep_process_h2ep_msg(struct pci_epf_tvnet *tvnet)
 		}
 		spin_unlock_irqrestore(&tvnet->h2ep_empty_lock, flags);
 
-		/* Advance H2EP full buffer after search in local list */
-		tvnet_ivc_advance_rd(&tvnet->h2ep_full);
-		if (WARN_ON(!found))
+		if (!found) {
+			/* Advance H2EP full buffer after search in local list */
+			tvnet_ivc_advance_rd(&tvnet->h2ep_full);
+			WARN_ON(1);
 			continue;
+		}
 #if ENABLE_DMA
-		dma_unmap_single(cdev, pcie_address, ndev->mtu + ETH_HLEN,
+		dma_unmap_single(cdev, pcie_address, h2ep_empty_ptr->size,
 				 DMA_FROM_DEVICE);
 		skb = h2ep_empty_ptr->skb;
-		skb_put(skb, len);
-		skb->protocol = eth_type_trans(skb, ndev);
-		napi_gro_receive(&tvnet->napi, skb);
 #else
 		/* Alloc new skb and copy data from full buffer */
-		skb = netdev_alloc_skb(ndev, len);
-		memcpy(skb->data, h2ep_empty_ptr->virt, len);
-		skb_put(skb, len);
-		skb->protocol = eth_type_trans(skb, ndev);
-		napi_gro_receive(&tvnet->napi, skb);
+		skb = netdev_alloc_skb(ndev, h2ep_empty_ptr->size);
+#endif
+		ret = -EINVAL;
+		if (skb && len <= h2ep_empty_ptr->size) {
+#if !ENABLE_DMA
+			memcpy(skb->data, h2ep_empty_ptr->virt, len);
+#endif
+			skb_put(skb, len);
+			ret = tvnet_ep_host_offload(tvnet) ?
+			      tvnet_data_msg_to_skb(&data_msg[idx], skb) : 0;
+		}
+
+		/* Advance once the offload info of the msg is consumed */
+		tvnet_ivc_advance_rd(&tvnet->h2ep_full);
 
+		if (ret) {
+			dev_dbg(tvnet->fdev, "%s: malformed H2EP msg, drop\n",
+				__func__);
+			dev_kfree_skb_any(skb);
+		} else {
+			skb->protocol = eth_type_trans(skb, ndev);
+			napi_gro_receive(&tvnet->napi, skb);
+		}
+
+#if !ENABLE_DMA
 		/* Free H2EP dst msg */
 		vunmap(h2ep_empty_ptr->virt);
 		iommu_unmap(domain, h2ep_empty_ptr->iova, PAGE_SIZE);
@@ -1347,7 +1448,7 @@ static int tvnet_ep_alloc_single_page_bar0_mem(struct pci_epf *epf,
 	struct bar0_amap *amap = &tvnet->bar0_amap[type];
 	int ret = 0;
 
-	amap->page = alloc_pages(GFP_KERNEL, 1);
+	amap->page = alloc_pages(GFP_KERNEL | __GFP_ZERO, 1);
 	if (!amap->page) {
 		dev_err(tvnet->fdev, "%s: type: %d alloc_pages() failed\n",
 			__func__, type);
@@ -1922,6 +2023,11 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	bar_md->bar0_base_phy = tvnet->bar0_iova;
 	bar_md->ep_rx_pkt_offset = bar_md->host_dma_offset +
 					tvnet->bar0_amap[HOST_DMA].size;
+	bar_md->ep_features = TVNET_SUPPORTED_FEATURES;
+	/* Set by the host driver, if it knows about it */
+	bar_md->host_features = 0;
+	/* Tells the host that the feature words above are valid */
+	bar_md->features_magic = TVNET_FEATURES_MAGIC;
 	bar_md->ep_rx_pkt_size = BAR0_SIZE -
 					tvnet->bar0_amap[META_DATA].size -
 					tvnet->bar0_amap[SIMPLE_IRQ].size -
@@ -1961,6 +2067,15 @@ static int tvnet_ep_pci_epf_bind(struct pci_epf *epf)
 	tvnet->ndev = ndev;
 	SET_NETDEV_DEV(ndev, fdev);
 	ndev->netdev_ops = &tvnet_netdev_ops;
+	/* Offloads stay masked by ndo_fix_features until the host has them */
+	ndev->hw_features = TVNET_FEATURES;
+	ndev->features = TVNET_FEATURES;
+	INIT_WORK(&tvnet->features_work, tvnet_ep_features_work);
+#if defined(NV_NETIF_SET_TSO_MAX_SIZE_PRESENT) /* Linux v5.19 */
+	netif_set_tso_max_size(ndev, TVNET_MAX_MTU);
+#else
+	netif_set_gso_max_size(ndev, TVNET_MAX_MTU);
+#endif
 #if defined(NV_NETIF_NAPI_ADD_WEIGHT_PRESENT) /* Linux v6.1 */
 	netif_napi_add_weight(ndev, &tvnet->napi, tvnet_ep_poll, TVNET_NAPI_WEIGHT);
 #else
@@ -2121,6 +2236,7 @@ static void tvnet_ep_pci_epf_unbind(struct pci_epf *epf)
 	dma_free_coherent(cdev,
 			  ((RING_COUNT + 1) * sizeof(struct tvnet_dma_desc)),
 			  tvnet->ep_dma_virt, tvnet->ep_dma_iova);
+	cancel_work_sync(&tvnet->features_work);
 	unregister_netdev(tvnet->ndev);
 	netif_napi_del(&tvnet->napi);
 	free_netdev(tvnet->ndev);
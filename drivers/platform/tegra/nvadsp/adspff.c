@@ -26,6 +26,8 @@
 #include <linux/debugfs.h>
 #include <linux/platform_device.h>
 #include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include <linux/tegra_nvadsp.h>
 #include <uapi/linux/sched/types.h>
@@ -36,6 +38,20 @@
 
 #define ADSPFF_MAX_OPEN_FILES	(32)
 
+/* write-behind chunk size and per-file bound on unwritten data */
+#define ADSPFF_WB_CHUNK_SIZE	(64 * 1024)
+#define ADSPFF_WB_MAX_PENDING	(512 * 1024)
+/* readahead window for sequential fread */
+#define ADSPFF_RA_SIZE		(128 * 1024)
+
+struct adspff_wb_req {
+	struct list_head list;
+	unsigned long long offset;
+	uint32_t len;
+	uint32_t cap;
+	uint8_t data[];
+};
+
 struct file_struct {
 	struct file *fp;
 	uint8_t file_name[ADSPFF_MAX_FILENAME_SIZE];
@@ -43,9 +59,25 @@ struct file_struct {
 	unsigned long long wr_offset;
 	unsigned long long rd_offset;
 	struct list_head list;
+
+	/* write-behind: ordered chunks not yet handed to the filesystem */
+	struct mutex wb_lock;
+	struct list_head wb_list;
+	uint32_t wb_pending;
+	int wb_error;
+	wait_queue_head_t wb_wait;
+	struct work_struct wb_work;
+
+	/* readahead: ra_buf caches [ra_offset, ra_offset + ra_len) */
+	uint8_t *ra_buf;
+	unsigned long long ra_offset;
+	uint32_t ra_len;
+	unsigned long long rd_last;
+	struct work_struct ra_work;
 };
 
 static struct list_head file_list;
+static struct workqueue_struct *adspff_wq;
 static spinlock_t adspff_lock;
 static int open_count;
 
@@ -123,6 +155,203 @@ static uint32_t file_size(struct file *file)
 	return size;
 }
 
+/******************************************************************************
+* Asynchronous file I/O
+******************************************************************************/
+
+static void adspff_wb_work_fn(struct work_struct *work)
+{
+	struct file_struct *file =
+		container_of(work, struct file_struct, wb_work);
+	struct adspff_wb_req *req;
+	unsigned long long offset;
+	int ret;
+
+	while (1) {
+		mutex_lock(&file->wb_lock);
+		req = list_first_entry_or_null(&file->wb_list,
+				struct adspff_wb_req, list);
+		if (req)
+			list_del(&req->list);
+		mutex_unlock(&file->wb_lock);
+
+		if (!req)
+			break;
+
+		offset = req->offset;
+		ret = file_write(file->fp, &offset, req->data, req->len);
+		if (ret != req->len) {
+			pr_err("write-behind of %s failed %d\n",
+				file->file_name, ret);
+			WRITE_ONCE(file->wb_error, (ret < 0) ? ret : -EIO);
+		}
+
+		mutex_lock(&file->wb_lock);
+		file->wb_pending -= req->len;
+		mutex_unlock(&file->wb_lock);
+		wake_up(&file->wb_wait);
+		kfree(req);
+	}
+}
+
+/* Queue data for write-behind, merging with the tail chunk when contiguous */
+static int adspff_wb_queue(struct file_struct *file, const uint8_t *data,
+				uint32_t size)
+{
+	struct adspff_wb_req *req;
+	bool merged = false;
+
+	wait_event(file->wb_wait,
+		   READ_ONCE(file->wb_pending) + size <= ADSPFF_WB_MAX_PENDING);
+
+	mutex_lock(&file->wb_lock);
+	req = list_empty(&file->wb_list) ? NULL :
+		list_last_entry(&file->wb_list, struct adspff_wb_req, list);
+	if (req && req->offset + req->len == file->wr_offset &&
+	    req->len + size <= req->cap) {
+		memcpy(req->data + req->len, data, size);
+		req->len += size;
+		merged = true;
+	}
+	mutex_unlock(&file->wb_lock);
+
+	if (!merged) {
+		req = kmalloc(struct_size(req, data,
+				max_t(uint32_t, size, ADSPFF_WB_CHUNK_SIZE)),
+				GFP_KERNEL);
+		if (!req)
+			return -ENOMEM;
+
+		req->offset = file->wr_offset;
+		req->len = size;
+		req->cap = max_t(uint32_t, size, ADSPFF_WB_CHUNK_SIZE);
+		memcpy(req->data, data, size);
+
+		mutex_lock(&file->wb_lock);
+		list_add_tail(&req->list, &file->wb_list);
+		mutex_unlock(&file->wb_lock);
+	}
+
+	mutex_lock(&file->wb_lock);
+	file->wb_pending += size;
+	mutex_unlock(&file->wb_lock);
+
+	file->wr_offset += size;
+	queue_work(adspff_wq, &file->wb_work);
+
+	return 0;
+}
+
+static void adspff_wb_drain(struct file_struct *file)
+{
+	flush_work(&file->wb_work);
+}
+
+static int adspff_fwrite_segment(struct file_struct *file,
+				const uint8_t *data, uint32_t size)
+{
+	if (!adspff_wb_queue(file, data, size))
+		return size;
+
+	/* out of memory for write-behind, write through */
+	adspff_wb_drain(file);
+	return file_write(file->fp, &file->wr_offset, (unsigned char *)data,
+			size);
+}
+
+static void adspff_ra_work_fn(struct work_struct *work)
+{
+	struct file_struct *file =
+		container_of(work, struct file_struct, ra_work);
+	unsigned long long pos = file->ra_offset + file->ra_len;
+	int ret;
+
+	ret = file_read(file->fp, &pos, file->ra_buf + file->ra_len,
+			ADSPFF_RA_SIZE - file->ra_len);
+	if (ret > 0)
+		file->ra_len += ret;
+}
+
+static void adspff_ra_drop(struct file_struct *file)
+{
+	flush_work(&file->ra_work);
+	file->ra_len = 0;
+}
+
+/*
+ * Keep the unread part of the window and prefetch behind it while the
+ * ADSP consumes what was just delivered. Only called with ra_work idle.
+ */
+static void adspff_ra_kick(struct file_struct *file)
+{
+	unsigned long long ra_end = file->ra_offset + file->ra_len;
+	uint32_t keep = 0;
+
+	if (!file->ra_buf) {
+		file->ra_buf = kmalloc(ADSPFF_RA_SIZE, GFP_KERNEL);
+		if (!file->ra_buf)
+			return;
+		file->ra_len = 0;
+	}
+
+	if (file->rd_offset >= file->ra_offset && file->rd_offset < ra_end) {
+		keep = ra_end - file->rd_offset;
+		memmove(file->ra_buf,
+			file->ra_buf + (file->rd_offset - file->ra_offset),
+			keep);
+	}
+	file->ra_offset = file->rd_offset;
+	file->ra_len = keep;
+
+	if (keep < ADSPFF_RA_SIZE / 2)
+		queue_work(adspff_wq, &file->ra_work);
+}
+
+/* Fill dst from the readahead window first, then from the file */
+static uint32_t adspff_file_read(struct file_struct *file, uint8_t *dst,
+				uint32_t size)
+{
+	unsigned long long ra_end = file->ra_offset + file->ra_len;
+	uint32_t done = 0;
+	int ret;
+
+	if (file->ra_len && file->rd_offset >= file->ra_offset &&
+	    file->rd_offset < ra_end) {
+		done = min_t(unsigned long long, size,
+			     ra_end - file->rd_offset);
+		memcpy(dst, file->ra_buf + (file->rd_offset - file->ra_offset),
+			done);
+		file->rd_offset += done;
+	}
+
+	if (done < size) {
+		ret = file_read(file->fp, &file->rd_offset, dst + done,
+				size - done);
+		if (ret > 0)
+			done += ret;
+	}
+
+	return done;
+}
+
+static void adspff_file_init(struct file_struct *file)
+{
+	mutex_init(&file->wb_lock);
+	INIT_LIST_HEAD(&file->wb_list);
+	init_waitqueue_head(&file->wb_wait);
+	INIT_WORK(&file->wb_work, adspff_wb_work_fn);
+	INIT_WORK(&file->ra_work, adspff_ra_work_fn);
+}
+
+/* Wait for all outstanding I/O of the file and drop its caches */
+static void adspff_file_quiesce(struct file_struct *file)
+{
+	adspff_wb_drain(file);
+	adspff_ra_drop(file);
+	kfree(file->ra_buf);
+	file->ra_buf = NULL;
+}
+
 /******************************************************************************
 * ADSPFF file functions
 ******************************************************************************/
@@ -196,6 +425,9 @@ static struct file_struct *check_file_opened(const char *path)
 		file = NULL;
 	} else {
 		file = kzalloc(sizeof(*file), GFP_KERNEL);
+		if (!file)
+			return NULL;
+		adspff_file_init(file);
 		open_count++;
 		list_add_tail(&file->list, &file_list);
 	}
@@ -316,6 +548,11 @@ static void adspff_fclose(void)
 
 	file = (struct file_struct *)message->msg.payload.fclose_msg.file;
 	if (file) {
+		adspff_wb_drain(file);
+		adspff_ra_drop(file);
+		/* write errors are reported until the ADSP closes the file */
+		file->wb_error = 0;
+		file->rd_last = 0;
 		if ((file->flags & O_APPEND) == 0) {
 			if (is_read_file(file))
 				file->rd_offset = 0;
@@ -348,6 +585,7 @@ static void adspff_fsize(void)
 	}
 	file = (struct file_struct *)message.msg.payload.fsize_msg.file;
 	if (file) {
+		adspff_wb_drain(file);
 		size = file_size(file->fp);
 	}
 
@@ -375,6 +613,7 @@ static void adspff_fwrite(void)
 	uint32_t size = 0;
 	uint32_t bytes_to_write = 0;
 	uint32_t bytes_written = 0;
+	int32_t wb_error = 0;
 
 	msg_recv = kzalloc(sizeof(union adspff_message_t), GFP_KERNEL);
 	if (!msg_recv)
@@ -396,21 +635,36 @@ static void adspff_fwrite(void)
 
 	bytes_to_write = ((adspff->write_buf.read_index + size) < ADSPFF_SHARED_BUFFER_SIZE) ?
 		size : (ADSPFF_SHARED_BUFFER_SIZE - adspff->write_buf.read_index);
-	ret = file_write(file->fp, &file->wr_offset,
-			adspff->write_buf.data + adspff->write_buf.read_index, bytes_to_write);
-	bytes_written += ret;
 
-	if ((size - bytes_to_write) > 0) {
-		ret = file_write(file->fp, &file->wr_offset,
-				adspff->write_buf.data, size - bytes_to_write);
-		bytes_written += ret;
+	/* cached data may be stale once the file is written */
+	if (file->ra_buf)
+		adspff_ra_drop(file);
+
+	/*
+	 * A failed write-behind leaves a hole in the file. This and every
+	 * further write is failed with its error until the file is closed,
+	 * the ADSP gets the error instead of a byte count.
+	 */
+	wb_error = READ_ONCE(file->wb_error);
+	if (wb_error) {
+		pr_err("%s: write of %u bytes failed, earlier write-behind failed %d\n",
+			file->file_name, size, wb_error);
+		goto consume;
 	}
 
+	bytes_written = adspff_fwrite_segment(file,
+			adspff->write_buf.data + adspff->write_buf.read_index,
+			bytes_to_write);
+	if ((size - bytes_to_write) > 0)
+		bytes_written += adspff_fwrite_segment(file,
+				adspff->write_buf.data, size - bytes_to_write);
+
+consume:
 	adspff->write_buf.read_index =
 		(adspff->write_buf.read_index + size) % ADSPFF_SHARED_BUFFER_SIZE;
 
 	/* send ack */
-	msg_recv->msg.payload.ack_msg.size = bytes_written;
+	msg_recv->msg.payload.ack_msg.size = wb_error ? wb_error : bytes_written;
 	ret = msgq_queue_message(&adspff->msgq_recv.msgq,
 			(msgq_message_t *)msg_recv);
 
@@ -434,6 +688,7 @@ static void adspff_fread(void)
 	uint32_t ri = adspff->read_buf.read_index;
 	uint8_t can_wrap = 0;
 	uint32_t size = 0, size_read = 0;
+	bool sequential;
 	int32_t ret = 0;
 
 	if (ri <= wi) {
@@ -473,26 +728,36 @@ static void adspff_fread(void)
 		goto send_ack;
 	}
 
+	/* reads must observe data still sitting in write-behind */
+	if (READ_ONCE(file->wb_pending))
+		adspff_wb_drain(file);
+	flush_work(&file->ra_work);
+	sequential = (file->rd_offset == file->rd_last);
+
 	if (can_wrap) {
 		uint32_t bytes_to_read = (size < (ADSPFF_SHARED_BUFFER_SIZE - wi)) ?
 			size : (ADSPFF_SHARED_BUFFER_SIZE - wi);
-		ret = file_read(file->fp, &file->rd_offset,
+		ret = adspff_file_read(file,
 				adspff->read_buf.data + wi, bytes_to_read);
 		size_read = ret;
 		if (ret < bytes_to_read)
-			goto send_ack;
+			goto read_done;
 		if ((size - bytes_to_read) > 0) {
-			ret = file_read(file->fp, &file->rd_offset,
+			ret = adspff_file_read(file,
 					adspff->read_buf.data, size - bytes_to_read);
 			size_read += ret;
-			goto send_ack;
 		}
 	} else {
-		ret = file_read(file->fp, &file->rd_offset,
+		size_read = adspff_file_read(file,
 				adspff->read_buf.data + wi, size);
-		size_read = ret;
-		goto send_ack;
 	}
+
+read_done:
+	file->rd_last = file->rd_offset;
+	if (sequential)
+		adspff_ra_kick(file);
+	else
+		file->ra_len = 0;
 send_ack:
 	msg_recv->msg.payload.ack_msg.size = size_read;
 	ret = msgq_queue_message(&adspff->msgq_recv.msgq,
@@ -610,6 +875,7 @@ static int adspff_set(void *data, u64 val)
 	list_for_each_safe(pos, n, &file_list) {
 		file = list_entry(pos, struct file_struct, list);
 		list_del(pos);
+		adspff_file_quiesce(file);
 		if (file->fp)
 			file_close(file->fp);
 		kfree(file);
@@ -673,6 +939,14 @@ int adspff_init(struct platform_device *pdev)
 		return -1;
 	}
 
+	adspff_wq = alloc_workqueue("adspff", WQ_UNBOUND,
+			ADSPFF_MAX_OPEN_FILES);
+	if (!adspff_wq) {
+		pr_err("adspff workqueue creation failed\n");
+		kthread_stop(adspff_kthread);
+		return -ENOMEM;
+	}
+
 	adspff = ADSPFF_SHARED_STATE(app_info->mem.shared);
 
 	ret = nvadsp_mbox_open(&rx_mbox, &adspff->mbox_id,
@@ -680,6 +954,9 @@ int adspff_init(struct platform_device *pdev)
 
 	if (ret < 0) {
 		pr_err("Failed to open mbox %d", adspff->mbox_id);
+		destroy_workqueue(adspff_wq);
+		adspff_wq = NULL;
+		kthread_stop(adspff_kthread);
 		return -1;
 	}
 
@@ -713,4 +990,6 @@ void adspff_exit(void)
 	nvadsp_mbox_close(&rx_mbox);
 	kthread_stop(adspff_kthread);
 	put_task_struct(adspff_kthread);
+	/* completes any write-behind still queued */
+	destroy_workqueue(adspff_wq);
 }
@@ -0,0 +1,359 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * adspff_test.c - ADSPFF host side test without an ADSP
+ *
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Plays the ADSP side: requests are put in the shared state and the
+ * file handlers of adspff.c are called directly, against a file on
+ * tmpfs. Mailbox notifications are recorded instead of sent.
+ */
+
+#define pr_fmt(fmt) "adspff_test: " fmt
+
+#include <linux/module.h>
+#include <linux/ktime.h>
+#include <linux/vmalloc.h>
+#include <linux/tegra_nvadsp.h>
+
+static uint32_t adspff_test_last_cmd;
+
+static status_t adspff_test_mbox_send(struct nvadsp_mbox *mbox, uint32_t data,
+			uint32_t flags, bool block, unsigned int timeout)
+{
+	adspff_test_last_cmd = data;
+	return 0;
+}
+
+/* The handlers under test are static */
+#define nvadsp_mbox_send adspff_test_mbox_send
+#include "adspff.c"
+#undef nvadsp_mbox_send
+
+static char *path = "/dev/shm/adspff_test";
+module_param(path, charp, 0444);
+MODULE_PARM_DESC(path, "file to run the test against, should be on tmpfs");
+
+static unsigned int size = 4 * 1024 * 1024;
+module_param(size, uint, 0444);
+MODULE_PARM_DESC(size, "bytes written and read back");
+
+static uint8_t adspff_test_pattern(uint32_t offset)
+{
+	return (offset * 31 + 7) & 0xff;
+}
+
+static int adspff_test_send(union adspff_message_t *message, int32_t wsize)
+{
+	message->msgq_msg.size = wsize;
+	return msgq_queue_message(&adspff->msgq_send.msgq,
+			(msgq_message_t *)message);
+}
+
+static int adspff_test_recv(union adspff_message_t *message, int32_t wsize,
+			uint32_t cmd)
+{
+	int ret;
+
+	message->msgq_msg.size = wsize;
+	ret = msgq_dequeue_message(&adspff->msgq_recv.msgq,
+			(msgq_message_t *)message);
+	if (ret < 0)
+		return ret;
+
+	if (adspff_test_last_cmd != cmd) {
+		pr_err("got mailbox cmd %u, expected %u\n",
+			adspff_test_last_cmd, cmd);
+		return -EPROTO;
+	}
+
+	return 0;
+}
+
+static int adspff_test_fopen(const char *modes, int64_t *file)
+{
+	union adspff_message_t message = { 0 };
+	int ret;
+
+	strscpy((char *)message.msg.payload.fopen_msg.fname, path,
+		ADSPFF_MAX_FILENAME_SIZE);
+	strscpy((char *)message.msg.payload.fopen_msg.modes, modes,
+		sizeof(message.msg.payload.fopen_msg.modes));
+	ret = adspff_test_send(&message, MSGQ_MSG_SIZE(struct fopen_msg_t));
+	if (ret < 0)
+		return ret;
+
+	adspff_fopen();
+
+	ret = adspff_test_recv(&message, MSGQ_MSG_SIZE(struct fopen_recv_msg_t),
+			adspff_cmd_fopen_recv);
+	if (ret < 0)
+		return ret;
+
+	*file = message.msg.payload.fopen_recv_msg.file;
+	return *file ? 0 : -ENOENT;
+}
+
+static int adspff_test_fclose(int64_t file)
+{
+	union adspff_message_t message = { 0 };
+	int ret;
+
+	message.msg.payload.fclose_msg.file = file;
+	ret = adspff_test_send(&message, MSGQ_MSG_SIZE(struct fclose_msg_t));
+	if (ret < 0)
+		return ret;
+
+	adspff_fclose();
+	return 0;
+}
+
+static int adspff_test_fsize(int64_t file, int32_t *fsize)
+{
+	union adspff_message_t message = { 0 };
+	int ret;
+
+	message.msg.payload.fsize_msg.file = file;
+	ret = adspff_test_send(&message, MSGQ_MSG_SIZE(struct fsize_msg_t));
+	if (ret < 0)
+		return ret;
+
+	adspff_fsize();
+
+	ret = adspff_test_recv(&message, MSGQ_MSG_SIZE(struct ack_msg_t),
+			adspff_cmd_ack);
+	if (ret < 0)
+		return ret;
+
+	*fsize = message.msg.payload.ack_msg.size;
+	return 0;
+}
+
+/* Returns the acked size, a byte count or an error */
+static int adspff_test_fwrite(int64_t file, uint32_t offset, uint32_t len)
+{
+	adspff_shared_buffer_t *buf = &adspff->write_buf;
+	union adspff_message_t message = { 0 };
+	uint32_t i;
+	int ret;
+
+	for (i = 0; i < len; i++)
+		buf->data[(buf->write_index + i) % ADSPFF_SHARED_BUFFER_SIZE] =
+			adspff_test_pattern(offset + i);
+	buf->write_index = (buf->write_index + len) % ADSPFF_SHARED_BUFFER_SIZE;
+
+	message.msg.payload.fwrite_msg.file = file;
+	message.msg.payload.fwrite_msg.size = len;
+	ret = adspff_test_send(&message, MSGQ_MSG_SIZE(struct fwrite_msg_t));
+	if (ret < 0)
+		return ret;
+
+	adspff_fwrite();
+
+	ret = adspff_test_recv(&message, MSGQ_MSG_SIZE(struct ack_msg_t),
+			adspff_cmd_ack);
+	if (ret < 0)
+		return ret;
+
+	if (buf->read_index != buf->write_index) {
+		pr_err("fwrite left %u bytes in the shared buffer\n",
+			(buf->write_index - buf->read_index) %
+			ADSPFF_SHARED_BUFFER_SIZE);
+		return -EPROTO;
+	}
+
+	return message.msg.payload.ack_msg.size;
+}
+
+/* Returns the number of bytes read and checked, or an error */
+static int adspff_test_fread(int64_t file, uint32_t offset, uint32_t len)
+{
+	adspff_shared_buffer_t *buf = &adspff->read_buf;
+	union adspff_message_t message = { 0 };
+	int32_t done;
+	int32_t i;
+	int ret;
+
+	message.msg.payload.fread_msg.file = file;
+	message.msg.payload.fread_msg.size = len;
+	ret = adspff_test_send(&message, MSGQ_MSG_SIZE(struct fread_msg_t));
+	if (ret < 0)
+		return ret;
+
+	adspff_fread();
+
+	ret = adspff_test_recv(&message, MSGQ_MSG_SIZE(struct ack_msg_t),
+			adspff_cmd_ack);
+	if (ret < 0)
+		return ret;
+
+	done = message.msg.payload.ack_msg.size;
+	for (i = 0; i < done; i++) {
+		uint8_t val = buf->data[(buf->read_index + i) %
+				ADSPFF_SHARED_BUFFER_SIZE];
+
+		if (val != adspff_test_pattern(offset + i)) {
+			pr_err("offset %u: read 0x%02x, expected 0x%02x\n",
+				offset + i, val,
+				adspff_test_pattern(offset + i));
+			return -EILSEQ;
+		}
+	}
+	buf->read_index = (buf->read_index + done) % ADSPFF_SHARED_BUFFER_SIZE;
+
+	return done;
+}
+
+static int adspff_test_write_read(int64_t file)
+{
+	uint32_t offset, len;
+	int32_t fsize;
+	ktime_t start;
+	s64 us;
+	int ret;
+
+	start = ktime_get();
+	for (offset = 0; offset < size; offset += len) {
+		len = min_t(uint32_t, size - offset, ADSPFF_WRITE_DATA_SIZE);
+		ret = adspff_test_fwrite(file, offset, len);
+		if (ret != len) {
+			pr_err("fwrite at %u acked %d, expected %u\n",
+				offset, ret, len);
+			return ret < 0 ? ret : -EIO;
+		}
+	}
+
+	/* includes waiting for the write-behind */
+	ret = adspff_test_fsize(file, &fsize);
+	if (ret < 0)
+		return ret;
+	us = ktime_us_delta(ktime_get(), start);
+	pr_info("fwrite: %u bytes in %u byte requests, %lld us\n",
+		size, ADSPFF_WRITE_DATA_SIZE, us);
+
+	if (fsize != size) {
+		pr_err("fsize %d, expected %u\n", fsize, size);
+		return -EIO;
+	}
+
+	ret = adspff_test_fclose(file);
+	if (ret < 0)
+		return ret;
+
+	start = ktime_get();
+	for (offset = 0; offset < size; offset += len) {
+		len = min_t(uint32_t, size - offset, ADSPFF_READ_DATA_SIZE);
+		ret = adspff_test_fread(file, offset, len);
+		if (ret != len) {
+			pr_err("fread at %u returned %d, expected %u\n",
+				offset, ret, len);
+			return ret < 0 ? ret : -EIO;
+		}
+	}
+	us = ktime_us_delta(ktime_get(), start);
+	pr_info("fread: %u bytes in %u byte requests, %lld us\n",
+		size, ADSPFF_READ_DATA_SIZE, us);
+
+	return adspff_test_fclose(file);
+}
+
+/* A failed write-behind fails every write until the file is closed */
+static int adspff_test_wb_error(int64_t file)
+{
+	struct file_struct *f = (struct file_struct *)file;
+	int32_t fsize;
+	int ret;
+
+	WRITE_ONCE(f->wb_error, -EIO);
+
+	ret = adspff_test_fwrite(file, 0, ADSPFF_WRITE_DATA_SIZE);
+	if (ret != -EIO) {
+		pr_err("fwrite after write-behind error acked %d\n", ret);
+		return -EPROTO;
+	}
+
+	ret = adspff_test_fwrite(file, 0, ADSPFF_WRITE_DATA_SIZE);
+	if (ret != -EIO) {
+		pr_err("second fwrite after write-behind error acked %d\n",
+			ret);
+		return -EPROTO;
+	}
+
+	ret = adspff_test_fsize(file, &fsize);
+	if (ret < 0)
+		return ret;
+	if (fsize != size) {
+		pr_err("failed fwrite changed the file size to %d\n", fsize);
+		return -EPROTO;
+	}
+
+	ret = adspff_test_fclose(file);
+	if (ret < 0)
+		return ret;
+
+	ret = adspff_test_fwrite(file, 0, ADSPFF_WRITE_DATA_SIZE);
+	if (ret != ADSPFF_WRITE_DATA_SIZE) {
+		pr_err("fwrite after fclose acked %d\n", ret);
+		return -EPROTO;
+	}
+
+	return adspff_test_fclose(file);
+}
+
+static int __init adspff_test_init(void)
+{
+	int64_t file;
+	int ret;
+
+	adspff = vzalloc(sizeof(*adspff));
+	if (!adspff)
+		return -ENOMEM;
+
+	adspff_wq = alloc_workqueue("adspff_test", WQ_UNBOUND,
+			ADSPFF_MAX_OPEN_FILES);
+	if (!adspff_wq) {
+		vfree(adspff);
+		return -ENOMEM;
+	}
+
+	msgq_init(&adspff->msgq_send.msgq, ADSPFF_MSG_QUEUE_WSIZE);
+	msgq_init(&adspff->msgq_recv.msgq, ADSPFF_MSG_QUEUE_WSIZE);
+	spin_lock_init(&adspff_lock);
+	INIT_LIST_HEAD(&file_list);
+
+	ret = adspff_test_fopen("w+", &file);
+	if (ret < 0) {
+		pr_err("fopen of %s failed %d\n", path, ret);
+		goto out;
+	}
+
+	ret = adspff_test_write_read(file);
+	if (ret < 0)
+		goto out;
+
+	ret = adspff_test_wb_error(file);
+
+out:
+	/* closes the files, as writing to close_files does */
+	adspff_set(NULL, 1);
+	destroy_workqueue(adspff_wq);
+	vfree(adspff);
+
+	if (ret < 0) {
+		pr_err("failed %d\n", ret);
+		return ret;
+	}
+
+	pr_info("passed\n");
+	return 0;
+}
+
+static void __exit adspff_test_exit(void)
+{
+}
+
+module_init(adspff_test_init);
+module_exit(adspff_test_exit);
+
+MODULE_DESCRIPTION("ADSPFF host side test");
+MODULE_LICENSE("GPL v2");
@@ -3,7 +3,7 @@
 
 #define pr_fmt(fmt) "%s : %d, " fmt, __func__, __LINE__
 
-#include <linux/list.h>
+#include <linux/rbtree.h>
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/err.h>
@@ -11,34 +11,106 @@
 
 #include "mem_manager.h"
 
-static void clear_alloc_list(struct mem_manager_info *mm_info);
+static void addr_tree_insert(struct mem_manager_info *mm_info,
+				struct mem_chunk *mc)
+{
+	struct rb_node **p = &mm_info->addr_root.rb_node;
+	struct rb_node *parent = NULL;
+	struct mem_chunk *entry;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct mem_chunk, addr_node);
+		if (mc->address < entry->address)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&mc->addr_node, parent, p);
+	rb_insert_color(&mc->addr_node, &mm_info->addr_root);
+}
+
+/* Free chunks are ordered by size, ties broken by lowest address */
+static void free_tree_insert(struct mem_manager_info *mm_info,
+				struct mem_chunk *mc)
+{
+	struct rb_node **p = &mm_info->free_root.rb_node;
+	struct rb_node *parent = NULL;
+	struct mem_chunk *entry;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct mem_chunk, size_node);
+		if (mc->size < entry->size ||
+		    (mc->size == entry->size && mc->address < entry->address))
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+
+	rb_link_node(&mc->size_node, parent, p);
+	rb_insert_color(&mc->size_node, &mm_info->free_root);
+
+	mc->free = true;
+	mm_info->nr_free++;
+	mm_info->free_size += mc->size;
+}
+
+static void free_tree_erase(struct mem_manager_info *mm_info,
+				struct mem_chunk *mc)
+{
+	rb_erase(&mc->size_node, &mm_info->free_root);
+
+	mc->free = false;
+	mm_info->nr_free--;
+	mm_info->free_size -= mc->size;
+}
+
+/* Smallest free chunk that can hold size bytes */
+static struct mem_chunk *free_tree_best_fit(struct mem_manager_info *mm_info,
+						size_t size)
+{
+	struct rb_node *node = mm_info->free_root.rb_node;
+	struct mem_chunk *best = NULL, *entry;
+
+	while (node) {
+		entry = rb_entry(node, struct mem_chunk, size_node);
+		if (entry->size >= size) {
+			best = entry;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	return best;
+}
+
+static struct mem_chunk *chunk_neighbour(struct rb_node *node)
+{
+	return node ? rb_entry(node, struct mem_chunk, addr_node) : NULL;
+}
 
 void *mem_request(void *mem_handle, const char *name, size_t size)
 {
 	unsigned long flags;
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
-	struct mem_chunk *mc_iterator = NULL, *best_match_chunk = NULL;
+	struct mem_chunk *best_match_chunk = NULL;
 	struct mem_chunk *new_mc = NULL;
 
 	spin_lock_irqsave(&mm_info->lock, flags);
 
 	/* Is mem full? */
-	if (list_empty(mm_info->free_list)) {
+	if (RB_EMPTY_ROOT(&mm_info->free_root)) {
 		pr_err("%s : memory full\n", mm_info->name);
 		spin_unlock_irqrestore(&mm_info->lock, flags);
 		return ERR_PTR(-ENOMEM);
 	}
 
 	/* Find the best size match */
-	list_for_each_entry(mc_iterator, mm_info->free_list, node) {
-		if (mc_iterator->size >= size) {
-			if (best_match_chunk == NULL)
-				best_match_chunk = mc_iterator;
-			else if (mc_iterator->size < best_match_chunk->size)
-				best_match_chunk = mc_iterator;
-		}
-	}
+	best_match_chunk = free_tree_best_fit(mm_info, size);
 
 	/* Is free node found? */
 	if (best_match_chunk == NULL) {
@@ -49,57 +121,45 @@ void *mem_request(void *mem_handle, const char *name, size_t size)
 
 	/* Is it exact match? */
 	if (best_match_chunk->size == size) {
-		list_del(&best_match_chunk->node);
-		list_for_each_entry(mc_iterator, mm_info->alloc_list, node) {
-			if (best_match_chunk->address < mc_iterator->address) {
-				list_add_tail(&best_match_chunk->node,
-						&mc_iterator->node);
-				strscpy(best_match_chunk->name, name,
-						NAME_SIZE);
-				spin_unlock_irqrestore(&mm_info->lock, flags);
-				return best_match_chunk;
-			}
-		}
-		list_add(&best_match_chunk->node, mm_info->alloc_list);
+		free_tree_erase(mm_info, best_match_chunk);
 		strscpy(best_match_chunk->name, name, NAME_SIZE);
+		mm_info->nr_alloc++;
 		spin_unlock_irqrestore(&mm_info->lock, flags);
 		return best_match_chunk;
-	} else {
-		new_mc = kzalloc(sizeof(struct mem_chunk), GFP_ATOMIC);
-		if (unlikely(!new_mc)) {
-			pr_err("failed to allocate memory for mem_chunk\n");
+	}
+
+	new_mc = kzalloc(sizeof(struct mem_chunk), GFP_ATOMIC);
+	if (unlikely(!new_mc)) {
+		pr_err("failed to allocate memory for mem_chunk\n");
 
-			spin_unlock_irqrestore(&mm_info->lock, flags);
-			return ERR_PTR(-ENOMEM);
-		}
-		new_mc->address = best_match_chunk->address;
-		new_mc->size = size;
-		strscpy(new_mc->name, name, NAME_SIZE);
-		best_match_chunk->address += size;
-		best_match_chunk->size -= size;
-		list_for_each_entry(mc_iterator, mm_info->alloc_list, node) {
-			if (new_mc->address < mc_iterator->address) {
-				list_add_tail(&new_mc->node,
-						&mc_iterator->node);
-				spin_unlock_irqrestore(&mm_info->lock, flags);
-				return new_mc;
-			}
-		}
-		list_add_tail(&new_mc->node, mm_info->alloc_list);
 		spin_unlock_irqrestore(&mm_info->lock, flags);
-		return new_mc;
+		return ERR_PTR(-ENOMEM);
 	}
+	new_mc->address = best_match_chunk->address;
+	new_mc->size = size;
+	strscpy(new_mc->name, name, NAME_SIZE);
+
+	/* Carve from the front; the remainder keeps its address order */
+	free_tree_erase(mm_info, best_match_chunk);
+	best_match_chunk->address += size;
+	best_match_chunk->size -= size;
+	free_tree_insert(mm_info, best_match_chunk);
+
+	addr_tree_insert(mm_info, new_mc);
+	mm_info->nr_alloc++;
+	spin_unlock_irqrestore(&mm_info->lock, flags);
+	return new_mc;
 }
 
 /*
- * Find the node with sepcified address and remove it from list
+ * Return the chunk to the free tree, merging it with free neighbours
  */
 bool mem_release(void *mem_handle, void *handle)
 {
 	unsigned long flags;
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
-	struct mem_chunk *mc_curr = NULL, *mc_prev = NULL;
+	struct mem_chunk *mc_prev = NULL, *mc_next = NULL;
 	struct mem_chunk *mc_free = (struct mem_chunk *)handle;
 
 	pr_debug(" addr = %lu, size = %lu, name = %s\n",
@@ -107,50 +167,39 @@ bool mem_release(void *mem_handle, void *handle)
 
 	spin_lock_irqsave(&mm_info->lock, flags);
 
-	list_for_each_entry(mc_curr, mm_info->free_list, node) {
-		if (mc_free->address < mc_curr->address) {
-
-			strscpy(mc_free->name, "FREE", NAME_SIZE);
-
-			/* adjacent next free node */
-			if (mc_curr->address ==
-				(mc_free->address + mc_free->size)) {
-
-				mc_curr->address = mc_free->address;
-				mc_curr->size += mc_free->size;
-				list_del(&mc_free->node);
-				kfree(mc_free);
-
-				/* and adjacent prev free node */
-				if ((mc_prev != NULL) &&
-				   ((mc_prev->address + mc_prev->size) ==
-						mc_curr->address)) {
-
-					mc_prev->size += mc_curr->size;
-					list_del(&mc_curr->node);
-					kfree(mc_curr);
-				}
-			}
-			/* adjacent prev free node */
-			else if ((mc_prev != NULL) &&
-				((mc_prev->address + mc_prev->size) ==
-						mc_free->address)) {
-
-				mc_prev->size += mc_free->size;
-				list_del(&mc_free->node);
-				kfree(mc_free);
-			} else {
-				list_del(&mc_free->node);
-				list_add_tail(&mc_free->node,
-						&mc_curr->node);
-			}
-			spin_unlock_irqrestore(&mm_info->lock, flags);
-			return true;
-		}
-		mc_prev = mc_curr;
+	if (mc_free->free) {
+		pr_err("%s : chunk at %lu already free\n",
+			mm_info->name, mc_free->address);
+		spin_unlock_irqrestore(&mm_info->lock, flags);
+		return false;
 	}
+
+	strscpy(mc_free->name, "FREE", NAME_SIZE);
+	mm_info->nr_alloc--;
+
+	/* adjacent next free node */
+	mc_next = chunk_neighbour(rb_next(&mc_free->addr_node));
+	if (mc_next && mc_next->free) {
+		free_tree_erase(mm_info, mc_next);
+		rb_erase(&mc_next->addr_node, &mm_info->addr_root);
+		mc_free->size += mc_next->size;
+		kfree(mc_next);
+	}
+
+	/* adjacent prev free node */
+	mc_prev = chunk_neighbour(rb_prev(&mc_free->addr_node));
+	if (mc_prev && mc_prev->free) {
+		free_tree_erase(mm_info, mc_prev);
+		rb_erase(&mc_free->addr_node, &mm_info->addr_root);
+		mc_prev->size += mc_free->size;
+		kfree(mc_free);
+		mc_free = mc_prev;
+	}
+
+	free_tree_insert(mm_info, mc_free);
+
 	spin_unlock_irqrestore(&mm_info->lock, flags);
-	return false;
+	return true;
 }
 
 inline unsigned long mem_get_address(void *handle)
@@ -159,22 +208,48 @@ inline unsigned long mem_get_address(void *handle)
 	return mc->address;
 }
 
+static unsigned long mem_largest_free(struct mem_manager_info *mm_info)
+{
+	struct rb_node *node = rb_last(&mm_info->free_root);
+
+	return node ? rb_entry(node, struct mem_chunk, size_node)->size : 0;
+}
+
+/*
+ * External fragmentation in percent: share of free memory that is not
+ * usable by a single allocation of the largest free chunk size.
+ */
+static unsigned long mem_fragmentation(struct mem_manager_info *mm_info)
+{
+	if (!mm_info->free_size)
+		return 0;
+
+	return 100 - (mem_largest_free(mm_info) * 100) / mm_info->free_size;
+}
+
 void mem_print(void *mem_handle)
 {
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
 	struct mem_chunk *mc_iterator = NULL;
+	struct rb_node *node;
 
 	pr_info("------------------------------------\n");
 	pr_info("%s ALLOCATED\n", mm_info->name);
-	list_for_each_entry(mc_iterator, mm_info->alloc_list, node) {
+	for (node = rb_first(&mm_info->addr_root); node; node = rb_next(node)) {
+		mc_iterator = rb_entry(node, struct mem_chunk, addr_node);
+		if (mc_iterator->free)
+			continue;
 		pr_info("  addr = %lu, size = %lu, name = %s\n",
 			mc_iterator->address, mc_iterator->size,
 			mc_iterator->name);
 	}
 
 	pr_info("%s FREE\n", mm_info->name);
-	list_for_each_entry(mc_iterator, mm_info->free_list, node) {
+	for (node = rb_first(&mm_info->addr_root); node; node = rb_next(node)) {
+		mc_iterator = rb_entry(node, struct mem_chunk, addr_node);
+		if (!mc_iterator->free)
+			continue;
 		pr_info("  addr = %lu, size = %lu, name = %s\n",
 			mc_iterator->address, mc_iterator->size,
 			mc_iterator->name);
@@ -185,46 +260,50 @@ void mem_print(void *mem_handle)
 
 void mem_dump(void *mem_handle, struct seq_file *s)
 {
+	unsigned long flags;
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
 	struct mem_chunk *mc_iterator = NULL;
+	struct rb_node *node;
+
+	spin_lock_irqsave(&mm_info->lock, flags);
 
 	seq_puts(s, "---------------------------------------\n");
 	seq_printf(s, "%s ALLOCATED\n", mm_info->name);
-	list_for_each_entry(mc_iterator, mm_info->alloc_list, node) {
+	for (node = rb_first(&mm_info->addr_root); node; node = rb_next(node)) {
+		mc_iterator = rb_entry(node, struct mem_chunk, addr_node);
+		if (mc_iterator->free)
+			continue;
 		seq_printf(s, "  addr = %lu, size = %lu, name = %s\n",
 			mc_iterator->address, mc_iterator->size,
 			mc_iterator->name);
 	}
 
 	seq_printf(s, "%s FREE\n", mm_info->name);
-	list_for_each_entry(mc_iterator, mm_info->free_list, node) {
+	for (node = rb_first(&mm_info->addr_root); node; node = rb_next(node)) {
+		mc_iterator = rb_entry(node, struct mem_chunk, addr_node);
+		if (!mc_iterator->free)
+			continue;
 		seq_printf(s, "  addr = %lu, size = %lu, name = %s\n",
 			mc_iterator->address, mc_iterator->size,
 			mc_iterator->name);
 	}
 
+	seq_printf(s, "%s STATS\n", mm_info->name);
+	seq_printf(s, "  total = %lu, free = %lu, allocated chunks = %lu\n",
+		mm_info->size, mm_info->free_size, mm_info->nr_alloc);
+	seq_printf(s, "  free chunks = %lu, largest free = %lu, fragmentation = %lu%%\n",
+		mm_info->nr_free, mem_largest_free(mm_info),
+		mem_fragmentation(mm_info));
+
 	seq_puts(s, "---------------------------------------\n");
-}
 
-static void clear_alloc_list(struct mem_manager_info *mm_info)
-{
-	struct list_head *curr, *next;
-	struct mem_chunk *mc = NULL;
-
-	list_for_each_safe(curr, next, mm_info->alloc_list) {
-		mc = list_entry(curr, struct mem_chunk, node);
-		pr_debug("  addr = %lu, size = %lu, name = %s\n",
-			mc->address, mc->size,
-			mc->name);
-		mem_release(mm_info, mc);
-	}
+	spin_unlock_irqrestore(&mm_info->lock, flags);
 }
 
 void *create_mem_manager(const char *name, unsigned long start_address,
 				unsigned long size)
 {
-	void *ret = NULL;
 	struct mem_chunk *mc;
 	struct mem_manager_info *mm_info =
 			kzalloc(sizeof(struct mem_manager_info), GFP_KERNEL);
@@ -235,67 +314,44 @@ void *create_mem_manager(const char *name, unsigned long start_address,
 
 	strscpy(mm_info->name, name, NAME_SIZE);
 
-	mm_info->alloc_list = kzalloc(sizeof(struct list_head), GFP_KERNEL);
-	if (unlikely(!mm_info->alloc_list)) {
-		pr_err("failed to allocate memory for alloc_list\n");
-		ret = ERR_PTR(-ENOMEM);
-		goto free_mm_info;
-	}
-
-	mm_info->free_list = kzalloc(sizeof(struct list_head), GFP_KERNEL);
-	if (unlikely(!mm_info->free_list)) {
-		pr_err("failed to allocate memory for free_list\n");
-		ret = ERR_PTR(-ENOMEM);
-		goto free_alloc_list;
-	}
-
-	INIT_LIST_HEAD(mm_info->alloc_list);
-	INIT_LIST_HEAD(mm_info->free_list);
+	mm_info->addr_root = RB_ROOT;
+	mm_info->free_root = RB_ROOT;
 
 	mm_info->start_address = start_address;
 	mm_info->size = size;
 
-	/* Add whole memory to free list */
+	/* Add whole memory to free tree */
 	mc = kzalloc(sizeof(struct mem_chunk), GFP_KERNEL);
 	if (unlikely(!mc)) {
 		pr_err("failed to allocate memory for mem_chunk\n");
-		ret = ERR_PTR(-ENOMEM);
-		goto free_free_list;
+		kfree(mm_info);
+		return ERR_PTR(-ENOMEM);
 	}
 
 	mc->address = mm_info->start_address;
 	mc->size = mm_info->size;
 	strscpy(mc->name, "FREE", NAME_SIZE);
-	list_add(&mc->node, mm_info->free_list);
+	addr_tree_insert(mm_info, mc);
+	free_tree_insert(mm_info, mc);
 	spin_lock_init(&mm_info->lock);
 
 	return (void *)mm_info;
-
-free_free_list:
-	kfree(mm_info->free_list);
-free_alloc_list:
-	kfree(mm_info->alloc_list);
-free_mm_info:
-	kfree(mm_info);
-
-	return ret;
 }
 
 void destroy_mem_manager(void *mem_handle)
 {
 	struct mem_manager_info *mm_info =
 		(struct mem_manager_info *)mem_handle;
-	struct mem_chunk *mc_last = NULL;
-
-	/* Clear all allocated memory */
-	clear_alloc_list(mm_info);
-
-	mc_last = list_entry((mm_info->free_list)->next,
-			struct mem_chunk, node);
-	list_del(&mc_last->node);
+	struct mem_chunk *mc, *next;
+
+	/* Drop all chunks, allocated or free */
+	rbtree_postorder_for_each_entry_safe(mc, next, &mm_info->addr_root,
+						addr_node) {
+		if (!mc->free)
+			pr_debug("  addr = %lu, size = %lu, name = %s\n",
+				mc->address, mc->size, mc->name);
+		kfree(mc);
+	}
 
-	kfree(mc_last);
-	kfree(mm_info->alloc_list);
-	kfree(mm_info->free_list);
 	kfree(mm_info);
 }
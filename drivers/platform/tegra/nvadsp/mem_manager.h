@@ -6,20 +6,30 @@
 #ifndef __TEGRA_NVADSP_MEM_MANAGER_H
 #define __TEGRA_NVADSP_MEM_MANAGER_H
 
+#include <linux/rbtree.h>
 #include <linux/sizes.h>
 
 #define NAME_SIZE SZ_16
 
+/*
+ * Chunks tile the managed range and all of them sit in the address tree;
+ * free chunks are additionally indexed by (size, address) in the size tree.
+ */
 struct mem_chunk {
-	struct list_head node;
+	struct rb_node addr_node;
+	struct rb_node size_node;
+	bool free;
 	char name[NAME_SIZE];
 	unsigned long address;
 	unsigned long size;
 };
 
 struct mem_manager_info {
-	struct list_head *alloc_list;
-	struct list_head *free_list;
+	struct rb_root addr_root;
+	struct rb_root free_root;
+	unsigned long nr_alloc;
+	unsigned long nr_free;
+	unsigned long free_size;
 	char name[NAME_SIZE];
 	unsigned long start_address;
 	unsigned long size;
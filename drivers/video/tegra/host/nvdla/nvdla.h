@@ -336,6 +336,40 @@ struct nvdla_emu_task {
 	u32 fence_counter;
 };
 
+/**
+ * struct nvdla_task_template:	task state registered once per network
+ *
+ * @ref			Reference count, one per user task in flight
+ * @buffers		nvhost buffers the address list is pinned in
+ * @in_task_status	input task status list
+ * @sof_task_status	sof task status list
+ * @eof_task_status	eof task status list
+ * @sof_timestamps	sof timestamp handle list
+ * @eof_timestamps	eof timestamp handle list
+ * @memory_handles	address list handles
+ * @addresses		pinned IOVA of each address list entry
+ * @timeout		max timeout to wait for task completion
+ *
+ */
+struct nvdla_task_template {
+	struct kref ref;
+	struct nvdla_buffers *buffers;
+	struct nvdla_status_notify in_task_status[MAX_NVDLA_IN_STATUS_PER_TASK];
+	struct nvdla_status_notify sof_task_status[MAX_NVDLA_OUT_STATUS_PER_TASK];
+	struct nvdla_status_notify eof_task_status[MAX_NVDLA_OUT_STATUS_PER_TASK];
+	struct nvdla_mem_handle sof_timestamps[MAX_NVDLA_OUT_TIMESTAMPS_PER_TASK];
+	struct nvdla_mem_handle eof_timestamps[MAX_NVDLA_OUT_TIMESTAMPS_PER_TASK];
+	struct nvdla_mem_handle memory_handles[MAX_NVDLA_BUFFERS_PER_TASK];
+	u64 addresses[MAX_NVDLA_BUFFERS_PER_TASK];
+	u8 num_in_task_status;
+	u8 num_sof_task_status;
+	u8 num_eof_task_status;
+	u8 num_sof_timestamps;
+	u8 num_eof_timestamps;
+	u32 num_addresses;
+	int timeout;
+};
+
 /**
  * struct nvdla_task:	structure for task info
  *
@@ -351,6 +385,7 @@ struct nvdla_emu_task {
  * @buf_size		Total size of task dma alloc
  * @timeout		max timeout to wait for task completion
  * @op_handle		pointer to handle list of operation descriptor
+ * @tmpl		template providing the pinned address list, or NULL
  *
  */
 struct nvdla_task {
@@ -381,6 +416,7 @@ struct nvdla_task {
 	size_t buf_size;
 	int timeout;
 	int pool_index;
+	struct nvdla_task_template *tmpl;
 
 	struct dma_buf *memory_dmabuf[MAX_NVDLA_BUFFERS_PER_TASK];
 	struct dma_buf *prefences_sem_dmabuf[MAX_NVDLA_PREFENCES_PER_TASK];
@@ -512,6 +548,7 @@ int nvdla_free_gcov_region(struct platform_device *pdev, bool update_region);
 int nvdla_emulator_submit(struct nvdla_queue *queue,
 				struct nvdla_emu_task *task);
 void task_free(struct kref *ref);
+void nvdla_task_template_put(struct nvdla_task_template *tmpl);
 int nvdla_get_signal_fences(struct nvdla_queue *queue, void *in_task);
 
 #ifdef CONFIG_PM
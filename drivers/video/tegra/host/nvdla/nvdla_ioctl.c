@@ -8,6 +8,8 @@
 
 #include <linux/arm64-barrier.h>
 #include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/nospec.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
@@ -28,12 +30,16 @@
  * @pdev		pointer to platform device
  * @queue		pointer to nvdla_queue
  * @buffers		pointer to nvdla_buffer
+ * @templates		task templates registered on this FD
+ * @template_lock	lock to protect templates
  */
 
 struct nvdla_private {
 	struct platform_device *pdev;
 	struct nvdla_queue *queue;
 	struct nvdla_buffers *buffers;
+	struct nvdla_task_template *templates[MAX_NVDLA_TEMPLATES_PER_FD];
+	struct mutex template_lock;
 };
 
 static int nvdla_get_fw_ver(struct nvdla_private *priv,
@@ -757,6 +763,245 @@ fail_to_get_val_args:
 	return err;
 }
 
+static int nvdla_fill_task_from_template(struct nvdla_private *priv,
+				struct nvdla_ioctl_submit_task *local_task,
+				struct nvdla_task *task)
+{
+	struct nvdla_task_template *tmpl;
+	struct platform_device *pdev = priv->pdev;
+	u32 id = local_task->template_id;
+
+	nvdla_dbg_fn(pdev, "template[%u]", id);
+
+	task->queue = priv->queue;
+	task->buffers = priv->buffers;
+
+	if (local_task->num_prefences > MAX_NVDLA_PREFENCES_PER_TASK ||
+	    local_task->num_postfences > MAX_NVDLA_POSTFENCES_PER_TASK) {
+		nvdla_dbg_err(pdev, "Invalid fence count");
+		return -EINVAL;
+	}
+
+	if (id >= MAX_NVDLA_TEMPLATES_PER_FD)
+		return -EINVAL;
+	id = array_index_nospec(id, MAX_NVDLA_TEMPLATES_PER_FD);
+
+	mutex_lock(&priv->template_lock);
+	tmpl = priv->templates[id];
+	if (tmpl)
+		kref_get(&tmpl->ref);
+	mutex_unlock(&priv->template_lock);
+
+	if (!tmpl) {
+		nvdla_dbg_err(pdev, "template[%u] not registered", id);
+		return -EINVAL;
+	}
+
+	/* reference is dropped when the task is freed */
+	task->tmpl = tmpl;
+
+	task->num_prefences = local_task->num_prefences;
+	task->num_postfences = local_task->num_postfences;
+	task->num_in_task_status = tmpl->num_in_task_status;
+	task->num_sof_task_status = tmpl->num_sof_task_status;
+	task->num_eof_task_status = tmpl->num_eof_task_status;
+	task->num_sof_timestamps = tmpl->num_sof_timestamps;
+	task->num_eof_timestamps = tmpl->num_eof_timestamps;
+	task->num_addresses = tmpl->num_addresses;
+	task->timeout = tmpl->timeout;
+
+	/* only the fences change between submits of a template */
+	if (copy_from_user(task->prefences,
+		(void __user *)local_task->prefences,
+		(task->num_prefences * sizeof(struct nvdev_fence)))) {
+		nvdla_dbg_err(pdev, "failed to copy prefences");
+		return -EFAULT;
+	}
+
+	if (copy_from_user(task->postfences,
+		(void __user *)local_task->postfences,
+		(task->num_postfences * sizeof(struct nvdev_fence)))) {
+		nvdla_dbg_err(pdev, "failed to copy postfences");
+		return -EFAULT;
+	}
+
+	memcpy(task->in_task_status, tmpl->in_task_status,
+		task->num_in_task_status * sizeof(struct nvdla_status_notify));
+	memcpy(task->sof_task_status, tmpl->sof_task_status,
+		task->num_sof_task_status * sizeof(struct nvdla_status_notify));
+	memcpy(task->eof_task_status, tmpl->eof_task_status,
+		task->num_eof_task_status * sizeof(struct nvdla_status_notify));
+	memcpy(task->sof_timestamps, tmpl->sof_timestamps,
+		task->num_sof_timestamps * sizeof(struct nvdla_mem_handle));
+	memcpy(task->eof_timestamps, tmpl->eof_timestamps,
+		task->num_eof_timestamps * sizeof(struct nvdla_mem_handle));
+	memcpy(task->memory_handles, tmpl->memory_handles,
+		task->num_addresses * sizeof(struct nvdla_mem_handle));
+
+	nvdla_dbg_info(pdev, "local task %p filled from template", task);
+
+	return 0;
+}
+
+static void nvdla_task_template_free(struct kref *ref)
+{
+	struct nvdla_task_template *tmpl =
+		container_of(ref, struct nvdla_task_template, ref);
+	int ii;
+
+	for (ii = 0; ii < tmpl->num_addresses; ii++) {
+		if (tmpl->memory_handles[ii].type ==
+				NVDLA_BUFFER_TYPE_INTERNAL)
+			continue;
+		nvdla_buffer_submit_unpin(tmpl->buffers,
+			&tmpl->memory_handles[ii].handle, 1);
+	}
+
+	kvfree(tmpl);
+}
+
+void nvdla_task_template_put(struct nvdla_task_template *tmpl)
+{
+	kref_put(&tmpl->ref, nvdla_task_template_free);
+}
+
+static int nvdla_register_template(struct nvdla_private *priv, void *arg)
+{
+	struct nvdla_template_args *args = (struct nvdla_template_args *)arg;
+	struct nvdla_ioctl_submit_task local_task;
+	struct nvdla_task_template *tmpl;
+	struct platform_device *pdev = priv->pdev;
+	dma_addr_t dma_addr;
+	size_t dma_size;
+	int err = 0;
+	u32 id, jj;
+
+	nvdla_dbg_fn(pdev, "");
+
+	if (copy_from_user(&local_task, (void __user *)(uintptr_t)args->task,
+			   sizeof(local_task)))
+		return -EFAULT;
+
+	err = nvdla_val_task_submit_input(&local_task);
+	if (err) {
+		nvdla_dbg_err(pdev, "Invalid template arguments");
+		return err;
+	}
+
+	tmpl = kvzalloc(sizeof(*tmpl), GFP_KERNEL);
+	if (!tmpl)
+		return -ENOMEM;
+
+	kref_init(&tmpl->ref);
+	tmpl->buffers = priv->buffers;
+	tmpl->num_in_task_status = local_task.num_input_task_status;
+	tmpl->num_sof_task_status = local_task.num_sof_task_status;
+	tmpl->num_eof_task_status = local_task.num_eof_task_status;
+	tmpl->num_sof_timestamps = local_task.num_sof_timestamps;
+	tmpl->num_eof_timestamps = local_task.num_eof_timestamps;
+	tmpl->timeout = local_task.timeout;
+
+	if (copy_from_user(tmpl->in_task_status,
+		(void __user *)local_task.input_task_status,
+		(tmpl->num_in_task_status *
+			sizeof(struct nvdla_status_notify))) ||
+	    copy_from_user(tmpl->sof_task_status,
+		(void __user *)local_task.sof_task_status,
+		(tmpl->num_sof_task_status *
+			sizeof(struct nvdla_status_notify))) ||
+	    copy_from_user(tmpl->eof_task_status,
+		(void __user *)local_task.eof_task_status,
+		(tmpl->num_eof_task_status *
+			sizeof(struct nvdla_status_notify))) ||
+	    copy_from_user(tmpl->sof_timestamps,
+		(void __user *)local_task.sof_timestamps,
+		(tmpl->num_sof_timestamps * sizeof(struct nvdla_mem_handle))) ||
+	    copy_from_user(tmpl->eof_timestamps,
+		(void __user *)local_task.eof_timestamps,
+		(tmpl->num_eof_timestamps * sizeof(struct nvdla_mem_handle))) ||
+	    copy_from_user(tmpl->memory_handles,
+		(void __user *)local_task.address_list,
+		(local_task.num_addresses * sizeof(struct nvdla_mem_handle)))) {
+		nvdla_dbg_err(pdev, "failed to copy template lists");
+		err = -EFAULT;
+		goto fail;
+	}
+
+	/* pin the address list once for all submits of this template */
+	for (jj = 0; jj < local_task.num_addresses; jj++) {
+		struct nvdla_mem_handle *mem = &tmpl->memory_handles[jj];
+
+		if (mem->type == NVDLA_BUFFER_TYPE_INTERNAL) {
+			/* For internal buffers, offset is the final address */
+			tmpl->addresses[jj] = mem->offset;
+			tmpl->num_addresses++;
+			continue;
+		}
+
+		if (!mem->handle) {
+			err = -EFAULT;
+			goto fail;
+		}
+
+		err = nvdla_buffer_submit_pin(tmpl->buffers, &mem->handle,
+				1, &dma_addr, &dma_size, NULL);
+		if (err) {
+			nvdla_dbg_err(pdev, "fail to pin address list");
+			goto fail;
+		}
+		tmpl->addresses[jj] = dma_addr + mem->offset;
+		tmpl->num_addresses++;
+	}
+	spec_bar(); /* break_spec_p#5_1 */
+
+	mutex_lock(&priv->template_lock);
+	for (id = 0; id < MAX_NVDLA_TEMPLATES_PER_FD; id++) {
+		if (!priv->templates[id])
+			break;
+	}
+	if (id == MAX_NVDLA_TEMPLATES_PER_FD) {
+		mutex_unlock(&priv->template_lock);
+		nvdla_dbg_err(pdev, "no free template slot");
+		err = -ENOSPC;
+		goto fail;
+	}
+	priv->templates[id] = tmpl;
+	mutex_unlock(&priv->template_lock);
+
+	args->id = id;
+	nvdla_dbg_info(pdev, "template[%u] registered", id);
+
+	return 0;
+
+fail:
+	nvdla_task_template_put(tmpl);
+	return err;
+}
+
+static int nvdla_release_template(struct nvdla_private *priv, void *arg)
+{
+	struct nvdla_template_args *args = (struct nvdla_template_args *)arg;
+	struct nvdla_task_template *tmpl;
+	u32 id = args->id;
+
+	if (id >= MAX_NVDLA_TEMPLATES_PER_FD)
+		return -EINVAL;
+	id = array_index_nospec(id, MAX_NVDLA_TEMPLATES_PER_FD);
+
+	mutex_lock(&priv->template_lock);
+	tmpl = priv->templates[id];
+	priv->templates[id] = NULL;
+	mutex_unlock(&priv->template_lock);
+
+	if (!tmpl)
+		return -EINVAL;
+
+	/* tasks still in flight keep the template pinned */
+	nvdla_task_template_put(tmpl);
+
+	return 0;
+}
+
 static void nvdla_dump_task(struct nvdla_task *task)
 {
 	int i;
@@ -1083,7 +1328,12 @@ static int nvdla_submit(struct nvdla_private *priv, void *arg)
 		kref_init(&task->ref);
 
 		/* fill local task param from user args */
-		err = nvdla_fill_task(queue, buffers, &local_task, task);
+		if (local_task.flags & NVDLA_TASK_FLAGS_TEMPLATE)
+			err = nvdla_fill_task_from_template(priv, &local_task,
+					task);
+		else
+			err = nvdla_fill_task(queue, buffers, &local_task,
+					task);
 		if (err) {
 			nvdla_dbg_err(pdev, "failed to fill task[%d]", i + 1);
 			goto fail_to_fill_task;
@@ -1226,6 +1476,12 @@ static long nvdla_ioctl(struct file *file, unsigned int cmd,
 	case NVDLA_IOCTL_RELEASE_QUEUE:
 		err = nvdla_queue_release_handler(priv, (void*)buf);
 		break;
+	case NVDLA_IOCTL_REGISTER_TEMPLATE:
+		err = nvdla_register_template(priv, (void *)buf);
+		break;
+	case NVDLA_IOCTL_RELEASE_TEMPLATE:
+		err = nvdla_release_template(priv, (void *)buf);
+		break;
 	default:
 		nvdla_dbg_err(pdev, "invalid IOCTL CMD");
 		err = -ENOIOCTLCMD;
@@ -1281,6 +1537,8 @@ static int nvdla_open(struct inode *inode, struct file *file)
 
 	/* Zero out explicitly */
 	priv->queue = NULL;
+	memset(priv->templates, 0, sizeof(priv->templates));
+	mutex_init(&priv->template_lock);
 
 	/**
 	 * Platform device corresponding to buffers is deferred
@@ -1308,6 +1566,7 @@ static int nvdla_release(struct inode *inode, struct file *file)
 {
 	struct nvdla_private *priv = file->private_data;
 	struct platform_device *pdev = priv->pdev;
+	int index;
 
 	nvdla_dbg_fn(pdev, "priv:%p", priv);
 
@@ -1321,6 +1580,11 @@ static int nvdla_release(struct inode *inode, struct file *file)
 		nvdla_queue_release_handler(priv, NULL);
 	}
 
+	for (index = 0; index < MAX_NVDLA_TEMPLATES_PER_FD; index++) {
+		if (priv->templates[index])
+			nvdla_task_template_put(priv->templates[index]);
+	}
+
 	nvdla_buffer_release(priv->buffers);
 	nvhost_module_remove_client(pdev, priv);
 
@@ -110,6 +110,7 @@ int nvdla_get_task_mem(struct nvdla_queue *queue,
 	task->task_desc = task_mem_info.va;
 	task->task_desc_pa = task_mem_info.dma_addr;
 	task->pool_index = task_mem_info.pool_index;
+	task->tmpl = NULL;
 
 	*ptask = task;
 
@@ -133,6 +134,10 @@ void task_free(struct kref *ref)
 
 	nvdla_dbg_info(pdev, "freeing task[%p]", task);
 
+	/* template pins outlive every task built from it */
+	if (task->tmpl)
+		nvdla_task_template_put(task->tmpl);
+
 	nvdla_put_task_mem(task);
 }
 
@@ -170,8 +175,8 @@ static int nvdla_unmap_task_memory(struct nvdla_task *task)
 
 	nvdla_dbg_fn(pdev, "task:[%p]", task);
 
-	/* unpin address list */
-	for (ii = 0; ii < task->num_addresses; ii++) {
+	/* unpin address list, template owned pins are kept */
+	for (ii = 0; ii < task->num_addresses && !task->tmpl; ii++) {
 		if (task->memory_handles[ii].type ==
 				NVDLA_BUFFER_TYPE_INTERNAL) {
 			/* No unpinning required for internal buffers */
@@ -530,6 +535,13 @@ static int nvdla_map_task_memory(struct nvdla_task *task)
 	task_desc->address_list = (uint64_t)((u8 *)task->task_desc_pa + offset);
 	task_desc->num_addresses = task->num_addresses;
 
+	/* address list was resolved when the template was registered */
+	if (task->tmpl) {
+		for (jj = 0; jj < task->num_addresses; jj++)
+			next = add_address(next, task->tmpl->addresses[jj]);
+		return 0;
+	}
+
 	/* update address list with all dma */
 	for (jj = 0; jj < task->num_addresses; jj++) {
 		dma_addr_t dma_addr;
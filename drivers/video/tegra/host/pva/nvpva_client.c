@@ -10,6 +10,7 @@
 #include "nvpva_buffer.h"
 #include "nvpva_client.h"
 #include "pva_iommu_context_dev.h"
+#include "pva_dma.h"
 
 /* Maximum contexts KMD creates per engine */
 #define NVPVA_CLIENT_MAX_CONTEXTS_PER_ENG (MAX_PVA_CLIENTS)
@@ -49,6 +50,7 @@ client_context_search_locked(struct platform_device *pdev,
 	c_node->pva = dev;
 	c_node->curr_sema_value = 0;
 	mutex_init(&c_node->sema_val_lock);
+	mutex_init(&c_node->dma_val_cache.lock);
 	if (dev->version != PVA_HW_GEN1) {
 		c_node->cntxt_dev =
 			nvpva_iommu_context_dev_allocate(NULL,
@@ -116,6 +118,8 @@ nvpva_client_context_free_locked(struct nvpva_client_context *client)
 	nvpva_buffer_release(client->buffers);
 	nvpva_iommu_context_dev_release(client->cntxt_dev);
 	mutex_destroy(&client->sema_val_lock);
+	pva_dma_val_cache_flush(client);
+	mutex_destroy(&client->dma_val_cache.lock);
 	client->buffers = NULL;
 	client->pva = NULL;
 	client->pid = 0;
@@ -11,6 +11,16 @@
 #include "pva_vpu_exe.h"
 
 struct pva;
+struct pva_dma_val_entry;
+
+#define NVPVA_DMA_VAL_CACHE_ENTRIES	8
+
+/* DMA configurations of this client that already passed validation */
+struct nvpva_dma_val_cache {
+	struct mutex lock;
+	struct pva_dma_val_entry *entries[NVPVA_DMA_VAL_CACHE_ENTRIES];
+	u32 next;
+};
 
 struct nvpva_client_context {
 	/* Reference to the device*/
@@ -35,6 +45,8 @@ struct nvpva_client_context {
 
 	/* Data structure to track elf context for vpu parsing */
 	struct nvpva_elf_context elf_ctx;
+
+	struct nvpva_dma_val_cache dma_val_cache;
 };
 
 struct pva;
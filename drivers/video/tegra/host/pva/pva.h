@@ -439,6 +439,8 @@ struct pva {
 #endif
 	u32 log_level;
 	u32 driver_log_mask;
+	atomic_t dma_val_hits;
+	atomic_t dma_val_misses;
 	struct nvpva_client_context *clients;
 	struct mutex clients_lock;
 
@@ -449,6 +449,10 @@ void pva_debugfs_init(struct platform_device *pdev)
 	debugfs_create_u32("profiling_level", 0644, de, &pva->profiling_level);
 	debugfs_create_bool("stats_enabled", 0644, de, &pva->stats_enabled);
 	debugfs_create_file("vpu_stats", 0644, de, pva, &pva_stats_fops);
+	debugfs_create_atomic_t("dma_val_cache_hits", 0444, de,
+				&pva->dma_val_hits);
+	debugfs_create_atomic_t("dma_val_cache_misses", 0444, de,
+				&pva->dma_val_misses);
 
 	mutex_init(&pva->fw_debug_log.saved_log_lock);
 	pva->fw_debug_log.size = FW_DEBUG_LOG_BUFFER_SIZE;
@@ -4,6 +4,8 @@
 #include <linux/kernel.h>
 #include <linux/seq_file.h>
 #include <linux/nospec.h>
+#include <linux/jhash.h>
+#include <linux/slab.h>
 #include "pva_dma.h"
 #include "pva_queue.h"
 #include "pva-sys-dma.h"
@@ -860,9 +862,11 @@ static int32_t nvpva_task_dma_desc_mapping(struct pva_submit_task *task,
 		dim3_check_relaxed = is_hwseq_mode_frm(task, desc_num)
 					|| is_hwseq_mode_t26x(task, desc_num);
 
-		err = validate_descriptor(umd_dma_desc,
-					  task->hwseq_config.hwseqTrigMode,
-					  dim3_check_relaxed);
+		/* descriptor set already validated with identical content */
+		if (task->dma_val_entry == NULL)
+			err = validate_descriptor(umd_dma_desc,
+						  task->hwseq_config.hwseqTrigMode,
+						  dim3_check_relaxed);
 		if (err) {
 			task_err(
 			    task,
@@ -2169,6 +2173,207 @@ out:
 	return err;
 }
 
+/*
+ * Validation cache
+ *
+ * An entry holds the full DMA configuration of a task (executable,
+ * descriptors, channels, hwseq config and blob) that passed validation,
+ * followed by the buffer sizes the boundary checks ran against. Entries are
+ * matched on content, the hash only selects candidates, and are immutable
+ * once published so a task may read its entry without the cache lock.
+ */
+struct pva_dma_val_entry {
+	struct kref ref;
+	u32 hash;
+	size_t key_size;
+	size_t sizes_size;
+	u8 data[];
+};
+
+struct pva_dma_val_key_hdr {
+	u32 version;
+	u32 blob_size;
+	u16 exe_id;
+	u8 num_descs;
+	u8 num_channels;
+};
+
+#define PVA_DMA_VAL_KEY_SEGS	5
+
+struct pva_dma_val_seg {
+	const void *ptr;
+	size_t len;
+};
+
+static size_t pva_dma_val_key(struct pva_submit_task *task, const u8 *blob,
+			      struct pva_dma_val_key_hdr *hdr,
+			      struct pva_dma_val_seg *seg)
+{
+	size_t key_size = 0;
+	u32 i;
+
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->version = task->pva->version;
+	hdr->blob_size = (blob != NULL) ? task->hwseq_config.hwseqBuf.size : 0U;
+	hdr->exe_id = get_sym_exe_id(task);
+	hdr->num_descs = task->num_dma_descriptors;
+	hdr->num_channels = task->num_dma_channels;
+
+	seg[0].ptr = hdr;
+	seg[0].len = sizeof(*hdr);
+	seg[1].ptr = task->dma_descriptors;
+	seg[1].len = task->num_dma_descriptors *
+		     sizeof(task->dma_descriptors[0]);
+	seg[2].ptr = task->dma_channels;
+	seg[2].len = task->num_dma_channels * sizeof(task->dma_channels[0]);
+	seg[3].ptr = &task->hwseq_config;
+	seg[3].len = sizeof(task->hwseq_config);
+	seg[4].ptr = blob;
+	seg[4].len = hdr->blob_size;
+
+	for (i = 0; i < PVA_DMA_VAL_KEY_SEGS; i++)
+		key_size += seg[i].len;
+
+	return key_size;
+}
+
+static bool pva_dma_val_key_equal(const struct pva_dma_val_entry *entry,
+				  const struct pva_dma_val_seg *seg,
+				  size_t key_size)
+{
+	const u8 *data = entry->data;
+	u32 i;
+
+	if (entry->key_size != key_size)
+		return false;
+
+	for (i = 0; i < PVA_DMA_VAL_KEY_SEGS; i++) {
+		if (memcmp(data, seg[i].ptr, seg[i].len) != 0)
+			return false;
+		data += seg[i].len;
+	}
+
+	return true;
+}
+
+static void pva_dma_val_entry_free(struct kref *ref)
+{
+	kfree(container_of(ref, struct pva_dma_val_entry, ref));
+}
+
+static void pva_dma_val_lookup(struct pva_submit_task *task, const u8 *blob)
+{
+	struct nvpva_dma_val_cache *cache = &task->client->dma_val_cache;
+	struct pva_dma_val_seg seg[PVA_DMA_VAL_KEY_SEGS];
+	struct pva_dma_val_key_hdr hdr;
+	struct pva_dma_val_entry *entry;
+	size_t key_size;
+	u32 hash = 0;
+	u32 i;
+
+	key_size = pva_dma_val_key(task, blob, &hdr, seg);
+	for (i = 0; i < PVA_DMA_VAL_KEY_SEGS; i++)
+		hash = jhash(seg[i].ptr, seg[i].len, hash);
+
+	mutex_lock(&cache->lock);
+	for (i = 0; i < NVPVA_DMA_VAL_CACHE_ENTRIES; i++) {
+		entry = cache->entries[i];
+		if ((entry != NULL) && (entry->hash == hash)
+		    && pva_dma_val_key_equal(entry, seg, key_size)) {
+			kref_get(&entry->ref);
+			task->dma_val_entry = entry;
+			break;
+		}
+	}
+	mutex_unlock(&cache->lock);
+}
+
+static bool pva_dma_val_sizes_match(struct pva_submit_task *task)
+{
+	struct pva_dma_val_entry *entry = task->dma_val_entry;
+
+	if (entry == NULL)
+		return false;
+
+	return memcmp(entry->data + entry->key_size, task->task_buff_info,
+		      entry->sizes_size) == 0;
+}
+
+/* Publish the configuration of a fully validated task */
+static void pva_dma_val_insert(struct pva_submit_task *task, const u8 *blob)
+{
+	struct nvpva_dma_val_cache *cache = &task->client->dma_val_cache;
+	struct pva_dma_val_seg seg[PVA_DMA_VAL_KEY_SEGS];
+	struct pva_dma_val_key_hdr hdr;
+	struct pva_dma_val_entry *entry, *old;
+	size_t key_size, sizes_size;
+	u8 *data;
+	u32 i, slot;
+
+	key_size = pva_dma_val_key(task, blob, &hdr, seg);
+	sizes_size = task->num_dma_descriptors *
+		     sizeof(task->task_buff_info[0]);
+
+	entry = kmalloc(struct_size(entry, data, key_size + sizes_size),
+			GFP_KERNEL);
+	if (entry == NULL)
+		return;
+
+	kref_init(&entry->ref);
+	entry->hash = 0;
+	entry->key_size = key_size;
+	entry->sizes_size = sizes_size;
+	data = entry->data;
+	for (i = 0; i < PVA_DMA_VAL_KEY_SEGS; i++) {
+		memcpy(data, seg[i].ptr, seg[i].len);
+		entry->hash = jhash(seg[i].ptr, seg[i].len, entry->hash);
+		data += seg[i].len;
+	}
+	memcpy(data, task->task_buff_info, sizes_size);
+
+	mutex_lock(&cache->lock);
+	/* replace a stale variant of the same configuration if present */
+	for (slot = 0; slot < NVPVA_DMA_VAL_CACHE_ENTRIES; slot++) {
+		if ((task->dma_val_entry != NULL)
+		    && (cache->entries[slot] == task->dma_val_entry))
+			break;
+	}
+	if (slot == NVPVA_DMA_VAL_CACHE_ENTRIES) {
+		slot = cache->next;
+		cache->next = (cache->next + 1U) % NVPVA_DMA_VAL_CACHE_ENTRIES;
+	}
+	old = cache->entries[slot];
+	cache->entries[slot] = entry;
+	mutex_unlock(&cache->lock);
+
+	if (old != NULL)
+		kref_put(&old->ref, pva_dma_val_entry_free);
+}
+
+static void pva_dma_val_put(struct pva_submit_task *task)
+{
+	if (task->dma_val_entry != NULL) {
+		kref_put(&task->dma_val_entry->ref, pva_dma_val_entry_free);
+		task->dma_val_entry = NULL;
+	}
+}
+
+void pva_dma_val_cache_flush(struct nvpva_client_context *client)
+{
+	struct nvpva_dma_val_cache *cache = &client->dma_val_cache;
+	struct pva_dma_val_entry *entry;
+	u32 i;
+
+	mutex_lock(&cache->lock);
+	for (i = 0; i < NVPVA_DMA_VAL_CACHE_ENTRIES; i++) {
+		entry = cache->entries[i];
+		cache->entries[i] = NULL;
+		if (entry != NULL)
+			kref_put(&entry->ref, pva_dma_val_entry_free);
+	}
+	mutex_unlock(&cache->lock);
+}
+
 int pva_task_write_dma_info(struct pva_submit_task *task,
 			    struct pva_hw_task *hw_task)
 {
@@ -2186,12 +2391,15 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 	u8 did;
 	u8 prev_did;
 	u8 bl_xfers_in_use = 0;
+	bool val_cached;
 	u32 hwseq_ram_size = (hwgen == PVA_HW_GEN2)
 				? PVA_HWSEQ_RAM_SIZE_T23X
 				: PVA_HWSEQ_RAM_SIZE_T26X;
 
 	nvpva_dbg_fn(task->pva, "");
 
+	task->dma_val_entry = NULL;
+
 	memset(task->desc_block_height_log2, U8_MAX, sizeof(task->desc_block_height_log2));
 	memset(task->hwseq_info, 0, sizeof(task->hwseq_info));
 	memset(task->desc_processed, 0, sizeof(task->desc_processed));
@@ -2246,6 +2454,8 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 			task->hwseq_config.hwseqBuf.size;
 	}
 
+	pva_dma_val_lookup(task, hwseqbuf_cpuva);
+
 	/* write dma channel info */
 	hw_task_dma_info->num_channels = task->num_dma_channels;
 	hw_task_dma_info->num_descriptors = task->num_dma_descriptors;
@@ -2337,7 +2547,9 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 		goto out;
 	}
 
-	if (task->pva->version <= PVA_HW_GEN2) {
+	/* boundaries also depend on the sizes of the buffers just patched */
+	val_cached = pva_dma_val_sizes_match(task);
+	if (!val_cached && (task->pva->version <= PVA_HW_GEN2)) {
 		for (i = 0; i < task->num_dma_channels; i++) {
 			err = 0;
 			if (task->hwseq_info[i].verify_bounds)
@@ -2351,6 +2563,13 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 		}
 	}
 
+	if (val_cached) {
+		atomic_inc(&task->pva->dma_val_hits);
+	} else {
+		atomic_inc(&task->pva->dma_val_misses);
+		pva_dma_val_insert(task, hwseqbuf_cpuva);
+	}
+
 	hw_task->task.dma_info =
 		task->dma_addr + offsetof(struct pva_hw_task, dma_info_and_params_list)
 		+ offsetof(struct pva_dma_info_and_params_list_s, dma_info);
@@ -2360,6 +2579,7 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 	hw_task_dma_info->dma_info_version = PVA_DMA_INFO_VERSION_ID;
 	hw_task_dma_info->dma_info_size = sizeof(struct pva_dma_info_s);
 out:
+	pva_dma_val_put(task);
 	if (hwseqbuf_cpuva != NULL)
 		pva_dmabuf_vunmap(mem->dmabuf, hwseqbuf_cpuva);
 
@@ -82,4 +82,7 @@ int pva_task_write_dma_info(struct pva_submit_task *task,
 
 int pva_task_write_dma_misr_info(struct pva_submit_task *task,
 			    struct pva_hw_task *hw_task);
+
+struct nvpva_client_context;
+void pva_dma_val_cache_flush(struct nvpva_client_context *client);
 #endif
@@ -0,0 +1,260 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Submit path DMA validation benchmark, runs without PVA hardware.
+ *
+ * Builds a task with SW sequenced descriptor chains and times
+ * pva_task_write_dma_info() with the validation cache flushed before
+ * every call (full validation) and with the cache warm (address patching
+ * only). Buffer pinning and symbol lookup are stubbed out, everything
+ * else is the code of pva_dma.c.
+ */
+
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/ktime.h>
+#include <linux/vmalloc.h>
+#include "pva.h"
+#include "pva_queue.h"
+#include "pva_vpu_exe.h"
+#include "nvpva_client.h"
+#include "pva_dma.h"
+
+#define PVA_DMA_BENCH_MC_SIZE		(16U * 1024U * 1024U)
+#define PVA_DMA_BENCH_VMEM_SIZE		(64U * 1024U)
+
+static struct pva_pinned_memory pva_dma_bench_mem = {
+	.size = PVA_DMA_BENCH_MC_SIZE,
+	.dma_addr = 0x80000000ULL,
+	.id = 1,
+};
+
+static struct pva_pinned_memory *
+pva_dma_bench_pin_mem(struct pva_submit_task *task, u32 id)
+{
+	return &pva_dma_bench_mem;
+}
+
+static int32_t pva_dma_bench_sym_offset(struct nvpva_elf_context *d,
+					uint16_t exe_id, uint32_t sym_id,
+					uint32_t *addr, uint32_t *size)
+{
+	*addr = 0U;
+	*size = PVA_DMA_BENCH_VMEM_SIZE;
+	return 0;
+}
+
+/* no hwseq blob is used, nothing gets mapped */
+static void *pva_dma_bench_vmap(struct dma_buf *dmabuf)
+{
+	return NULL;
+}
+
+static void pva_dma_bench_vunmap(struct dma_buf *dmabuf, void *addr)
+{
+}
+
+/* The function under test is built against the stubs above */
+#define pva_task_pin_mem	pva_dma_bench_pin_mem
+#define pva_get_sym_offset	pva_dma_bench_sym_offset
+#define pva_dmabuf_vmap		pva_dma_bench_vmap
+#define pva_dmabuf_vunmap	pva_dma_bench_vunmap
+#include "pva_dma.c"
+#undef pva_task_pin_mem
+#undef pva_get_sym_offset
+#undef pva_dmabuf_vmap
+#undef pva_dmabuf_vunmap
+
+static unsigned int descs = 32;
+module_param(descs, uint, 0444);
+MODULE_PARM_DESC(descs, "DMA descriptors per task");
+
+static unsigned int channels = 4;
+module_param(channels, uint, 0444);
+MODULE_PARM_DESC(channels, "DMA channels the descriptors are chained on");
+
+static unsigned int iterations = 10000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "submits timed per run");
+
+struct pva_dma_bench_stats {
+	u64 min;
+	u64 max;
+	u64 total;
+};
+
+/* MC to VMEM tiles, one chain of descriptors per channel */
+static void pva_dma_bench_setup(struct pva_submit_task *task)
+{
+	u32 per_ch = DIV_ROUND_UP(descs, channels);
+	u32 i;
+
+	task->exe_id1 = 1U;
+	task->exe_id2 = NVPVA_NOOP_EXE_ID;
+	task->num_dma_descriptors = descs;
+	task->num_dma_channels = channels;
+
+	for (i = 0; i < descs; i++) {
+		struct nvpva_dma_descriptor *desc = &task->dma_descriptors[i];
+
+		desc->srcPtr = pva_dma_bench_mem.id;
+		desc->dstPtr = 1U;
+		desc->dst2Ptr = NVPVA_INVALID_SYMBOL_ID;
+		desc->src_offset = (u64)i * 4096U;
+		desc->tx = 64U;
+		desc->ty = 16U;
+		desc->srcLinePitch = 256U;
+		desc->dstLinePitch = 64U;
+		desc->srcTransferMode = DMA_DESC_SRC_XFER_MC;
+		desc->dstTransferMode = DMA_DESC_DST_XFER_VMEM;
+		/* link IDs are 1 based, 0 ends the chain */
+		if (((i + 1U) % per_ch != 0U) && (i + 1U < descs))
+			desc->linkDescId = i + 2U;
+	}
+
+	for (i = 0; i < channels; i++)
+		task->dma_channels[i].descIndex = i * per_ch;
+}
+
+static int pva_dma_bench_run(struct pva_submit_task *task,
+			     struct pva_hw_task *hw_task,
+			     const struct pva_hw_task *ref,
+			     bool flush, struct pva_dma_bench_stats *stats)
+{
+	const size_t desc_size = descs * sizeof(hw_task->dma_desc[0]);
+	u64 start, ns;
+	unsigned int i;
+	int err;
+
+	stats->min = U64_MAX;
+	stats->max = 0;
+	stats->total = 0;
+
+	for (i = 0; i < iterations; i++) {
+		if (flush)
+			pva_dma_val_cache_flush(task->client);
+		memset(hw_task, 0, sizeof(*hw_task));
+
+		start = ktime_get_ns();
+		err = pva_task_write_dma_info(task, hw_task);
+		ns = ktime_get_ns() - start;
+		if (err) {
+			pr_err("pva_dma_bench: submit %u failed %d\n", i, err);
+			return err;
+		}
+
+		/* cached and full validation must produce the same HW task */
+		if (memcmp(&hw_task->dma_info_and_params_list.dma_info,
+			   &ref->dma_info_and_params_list.dma_info,
+			   sizeof(ref->dma_info_and_params_list.dma_info)) != 0
+		    || memcmp(hw_task->dma_desc, ref->dma_desc, desc_size) != 0) {
+			pr_err("pva_dma_bench: submit %u differs from reference\n",
+			       i);
+			return -EILSEQ;
+		}
+
+		stats->min = min(stats->min, ns);
+		stats->max = max(stats->max, ns);
+		stats->total += ns;
+	}
+
+	return 0;
+}
+
+static void pva_dma_bench_report(const char *name,
+				 const struct pva_dma_bench_stats *stats)
+{
+	pr_info("pva_dma_bench: %s: min %llu avg %llu max %llu ns\n", name,
+		stats->min, div_u64(stats->total, iterations), stats->max);
+}
+
+static int __init pva_dma_bench_init(void)
+{
+	struct platform_device *pdev;
+	struct nvpva_client_context *client = NULL;
+	struct pva_submit_task *task = NULL;
+	struct pva_hw_task *hw_task = NULL;
+	struct pva_hw_task *ref = NULL;
+	struct pva_dma_bench_stats cold, warm;
+	struct pva *pva = NULL;
+	int err = -ENOMEM;
+
+	if ((descs == 0U) || (descs >= NVPVA_RESERVED_DESCRIPTORS_START_IDX)
+	    || (channels == 0U) || (channels > descs)
+	    || (channels > NVPVA_TASK_MAX_DMA_CHANNELS_T23X)
+	    || (iterations == 0U))
+		return -EINVAL;
+
+	pdev = platform_device_register_simple("pva_dma_bench", -1, NULL, 0);
+	if (IS_ERR(pdev))
+		return PTR_ERR(pdev);
+
+	pva = kzalloc(sizeof(*pva), GFP_KERNEL);
+	client = kzalloc(sizeof(*client), GFP_KERNEL);
+	task = vzalloc(sizeof(*task));
+	hw_task = vzalloc(sizeof(*hw_task));
+	ref = vzalloc(sizeof(*ref));
+	if (!pva || !client || !task || !hw_task || !ref)
+		goto out;
+
+	pva->version = PVA_HW_GEN2;
+	pva->pdev = pdev;
+	client->pva = pva;
+	mutex_init(&client->dma_val_cache.lock);
+	task->pva = pva;
+	task->client = client;
+	pva_dma_bench_setup(task);
+
+	/* reference output of a fully validated submit */
+	err = pva_task_write_dma_info(task, hw_task);
+	if (err) {
+		pr_err("pva_dma_bench: reference submit failed %d\n", err);
+		goto out;
+	}
+	memcpy(ref, hw_task, sizeof(*ref));
+
+	err = pva_dma_bench_run(task, hw_task, ref, true, &cold);
+	if (err)
+		goto out;
+
+	atomic_set(&pva->dma_val_hits, 0);
+	atomic_set(&pva->dma_val_misses, 0);
+	err = pva_dma_bench_run(task, hw_task, ref, false, &warm);
+	if (err)
+		goto out;
+
+	pr_info("pva_dma_bench: %u descriptors on %u channels, %u submits\n",
+		descs, channels, iterations);
+	pva_dma_bench_report("full validation", &cold);
+	pva_dma_bench_report("cached", &warm);
+
+	/* an identical configuration must never be validated again */
+	if (atomic_read(&pva->dma_val_misses) != 0) {
+		pr_err("pva_dma_bench: cached run missed %d times\n",
+		       atomic_read(&pva->dma_val_misses));
+		err = -EPROTO;
+	}
+
+out:
+	if (client && client->pva)
+		pva_dma_val_cache_flush(client);
+	vfree(ref);
+	vfree(hw_task);
+	vfree(task);
+	kfree(client);
+	kfree(pva);
+	platform_device_unregister(pdev);
+
+	return err;
+}
+
+static void __exit pva_dma_bench_exit(void)
+{
+}
+
+module_init(pva_dma_bench_init);
+module_exit(pva_dma_bench_exit);
+
+MODULE_DESCRIPTION("PVA DMA validation benchmark");
+MODULE_LICENSE("GPL v2");
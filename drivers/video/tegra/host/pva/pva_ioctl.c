@@ -29,6 +29,7 @@
 #include "pva_vpu_app_auth.h"
 #include "pva_system_allow_list.h"
 #include "nvpva_client.h"
+#include "pva_dma.h"
 /**
  * @brief pva_private - Per-fd specific data
  *
@@ -662,6 +663,9 @@ static int pva_register_vpu_exec(struct pva_private *priv, void *arg)
 		goto free_mem;
 	}
 
+	/* symbol layout behind a reused exe_id may have changed */
+	pva_dma_val_cache_flush(priv->client);
+
 	reg_out->exe_id = exe_id;
 	image = get_elf_image(&priv->client->elf_ctx, exe_id);
 	reg_out->num_of_symbols = image->num_symbols -
@@ -680,6 +684,9 @@ static int pva_unregister_vpu_exec(struct pva_private *priv, void *arg)
 {
 	struct nvpva_vpu_exe_unregister_in_arg *unreg_in =
 		(struct nvpva_vpu_exe_unregister_in_arg *)arg;
+
+	pva_dma_val_cache_flush(priv->client);
+
 	return pva_release_vpu_app(&priv->client->elf_ctx,
 			unreg_in->exe_id, false);
 }
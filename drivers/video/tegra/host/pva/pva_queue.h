@@ -74,6 +74,8 @@ struct pva_dma_task_buffer_info_s {
 	uint64_t dst2_buffer_size;
 };
 
+struct pva_dma_val_entry;
+
 /**
  * @brief	Describe a task for PVA
  *
@@ -190,6 +192,9 @@ struct pva_submit_task {
 	u64 src_surf_base_addr;
 	u64 dst_surf_base_addr;
 	bool is_system_app;
+
+	/** Validation cache entry matching this task's DMA setup */
+	struct pva_dma_val_entry *dma_val_entry;
 };
 
 struct pva_submit_tasks {
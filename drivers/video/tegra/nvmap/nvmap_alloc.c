@@ -1092,7 +1092,8 @@ void _nvmap_handle_free(struct nvmap_handle *h)
 out:
 	NVMAP_TAG_TRACE(trace_nvmap_destroy_handle,
 		NULL, get_current()->pid, 0, NVMAP_TP_ARGS_H(h));
-	kfree(h);
+	/* nvmap_validate_get() may still be looking at the handle */
+	kfree_rcu(h, rcu);
 }
 
 void nvmap_free_handle(struct nvmap_client *client,
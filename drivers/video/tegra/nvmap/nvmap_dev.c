@@ -792,7 +792,8 @@ static int nvmap_page_mapcount(struct page *page)
 static void nvmap_get_total_mss(u64 *pss, u64 *total, u32 heap_type)
 {
 	int i;
-	struct rb_node *n;
+	unsigned int shard, bkt;
+	struct nvmap_handle *h;
 	struct nvmap_device *dev = nvmap_dev;
 
 	*total = 0;
@@ -800,27 +801,26 @@ static void nvmap_get_total_mss(u64 *pss, u64 *total, u32 heap_type)
 		*pss = 0;
 	if (!dev)
 		return;
-	spin_lock(&dev->handle_lock);
-	n = rb_first(&dev->handles);
-	for (; n != NULL; n = rb_next(n)) {
-		struct nvmap_handle *h =
-			rb_entry(n, struct nvmap_handle, node);
-
-		if (!h || !h->alloc || h->heap_type != heap_type)
-			continue;
-
-		*total += h->size;
-		if (!pss)
-			continue;
-
-		for (i = 0; i < h->size >> PAGE_SHIFT; i++) {
-			struct page *page = nvmap_to_page(h->pgalloc.pages[i]);
-
-			if (nvmap_page_mapcount(page) > 0)
-				*pss += PAGE_SIZE;
+	for (shard = 0; shard < NVMAP_HANDLE_LOCK_SHARDS; shard++) {
+		spin_lock(&dev->handle_lock[shard]);
+		nvmap_for_each_handle_in_shard(dev, h, shard, bkt) {
+			if (!h->alloc || h->heap_type != heap_type)
+				continue;
+
+			*total += h->size;
+			if (!pss)
+				continue;
+
+			for (i = 0; i < h->size >> PAGE_SHIFT; i++) {
+				struct page *page =
+					nvmap_to_page(h->pgalloc.pages[i]);
+
+				if (nvmap_page_mapcount(page) > 0)
+					*pss += PAGE_SIZE;
+			}
 		}
+		spin_unlock(&dev->handle_lock[shard]);
 	}
-	spin_unlock(&dev->handle_lock);
 }
 
 static int nvmap_debug_allocations_show(struct seq_file *s, void *unused)
@@ -899,53 +899,51 @@ DEBUGFS_OPEN_FOPS(device_list);
 static int nvmap_debug_all_allocations_show(struct seq_file *s, void *unused)
 {
 	u32 heap_type = (u32)(uintptr_t)s->private;
-	struct rb_node *n;
+	struct nvmap_handle *handle;
+	unsigned int shard, bkt;
 
-
-	spin_lock(&nvmap_dev->handle_lock);
 	seq_printf(s, "%8s %11s %9s %6s %6s %6s %6s %8s\n",
 			"BASE", "SIZE", "USERFLAGS", "REFS",
 			"KMAPS", "UMAPS", "SHARE", "UID");
 
 	/* for each handle */
-	n = rb_first(&nvmap_dev->handles);
-	for (; n != NULL; n = rb_next(n)) {
-		struct nvmap_handle *handle =
-			rb_entry(n, struct nvmap_handle, node);
-		int i = 0;
+	for (shard = 0; shard < NVMAP_HANDLE_LOCK_SHARDS; shard++) {
+		spin_lock(&nvmap_dev->handle_lock[shard]);
+		nvmap_for_each_handle_in_shard(nvmap_dev, handle, shard, bkt) {
+			int i = 0;
 
-		if (handle->alloc && handle->heap_type == heap_type) {
-			phys_addr_t base = heap_type == NVMAP_HEAP_IOVMM ? 0 :
-					   handle->heap_pgalloc ? 0 :
-					   (handle->carveout->base);
-			size_t size = K(handle->size);
+			if (handle->alloc && handle->heap_type == heap_type) {
+				phys_addr_t base = heap_type == NVMAP_HEAP_IOVMM ? 0 :
+						   handle->heap_pgalloc ? 0 :
+						   (handle->carveout->base);
+				size_t size = K(handle->size);
 
 next_page:
-			if ((heap_type == NVMAP_HEAP_CARVEOUT_VPR) && handle->heap_pgalloc) {
-				base = page_to_phys(handle->pgalloc.pages[i++]);
-				size = K(PAGE_SIZE);
-			}
-
-			seq_printf(s,
-				"%8llx %10zuK %9x %6u %6u %6u %6u %8p\n",
-				(unsigned long long)base, K(handle->size),
-				handle->userflags,
-				atomic_read(&handle->ref),
-				atomic_read(&handle->kmap_count),
-				atomic_read(&handle->umap_count),
-				atomic_read(&handle->share_count),
-				handle);
+				if ((heap_type == NVMAP_HEAP_CARVEOUT_VPR) && handle->heap_pgalloc) {
+					base = page_to_phys(handle->pgalloc.pages[i++]);
+					size = K(PAGE_SIZE);
+				}
 
-			if ((heap_type == NVMAP_HEAP_CARVEOUT_VPR) && handle->heap_pgalloc) {
-				i++;
-				if (i < (handle->size >> PAGE_SHIFT))
-					goto next_page;
+				seq_printf(s,
+					"%8llx %10zuK %9x %6u %6u %6u %6u %8p\n",
+					(unsigned long long)base, K(handle->size),
+					handle->userflags,
+					atomic_read(&handle->ref),
+					atomic_read(&handle->kmap_count),
+					atomic_read(&handle->umap_count),
+					atomic_read(&handle->share_count),
+					handle);
+
+				if ((heap_type == NVMAP_HEAP_CARVEOUT_VPR) && handle->heap_pgalloc) {
+					i++;
+					if (i < (handle->size >> PAGE_SHIFT))
+						goto next_page;
+				}
 			}
 		}
+		spin_unlock(&nvmap_dev->handle_lock[shard]);
 	}
 
-	spin_unlock(&nvmap_dev->handle_lock);
-
 	return 0;
 }
 
@@ -954,53 +952,51 @@ DEBUGFS_OPEN_FOPS(all_allocations);
 static int nvmap_debug_orphan_handles_show(struct seq_file *s, void *unused)
 {
 	u32 heap_type = (u32)(uintptr_t)s->private;
-	struct rb_node *n;
-
+	struct nvmap_handle *handle;
+	unsigned int shard, bkt;
 
-	spin_lock(&nvmap_dev->handle_lock);
 	seq_printf(s, "%8s %11s %9s %6s %6s %6s %8s\n",
 			"BASE", "SIZE", "USERFLAGS", "REFS",
 			"KMAPS", "UMAPS", "UID");
 
 	/* for each handle */
-	n = rb_first(&nvmap_dev->handles);
-	for (; n != NULL; n = rb_next(n)) {
-		struct nvmap_handle *handle =
-			rb_entry(n, struct nvmap_handle, node);
-		int i = 0;
+	for (shard = 0; shard < NVMAP_HANDLE_LOCK_SHARDS; shard++) {
+		spin_lock(&nvmap_dev->handle_lock[shard]);
+		nvmap_for_each_handle_in_shard(nvmap_dev, handle, shard, bkt) {
+			int i = 0;
 
-		if (handle->alloc && handle->heap_type == heap_type &&
-			!atomic_read(&handle->share_count)) {
-			phys_addr_t base = heap_type == NVMAP_HEAP_IOVMM ? 0 :
-					   handle->heap_pgalloc ? 0 :
-					   (handle->carveout->base);
-			size_t size = K(handle->size);
+			if (handle->alloc && handle->heap_type == heap_type &&
+				!atomic_read(&handle->share_count)) {
+				phys_addr_t base = heap_type == NVMAP_HEAP_IOVMM ? 0 :
+						   handle->heap_pgalloc ? 0 :
+						   (handle->carveout->base);
+				size_t size = K(handle->size);
 
 next_page:
-			if ((heap_type == NVMAP_HEAP_CARVEOUT_VPR) && handle->heap_pgalloc) {
-				base = page_to_phys(handle->pgalloc.pages[i++]);
-				size = K(PAGE_SIZE);
-			}
-
-			seq_printf(s,
-				"%8llx %10zuK %9x %6u %6u %6u %8p\n",
-				(unsigned long long)base, K(handle->size),
-				handle->userflags,
-				atomic_read(&handle->ref),
-				atomic_read(&handle->kmap_count),
-				atomic_read(&handle->umap_count),
-				handle);
+				if ((heap_type == NVMAP_HEAP_CARVEOUT_VPR) && handle->heap_pgalloc) {
+					base = page_to_phys(handle->pgalloc.pages[i++]);
+					size = K(PAGE_SIZE);
+				}
 
-			if ((heap_type == NVMAP_HEAP_CARVEOUT_VPR) && handle->heap_pgalloc) {
-				i++;
-				if (i < (handle->size >> PAGE_SHIFT))
-					goto next_page;
+				seq_printf(s,
+					"%8llx %10zuK %9x %6u %6u %6u %8p\n",
+					(unsigned long long)base, K(handle->size),
+					handle->userflags,
+					atomic_read(&handle->ref),
+					atomic_read(&handle->kmap_count),
+					atomic_read(&handle->umap_count),
+					handle);
+
+				if ((heap_type == NVMAP_HEAP_CARVEOUT_VPR) && handle->heap_pgalloc) {
+					i++;
+					if (i < (handle->size >> PAGE_SHIFT))
+						goto next_page;
+				}
 			}
 		}
+		spin_unlock(&nvmap_dev->handle_lock[shard]);
 	}
 
-	spin_unlock(&nvmap_dev->handle_lock);
-
 	return 0;
 }
 
@@ -1433,8 +1429,9 @@ int __init nvmap_probe(struct platform_device *pdev)
 	dev->dev_user.name = "nvmap";
 	dev->dev_user.fops = &nvmap_user_fops;
 	dev->dev_user.parent = &pdev->dev;
-	dev->handles = RB_ROOT;
-	dev->serial_id_counter = 0;
+	for (i = 0; i < ARRAY_SIZE(dev->handles); i++)
+		INIT_HLIST_HEAD(&dev->handles[i]);
+	atomic64_set(&dev->serial_id_counter, 0);
 
 #ifdef NVMAP_CONFIG_PAGE_POOLS
 	e = nvmap_page_pool_init(dev);
@@ -1442,7 +1439,8 @@ int __init nvmap_probe(struct platform_device *pdev)
 		goto fail;
 #endif
 
-	spin_lock_init(&dev->handle_lock);
+	for (i = 0; i < NVMAP_HANDLE_LOCK_SHARDS; i++)
+		spin_lock_init(&dev->handle_lock[i]);
 	INIT_LIST_HEAD(&dev->clients);
 	dev->pids = RB_ROOT;
 	mutex_init(&dev->clients_lock);
@@ -1481,6 +1479,7 @@ int __init nvmap_probe(struct platform_device *pdev)
 #ifdef NVMAP_CONFIG_PAGE_POOLS
 	nvmap_page_pool_debugfs_init(nvmap_dev->debug_root);
 #endif
+	nvmap_dmabuf_stash_debugfs_init(nvmap_dev->debug_root);
 	nvmap_stats_init(nvmap_debug_root);
 	platform_set_drvdata(pdev, dev);
 
@@ -1543,7 +1542,7 @@ finish:
 int nvmap_remove(struct platform_device *pdev)
 {
 	struct nvmap_device *dev = platform_get_drvdata(pdev);
-	struct rb_node *n;
+	struct hlist_node *n;
 	struct nvmap_handle *h;
 	int i;
 
@@ -1557,10 +1556,11 @@ int nvmap_remove(struct platform_device *pdev)
 	nvmap_page_pool_clear();
 	nvmap_page_pool_fini(nvmap_dev);
 #endif
-	while ((n = rb_first(&dev->handles))) {
-		h = rb_entry(n, struct nvmap_handle, node);
-		rb_erase(&h->node, &dev->handles);
-		kfree(h);
+	for (i = 0; i < ARRAY_SIZE(dev->handles); i++) {
+		hlist_for_each_entry_safe(h, n, &dev->handles[i], node) {
+			hlist_del(&h->node);
+			kfree(h);
+		}
 	}
 
 	for (i = 0; i < dev->nr_carveouts; i++) {
@@ -24,6 +24,8 @@
 #include <linux/of.h>
 #include <linux/version.h>
 #include <linux/iommu.h>
+#include <linux/hashtable.h>
+#include <linux/moduleparam.h>
 #if defined(NV_LINUX_IOSYS_MAP_H_PRESENT)
 #include <linux/iosys-map.h>
 #endif
@@ -43,12 +45,40 @@ struct nvmap_handle_sgt {
 	enum dma_data_direction dir;
 	struct sg_table *sgt;
 	struct device *dev;
-	struct list_head maps_entry;
+	struct hlist_node hash_entry;
+	struct list_head lru_entry;
+	unsigned int refs;	/* outstanding maps of this sgt */
 	struct nvmap_handle_info *owner;
 } ____cacheline_aligned_in_smp;
 
 static struct kmem_cache *handle_sgt_cache;
 
+/*
+ * Number of sg tables stashed per dma-buf before the least recently used
+ * unmapped ones are released. Tables that are still mapped are never
+ * evicted, so the limit can be exceeded temporarily.
+ */
+static unsigned int sgt_stash_max = 16;
+module_param(sgt_stash_max, uint, 0644);
+
+static atomic64_t stash_hits;
+static atomic64_t stash_misses;
+static atomic64_t stash_evictions;
+static atomic64_t stash_entries;
+static atomic64_t stash_bytes;
+
+static inline unsigned long nvmap_sgt_stash_key(struct device *dev,
+					       enum dma_data_direction dir)
+{
+	return (unsigned long)dev ^ dir;
+}
+
+static inline size_t nvmap_sgt_stash_size(struct sg_table *sgt)
+{
+	return sizeof(struct nvmap_handle_sgt) + sizeof(*sgt) +
+	       sgt->orig_nents * sizeof(struct scatterlist);
+}
+
 /*
  * Initialize a kmem cache for allocating nvmap_handle_sgt's.
  */
@@ -68,6 +98,39 @@ void nvmap_dmabuf_stash_deinit(void)
 	kmem_cache_destroy(handle_sgt_cache);
 }
 
+static int nvmap_dmabuf_stash_stats_show(struct seq_file *s, void *unused)
+{
+	seq_printf(s, "hits:      %lld\n", atomic64_read(&stash_hits));
+	seq_printf(s, "misses:    %lld\n", atomic64_read(&stash_misses));
+	seq_printf(s, "evictions: %lld\n", atomic64_read(&stash_evictions));
+	seq_printf(s, "entries:   %lld\n", atomic64_read(&stash_entries));
+	seq_printf(s, "bytes:     %lld\n", atomic64_read(&stash_bytes));
+	return 0;
+}
+
+static int nvmap_dmabuf_stash_stats_open(struct inode *inode,
+					 struct file *file)
+{
+	return single_open(file, nvmap_dmabuf_stash_stats_show,
+			   inode->i_private);
+}
+
+static const struct file_operations nvmap_dmabuf_stash_stats_fops = {
+	.open = nvmap_dmabuf_stash_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+void nvmap_dmabuf_stash_debugfs_init(struct dentry *nvmap_root)
+{
+	if (IS_ERR_OR_NULL(nvmap_root))
+		return;
+
+	debugfs_create_file("sgt_stash", S_IRUGO, nvmap_root, NULL,
+			    &nvmap_dmabuf_stash_stats_fops);
+}
+
 static int __nvmap_dmabuf_attach(struct dma_buf *dmabuf, struct device *dev,
 			       struct dma_buf_attachment *attach)
 {
@@ -112,6 +175,59 @@ static inline bool access_vpr_phys(struct device *dev)
 	return !!of_find_property(dev->of_node, "access-vpr-phys", NULL);
 }
 
+static void __nvmap_dmabuf_unmap_sgt(struct nvmap_handle_info *info,
+				     struct device *dev,
+				     enum dma_data_direction dir,
+				     struct sg_table *sgt)
+{
+	if (!(nvmap_dev->dynamic_dma_map_mask & info->handle->heap_type)) {
+		sg_dma_address(sgt->sgl) = 0;
+	} else if (info->handle->heap_type == NVMAP_HEAP_CARVEOUT_VPR &&
+			access_vpr_phys(dev)) {
+		sg_dma_address(sgt->sgl) = 0;
+	} else {
+		dma_unmap_sg_attrs(dev,
+				   sgt->sgl, sgt->nents,
+				   dir, DMA_ATTR_SKIP_CPU_SYNC);
+	}
+	__nvmap_free_sg_table(NULL, info->handle, sgt);
+}
+
+static void nvmap_dmabuf_stash_free_locked(struct nvmap_handle_sgt *nvmap_sgt)
+{
+	struct nvmap_handle_info *info = nvmap_sgt->owner;
+
+	hash_del(&nvmap_sgt->hash_entry);
+	list_del(&nvmap_sgt->lru_entry);
+	info->nr_maps--;
+	atomic64_dec(&stash_entries);
+	atomic64_sub(nvmap_sgt_stash_size(nvmap_sgt->sgt), &stash_bytes);
+
+	__nvmap_dmabuf_unmap_sgt(info, nvmap_sgt->dev, nvmap_sgt->dir,
+				 nvmap_sgt->sgt);
+	kmem_cache_free(handle_sgt_cache, nvmap_sgt);
+}
+
+/*
+ * Release least recently used, unmapped sg tables until the stash is back
+ * under sgt_stash_max.
+ */
+static void nvmap_dmabuf_stash_evict_locked(struct nvmap_handle_info *info)
+{
+	struct nvmap_handle_sgt *nvmap_sgt, *tmp;
+
+	list_for_each_entry_safe_reverse(nvmap_sgt, tmp, &info->maps_lru,
+					 lru_entry) {
+		if (info->nr_maps <= sgt_stash_max)
+			break;
+		if (nvmap_sgt->refs)
+			continue;
+
+		nvmap_dmabuf_stash_free_locked(nvmap_sgt);
+		atomic64_inc(&stash_evictions);
+	}
+}
+
 static int nvmap_dmabuf_stash_sgt_locked(struct dma_buf_attachment *attach,
 					 enum dma_data_direction dir,
 					 struct sg_table *sgt)
@@ -128,29 +244,54 @@ static int nvmap_dmabuf_stash_sgt_locked(struct dma_buf_attachment *attach,
 	nvmap_sgt->dir = dir;
 	nvmap_sgt->sgt = sgt;
 	nvmap_sgt->dev = attach->dev;
+	nvmap_sgt->refs = 1;
 	nvmap_sgt->owner = info;
-	list_add(&nvmap_sgt->maps_entry, &info->maps);
+	hash_add(info->maps, &nvmap_sgt->hash_entry,
+		 nvmap_sgt_stash_key(attach->dev, dir));
+	list_add(&nvmap_sgt->lru_entry, &info->maps_lru);
+	info->nr_maps++;
+	atomic64_inc(&stash_entries);
+	atomic64_add(nvmap_sgt_stash_size(sgt), &stash_bytes);
+
+	nvmap_dmabuf_stash_evict_locked(info);
 
 	return 0;
 }
 
+static struct nvmap_handle_sgt *
+nvmap_dmabuf_stash_lookup_locked(struct nvmap_handle_info *info,
+				 struct device *dev,
+				 enum dma_data_direction dir)
+{
+	struct nvmap_handle_sgt *nvmap_sgt;
+
+	hash_for_each_possible(info->maps, nvmap_sgt, hash_entry,
+			       nvmap_sgt_stash_key(dev, dir)) {
+		if (nvmap_sgt->dir == dir && nvmap_sgt->dev == dev)
+			return nvmap_sgt;
+	}
+
+	return NULL;
+}
+
 static struct sg_table *nvmap_dmabuf_get_sgt_from_stash(struct dma_buf_attachment *attach,
 							enum dma_data_direction dir)
 {
 	struct nvmap_handle_info *info = attach->dmabuf->priv;
 	struct nvmap_handle_sgt *nvmap_sgt;
-	struct sg_table *sgt = NULL;
 
-	list_for_each_entry(nvmap_sgt, &info->maps, maps_entry) {
-		if (nvmap_sgt->dir != dir || nvmap_sgt->dev != attach->dev)
-			continue;
-
-		/* found sgt in stash */
-		sgt = nvmap_sgt->sgt;
-		break;
+	nvmap_sgt = nvmap_dmabuf_stash_lookup_locked(info, attach->dev, dir);
+	if (!nvmap_sgt) {
+		atomic64_inc(&stash_misses);
+		return NULL;
 	}
 
-	return sgt;
+	/* found sgt in stash */
+	nvmap_sgt->refs++;
+	list_move(&nvmap_sgt->lru_entry, &info->maps_lru);
+	atomic64_inc(&stash_hits);
+
+	return nvmap_sgt->sgt;
 }
 
 static struct sg_table *nvmap_dmabuf_map_dma_buf(struct dma_buf_attachment *attach,
@@ -235,31 +376,12 @@ err_map:
 	return ERR_PTR(-ENOMEM);
 }
 
-static void __nvmap_dmabuf_unmap_dma_buf(struct nvmap_handle_sgt *nvmap_sgt)
-{
-	struct nvmap_handle_info *info = nvmap_sgt->owner;
-	enum dma_data_direction dir = nvmap_sgt->dir;
-	struct sg_table *sgt = nvmap_sgt->sgt;
-	struct device *dev = nvmap_sgt->dev;
-
-	if (!(nvmap_dev->dynamic_dma_map_mask & info->handle->heap_type)) {
-		sg_dma_address(sgt->sgl) = 0;
-	} else if (info->handle->heap_type == NVMAP_HEAP_CARVEOUT_VPR &&
-			access_vpr_phys(dev)) {
-		sg_dma_address(sgt->sgl) = 0;
-	} else {
-		dma_unmap_sg_attrs(dev,
-				   sgt->sgl, sgt->nents,
-				   dir, DMA_ATTR_SKIP_CPU_SYNC);
-	}
-	__nvmap_free_sg_table(NULL, info->handle, sgt);
-}
-
 static void nvmap_dmabuf_unmap_dma_buf(struct dma_buf_attachment *attach,
 				       struct sg_table *sgt,
 				       enum dma_data_direction dir)
 {
 	struct nvmap_handle_info *info = attach->dmabuf->priv;
+	struct nvmap_handle_sgt *nvmap_sgt;
 #ifdef NVMAP_CONFIG_DEBUG_MAPS
 	char *device_name = NULL;
 	u32 heap_type = 0;
@@ -274,6 +396,16 @@ static void nvmap_dmabuf_unmap_dma_buf(struct dma_buf_attachment *attach,
 		return;
 	}
 
+	nvmap_sgt = nvmap_dmabuf_stash_lookup_locked(info, attach->dev, dir);
+	if (nvmap_sgt && nvmap_sgt->sgt == sgt) {
+		if (!WARN_ON(!nvmap_sgt->refs))
+			nvmap_sgt->refs--;
+		nvmap_dmabuf_stash_evict_locked(info);
+	} else {
+		/* The sgt could not be stashed at map time, drop it now. */
+		__nvmap_dmabuf_unmap_sgt(info, attach->dev, dir, sgt);
+	}
+
 #ifdef NVMAP_CONFIG_DEBUG_MAPS
 	/* Remove the device name from the list of carveout accessing devices */
 	heap_type = info->handle->heap_type;
@@ -287,7 +419,7 @@ static void nvmap_dmabuf_unmap_dma_buf(struct dma_buf_attachment *attach,
 static void nvmap_dmabuf_release(struct dma_buf *dmabuf)
 {
 	struct nvmap_handle_info *info = dmabuf->priv;
-	struct nvmap_handle_sgt *nvmap_sgt;
+	struct nvmap_handle_sgt *nvmap_sgt, *tmp;
 
 	trace_nvmap_dmabuf_release(info->handle->owner ?
 				   info->handle->owner->name : "unknown",
@@ -295,14 +427,8 @@ static void nvmap_dmabuf_release(struct dma_buf *dmabuf)
 				   dmabuf);
 
 	mutex_lock(&info->maps_lock);
-	while (!list_empty(&info->maps)) {
-		nvmap_sgt = list_first_entry(&info->maps,
-					     struct nvmap_handle_sgt,
-					     maps_entry);
-		__nvmap_dmabuf_unmap_dma_buf(nvmap_sgt);
-		list_del(&nvmap_sgt->maps_entry);
-		kmem_cache_free(handle_sgt_cache, nvmap_sgt);
-	}
+	list_for_each_entry_safe(nvmap_sgt, tmp, &info->maps_lru, lru_entry)
+		nvmap_dmabuf_stash_free_locked(nvmap_sgt);
 	mutex_unlock(&info->maps_lock);
 
 	mutex_lock(&info->handle->lock);
@@ -466,6 +592,7 @@ int __nvmap_map(struct nvmap_handle *h, struct vm_area_struct *vma)
 	vma->vm_private_data = priv;
 	vma->vm_page_prot = nvmap_pgprot(h, vma->vm_page_prot);
 	nvmap_vma_open(vma);
+	nvmap_vma_prefault(vma);
 	return 0;
 }
 
@@ -615,7 +742,8 @@ struct dma_buf *__nvmap_make_dmabuf(struct nvmap_client *client,
 	}
 	info->handle = handle;
 	info->is_ro = ro_buf;
-	INIT_LIST_HEAD(&info->maps);
+	hash_init(info->maps);
+	INIT_LIST_HEAD(&info->maps_lru);
 	mutex_init(&info->maps_lock);
 
 	dmabuf = __dma_buf_export(info, handle->size, ro_buf);
@@ -7,9 +7,15 @@
 
 #include <trace/events/nvmap.h>
 #include <linux/highmem.h>
+#include <linux/log2.h>
+#include <linux/moduleparam.h>
 
 #include "nvmap_priv.h"
 
+#if defined(NV_LINUX_PFN_T_H_PRESENT)
+#include <linux/pfn_t.h>
+#endif
+
 static void nvmap_vma_close(struct vm_area_struct *vma);
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
@@ -21,10 +27,41 @@ static int nvmap_vma_fault(struct vm_fault *vmf);
 static int nvmap_vma_fault(struct vm_area_struct *vma, struct vm_fault *vmf);
 #endif
 
+#if defined(CONFIG_TRANSPARENT_HUGEPAGE) && \
+	LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+#define NVMAP_HUGE_FAULT
+#if defined(NV_VM_OPERATIONS_STRUCT_HUGE_FAULT_HAS_ORDER_ARG) /* Linux v6.6 */
+static vm_fault_t nvmap_vma_huge_fault(struct vm_fault *vmf,
+				       unsigned int order);
+#else
+static vm_fault_t nvmap_vma_huge_fault(struct vm_fault *vmf,
+				       enum page_entry_size pe_size);
+#endif
+#endif
+
+/*
+ * Carveout memory without struct pages is mapped with raw PFNs. It is
+ * physically contiguous, so each fault populates a naturally aligned window
+ * of fault_around_pages around the faulting address instead of one page.
+ */
+static unsigned int fault_around_pages = 16;
+module_param(fault_around_pages, uint, 0644);
+
+/*
+ * Populate PFN mappings at mmap() time instead of on fault. Mappings made
+ * with MAP_LOCKED, or after mlockall(MCL_FUTURE), are always populated;
+ * this turns it on for all of them.
+ */
+static bool prefault_carveout;
+module_param(prefault_carveout, bool, 0644);
+
 struct vm_operations_struct nvmap_vma_ops = {
 	.open		= nvmap_vma_open,
 	.close		= nvmap_vma_close,
 	.fault		= nvmap_vma_fault,
+#ifdef NVMAP_HUGE_FAULT
+	.huge_fault	= nvmap_vma_huge_fault,
+#endif
 };
 
 int is_nvmap_vma(struct vm_area_struct *vma)
@@ -166,8 +203,67 @@ static void nvmap_vma_close(struct vm_area_struct *vma)
 }
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
-static vm_fault_t nvmap_vma_fault(struct vm_fault *vmf)
 #define vm_insert_pfn vmf_insert_pfn
+#endif
+
+/*
+ * The core mm does not populate VM_PFNMAP mappings on mlock, so do it here
+ * for MAP_LOCKED mappings. PTEs are inserted one by one rather than with
+ * remap_pfn_range(), which would rewrite vm_pgoff of a COW mapping and the
+ * VMA flags the fault handler relies on.
+ */
+void nvmap_vma_prefault(struct vm_area_struct *vma)
+{
+	struct nvmap_vma_priv *priv = vma->vm_private_data;
+	struct nvmap_handle *h = priv->handle;
+	unsigned long offs, pfn, addr, size = vma->vm_end - vma->vm_start;
+
+	if (!prefault_carveout && !(vma->vm_flags & VM_LOCKED))
+		return;
+
+	if (!h->alloc || h->heap_pgalloc)
+		return;
+
+	offs = priv->offs + (vma->vm_pgoff << PAGE_SHIFT);
+	if (offs >= h->size || size > h->size - offs)
+		return;
+
+	pfn = (h->carveout->base + offs) >> PAGE_SHIFT;
+	/* CMA backed carveouts have struct pages and take the fault path */
+	if (pfn_valid(pfn))
+		return;
+
+	for (addr = vma->vm_start; addr < vma->vm_end; addr += PAGE_SIZE, pfn++)
+		vm_insert_pfn(vma, addr, pfn);
+}
+
+/*
+ * Map the pages of a PFN-mapped carveout handle around @addr. @offs is the
+ * handle offset of @addr. The window is clipped to both the VMA and the
+ * handle; PTEs that are already present are left alone.
+ */
+static void nvmap_fault_around_pfn(struct vm_area_struct *vma,
+				   struct nvmap_handle *h,
+				   unsigned long addr, unsigned long offs)
+{
+	unsigned long nr = max(fault_around_pages, 1U);
+	unsigned long start, end, pfn;
+
+	nr = rounddown_pow_of_two(nr);
+	addr &= PAGE_MASK;
+	offs &= PAGE_MASK;
+
+	start = max(ALIGN_DOWN(addr, nr << PAGE_SHIFT), vma->vm_start);
+	end = min(start + (nr << PAGE_SHIFT), vma->vm_end);
+	end = min(end, addr + (h->size - offs));
+
+	pfn = (h->carveout->base + offs - (addr - start)) >> PAGE_SHIFT;
+	for (; start < end; start += PAGE_SIZE, pfn++)
+		vm_insert_pfn(vma, start, pfn);
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
+static vm_fault_t nvmap_vma_fault(struct vm_fault *vmf)
 #elif LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
 static int nvmap_vma_fault(struct vm_fault *vmf)
 #else
@@ -203,8 +299,8 @@ static int nvmap_vma_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 		BUG_ON(priv->handle->carveout->base & ~PAGE_MASK);
 		pfn = ((priv->handle->carveout->base + offs) >> PAGE_SHIFT);
 		if (!pfn_valid(pfn)) {
-			vm_insert_pfn(vma,
-				(unsigned long)vmf_address, pfn);
+			nvmap_fault_around_pfn(vma, priv->handle,
+				(unsigned long)vmf_address, offs);
 			return VM_FAULT_NOPAGE;
 		}
 		/* CMA memory would get here */
@@ -262,3 +358,57 @@ finish:
 	vmf->page = page;
 	return (page) ? 0 : VM_FAULT_SIGBUS;
 }
+
+#ifdef NVMAP_HUGE_FAULT
+/*
+ * Map a PMD at once where the VMA, the handle and the carveout are all PMD
+ * aligned. Everything else falls back to nvmap_vma_fault().
+ */
+#if defined(NV_VM_OPERATIONS_STRUCT_HUGE_FAULT_HAS_ORDER_ARG) /* Linux v6.6 */
+static vm_fault_t nvmap_vma_huge_fault(struct vm_fault *vmf,
+				       unsigned int order)
+#else
+static vm_fault_t nvmap_vma_huge_fault(struct vm_fault *vmf,
+				       enum page_entry_size pe_size)
+#endif
+{
+	struct vm_area_struct *vma = vmf->vma;
+	struct nvmap_vma_priv *priv = vma->vm_private_data;
+	unsigned long addr = vmf->address & PMD_MASK;
+	struct nvmap_handle *h;
+	unsigned long offs, pfn;
+
+#if defined(NV_VM_OPERATIONS_STRUCT_HUGE_FAULT_HAS_ORDER_ARG)
+	if (order != PMD_SHIFT - PAGE_SHIFT)
+#else
+	if (pe_size != PE_SIZE_PMD)
+#endif
+		return VM_FAULT_FALLBACK;
+
+	if (!priv || !priv->handle || !priv->handle->alloc)
+		return VM_FAULT_FALLBACK;
+
+	h = priv->handle;
+	if (h->heap_pgalloc)
+		return VM_FAULT_FALLBACK;
+
+	if (addr < vma->vm_start || addr + PMD_SIZE > vma->vm_end)
+		return VM_FAULT_FALLBACK;
+
+	offs = priv->offs + (vma->vm_pgoff << PAGE_SHIFT) +
+		(addr - vma->vm_start);
+	if (offs >= h->size || PMD_SIZE > h->size - offs)
+		return VM_FAULT_FALLBACK;
+
+	pfn = (h->carveout->base + offs) >> PAGE_SHIFT;
+	if (!IS_ALIGNED(pfn, PMD_SIZE >> PAGE_SHIFT) || pfn_valid(pfn))
+		return VM_FAULT_FALLBACK;
+
+#if defined(NV_LINUX_PFN_T_H_PRESENT)
+	return vmf_insert_pfn_pmd(vmf, pfn_to_pfn_t(pfn),
+				  vmf->flags & FAULT_FLAG_WRITE);
+#else
+	return vmf_insert_pfn_pmd(vmf, pfn, vmf->flags & FAULT_FLAG_WRITE);
+#endif
+}
+#endif
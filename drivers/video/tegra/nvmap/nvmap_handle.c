@@ -58,46 +58,37 @@ struct nvmap_handle_ref *__nvmap_validate_locked(struct nvmap_client *c,
 
 	return NULL;
 }
-/* adds a newly-created handle to the device master tree */
+/* adds a newly-created handle to the device master hash */
 void nvmap_handle_add(struct nvmap_device *dev, struct nvmap_handle *h)
 {
-	struct rb_node **p;
-	struct rb_node *parent = NULL;
+	u32 bkt = nvmap_handle_bucket(h);
+	spinlock_t *lock = nvmap_handle_shard_lock(dev, bkt);
 
-	spin_lock(&dev->handle_lock);
-	p = &dev->handles.rb_node;
-	while (*p) {
-		struct nvmap_handle *b;
-
-		parent = *p;
-		b = rb_entry(parent, struct nvmap_handle, node);
-		if (h > b)
-			p = &parent->rb_right;
-		else
-			p = &parent->rb_left;
-	}
-	rb_link_node(&h->node, parent, p);
-	rb_insert_color(&h->node, &dev->handles);
-	nvmap_lru_add(h);
 	/*
-	 * Set handle's serial_id to global serial id counter and then update the counter.
-	 * This operation is done here, so as to protect from concurrency issue, as we take
-	 * lock on handle_lock.
+	 * Set handle's serial_id from the global serial id counter. The
+	 * counter is atomic so that handles hashed to different lock shards
+	 * still get unique ids.
 	 */
-	h->serial_id = dev->serial_id_counter++;
-	spin_unlock(&dev->handle_lock);
+	h->serial_id = atomic64_inc_return(&dev->serial_id_counter) - 1;
+
+	spin_lock(lock);
+	hlist_add_head_rcu(&h->node, &dev->handles[bkt]);
+	nvmap_lru_add(h);
+	spin_unlock(lock);
 }
 
-/* remove a handle from the device's tree of all handles; called
+/* remove a handle from the device's hash of all handles; called
  * when freeing handles. */
 int nvmap_handle_remove(struct nvmap_device *dev, struct nvmap_handle *h)
 {
-	spin_lock(&dev->handle_lock);
+	spinlock_t *lock = nvmap_handle_shard_lock(dev, nvmap_handle_bucket(h));
+
+	spin_lock(lock);
 
 	/* re-test inside the spinlock if the handle really has no clients;
 	 * only remove the handle if it is unreferenced */
 	if (atomic_add_return(0, &h->ref) > 0) {
-		spin_unlock(&dev->handle_lock);
+		spin_unlock(lock);
 		return -EBUSY;
 	}
 	smp_rmb();
@@ -105,36 +96,35 @@ int nvmap_handle_remove(struct nvmap_device *dev, struct nvmap_handle *h)
 	BUG_ON(atomic_read(&h->pin) != 0);
 
 	nvmap_lru_del(h);
-	rb_erase(&h->node, &dev->handles);
+	hlist_del_rcu(&h->node);
 
-	spin_unlock(&dev->handle_lock);
+	spin_unlock(lock);
 	return 0;
 }
 
-/* Validates that a handle is in the device master tree and that the
- * client has permission to access it. */
+/* Validates that a handle is in the device master hash and takes a
+ * reference on it. The lookup is lockless: handles are freed only after
+ * an RCU grace period, and a handle whose last reference is already gone
+ * is never revived. */
 struct nvmap_handle *nvmap_validate_get(struct nvmap_handle *id)
 {
-	struct nvmap_handle *h = NULL;
-	struct rb_node *n;
-
-	spin_lock(&nvmap_dev->handle_lock);
+	struct nvmap_handle *h;
+	u32 bkt = nvmap_handle_bucket(id);
 
-	n = nvmap_dev->handles.rb_node;
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(h, &nvmap_dev->handles[bkt], node) {
+		if (h != id)
+			continue;
 
-	while (n) {
-		h = rb_entry(n, struct nvmap_handle, node);
-		if (h == id) {
-			h = nvmap_handle_get(h);
-			spin_unlock(&nvmap_dev->handle_lock);
-			return h;
-		}
-		if (id > h)
-			n = n->rb_right;
+		if (!atomic_inc_not_zero(&h->ref))
+			h = NULL;
 		else
-			n = n->rb_left;
+			NVMAP_TAG_TRACE(trace_nvmap_handle_get, h,
+					atomic_read(&h->ref));
+		rcu_read_unlock();
+		return h;
 	}
-	spin_unlock(&nvmap_dev->handle_lock);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -290,28 +280,29 @@ struct nvmap_handle_ref *nvmap_try_duplicate_by_ivmid(
 {
 	struct nvmap_handle *h = NULL;
 	struct nvmap_handle_ref *ref = NULL;
-	struct rb_node *n;
+	unsigned int shard, bkt;
 
-	spin_lock(&nvmap_dev->handle_lock);
+	for (shard = 0; shard < NVMAP_HANDLE_LOCK_SHARDS; shard++) {
+		spin_lock(&nvmap_dev->handle_lock[shard]);
+		nvmap_for_each_handle_in_shard(nvmap_dev, h, shard, bkt) {
+			if (h->ivm_id != ivm_id)
+				continue;
 
-	n = nvmap_dev->handles.rb_node;
-	for (n = rb_first(&nvmap_dev->handles); n; n = rb_next(n)) {
-		h = rb_entry(n, struct nvmap_handle, node);
-		if (h->ivm_id == ivm_id) {
 			BUG_ON(!virt_addr_valid(h));
 			/* get handle's ref only if non-zero */
 			if (atomic_inc_not_zero(&h->ref) == 0) {
 				*block = h->carveout;
 				/* strip handle's block and fail duplication */
 				h->carveout = NULL;
-				break;
+				spin_unlock(&nvmap_dev->handle_lock[shard]);
+				goto finish;
 			}
-			spin_unlock(&nvmap_dev->handle_lock);
+			spin_unlock(&nvmap_dev->handle_lock[shard]);
 			goto found;
 		}
+		spin_unlock(&nvmap_dev->handle_lock[shard]);
 	}
 
-	spin_unlock(&nvmap_dev->handle_lock);
 	/* handle is either freed or being freed, don't duplicate it */
 	goto finish;
 
@@ -19,6 +19,9 @@
 #include <linux/freezer.h>
 #include <linux/highmem.h>
 #include <linux/version.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
 #include <linux/sched/clock.h>
@@ -31,11 +34,20 @@
 
 #define NVMAP_TEST_PAGE_POOL_SHRINKER     1
 #define PENDING_PAGES_SIZE                (SZ_1M / PAGE_SIZE)
+#define NVMAP_PP_MAX_ZERO_THREADS         4
 
 static bool enable_pp = 1;
 static u32 pool_size;
 
-static struct task_struct *background_allocator;
+struct nvmap_pp_zero_thread {
+	struct task_struct *task;
+	unsigned int id;
+	/* Pages to be zeroed in a batch, too big for the stack */
+	struct page *pending[PENDING_PAGES_SIZE];
+};
+
+static struct nvmap_pp_zero_thread *zero_threads;
+static unsigned int nr_zero_threads;
 static DECLARE_WAIT_QUEUE_HEAD(nvmap_bg_wait);
 
 #ifdef NVMAP_CONFIG_PAGE_POOL_DEBUG
@@ -139,9 +151,18 @@ exit:
 }
 #endif /* CONFIG_ARM64_4K_PAGES */
 
-static inline bool nvmap_bg_should_run(struct nvmap_page_pool *pool)
+/*
+ * Zeroing thread 0 drains the zero list on its own. Every further thread only
+ * joins in once another full batch of pages is waiting, so the number of
+ * threads zeroing at once follows the pressure on the pool.
+ */
+static inline bool nvmap_bg_should_run(struct nvmap_page_pool *pool,
+				       unsigned int id)
 {
-	return !list_empty(&pool->zero_list);
+	if (!id)
+		return !list_empty(&pool->zero_list);
+
+	return READ_ONCE(pool->to_zero) > id * PENDING_PAGES_SIZE;
 }
 
 static void nvmap_pp_zero_pages(struct page **pages, int nr)
@@ -156,16 +177,12 @@ static void nvmap_pp_zero_pages(struct page **pages, int nr)
 	trace_nvmap_pp_zero_pages(nr);
 }
 
-static void nvmap_pp_do_background_zero_pages(struct nvmap_page_pool *pool)
+static void nvmap_pp_do_background_zero_pages(struct nvmap_page_pool *pool,
+					      struct page **pending_zero_pages)
 {
 	int i;
 	struct page *page;
 	int ret;
-	/*
-	 * Statically declared array of pages to be zeroed in a batch,
-	 * local to this thread but too big for the stack.
-	 */
-	static struct page *pending_zero_pages[PENDING_PAGES_SIZE];
 
 	rt_mutex_lock(&pool->lock);
 	for (i = 0; i < PENDING_PAGES_SIZE; i++) {
@@ -200,12 +217,13 @@ static void nvmap_pp_do_background_zero_pages(struct nvmap_page_pool *pool)
  */
 static int nvmap_background_zero_thread(void *arg)
 {
+	struct nvmap_pp_zero_thread *zt = arg;
 	struct nvmap_page_pool *pool = &nvmap_dev->pool;
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 9, 0)
 	struct sched_param param = { .sched_priority = 0 };
 #endif
 
-	pr_info("PP zeroing thread starting.\n");
+	pr_info("PP zeroing thread %u starting.\n", zt->id);
 
 	set_freezable();
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 9, 0)
@@ -215,11 +233,11 @@ static int nvmap_background_zero_thread(void *arg)
 #endif
 
 	while (!kthread_should_stop()) {
-		while (nvmap_bg_should_run(pool))
-			nvmap_pp_do_background_zero_pages(pool);
+		while (nvmap_bg_should_run(pool, zt->id))
+			nvmap_pp_do_background_zero_pages(pool, zt->pending);
 
 		wait_event_freezable(nvmap_bg_wait,
-				nvmap_bg_should_run(pool) ||
+				nvmap_bg_should_run(pool, zt->id) ||
 				kthread_should_stop());
 	}
 
@@ -233,6 +251,127 @@ static void nvmap_pgcount(struct page *page, bool incr)
 }
 #endif /* NVMAP_CONFIG_PAGE_POOL_DEBUG */
 
+/*
+ * Serve as many of @nr pages as possible from this CPU's magazine. Magazines
+ * only hold pages from the node of the CPUs they belong to, so a request for
+ * a specific remote node skips them and is counted as a miss.
+ *
+ * Only migration is disabled while the magazine is used: its lock is a
+ * sleeping lock on PREEMPT_RT and must not be taken with preemption off.
+ */
+static u32 nvmap_pp_mag_alloc(struct nvmap_page_pool *pool,
+			      struct page **pages, u32 nr,
+			      bool use_numa, int numa_id)
+{
+	struct nvmap_pp_magazine *mag;
+	bool remote;
+	u32 ind = 0;
+
+	migrate_disable();
+	mag = this_cpu_ptr(pool->mags);
+	remote = use_numa && numa_id != NUMA_NO_NODE &&
+		 numa_id != numa_mem_id();
+
+	spin_lock(&mag->lock);
+	while (!remote && ind < nr && mag->count)
+		pages[ind++] = mag->pages[--mag->count];
+	mag->hits += ind;
+	mag->misses += nr - ind;
+	spin_unlock(&mag->lock);
+	migrate_enable();
+
+	if (ind)
+		atomic_sub(ind, &pool->mag_count);
+
+	return ind;
+}
+
+/*
+ * Take a batch of zeroed pages off the page list for a magazine refill. The
+ * pages stay accounted to the pool through mag_count.
+ *
+ * You must lock the page pool before using this.
+ */
+static u32 nvmap_pp_mag_take_locked(struct nvmap_page_pool *pool,
+				    struct page **pages)
+{
+	bool use_numa = num_online_nodes() > 1;
+	u32 i;
+
+	for (i = 0; i < NVMAP_PP_MAG_BATCH; i++) {
+		pages[i] = get_page_list_page(pool, use_numa, NUMA_NO_NODE);
+		if (!pages[i])
+			break;
+#ifdef NVMAP_CONFIG_PAGE_POOL_DEBUG
+		nvmap_pgcount(pages[i], false);
+#endif /* NVMAP_CONFIG_PAGE_POOL_DEBUG */
+	}
+
+	atomic_add(i, &pool->mag_count);
+	return i;
+}
+
+static void nvmap_pp_mag_refill(struct nvmap_page_pool *pool,
+				struct page **pages, u32 nr)
+{
+	struct nvmap_pp_magazine *mag;
+	u32 n, ret;
+
+	migrate_disable();
+	mag = this_cpu_ptr(pool->mags);
+	spin_lock(&mag->lock);
+	n = min_t(u32, nr, NVMAP_PP_MAG_SIZE - mag->count);
+	memcpy(&mag->pages[mag->count], pages, n * sizeof(*pages));
+	mag->count += n;
+	spin_unlock(&mag->lock);
+	migrate_enable();
+
+	if (n == nr)
+		return;
+
+	/* Raced with another refill of this magazine, return the rest. */
+	rt_mutex_lock(&pool->lock);
+	atomic_sub(nr - n, &pool->mag_count);
+	ret = n + __nvmap_page_pool_fill_lots_locked(pool, &pages[n], nr - n);
+	rt_mutex_unlock(&pool->lock);
+
+	for (; ret < nr; ret++)
+		__free_page(pages[ret]);
+}
+
+/*
+ * Free up to @nr_pages pages held in the per-CPU magazines back to the
+ * system. Returns the number of pages still to be released.
+ */
+static ulong nvmap_pp_mag_drain(struct nvmap_page_pool *pool, ulong nr_pages)
+{
+	int cpu;
+
+	if (!pool->mags)
+		return nr_pages;
+
+	for_each_possible_cpu(cpu) {
+		struct nvmap_pp_magazine *mag = per_cpu_ptr(pool->mags, cpu);
+		struct page *page;
+
+		while (nr_pages) {
+			spin_lock(&mag->lock);
+			if (!mag->count) {
+				spin_unlock(&mag->lock);
+				break;
+			}
+			page = mag->pages[--mag->count];
+			spin_unlock(&mag->lock);
+
+			atomic_dec(&pool->mag_count);
+			__free_page(page);
+			nr_pages--;
+		}
+	}
+
+	return nr_pages;
+}
+
 /*
  * Free the passed number of pages from the page pool. This happens regardless
  * of whether the page pools are enabled. This lets one disable the page pools
@@ -298,6 +437,8 @@ static ulong nvmap_page_pool_free_pages_locked(struct nvmap_page_pool *pool,
 #endif /* CONFIG_ARM64_4K_PAGES */
 	}
 
+	nr_pages = nvmap_pp_mag_drain(pool, nr_pages);
+
 	pr_debug("remaining pages to release=%ld\n", nr_pages);
 	return nr_pages;
 }
@@ -311,13 +452,19 @@ int nvmap_page_pool_alloc_lots(struct nvmap_page_pool *pool,
 				struct page **pages, u32 nr,
 				bool use_numa, int numa_id)
 {
-	u32 ind = 0;
+	struct page *refill[NVMAP_PP_MAG_BATCH];
+	u32 nr_refill = 0;
+	u32 ind;
 	u32 non_zero_idx;
 	u32 non_zero_cnt = 0;
 
 	if (!enable_pp || !nr)
 		return 0;
 
+	ind = nvmap_pp_mag_alloc(pool, pages, nr, use_numa, numa_id);
+	if (ind == nr)
+		goto out;
+
 	rt_mutex_lock(&pool->lock);
 
 	while (ind < nr) {
@@ -342,12 +489,21 @@ int nvmap_page_pool_alloc_lots(struct nvmap_page_pool *pool,
 #endif /* NVMAP_CONFIG_PAGE_POOL_DEBUG */
 	}
 
+	/* Top up this CPU's magazine while the pool lock is held anyway. */
+	if (ind == nr && (!use_numa || numa_id == NUMA_NO_NODE) &&
+	    READ_ONCE(raw_cpu_ptr(pool->mags)->count) < NVMAP_PP_MAG_BATCH)
+		nr_refill = nvmap_pp_mag_take_locked(pool, refill);
+
 	rt_mutex_unlock(&pool->lock);
 
+	if (nr_refill)
+		nvmap_pp_mag_refill(pool, refill, nr_refill);
+
 	/* Zero non-zeroed pages, if any */
 	if (non_zero_cnt)
 		nvmap_pp_zero_pages(&pages[non_zero_idx], non_zero_cnt);
 
+out:
 	pp_alloc_add(pool, ind);
 	pp_hit_add(pool, ind);
 	pp_miss_add(pool, nr - ind);
@@ -426,12 +582,16 @@ static int __nvmap_page_pool_fill_lots_locked(struct nvmap_page_pool *pool,
 	int real_nr;
 	int pages_to_fill;
 	int ind = 0;
+	u32 used;
 
 	if (!enable_pp)
 		return 0;
 
 	BUG_ON(pool->count > pool->max);
-	real_nr = min_t(u32, pool->max - pool->count, nr);
+	used = pool->count + atomic_read(&pool->mag_count);
+	if (used >= pool->max)
+		return 0;
+	real_nr = min_t(u32, pool->max - used, nr);
 	pages_to_fill = real_nr;
 	if (real_nr == 0)
 		return 0;
@@ -470,12 +630,15 @@ u32 nvmap_page_pool_fill_lots(struct nvmap_page_pool *pool,
 	u32 ret = 0;
 	u32 i;
 	u32 save_to_zero;
+	u32 used;
 
 	rt_mutex_lock(&pool->lock);
 
 	save_to_zero = pool->to_zero;
 
-	ret = min(nr, pool->max - pool->count - pool->to_zero - pool->under_zero);
+	used = pool->count + pool->to_zero + pool->under_zero +
+	       atomic_read(&pool->mag_count);
+	ret = used < pool->max ? min(nr, pool->max - used) : 0;
 
 	for (i = 0; i < ret; i++) {
 		/* If page has additonal referecnces, Don't add it into
@@ -510,7 +673,8 @@ ulong nvmap_page_pool_get_unused_pages(void)
 	if (!nvmap_dev)
 		return 0;
 
-	total = nvmap_dev->pool.count + nvmap_dev->pool.to_zero;
+	total = nvmap_dev->pool.count + nvmap_dev->pool.to_zero +
+		atomic_read(&nvmap_dev->pool.mag_count);
 
 	return total;
 }
@@ -525,7 +689,8 @@ int nvmap_page_pool_clear(void)
 
 	rt_mutex_lock(&pool->lock);
 
-	(void)nvmap_page_pool_free_pages_locked(pool, pool->count + pool->to_zero);
+	(void)nvmap_page_pool_free_pages_locked(pool, pool->count + pool->to_zero +
+						atomic_read(&pool->mag_count));
 
 	/* For some reason, if an error occured... */
 	if (!list_empty(&pool->page_list) || !list_empty(&pool->zero_list)) {
@@ -688,6 +853,46 @@ static struct kernel_param_ops pool_size_ops = {
 
 module_param_cb(pool_size, &pool_size_ops, &pool_size, 0644);
 
+static int nvmap_pp_magazines_show(struct seq_file *s, void *unused)
+{
+	struct nvmap_page_pool *pool = s->private;
+	int cpu;
+
+	seq_printf(s, "%-4s %6s %16s %16s %5s\n",
+		   "cpu", "pages", "hits", "misses", "hit%");
+
+	for_each_possible_cpu(cpu) {
+		struct nvmap_pp_magazine *mag = per_cpu_ptr(pool->mags, cpu);
+		u64 hits, misses;
+		u32 count;
+
+		spin_lock(&mag->lock);
+		count = mag->count;
+		hits = mag->hits;
+		misses = mag->misses;
+		spin_unlock(&mag->lock);
+
+		seq_printf(s, "%-4d %6u %16llu %16llu %5llu\n", cpu, count,
+			   hits, misses,
+			   hits + misses ?
+			   div64_u64(hits * 100, hits + misses) : 0);
+	}
+
+	return 0;
+}
+
+static int nvmap_pp_magazines_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, nvmap_pp_magazines_show, inode->i_private);
+}
+
+static const struct file_operations nvmap_pp_magazines_fops = {
+	.open = nvmap_pp_magazines_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 int nvmap_page_pool_debugfs_init(struct dentry *nvmap_root)
 {
 	struct dentry *pp_root;
@@ -719,6 +924,8 @@ int nvmap_page_pool_debugfs_init(struct dentry *nvmap_root)
 	debugfs_create_u64("total_page_allocs",
 			   S_IRUGO, pp_root,
 			   &nvmap_total_page_allocs);
+	debugfs_create_file("magazines", S_IRUGO, pp_root,
+			    &nvmap_dev->pool, &nvmap_pp_magazines_fops);
 
 #ifdef NVMAP_CONFIG_PAGE_POOL_DEBUG
 	debugfs_create_u64("page_pool_allocs",
@@ -742,6 +949,8 @@ int nvmap_page_pool_init(struct nvmap_device *dev)
 {
 	struct sysinfo info;
 	struct nvmap_page_pool *pool = &dev->pool;
+	unsigned int i;
+	int cpu;
 
 	memset(pool, 0x0, sizeof(*pool));
 	rt_mutex_init(&pool->lock);
@@ -771,10 +980,38 @@ int nvmap_page_pool_init(struct nvmap_device *dev)
 	pr_info("nvmap page pool size: %u pages (%u MB)\n", pool->max,
 		(pool->max * info.mem_unit) >> 20);
 
-	background_allocator = kthread_run(nvmap_background_zero_thread,
-					    NULL, "nvmap-bz");
-	if (IS_ERR(background_allocator))
+	pool->mags = alloc_percpu(struct nvmap_pp_magazine);
+	if (!pool->mags)
+		goto fail;
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(pool->mags, cpu)->lock);
+
+	nr_zero_threads = clamp(num_online_cpus() / 2, 1U,
+				(unsigned int)NVMAP_PP_MAX_ZERO_THREADS);
+	zero_threads = kcalloc(nr_zero_threads, sizeof(*zero_threads),
+			       GFP_KERNEL);
+	if (!zero_threads)
 		goto fail;
+
+	for (i = 0; i < nr_zero_threads; i++) {
+		struct task_struct *task;
+
+		zero_threads[i].id = i;
+		if (i)
+			task = kthread_run(nvmap_background_zero_thread,
+					   &zero_threads[i], "nvmap-bz/%u", i);
+		else
+			task = kthread_run(nvmap_background_zero_thread,
+					   &zero_threads[i], "nvmap-bz");
+		if (IS_ERR(task)) {
+			/* Only the first zeroing thread is mandatory */
+			if (!i)
+				goto fail;
+			nr_zero_threads = i;
+			break;
+		}
+		zero_threads[i].task = task;
+	}
 #if defined(NV_SHRINKER_ALLOC_PRESENT) /* Linux 6.7 */
 	nvmap_page_pool_shrinker = shrinker_alloc(0, "nvmap_pp_shrinker");
 	if (!nvmap_page_pool_shrinker) {
@@ -803,21 +1040,31 @@ fail:
 int nvmap_page_pool_fini(struct nvmap_device *dev)
 {
 	struct nvmap_page_pool *pool = &dev->pool;
+	unsigned int i;
 
 	/*
 	 * if background allocator is not initialzed or not
 	 * properly initialized, then shrinker is also not
 	 * registered
 	 */
-	if (!IS_ERR_OR_NULL(background_allocator)) {
+	if (zero_threads && zero_threads[0].task) {
 #if defined(NV_SHRINKER_ALLOC_PRESENT) /* Linux 6.7 */
 		shrinker_free(nvmap_page_pool_shrinker);
 		nvmap_page_pool_shrinker = NULL;
 #else
 		unregister_shrinker(&nvmap_page_pool_shrinker);
 #endif
-		kthread_stop(background_allocator);
-		background_allocator = NULL;
+		for (i = 0; i < nr_zero_threads; i++)
+			kthread_stop(zero_threads[i].task);
+	}
+	kfree(zero_threads);
+	zero_threads = NULL;
+	nr_zero_threads = 0;
+
+	if (pool->mags) {
+		nvmap_pp_mag_drain(pool, ULONG_MAX);
+		free_percpu(pool->mags);
+		pool->mags = NULL;
 	}
 
 	WARN_ON(!list_empty(&pool->page_list));
@@ -15,6 +15,7 @@
 #include <linux/mutex.h>
 #include <linux/rtmutex.h>
 #include <linux/rbtree.h>
+#include <linux/hashtable.h>
 #include <linux/sched.h>
 #include <linux/wait.h>
 #include <linux/atomic.h>
@@ -223,7 +224,8 @@ struct nvmap_handle_dmabuf_priv {
 };
 
 struct nvmap_handle {
-	struct rb_node node;	/* entry on global handle tree */
+	struct hlist_node node;	/* entry on global handle hash */
+	struct rcu_head rcu;
 	atomic_t ref;		/* reference count (i.e., # of duplications) */
 	atomic_t pin;		/* pin count */
 	u32 flags;		/* caching flags */
@@ -273,9 +275,14 @@ struct nvmap_handle {
 	u64 serial_id;
 };
 
+#define NVMAP_SGT_STASH_HASH_BITS	4
+
 struct nvmap_handle_info {
 	struct nvmap_handle *handle;
-	struct list_head maps;
+	/* stashed sg tables, hashed on (device, direction) */
+	DECLARE_HASHTABLE(maps, NVMAP_SGT_STASH_HASH_BITS);
+	struct list_head maps_lru;	/* most recently used first */
+	unsigned int nr_maps;
 	struct mutex maps_lock;
 	bool is_ro;
 };
@@ -309,12 +316,31 @@ struct nvmap_handle_ref {
 #ifdef CONFIG_ARM64_4K_PAGES
 #define NVMAP_PP_BIG_PAGE_SIZE           (0x10000)
 #endif /* CONFIG_ARM64_4K_PAGES */
+
+/*
+ * Per-CPU cache of zeroed pages in front of the page pool. Allocations are
+ * served from the local magazine without touching the pool lock; magazines
+ * are refilled from the page list in batches.
+ */
+#define NVMAP_PP_MAG_SIZE                (64)
+#define NVMAP_PP_MAG_BATCH               (32)
+
+struct nvmap_pp_magazine {
+	spinlock_t lock;
+	u32 count;
+	struct page *pages[NVMAP_PP_MAG_SIZE];
+	u64 hits;       /* Pages served from this magazine */
+	u64 misses;     /* Pages this CPU had to take from the pool */
+};
+
 struct nvmap_page_pool {
 	struct rt_mutex lock;
 	u32 count;      /* Number of pages in the page & dirty list. */
 	u32 max;        /* Max no. of pages in all lists. */
 	u32 to_zero;    /* Number of pages on the zero list */
 	u32 under_zero; /* Number of pages getting zeroed */
+	atomic_t mag_count; /* Number of pages held in per-CPU magazines */
+	struct nvmap_pp_magazine __percpu *mags;
 #ifdef CONFIG_ARM64_4K_PAGES
 	u32 big_pg_sz;  /* big page size supported(64k, etc.) */
 	u32 big_page_count;   /* Number of zeroed big pages avaialble */
@@ -379,9 +405,13 @@ struct nvmap_vma_priv {
 	atomic_t	count;	/* number of processes cloning the VMA */
 };
 
+#define NVMAP_HANDLE_HASH_BITS		10
+#define NVMAP_HANDLE_LOCK_SHARDS	16
+
 struct nvmap_device {
-	struct rb_root	handles;
-	spinlock_t	handle_lock;
+	/* all handles; RCU for lookups, sharded locks for updates */
+	struct hlist_head handles[1 << NVMAP_HANDLE_HASH_BITS];
+	spinlock_t	handle_lock[NVMAP_HANDLE_LOCK_SHARDS];
 	struct miscdevice dev_user;
 	struct nvmap_carveout_node *heaps;
 	int nr_heaps;
@@ -407,7 +437,7 @@ struct nvmap_device {
 #endif /* NVMAP_CONFIG_DEBUG_MAPS */
 	/* Perform cache flush at buffer allocation from carveout */
 	bool co_cache_flush_at_alloc;
-	u64 serial_id_counter; /* This is global counter common across different client processes */
+	atomic64_t serial_id_counter; /* This is global counter common across different client processes */
 };
 
 struct handles_range {
@@ -421,6 +451,26 @@ struct handles_range {
 extern struct nvmap_device *nvmap_dev;
 extern ulong nvmap_init_time;
 
+static inline u32 nvmap_handle_bucket(struct nvmap_handle *h)
+{
+	return hash_ptr(h, NVMAP_HANDLE_HASH_BITS);
+}
+
+static inline spinlock_t *nvmap_handle_shard_lock(struct nvmap_device *dev,
+						  u32 bkt)
+{
+	return &dev->handle_lock[bkt & (NVMAP_HANDLE_LOCK_SHARDS - 1)];
+}
+
+/*
+ * Walk the handles hashed to lock shard @shard. The caller must hold
+ * dev->handle_lock[shard].
+ */
+#define nvmap_for_each_handle_in_shard(dev, h, shard, bkt)		\
+	for ((bkt) = (shard); (bkt) < ARRAY_SIZE((dev)->handles);	\
+	     (bkt) += NVMAP_HANDLE_LOCK_SHARDS)				\
+		hlist_for_each_entry(h, &(dev)->handles[bkt], node)
+
 static inline void nvmap_ref_lock(struct nvmap_client *priv)
 {
 	mutex_lock(&priv->ref_lock);
@@ -624,6 +674,7 @@ int __nvmap_dmabuf_fd(struct nvmap_client *client,
 
 int nvmap_dmabuf_stash_init(void);
 void nvmap_dmabuf_stash_deinit(void);
+void nvmap_dmabuf_stash_debugfs_init(struct dentry *nvmap_root);
 
 void *nvmap_altalloc(size_t len);
 void nvmap_altfree(void *ptr, size_t len);
@@ -728,6 +779,7 @@ static inline struct page **nvmap_pages(struct page **pg_pages, u32 nr_pages)
 void nvmap_zap_handle(struct nvmap_handle *handle, u64 offset, u64 size);
 
 void nvmap_vma_open(struct vm_area_struct *vma);
+void nvmap_vma_prefault(struct vm_area_struct *vma);
 
 int nvmap_reserve_pages(struct nvmap_handle **handles, u64 *offsets,
 			u64 *sizes, u32 nr, u32 op, bool is_32);
@@ -16,7 +16,9 @@
 #include <linux/slab.h>
 #include <linux/mm.h>
 #include <linux/sched.h>
+#include <linux/eventfd.h>
 #include <soc/tegra/fuse.h>
+#include <soc/tegra/ivc_ext.h>
 
 #include <uapi/linux/tegra-ivc-dev.h>
 #include "tegra_hv.h"
@@ -47,6 +49,8 @@ struct ivc_dev {
 	struct mutex		file_lock;
 	/* Bool to store whether we received any ivc interrupt */
 	bool			ivc_intr_rcvd;
+	/* Signalled on every channel notification when set */
+	struct eventfd_ctx	*eventfd;
 };
 
 static dev_t ivc_dev;
@@ -55,6 +59,53 @@ static const struct ivc_info_page *s_infop;
 static uint32_t s_guestid = INVALID_VMID;
 
 
+static void ivc_dev_signal_eventfd(struct eventfd_ctx *ctx)
+{
+#if defined(NV_EVENTFD_SIGNAL_HAS_COUNTER_ARG) /* Linux < v6.8 */
+	eventfd_signal(ctx, 1);
+#else
+	eventfd_signal(ctx);
+#endif
+}
+
+/*
+ * Frames written by the peer that have not been consumed yet. A peer that
+ * reports an over-full queue is clamped so that userspace never gets handed
+ * a range larger than the queue.
+ */
+static uint32_t ivc_dev_rx_pending(struct tegra_ivc *ivc)
+{
+	uint32_t avail;
+
+	if (!tegra_ivc_can_read(ivc))
+		return 0;
+
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	avail = tegra_ivc_frames_available(ivc, &ivc->rx.map);
+#else
+	avail = tegra_ivc_frames_available(ivc, ivc->rx.channel);
+#endif
+
+	return min(ivc->num_frames - avail, ivc->num_frames);
+}
+
+/* Frames that can be written without overrunning the peer. */
+static uint32_t ivc_dev_tx_free(struct tegra_ivc *ivc)
+{
+	uint32_t avail;
+
+	if (!tegra_ivc_can_write(ivc))
+		return 0;
+
+#if defined(NV_TEGRA_IVC_STRUCT_HAS_IOSYS_MAP)
+	avail = tegra_ivc_frames_available(ivc, &ivc->tx.map);
+#else
+	avail = tegra_ivc_frames_available(ivc, ivc->tx.channel);
+#endif
+
+	return min(avail, ivc->num_frames);
+}
+
 static irqreturn_t ivc_dev_handler(int irq, void *data)
 {
 	struct ivc_dev *ivcd = data;
@@ -63,6 +114,12 @@ static irqreturn_t ivc_dev_handler(int irq, void *data)
 
 	mutex_lock(&ivcd->file_lock);
 	ivcd->ivc_intr_rcvd = true;
+	/*
+	 * The eventfd counter accumulates until userspace reads it, so a
+	 * burst of notifications costs the consumer a single wakeup.
+	 */
+	if (ivcd->eventfd)
+		ivc_dev_signal_eventfd(ivcd->eventfd);
 	mutex_unlock(&ivcd->file_lock);
 
 	/* simple implementation, just kick all waiters */
@@ -130,6 +187,11 @@ static int ivc_dev_release(struct inode *inode, struct file *filp)
 
 	devm_free_irq(ivcd->device, ivck->irq, ivcd);
 
+	if (ivcd->eventfd) {
+		eventfd_ctx_put(ivcd->eventfd);
+		ivcd->eventfd = NULL;
+	}
+
 	ivcd->ivck = NULL;
 
 	/*
@@ -168,12 +230,18 @@ static __poll_t ivc_dev_poll(struct file *filp, poll_table *wait)
 
 	poll_wait(filp, &ivcd->wq, wait);
 
-	/* If we have rcvd ivc interrupt, inform the user */
+	/*
+	 * Readiness follows the ring state. A pending interrupt still reports
+	 * POLLIN so that NvSciIpc gets to run its reset handshake when the
+	 * peer notifies without queueing any frame.
+	 */
 	mutex_lock(&ivcd->file_lock);
-	if (ivcd->ivc_intr_rcvd == true) {
+	if (ivcd->ivc_intr_rcvd == true || ivc_dev_rx_pending(ivc) != 0) {
 		mask |= ((__force __poll_t)POLLIN) | ((__force __poll_t)POLLRDNORM);
 		ivcd->ivc_intr_rcvd = false;
 	}
+	if (ivc_dev_tx_free(ivc) != 0)
+		mask |= ((__force __poll_t)POLLOUT) | ((__force __poll_t)POLLWRNORM);
 	mutex_unlock(&ivcd->file_lock);
 	/* no exceptions */
 
@@ -236,6 +304,92 @@ static int ivc_dev_mmap(struct file *filp, struct vm_area_struct *vma)
 	return ret;
 }
 
+/*
+ * The in-place frame ioctls below hand userspace ranges of frames in the
+ * mmapped queue. Local positions are resynchronised with the shared counters
+ * first, since NvSciIpc may also have advanced them through the mapping.
+ */
+static long ivc_dev_acquire(struct ivc_dev *ivcd, unsigned int cmd,
+		struct nvipc_ivc_frames *frames)
+{
+	struct tegra_ivc *ivc = tegra_hv_ivc_convert_cookie(ivcd->ivck);
+	uint32_t count;
+	long ret;
+
+	mutex_lock(&ivcd->file_lock);
+	ret = tegra_ivc_channel_sync(ivc);
+	if (ret == 0) {
+		if (cmd == NVIPC_IVC_IOCTL_RX_ACQUIRE) {
+			count = ivc_dev_rx_pending(ivc);
+			frames->index = ivc->rx.position;
+		} else {
+			count = ivc_dev_tx_free(ivc);
+			frames->index = ivc->tx.position;
+		}
+		frames->count = min(frames->count, count);
+	}
+	mutex_unlock(&ivcd->file_lock);
+
+	return ret;
+}
+
+/*
+ * Advance the queue by a whole range at once: one counter update and at most
+ * one doorbell regardless of the number of frames.
+ */
+static long ivc_dev_commit(struct ivc_dev *ivcd, unsigned int cmd,
+		struct nvipc_ivc_frames *frames)
+{
+	struct tegra_ivc *ivc = tegra_hv_ivc_convert_cookie(ivcd->ivck);
+	bool rx = (cmd == NVIPC_IVC_IOCTL_RX_RELEASE);
+	uint32_t limit;
+	long ret = 0;
+
+	mutex_lock(&ivcd->file_lock);
+	limit = rx ? ivc_dev_rx_pending(ivc) : ivc_dev_tx_free(ivc);
+	if (frames->count > limit) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	frames->index = rx ? ivc->rx.position : ivc->tx.position;
+	if (rx)
+		ret = tegra_hv_ivc_read_advance_n(ivcd->ivck, frames->count);
+	else
+		ret = tegra_hv_ivc_write_advance_n(ivcd->ivck, frames->count);
+	/* nothing was advanced if the channel was reset in the meantime */
+	if (ret < 0)
+		frames->count = 0;
+
+unlock:
+	mutex_unlock(&ivcd->file_lock);
+
+	return ret;
+}
+
+static long ivc_dev_set_eventfd(struct ivc_dev *ivcd, int32_t fd)
+{
+	struct eventfd_ctx *ctx = NULL, *old;
+
+	if (fd >= 0) {
+		ctx = eventfd_ctx_fdget(fd);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+	} else if (fd != -1) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&ivcd->file_lock);
+	old = ivcd->eventfd;
+	ivcd->eventfd = ctx;
+	mutex_unlock(&ivcd->file_lock);
+
+	if (old)
+		eventfd_ctx_put(old);
+
+	return 0;
+}
+
 /* Need this temporarily to get the change merged. Will be removed later */
 #define NVIPC_IVC_IOCTL_GET_INFO_LEGACY 0xC018AA01
 #define NVIPC_IVC_IOCTL_NOTIFY_REMOTE_LEGACY 0xC018AA02
@@ -244,7 +398,9 @@ static long ivc_dev_ioctl(struct file *filp, unsigned int cmd,
 {
 	struct ivc_dev *ivcd = filp->private_data;
 	struct nvipc_ivc_info info;
+	struct nvipc_ivc_frames frames;
 	uint64_t ivc_area_ipa, ivc_area_size;
+	int32_t fd;
 	long ret = 0;
 
 	/* validate the cmd */
@@ -332,6 +488,36 @@ static long ivc_dev_ioctl(struct file *filp, unsigned int cmd,
 		}
 		break;
 
+	case NVIPC_IVC_IOCTL_RX_ACQUIRE:
+	case NVIPC_IVC_IOCTL_TX_ACQUIRE:
+	case NVIPC_IVC_IOCTL_RX_RELEASE:
+	case NVIPC_IVC_IOCTL_TX_SUBMIT:
+		if (copy_from_user(&frames, (void __user *) arg,
+			sizeof(frames))) {
+			ret = -EFAULT;
+			goto exit;
+		}
+
+		if (cmd == NVIPC_IVC_IOCTL_RX_ACQUIRE ||
+			cmd == NVIPC_IVC_IOCTL_TX_ACQUIRE)
+			ret = ivc_dev_acquire(ivcd, cmd, &frames);
+		else
+			ret = ivc_dev_commit(ivcd, cmd, &frames);
+
+		if (copy_to_user((void __user *) arg, &frames,
+			sizeof(frames))) {
+			ret = -EFAULT;
+		}
+		break;
+
+	case NVIPC_IVC_IOCTL_SET_EVENTFD:
+		if (copy_from_user(&fd, (void __user *) arg, sizeof(fd))) {
+			ret = -EFAULT;
+			goto exit;
+		}
+		ret = ivc_dev_set_eventfd(ivcd, fd);
+		break;
+
 	default:
 		ret = -ENOTTY;
 	}
@@ -884,6 +884,49 @@ int tegra_hv_ivc_read_advance(struct tegra_hv_ivc_cookie *ivck)
 }
 EXPORT_SYMBOL(tegra_hv_ivc_read_advance);
 
+int tegra_hv_ivc_read_advance_n(struct tegra_hv_ivc_cookie *ivck, u32 n)
+{
+	struct hv_ivc *ivc = cookie_to_ivc_dev(ivck);
+
+	return tegra_ivc_read_advance_n(&ivc->ivc, n);
+}
+EXPORT_SYMBOL(tegra_hv_ivc_read_advance_n);
+
+int tegra_hv_ivc_write_advance_n(struct tegra_hv_ivc_cookie *ivck, u32 n)
+{
+	struct hv_ivc *ivc = cookie_to_ivc_dev(ivck);
+
+	return tegra_ivc_write_advance_n(&ivc->ivc, n);
+}
+EXPORT_SYMBOL(tegra_hv_ivc_write_advance_n);
+
+int tegra_hv_ivc_read_batch(struct tegra_hv_ivc_cookie *ivck, void *buf,
+			    size_t size, u32 max)
+{
+	struct hv_ivc *ivc = cookie_to_ivc_dev(ivck);
+
+	return tegra_ivc_read_batch(&ivc->ivc, buf, size, max);
+}
+EXPORT_SYMBOL(tegra_hv_ivc_read_batch);
+
+int tegra_hv_ivc_read_peek_batch(struct tegra_hv_ivc_cookie *ivck, void *buf,
+				 size_t size, u32 max)
+{
+	struct hv_ivc *ivc = cookie_to_ivc_dev(ivck);
+
+	return tegra_ivc_read_peek_batch(&ivc->ivc, buf, size, max);
+}
+EXPORT_SYMBOL(tegra_hv_ivc_read_peek_batch);
+
+int tegra_hv_ivc_write_batch(struct tegra_hv_ivc_cookie *ivck,
+			     const void *buf, size_t size, u32 count)
+{
+	struct hv_ivc *ivc = cookie_to_ivc_dev(ivck);
+
+	return tegra_ivc_write_batch(&ivc->ivc, buf, size, count);
+}
+EXPORT_SYMBOL(tegra_hv_ivc_write_batch);
+
 struct tegra_ivc *tegra_hv_ivc_convert_cookie(struct tegra_hv_ivc_cookie *ivck)
 {
 	return &cookie_to_ivc_dev(ivck)->ivc;
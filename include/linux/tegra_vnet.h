@@ -25,6 +25,33 @@
 #define TVNET_MIN_MTU 68
 #define TVNET_MAX_MTU TVNET_DEFAULT_MTU
 
+/*
+ * RX buffers hold a full TSO frame independent of the MTU. With offloads
+ * each side keeps RING_COUNT of them posted, i.e. 256 * (64512 + ETH_HLEN),
+ * about 16 MB per direction instead of 256 * (mtu + ETH_HLEN).
+ */
+#define TVNET_RX_BUF_LEN (TVNET_MAX_MTU + ETH_HLEN)
+
+/* Offloads that need the peer to handle the full_buffer offload info */
+#define TVNET_OFFLOAD_FEATURES (NETIF_F_HW_CSUM | NETIF_F_TSO | \
+				NETIF_F_TSO6 | NETIF_F_TSO_ECN)
+
+/* Frags are carried by chained DMA descriptors, any peer can take them */
+#define TVNET_FEATURES (NETIF_F_SG | TVNET_OFFLOAD_FEATURES)
+
+/*
+ * bar_md.ep_features/host_features: capabilities of each side. Only valid
+ * if bar_md.features_magic is TVNET_FEATURES_MAGIC, an EP that predates
+ * them leaves whatever was in BAR0 there.
+ */
+#define TVNET_FEATURES_MAGIC		0x54564654	/* "TVFT" */
+/* Offload info in full_buffer msgs is filled in and honoured */
+#define TVNET_FEATURE_OFFLOAD		BIT(0)
+#define TVNET_SUPPORTED_FEATURES	TVNET_FEATURE_OFFLOAD
+
+/* Linear part plus one descriptor per frag */
+#define TVNET_MAX_SKB_SEGS (MAX_SKB_FRAGS + 1)
+
 #define TVNET_NAPI_WEIGHT	64
 
 #define RING_COUNT 256
@@ -218,6 +245,10 @@ struct bar_md {
 	u64 bar0_base_phy;
 	u32 ep_rx_pkt_offset;
 	u32 ep_rx_pkt_size;
+	/* TVNET_FEATURE_* advertised by each side */
+	u32 features_magic;
+	u32 ep_features;
+	u32 host_features;
 };
 
 enum ctrl_msg_type {
@@ -240,6 +271,15 @@ enum data_msg_type {
 	DATA_MSG_FULL_BUF,
 };
 
+/* full_buffer.flags */
+#define DATA_MSG_FLAG_CSUM_PARTIAL	BIT(0)
+
+/* full_buffer.gso_type */
+#define DATA_MSG_GSO_NONE		0
+#define DATA_MSG_GSO_TCPV4		1
+#define DATA_MSG_GSO_TCPV6		2
+#define DATA_MSG_GSO_ECN		BIT(7)
+
 struct data_msg {
 	u32 msg_id; /* enum data_msg_type */
 	union {
@@ -250,6 +290,12 @@ struct data_msg {
 		struct {
 			u32 packet_size;
 			u64 pcie_address;
+			/* Offload info, offsets relative to the MAC header */
+			u32 flags;
+			u16 csum_start;
+			u16 csum_offset;
+			u16 gso_size;
+			u16 gso_type;
 		} full_buffer;
 		u32 reserved[7];
 	} u;
@@ -331,6 +377,149 @@ struct dma_desc_cnt {
 };
 #endif
 
+struct tvnet_skb_map {
+	int nr_segs;
+	/* First segment is the linear part mapped with dma_map_single() */
+	bool linear;
+	dma_addr_t iova[TVNET_MAX_SKB_SEGS];
+	u32 len[TVNET_MAX_SKB_SEGS];
+};
+
+static inline void tvnet_unmap_skb(struct device *d, struct tvnet_skb_map *map)
+{
+	int i;
+
+	for (i = 0; i < map->nr_segs; i++) {
+		if (i == 0 && map->linear)
+			dma_unmap_single(d, map->iova[i], map->len[i],
+					 DMA_TO_DEVICE);
+		else
+			dma_unmap_page(d, map->iova[i], map->len[i],
+				       DMA_TO_DEVICE);
+	}
+	map->nr_segs = 0;
+}
+
+/* Map linear part and frags of skb, one DMA segment each */
+static inline int tvnet_map_skb(struct device *d, struct sk_buff *skb,
+				struct tvnet_skb_map *map)
+{
+	struct skb_shared_info *info = skb_shinfo(skb);
+	u32 len = skb_headlen(skb);
+	dma_addr_t iova;
+	int i;
+
+	map->nr_segs = 0;
+	map->linear = !!len;
+
+	if (len) {
+		iova = dma_map_single(d, skb->data, len, DMA_TO_DEVICE);
+		if (dma_mapping_error(d, iova))
+			return -ENOMEM;
+		map->iova[map->nr_segs] = iova;
+		map->len[map->nr_segs++] = len;
+	}
+
+	for (i = 0; i < info->nr_frags; i++) {
+		const skb_frag_t *frag = &info->frags[i];
+
+		len = skb_frag_size(frag);
+		if (!len)
+			continue;
+		iova = skb_frag_dma_map(d, frag, 0, len, DMA_TO_DEVICE);
+		if (dma_mapping_error(d, iova)) {
+			tvnet_unmap_skb(d, map);
+			return -ENOMEM;
+		}
+		map->iova[map->nr_segs] = iova;
+		map->len[map->nr_segs++] = len;
+	}
+
+	return 0;
+}
+
+/* Describe checksum and segmentation offload of skb in a full msg */
+static inline int tvnet_skb_to_data_msg(struct sk_buff *skb,
+					struct data_msg *msg)
+{
+	struct skb_shared_info *info = skb_shinfo(skb);
+	u32 flags = 0;
+	u16 csum_start = 0, csum_offset = 0, gso_size = 0;
+	u16 gso_type = DATA_MSG_GSO_NONE;
+
+	if (skb->ip_summed == CHECKSUM_PARTIAL) {
+		flags |= DATA_MSG_FLAG_CSUM_PARTIAL;
+		csum_start = skb_checksum_start_offset(skb);
+		csum_offset = skb->csum_offset;
+	}
+
+	if (skb_is_gso(skb)) {
+		if (info->gso_type & SKB_GSO_TCPV4)
+			gso_type = DATA_MSG_GSO_TCPV4;
+		else if (info->gso_type & SKB_GSO_TCPV6)
+			gso_type = DATA_MSG_GSO_TCPV6;
+		else
+			return -EINVAL;
+		if (info->gso_type & SKB_GSO_TCP_ECN)
+			gso_type |= DATA_MSG_GSO_ECN;
+		gso_size = info->gso_size;
+	}
+
+	msg->u.full_buffer.flags = flags;
+	msg->u.full_buffer.csum_start = csum_start;
+	msg->u.full_buffer.csum_offset = csum_offset;
+	msg->u.full_buffer.gso_size = gso_size;
+	msg->u.full_buffer.gso_type = gso_type;
+
+	return 0;
+}
+
+/*
+ * Apply offload info of a full msg to the received skb, skb->data must
+ * still point to the MAC header.
+ */
+static inline int tvnet_data_msg_to_skb(struct data_msg *msg,
+					struct sk_buff *skb)
+{
+	struct skb_shared_info *info = skb_shinfo(skb);
+	u32 flags = READ_ONCE(msg->u.full_buffer.flags);
+	u16 csum_start = READ_ONCE(msg->u.full_buffer.csum_start);
+	u16 csum_offset = READ_ONCE(msg->u.full_buffer.csum_offset);
+	u16 gso_size = READ_ONCE(msg->u.full_buffer.gso_size);
+	u16 gso_type = READ_ONCE(msg->u.full_buffer.gso_type);
+
+	if (flags & DATA_MSG_FLAG_CSUM_PARTIAL) {
+		if (!skb_partial_csum_set(skb, csum_start, csum_offset))
+			return -EINVAL;
+	}
+
+	if (gso_type == DATA_MSG_GSO_NONE)
+		return 0;
+
+	if (!(flags & DATA_MSG_FLAG_CSUM_PARTIAL) || !gso_size)
+		return -EINVAL;
+
+	switch (gso_type & ~DATA_MSG_GSO_ECN) {
+	case DATA_MSG_GSO_TCPV4:
+		info->gso_type = SKB_GSO_TCPV4;
+		break;
+	case DATA_MSG_GSO_TCPV6:
+		info->gso_type = SKB_GSO_TCPV6;
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (gso_type & DATA_MSG_GSO_ECN)
+		info->gso_type |= SKB_GSO_TCP_ECN;
+
+	/* Peer is not trusted, header is validated before segmentation */
+	info->gso_type |= SKB_GSO_DODGY;
+	info->gso_size = gso_size;
+	info->gso_segs = 0;
+
+	return 0;
+}
+
 static inline bool tvnet_ivc_empty(struct tvnet_counter *counter)
 {
 	u32 rd, wr;
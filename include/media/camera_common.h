@@ -105,6 +105,32 @@ regmap_util_write_table_16_as_8(struct regmap *regmap,
 				int num_override_regs,
 				u16 wait_ms_addr, u16 end_addr);
 
+/*
+ * Largest burst the vi i2c FIFO takes, see regmap_util_write_table_8()
+ */
+#define REGMAP_UTIL_MAX_BURST	16
+
+struct regmap_util_prog;
+struct regmap_util_shadow;
+
+struct regmap_util_prog *
+regmap_util_compile_table_8(struct device *dev,
+			    const struct reg_8 table[],
+			    const struct reg_8 override_list[],
+			    int num_override_regs,
+			    u16 wait_ms_addr, u16 end_addr,
+			    unsigned int max_burst);
+
+int
+regmap_util_write_prog(struct regmap *regmap,
+		       const struct regmap_util_prog *prog,
+		       struct regmap_util_shadow *shadow);
+
+struct regmap_util_shadow *regmap_util_shadow_alloc(struct device *dev);
+void regmap_util_shadow_invalidate(struct regmap_util_shadow *shadow);
+void regmap_util_shadow_update(struct regmap_util_shadow *shadow,
+			       u16 addr, u8 val);
+
 enum switch_state {
 	SWITCH_OFF,
 	SWITCH_ON,
@@ -28,6 +28,17 @@
 struct tegra_vi_channel;
 struct capture_buffer_table;
 
+/**
+ * @brief Capture status indication callback, see
+ *	  @ref vi_capture_set_status_callback().
+ *
+ * @param[in]	chan		VI channel context
+ * @param[in]	priv		Private context passed at registration
+ * @param[in]	buffer_index	Index of the completed capture descriptor
+ */
+typedef void (*vi_capture_status_cb)(struct tegra_vi_channel *chan,
+	void *priv, uint32_t buffer_index);
+
 /**
  * @brief VI channel capture context.
  */
@@ -75,6 +86,9 @@ struct vi_capture {
 		 * Completion for capture requests (frame), if progress status
 		 * notifier is not in use
 		 */
+	vi_capture_status_cb status_cb;
+		/**< Capture status callback, replaces capture_resp if set */
+	void *status_cb_priv; /**< Private context for status_cb */
 	struct mutex control_msg_lock;
 		/**< Lock for capture-control IVC control_resp_msg */
 	struct CAPTURE_CONTROL_MSG control_resp_msg;
@@ -439,6 +453,25 @@ int vi_capture_status(
 	struct tegra_vi_channel *chan,
 	int32_t timeout_ms);
 
+/**
+ * @brief Deliver capture status indications to a callback instead of
+ *	  completing the request FIFO waited on by @ref vi_capture_status().
+ *
+ * The callback runs in the capture IVC worker thread, in request order for
+ * the channel. It must not block; it is expected to hand the completion off
+ * to a workqueue.
+ *
+ * @param[in]	chan	VI channel context
+ * @param[in]	cb	Status callback, NULL to revert to vi_capture_status()
+ * @param[in]	priv	Private context passed to @a cb
+ *
+ * @returns	0 (success), neg. errno (failure)
+ */
+int vi_capture_set_status_callback(
+	struct tegra_vi_channel *chan,
+	vi_capture_status_cb cb,
+	void *priv);
+
 /**
  * @brief Setup VI channel capture status progress notifier.
  *
@@ -202,8 +202,6 @@ struct tegra_channel {
 	struct task_struct *kthread_release;
 	wait_queue_head_t start_wait;
 	wait_queue_head_t release_wait;
-	struct task_struct *kthread_capture_dequeue;
-	wait_queue_head_t dequeue_wait;
 	struct vb2_queue queue;
 	void *alloc_ctx;
 	bool init_done;
@@ -215,6 +213,8 @@ struct tegra_channel {
 	spinlock_t dequeue_lock;
 	struct work_struct status_work;
 	struct work_struct error_work;
+	struct delayed_work capture_timeout_work;
+	atomic_t capture_status_cnt[TEGRA_CSI_BLOCKS];
 
 	void __iomem *csibase[TEGRA_CSI_BLOCKS];
 	unsigned int stride_align;
@@ -339,6 +339,8 @@ struct tegra_mc_vi {
 	bool bypass;
 
 	const struct tegra_vi_fops *fops;
+	/* shared by all channels to process capture completions */
+	struct workqueue_struct *capture_wq;
 };
 
 int tegra_vi_get_port_info(struct tegra_channel *chan,
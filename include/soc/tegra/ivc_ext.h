@@ -143,4 +143,73 @@ int tegra_ivc_read_peek(struct tegra_ivc *ivc, void __user *usr_buf, void *buf,
  */
 int tegra_ivc_write(struct tegra_ivc *ivc, const void __user *usr_buf, const void *buf, size_t size);
 
+/**
+ * tegra_ivc_read_advance_n - Releases several received frames at once
+ * @ivc		pointer of the IVC channel
+ * @n		number of frames to release
+ *
+ * Releases @n frames with a single counter update and notifies the peer at
+ * most once.
+ *
+ * Returns 0 on success, -EINVAL if fewer than @n frames are pending.
+ */
+int tegra_ivc_read_advance_n(struct tegra_ivc *ivc, u32 n);
+
+/**
+ * tegra_ivc_write_advance_n - Commits several written frames at once
+ * @ivc		pointer of the IVC channel
+ * @n		number of frames to commit
+ *
+ * Commits @n frames with a single counter update and notifies the peer at
+ * most once.
+ *
+ * Returns 0 on success, -EINVAL if fewer than @n frames are free.
+ */
+int tegra_ivc_write_advance_n(struct tegra_ivc *ivc, u32 n);
+
+/**
+ * tegra_ivc_read_batch - Reads several frames from ivc channel at once
+ * @ivc		pointer of the IVC channel
+ * @buf		kernel buffer for @max frames of @size bytes each
+ * @size	data to be read from each frame
+ * @max		max number of frames to read
+ *
+ * Copies up to @max pending frames to @buf and releases them with a single
+ * counter update, notifying the peer at most once.
+ *
+ * Returns no. of frames read, -ENOSPC if none is pending, else error.
+ */
+int tegra_ivc_read_batch(struct tegra_ivc *ivc, void *buf, size_t size,
+			 u32 max);
+
+/**
+ * tegra_ivc_read_peek_batch - Peeks at several frames of ivc channel
+ * @ivc		pointer of the IVC channel
+ * @buf		kernel buffer for @max frames of @size bytes each
+ * @size	data to be read from each frame
+ * @max		max number of frames to read
+ *
+ * Like tegra_ivc_read_batch() but leaves the frames in the channel, release
+ * them with tegra_ivc_read_advance_n().
+ *
+ * Returns no. of frames read, -ENOSPC if none is pending, else error.
+ */
+int tegra_ivc_read_peek_batch(struct tegra_ivc *ivc, void *buf, size_t size,
+			      u32 max);
+
+/**
+ * tegra_ivc_write_batch - Writes several frames to ivc channel at once
+ * @ivc		pointer of the IVC channel
+ * @buf		kernel buffer holding @count frames of @size bytes each
+ * @size	data to be written to each frame
+ * @count	number of frames to write
+ *
+ * Writes as many of the @count frames as fit and commits them with a single
+ * counter update, notifying the peer at most once.
+ *
+ * Returns no. of frames written, -ENOSPC if the channel is full, else error.
+ */
+int tegra_ivc_write_batch(struct tegra_ivc *ivc, const void *buf, size_t size,
+			  u32 count);
+
 #endif /* __TEGRA_IVC_EXT_H */
@@ -210,6 +210,18 @@ void *tegra_hv_ivc_read_get_next_frame(struct tegra_hv_ivc_cookie *ivck);
  */
 int tegra_hv_ivc_read_advance(struct tegra_hv_ivc_cookie *ivck);
 
+/**
+ * tegra_hv_ivc_read_advance_n - Advance the read queue by several frames
+ * @ivck	IVC cookie of the queue
+ * @n		Number of frames to release
+ *
+ * Advance the read queue with one counter update and at most one
+ * notification of the peer.
+ *
+ * Returns 0, or a negative error value if failed.
+ */
+int tegra_hv_ivc_read_advance_n(struct tegra_hv_ivc_cookie *ivck, u32 n);
+
 /**
  * ivc_hv_ivc_write_poke - Poke data to a frame to be transmitted
  * @ivck	IVC cookie of the queue
@@ -245,6 +257,63 @@ void *tegra_hv_ivc_write_get_next_frame(struct tegra_hv_ivc_cookie *ivck);
  */
 int tegra_hv_ivc_write_advance(struct tegra_hv_ivc_cookie *ivck);
 
+/**
+ * tegra_hv_ivc_write_advance_n - Advance the write queue by several frames
+ * @ivck	IVC cookie of the queue
+ * @n		Number of frames to commit
+ *
+ * Advance the write queue with one counter update and at most one
+ * notification of the peer.
+ *
+ * Returns 0, or a negative error value if failed.
+ */
+int tegra_hv_ivc_write_advance_n(struct tegra_hv_ivc_cookie *ivck, u32 n);
+
+/**
+ * tegra_hv_ivc_read_batch - Read several frames at once
+ * @ivck	IVC cookie of the queue
+ * @buf		Buffer for @max frames of @size bytes each
+ * @size	Count of bytes to copy from each frame
+ * @max		Max number of frames to read
+ *
+ * Read the pending frames, up to @max, and advance the read queue with
+ * one counter update and at most one notification of the peer.
+ *
+ * Returns the number of frames read, or a negative error value if failed.
+ */
+int tegra_hv_ivc_read_batch(struct tegra_hv_ivc_cookie *ivck, void *buf,
+			    size_t size, u32 max);
+
+/**
+ * tegra_hv_ivc_read_peek_batch - Peek at several received frames
+ * @ivck	IVC cookie of the queue
+ * @buf		Buffer for @max frames of @size bytes each
+ * @size	Count of bytes to copy from each frame
+ * @max		Max number of frames to copy
+ *
+ * Copy the pending frames, up to @max, without removing them from the
+ * queue. Release them with tegra_hv_ivc_read_advance_n().
+ *
+ * Returns the number of frames copied, or a negative error value if failed.
+ */
+int tegra_hv_ivc_read_peek_batch(struct tegra_hv_ivc_cookie *ivck, void *buf,
+				 size_t size, u32 max);
+
+/**
+ * tegra_hv_ivc_write_batch - Write several frames at once
+ * @ivck	IVC cookie of the queue
+ * @buf		Buffer holding @count frames of @size bytes each
+ * @size	Count of bytes to copy to each frame
+ * @count	Number of frames to write
+ *
+ * Write as many of the frames as fit and advance the write queue with one
+ * counter update and at most one notification of the peer.
+ *
+ * Returns the number of frames written, or a negative error value if failed.
+ */
+int tegra_hv_ivc_write_batch(struct tegra_hv_ivc_cookie *ivck,
+			     const void *buf, size_t size, u32 count);
+
 /**
  * tegra_hv_mempool_reserve - reserve a mempool for use
  * @id		Id of the requested mempool.
@@ -397,6 +466,12 @@ static inline int tegra_hv_ivc_read_advance(struct tegra_hv_ivc_cookie *ivck)
 	return -ENOTSUPP;
 };
 
+static inline int tegra_hv_ivc_read_advance_n(struct tegra_hv_ivc_cookie *ivck,
+					      u32 n)
+{
+	return -ENOTSUPP;
+};
+
 static inline int tegra_hv_ivc_write_poke(struct tegra_hv_ivc_cookie *ivck,
 					  const void *buf, int off, int count)
 {
@@ -414,6 +489,32 @@ static inline int tegra_hv_ivc_write_advance(struct tegra_hv_ivc_cookie *ivck)
 	return -ENOTSUPP;
 };
 
+static inline int tegra_hv_ivc_write_advance_n(struct tegra_hv_ivc_cookie *ivck,
+					       u32 n)
+{
+	return -ENOTSUPP;
+};
+
+static inline int tegra_hv_ivc_read_batch(struct tegra_hv_ivc_cookie *ivck,
+					  void *buf, size_t size, u32 max)
+{
+	return -ENOTSUPP;
+};
+
+static inline int tegra_hv_ivc_read_peek_batch(
+		struct tegra_hv_ivc_cookie *ivck, void *buf, size_t size,
+		u32 max)
+{
+	return -ENOTSUPP;
+};
+
+static inline int tegra_hv_ivc_write_batch(struct tegra_hv_ivc_cookie *ivck,
+					   const void *buf, size_t size,
+					   u32 count)
+{
+	return -ENOTSUPP;
+};
+
 static inline struct tegra_hv_ivm_cookie *tegra_hv_mempool_reserve(unsigned id)
 {
 	return ERR_PTR(-ENOTSUPP);
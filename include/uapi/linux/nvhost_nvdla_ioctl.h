@@ -155,7 +155,8 @@ struct nvdla_mem_handle {
  * @num_sof_timestamps   	number of sof timestamp
  * @num_eof_timestamps   	number of eof timestamp
  * @flags			flags for bitwise task info embeddeing
- * @reserved			reserved for future use
+ * @template_id		registered template used when
+ *				NVDLA_TASK_FLAGS_TEMPLATE is set
  * @prefences			pointer to pre-fence struct table
  * @postfences			pointer to post-fence struct table
  * @input_task_status		pointer to input task status struct table
@@ -179,8 +180,9 @@ struct nvdla_ioctl_submit_task {
 	__u8 reserved0[1];
 #define MAX_NVDLA_BUFFERS_PER_TASK (384U)
 	__u32 num_addresses;
+#define NVDLA_TASK_FLAGS_TEMPLATE	(1 << 0)
 	__u16 flags;
-	__u16 reserved1;
+	__u16 template_id;
 
 	__u64 prefences;
 	__u64 postfences;
@@ -194,6 +196,25 @@ struct nvdla_ioctl_submit_task {
 	__u64 timeout;
 };
 
+/**
+ * struct nvdla_template_args structure to register or release a task template
+ *
+ * @task		pointer to nvdla_ioctl_submit_task describing the
+ *			status, timestamp and address lists of the template
+ * @id			template id, returned on register
+ * @reserved		reserved for future use
+ *
+ * Tasks submitted with NVDLA_TASK_FLAGS_TEMPLATE only supply their fences,
+ * everything else is taken from the template which keeps its address list
+ * pinned until it is released.
+ */
+struct nvdla_template_args {
+	__u64 task;
+#define MAX_NVDLA_TEMPLATES_PER_FD	16
+	__u32 id;
+	__u32 reserved;
+};
+
 /**
  * struct nvdla_ioctl_emu_submit_task structure for single emulator task
  * information
@@ -268,8 +289,12 @@ struct nvdla_status_notify {
 	_IO(NVHOST_NVDLA_IOCTL_MAGIC, 9)
 #define NVDLA_IOCTL_RELEASE_QUEUE \
 	_IO(NVHOST_NVDLA_IOCTL_MAGIC, 10)
+#define NVDLA_IOCTL_REGISTER_TEMPLATE \
+	_IOWR(NVHOST_NVDLA_IOCTL_MAGIC, 11, struct nvdla_template_args)
+#define NVDLA_IOCTL_RELEASE_TEMPLATE \
+	_IOW(NVHOST_NVDLA_IOCTL_MAGIC, 12, struct nvdla_template_args)
 #define NVDLA_IOCTL_LAST		\
-		_IOC_NR(NVDLA_IOCTL_RELEASE_QUEUE)
+		_IOC_NR(NVDLA_IOCTL_RELEASE_TEMPLATE)
 
 #define NVDLA_IOCTL_MAX_ARG_SIZE  \
 		sizeof(struct nvdla_pin_unpin_args)
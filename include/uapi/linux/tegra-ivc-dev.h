@@ -24,6 +24,16 @@ struct nvipc_ivc_info {
 	uint16_t noti_type; /* IVC_TRAP_IPA, IVC_MSI_IPA */
 };
 
+/*
+ * Range of frames in the mmapped queue. Frames are referenced by index
+ * relative to the first frame of the rx or tx queue described by
+ * nvipc_ivc_info, and a range may wrap around at nframes.
+ */
+struct nvipc_ivc_frames {
+	uint32_t index;	/* out: index of the first frame */
+	uint32_t count;	/* in: max/consumed frames, out: frames in range */
+};
+
 /*  IOCTL magic number */
 #define NVIPC_IVC_IOCTL_MAGIC 0xAA
 
@@ -39,7 +49,27 @@ struct nvipc_ivc_info {
 #define NVIPC_IVC_IOCTL_GET_VMID \
 	_IOR(NVIPC_IVC_IOCTL_MAGIC, 3, uint32_t)
 
-#define NVIPC_IVC_IOCTL_NUMBER_MAX 3
+/* get the range of frames ready to be read in place */
+#define NVIPC_IVC_IOCTL_RX_ACQUIRE \
+	_IOWR(NVIPC_IVC_IOCTL_MAGIC, 4, struct nvipc_ivc_frames)
+
+/* return 'count' frames read in place to the peer */
+#define NVIPC_IVC_IOCTL_RX_RELEASE \
+	_IOWR(NVIPC_IVC_IOCTL_MAGIC, 5, struct nvipc_ivc_frames)
+
+/* get the range of frames free to be written in place */
+#define NVIPC_IVC_IOCTL_TX_ACQUIRE \
+	_IOWR(NVIPC_IVC_IOCTL_MAGIC, 6, struct nvipc_ivc_frames)
+
+/* hand 'count' frames written in place over to the peer */
+#define NVIPC_IVC_IOCTL_TX_SUBMIT \
+	_IOWR(NVIPC_IVC_IOCTL_MAGIC, 7, struct nvipc_ivc_frames)
+
+/* signal an eventfd on channel notifications, -1 to detach */
+#define NVIPC_IVC_IOCTL_SET_EVENTFD \
+	_IOW(NVIPC_IVC_IOCTL_MAGIC, 8, int32_t)
+
+#define NVIPC_IVC_IOCTL_NUMBER_MAX 8
 
 int ivc_cdev_get_peer_vmid(uint32_t qid, uint32_t *peer_vmid);
 int ivc_cdev_get_noti_type(uint32_t qid, uint32_t *noti_type);
@@ -6224,6 +6224,28 @@ compile_test() {
             compile_check_conftest "$CODE" "NV_VM_AREA_STRUCT_HAS_CONST_VM_FLAGS" "" "types"
         ;;
 
+        vm_operations_struct_huge_fault_has_order_arg)
+            #
+            # Determine if the 'huge_fault' callback of the
+            # 'vm_operations_struct' structure takes the page order
+            # instead of an 'enum page_entry_size'.
+            #
+            # Changed by the commit "mm: remove enum page_entry_size" in
+            # v6.6 of the linux kernel tree.
+            #
+            CODE="
+            #include <linux/mm.h>
+            static inline vm_fault_t conftest_huge_fault(struct vm_fault *vmf,
+                                                         unsigned int order) {
+                return 0;
+            }
+            static struct vm_operations_struct vm_ops = {
+                  .huge_fault = conftest_huge_fault,
+            };"
+
+            compile_check_conftest "$CODE" "NV_VM_OPERATIONS_STRUCT_HUGE_FAULT_HAS_ORDER_ARG" "" "types"
+        ;;
+
         drm_driver_has_dumb_destroy)
             #
             # Determine if the 'drm_driver' structure has a 'dumb_destroy'
@@ -7198,6 +7220,22 @@ compile_test() {
                     "NV_ETHTOOL_OPS_GET_SET_RXFH_HAS_RXFH_PARAM_ARGS" "" "types"
         ;;
 
+        eventfd_signal_has_counter_arg)
+            #
+            # Determine if the function eventfd_signal() has the 'n' argument.
+            #
+            # Commit 3652117f8548 ("eventfd: simplify eventfd_signal()")
+            # removed the counter argument in Linux v6.8.
+            #
+            CODE="
+            #include <linux/eventfd.h>
+            void conftest_eventfd_signal_has_counter_arg(struct eventfd_ctx *ctx) {
+                    eventfd_signal(ctx, 1);
+            }"
+
+            compile_check_conftest "$CODE" "NV_EVENTFD_SIGNAL_HAS_COUNTER_ARG" "" "types"
+        ;;
+
         fd_empty)
             #
             # Determine if macro fd_empty() is present.
@@ -7353,6 +7391,24 @@ compile_test() {
             compile_check_conftest "$CODE" "NV_NETIF_SET_TSO_MAX_SIZE_PRESENT" "" "functions"
         ;;
 
+        xdp_set_features_flag)
+            #
+            # Determine if xdp_set_features_flag() function is present
+            #
+            # Added by commit 66c0e13ad236 ("drivers: net: turn on XDP
+            # features") in Linux v6.3.
+            #
+            CODE="
+            #include <net/xdp.h>
+            void conftest_xdp_set_features_flag(void)
+            {
+                    xdp_set_features_flag();
+            }
+            "
+
+            compile_check_conftest "$CODE" "NV_XDP_SET_FEATURES_FLAG_PRESENT" "" "functions"
+        ;;
+
         netif_napi_add_weight)
             #
             # Determine if netif_napi_add_weight() function is present
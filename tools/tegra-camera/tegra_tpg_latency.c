@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ */
+
+/*
+ * tegra_tpg_latency - capture completion latency and jitter on a VI
+ * test pattern generator channel.
+ *
+ * Streams from a TPG video node (nvhost-vi-tpg-t19x loaded) and, per
+ * frame, compares the SOF timestamp filled in from the capture status
+ * with the time the buffer was dequeued. SOF timestamps are TSC based,
+ * so the completion delay is reported relative to the fastest frame of
+ * the run rather than as an absolute value.
+ *
+ * Run one instance per TPG channel at once to look at cross-channel
+ * effects, e.g. head-of-line blocking between ports.
+ *
+ * Example Usage:
+ *	tegra_tpg_latency -d /dev/video0 -c 1000
+ *
+ * Build: cc -O2 -o tegra_tpg_latency tegra_tpg_latency.c -lm
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <linux/videodev2.h>
+
+#define MAX_BUFFERS	16
+#define DQBUF_TIMEOUT_MS	2000
+
+struct frame_sample {
+	uint64_t sof_ns;
+	uint64_t dq_ns;
+	bool error;
+};
+
+struct stream {
+	int fd;
+	unsigned int nbufs;
+	void *mem[MAX_BUFFERS];
+	size_t len[MAX_BUFFERS];
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while (ret == -1 && errno == EINTR);
+
+	return ret == -1 ? -errno : 0;
+}
+
+static int stream_open(struct stream *s, const char *device_name,
+		       unsigned int nbufs)
+{
+	struct v4l2_requestbuffers req = {0};
+	struct v4l2_capability cap = {0};
+	struct v4l2_format fmt = {0};
+	unsigned int i;
+	int ret;
+
+	memset(s, 0, sizeof(*s));
+	s->fd = open(device_name, O_RDWR | O_NONBLOCK);
+	if (s->fd == -1) {
+		perror("Failed to open video device");
+		return -errno;
+	}
+
+	ret = xioctl(s->fd, VIDIOC_QUERYCAP, &cap);
+	if (ret < 0 || !(cap.device_caps & V4L2_CAP_STREAMING)) {
+		fprintf(stderr, "%s is not a streaming capture device\n",
+			device_name);
+		return ret < 0 ? ret : -EINVAL;
+	}
+
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	ret = xioctl(s->fd, VIDIOC_G_FMT, &fmt);
+	if (ret < 0) {
+		fprintf(stderr, "Failed to get format (%d)\n", ret);
+		return ret;
+	}
+
+	fprintf(stdout, "%s: %ux%u %.4s, %u buffers\n", cap.card,
+		fmt.fmt.pix.width, fmt.fmt.pix.height,
+		(char *)&fmt.fmt.pix.pixelformat, nbufs);
+
+	req.count = nbufs;
+	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory = V4L2_MEMORY_MMAP;
+	ret = xioctl(s->fd, VIDIOC_REQBUFS, &req);
+	if (ret < 0) {
+		fprintf(stderr, "Failed to request buffers (%d)\n", ret);
+		return ret;
+	}
+	s->nbufs = req.count > MAX_BUFFERS ? MAX_BUFFERS : req.count;
+
+	for (i = 0; i < s->nbufs; i++) {
+		struct v4l2_buffer buf = {0};
+
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		ret = xioctl(s->fd, VIDIOC_QUERYBUF, &buf);
+		if (ret < 0)
+			return ret;
+
+		s->len[i] = buf.length;
+		s->mem[i] = mmap(NULL, buf.length, PROT_READ, MAP_SHARED,
+				 s->fd, buf.m.offset);
+		if (s->mem[i] == MAP_FAILED) {
+			s->mem[i] = NULL;
+			perror("Failed to map buffer");
+			return -errno;
+		}
+
+		ret = xioctl(s->fd, VIDIOC_QBUF, &buf);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void stream_close(struct stream *s)
+{
+	unsigned int i;
+
+	for (i = 0; i < s->nbufs; i++)
+		if (s->mem[i])
+			munmap(s->mem[i], s->len[i]);
+	if (s->fd != -1)
+		close(s->fd);
+}
+
+static int capture(struct stream *s, struct frame_sample *samples,
+		   unsigned int count)
+{
+	struct pollfd pfd = { .fd = s->fd, .events = POLLIN };
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	unsigned int n = 0;
+	int ret;
+
+	ret = xioctl(s->fd, VIDIOC_STREAMON, &type);
+	if (ret < 0) {
+		fprintf(stderr, "Failed to start streaming (%d)\n", ret);
+		return ret;
+	}
+
+	while (n < count) {
+		struct v4l2_buffer buf = {0};
+
+		ret = poll(&pfd, 1, DQBUF_TIMEOUT_MS);
+		if (ret == 0) {
+			fprintf(stderr, "No frame after %d ms\n",
+				DQBUF_TIMEOUT_MS);
+			ret = -ETIMEDOUT;
+			break;
+		} else if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			ret = -errno;
+			break;
+		}
+
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		ret = xioctl(s->fd, VIDIOC_DQBUF, &buf);
+		if (ret == -EAGAIN)
+			continue;
+		if (ret < 0)
+			break;
+
+		samples[n].dq_ns = now_ns();
+		samples[n].sof_ns = (uint64_t)buf.timestamp.tv_sec *
+			1000000000ULL + (uint64_t)buf.timestamp.tv_usec * 1000ULL;
+		samples[n].error = (buf.flags & V4L2_BUF_FLAG_ERROR) != 0;
+		n++;
+
+		ret = xioctl(s->fd, VIDIOC_QBUF, &buf);
+		if (ret < 0)
+			break;
+	}
+
+	xioctl(s->fd, VIDIOC_STREAMOFF, &type);
+
+	return ret < 0 ? ret : (int)n;
+}
+
+static void print_stats(const char *name, uint64_t *val, unsigned int n)
+{
+	double mean = 0.0, var = 0.0;
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		mean += (double)val[i];
+	mean /= n;
+	for (i = 0; i < n; i++)
+		var += ((double)val[i] - mean) * ((double)val[i] - mean);
+	var /= n;
+
+	qsort(val, n, sizeof(*val), cmp_u64);
+	fprintf(stdout, "  %-18s us: mean %9.1f stddev %7.1f min %9.1f"
+		" p99 %9.1f max %9.1f\n", name, mean / 1000.0,
+		sqrt(var) / 1000.0, val[0] / 1000.0,
+		val[(n - 1) * 99 / 100] / 1000.0, val[n - 1] / 1000.0);
+}
+
+static int report(struct frame_sample *samples, unsigned int n,
+		  unsigned int skip)
+{
+	uint64_t *sof_int, *dq_int, *delay;
+	uint64_t min_delay = UINT64_MAX;
+	unsigned int i, m, errors = 0, dropped = 0;
+
+	if (n <= skip + 1) {
+		fprintf(stderr, "Not enough frames captured (%u)\n", n);
+		return -EINVAL;
+	}
+
+	samples += skip;
+	n -= skip;
+	m = n - 1;
+
+	sof_int = calloc(m, sizeof(*sof_int));
+	dq_int = calloc(m, sizeof(*dq_int));
+	delay = calloc(n, sizeof(*delay));
+	if (!sof_int || !dq_int || !delay) {
+		free(sof_int);
+		free(dq_int);
+		free(delay);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < n; i++) {
+		delay[i] = samples[i].dq_ns - samples[i].sof_ns;
+		if (delay[i] < min_delay)
+			min_delay = delay[i];
+		if (samples[i].error)
+			errors++;
+		if (i == 0)
+			continue;
+
+		sof_int[i - 1] = samples[i].sof_ns - samples[i - 1].sof_ns;
+		dq_int[i - 1] = samples[i].dq_ns - samples[i - 1].dq_ns;
+	}
+
+	/* SOF is TSC based, its offset to CLOCK_MONOTONIC is unknown */
+	for (i = 0; i < n; i++)
+		delay[i] -= min_delay;
+
+	print_stats("SOF interval", sof_int, m);
+	print_stats("dequeue interval", dq_int, m);
+	print_stats("completion delay", delay, n);
+
+	/*
+	 * buffer sequence numbers are assigned on completion, a lost frame
+	 * only shows as a gap between SOFs; sof_int is sorted by now
+	 */
+	for (i = 0; i < m; i++)
+		if (sof_int[i] * 2 > sof_int[m / 2] * 3)
+			dropped++;
+
+	fprintf(stdout, "%u frames, %u with errors, %u SOF gaps\n",
+		n, errors, dropped);
+	fprintf(stdout, "  (completion delay: SOF to dequeue, relative to the"
+		" fastest frame)\n");
+
+	free(sof_int);
+	free(dq_int);
+	free(delay);
+
+	return 0;
+}
+
+void print_usage(char *bin_name)
+{
+	fprintf(stderr, "Usage: %s [options]...\n"
+		"Measure capture completion latency and jitter on a TPG channel\n"
+		"  -d <dev>   TPG video device, e.g. /dev/video0\n"
+		" [-c <n>]    Capture <n> frames (default 300)\n"
+		" [-b <n>]    Number of capture buffers (default 4)\n"
+		" [-s <n>]    Skip the first <n> frames (default 10)\n"
+		"  -h         This helptext\n"
+		"\n"
+		"Example:\n"
+		"%s -d /dev/video0 -c 1000\n",
+		bin_name, bin_name
+	);
+}
+
+int main(int argc, char **argv)
+{
+	const char *device_name = NULL;
+	unsigned int count = 300;
+	unsigned int nbufs = 4;
+	unsigned int skip = 10;
+	struct frame_sample *samples;
+	struct stream s = { .fd = -1 };
+	int ret, c;
+
+	while ((c = getopt(argc, argv, "b:c:d:s:h")) != -1) {
+		switch (c) {
+		case 'b':
+			nbufs = strtoul(optarg, NULL, 10);
+			break;
+		case 'c':
+			count = strtoul(optarg, NULL, 10);
+			break;
+		case 'd':
+			device_name = optarg;
+			break;
+		case 's':
+			skip = strtoul(optarg, NULL, 10);
+			break;
+		case 'h':
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!device_name || count == 0 || nbufs == 0 || nbufs > MAX_BUFFERS) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	samples = calloc(count + skip, sizeof(*samples));
+	if (!samples)
+		return 1;
+
+	ret = stream_open(&s, device_name, nbufs);
+	if (ret == 0)
+		ret = capture(&s, samples, count + skip);
+	if (ret >= 0)
+		ret = report(samples, ret, skip);
+
+	if (ret < 0)
+		fprintf(stderr, "Failed (%d)\n", ret);
+	stream_close(&s);
+	free(samples);
+
+	return ret < 0 ? 1 : 0;
+}
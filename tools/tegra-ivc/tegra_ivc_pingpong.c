@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ *
+ * SPDX-License-Identifier: GPL-2.0
+ */
+
+/*
+ * tegra_ivc_pingpong - measure IVC round trips in batches of frames
+ *
+ * One end echoes every frame it receives, the other end sends <batch>
+ * frames at once and times until all of them are back. Frames are
+ * accessed in place through the mmapped queue and handed over with the
+ * RX/TX frame range ioctls of the ivc character device, so a batch costs
+ * one counter update and at most one notification each way.
+ *
+ * A loopback queue pair lets both ends run in the same VM.
+ *
+ * Example Usage:
+ *	tegra_ivc_pingpong -d ivc1 -e &
+ *	tegra_ivc_pingpong -d ivc0 -b 1 -c 100000
+ *	tegra_ivc_pingpong -d ivc0 -b 16 -c 100000
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <linux/tegra-ivc-dev.h>
+
+/* Layout of the shared queue header, see drivers/firmware/tegra/ivc_ext.c */
+#define IVC_ALIGN		64
+#define IVC_HEADER_SIZE		(2 * IVC_ALIGN)
+#define IVC_TX_COUNT		0
+#define IVC_TX_STATE		4
+#define IVC_RX_COUNT		IVC_ALIGN
+
+#define IVC_STATE_ESTABLISHED	0
+#define IVC_STATE_SYNC		1
+#define IVC_STATE_ACK		2
+
+#define RESET_TIMEOUT_MS	5000
+
+struct pingpong {
+	int fd;
+	int efd;
+	bool spin;
+	struct nvipc_ivc_info info;
+	uint8_t *area;
+	uint8_t *rx;
+	uint8_t *tx;
+};
+
+static volatile uint32_t *hdr_field(uint8_t *queue, unsigned int offset)
+{
+	return (volatile uint32_t *)(queue + offset);
+}
+
+static uint8_t *frame_ptr(struct pingpong *pp, uint8_t *queue, uint32_t index)
+{
+	return queue + IVC_HEADER_SIZE +
+		(size_t)(index % pp->info.nframes) * pp->info.frame_size;
+}
+
+static int notify_remote(struct pingpong *pp)
+{
+	if (ioctl(pp->fd, NVIPC_IVC_IOCTL_NOTIFY_REMOTE) == -1)
+		return -errno;
+
+	return 0;
+}
+
+/* Block until the peer notified us, or just return when spinning */
+static int wait_event(struct pingpong *pp, int timeout_ms)
+{
+	struct pollfd pfd = { .fd = pp->efd, .events = POLLIN };
+	uint64_t count;
+	int ret;
+
+	if (pp->spin)
+		return 0;
+
+	ret = poll(&pfd, 1, timeout_ms);
+	if (ret == -1)
+		return -errno;
+	if (ret == 0)
+		return -ETIMEDOUT;
+
+	if (read(pp->efd, &count, sizeof(count)) != sizeof(count))
+		return -errno;
+
+	return 0;
+}
+
+/*
+ * IVC reset handshake, the same state machine as tegra_ivc_notified().
+ * Our state is tx.state of the tx queue, the peer's one is tx.state of
+ * the rx queue.
+ */
+static int establish(struct pingpong *pp)
+{
+	volatile uint32_t *state = hdr_field(pp->tx, IVC_TX_STATE);
+	volatile uint32_t *peer = hdr_field(pp->rx, IVC_TX_STATE);
+	int waited = 0;
+	int ret;
+
+	*state = IVC_STATE_SYNC;
+	__sync_synchronize();
+	ret = notify_remote(pp);
+	if (ret < 0)
+		return ret;
+
+	while (*state != IVC_STATE_ESTABLISHED) {
+		uint32_t peer_state = *peer;
+
+		__sync_synchronize();
+		if (peer_state == IVC_STATE_SYNC ||
+		    (*state == IVC_STATE_SYNC && peer_state == IVC_STATE_ACK)) {
+			*hdr_field(pp->tx, IVC_TX_COUNT) = 0;
+			*hdr_field(pp->rx, IVC_RX_COUNT) = 0;
+			__sync_synchronize();
+			*state = (peer_state == IVC_STATE_SYNC) ?
+				IVC_STATE_ACK : IVC_STATE_ESTABLISHED;
+			ret = notify_remote(pp);
+		} else if (*state == IVC_STATE_ACK) {
+			*state = IVC_STATE_ESTABLISHED;
+			ret = notify_remote(pp);
+		} else {
+			ret = 0;
+		}
+		if (ret < 0)
+			return ret;
+
+		if (*state == IVC_STATE_ESTABLISHED)
+			break;
+
+		if (pp->spin) {
+			usleep(1000);
+			ret = -ETIMEDOUT;
+		} else {
+			ret = wait_event(pp, 1);
+		}
+		if (ret == -ETIMEDOUT) {
+			if (++waited > RESET_TIMEOUT_MS)
+				return -ETIMEDOUT;
+		} else if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int frames_ioctl(struct pingpong *pp, unsigned long cmd,
+			uint32_t count, struct nvipc_ivc_frames *frames)
+{
+	frames->index = 0;
+	frames->count = count;
+	if (ioctl(pp->fd, cmd, frames) == -1)
+		return -errno;
+
+	return 0;
+}
+
+static int pingpong_open(struct pingpong *pp, const char *device_name,
+			 bool spin)
+{
+	char path[64];
+	int32_t efd;
+	size_t offset = 0;
+
+	memset(pp, 0, sizeof(*pp));
+	pp->spin = spin;
+	pp->efd = -1;
+
+	snprintf(path, sizeof(path), "/dev/%s", device_name);
+	pp->fd = open(path, O_RDWR);
+	if (pp->fd == -1) {
+		perror("Failed to open ivc device");
+		return -errno;
+	}
+
+	if (ioctl(pp->fd, NVIPC_IVC_IOCTL_GET_INFO, &pp->info) == -1) {
+		perror("Failed to get ivc info");
+		return -errno;
+	}
+
+	if (pp->info.frame_size < sizeof(uint64_t)) {
+		fprintf(stderr, "Frame size %u too small\n",
+			pp->info.frame_size);
+		return -EINVAL;
+	}
+
+	pp->area = mmap(NULL, pp->info.area_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, pp->fd, 0);
+	if (pp->area == MAP_FAILED) {
+		perror("Failed to map ivc area");
+		return -errno;
+	}
+
+	offset = pp->info.queue_offset;
+	pp->rx = pp->area + offset +
+		(pp->info.rx_first ? 0 : pp->info.queue_size);
+	pp->tx = pp->area + offset +
+		(pp->info.rx_first ? pp->info.queue_size : 0);
+
+	pp->efd = eventfd(0, EFD_CLOEXEC);
+	if (pp->efd == -1) {
+		perror("Failed to create eventfd");
+		return -errno;
+	}
+
+	efd = pp->efd;
+	if (ioctl(pp->fd, NVIPC_IVC_IOCTL_SET_EVENTFD, &efd) == -1) {
+		perror("Failed to attach eventfd");
+		return -errno;
+	}
+
+	return 0;
+}
+
+static void pingpong_close(struct pingpong *pp)
+{
+	if (pp->efd != -1)
+		close(pp->efd);
+	if (pp->area && pp->area != MAP_FAILED)
+		munmap(pp->area, pp->info.area_size);
+	if (pp->fd != -1)
+		close(pp->fd);
+}
+
+/* Send every received frame back, as many at once as the queues allow */
+static int echo(struct pingpong *pp)
+{
+	struct nvipc_ivc_frames rx, tx;
+	uint32_t i, n;
+	int ret;
+
+	fprintf(stdout, "Echoing, %u frames of %u bytes\n",
+		pp->info.nframes, pp->info.frame_size);
+
+	while (1) {
+		ret = frames_ioctl(pp, NVIPC_IVC_IOCTL_RX_ACQUIRE,
+				   pp->info.nframes, &rx);
+		if (ret == 0 && rx.count != 0)
+			ret = frames_ioctl(pp, NVIPC_IVC_IOCTL_TX_ACQUIRE,
+					   rx.count, &tx);
+		if (ret < 0)
+			return ret;
+
+		n = (rx.count != 0) ? tx.count : 0;
+		if (n == 0) {
+			ret = wait_event(pp, -1);
+			if (ret < 0)
+				return ret;
+			continue;
+		}
+
+		for (i = 0; i < n; i++)
+			memcpy(frame_ptr(pp, pp->tx, tx.index + i),
+			       frame_ptr(pp, pp->rx, rx.index + i),
+			       pp->info.frame_size);
+
+		ret = frames_ioctl(pp, NVIPC_IVC_IOCTL_TX_SUBMIT, n, &tx);
+		if (ret == 0)
+			ret = frames_ioctl(pp, NVIPC_IVC_IOCTL_RX_RELEASE, n,
+					   &rx);
+		if (ret < 0)
+			return ret;
+	}
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* One round trip: send <batch> frames, wait until all of them are back */
+static int round_trip(struct pingpong *pp, uint32_t batch, uint64_t *seq)
+{
+	struct nvipc_ivc_frames frames;
+	uint64_t expect = *seq;
+	uint32_t i, sent, got;
+	int ret;
+
+	for (sent = 0; sent < batch; sent += frames.count) {
+		ret = frames_ioctl(pp, NVIPC_IVC_IOCTL_TX_ACQUIRE,
+				   batch - sent, &frames);
+		if (ret < 0)
+			return ret;
+		if (frames.count == 0) {
+			ret = wait_event(pp, 1000);
+			if (ret < 0)
+				return ret;
+			continue;
+		}
+
+		for (i = 0; i < frames.count; i++) {
+			uint64_t val = (*seq)++;
+
+			memcpy(frame_ptr(pp, pp->tx, frames.index + i), &val,
+			       sizeof(val));
+		}
+
+		ret = frames_ioctl(pp, NVIPC_IVC_IOCTL_TX_SUBMIT,
+				   frames.count, &frames);
+		if (ret < 0)
+			return ret;
+	}
+
+	for (got = 0; got < batch; got += frames.count) {
+		ret = frames_ioctl(pp, NVIPC_IVC_IOCTL_RX_ACQUIRE,
+				   batch - got, &frames);
+		if (ret < 0)
+			return ret;
+		if (frames.count == 0) {
+			ret = wait_event(pp, 1000);
+			if (ret < 0)
+				return ret;
+			continue;
+		}
+
+		for (i = 0; i < frames.count; i++) {
+			uint64_t val;
+
+			memcpy(&val, frame_ptr(pp, pp->rx, frames.index + i),
+			       sizeof(val));
+			if (val != expect) {
+				fprintf(stderr, "Got frame %" PRIu64
+					", expected %" PRIu64 "\n",
+					val, expect);
+				return -EIO;
+			}
+			expect++;
+		}
+
+		ret = frames_ioctl(pp, NVIPC_IVC_IOCTL_RX_RELEASE,
+				   frames.count, &frames);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int ping(struct pingpong *pp, uint32_t batch, unsigned int loops)
+{
+	uint64_t *rtt, seq = 0, start, total = 0;
+	unsigned int i;
+	int ret = 0;
+
+	if (batch == 0 || batch >= pp->info.nframes) {
+		fprintf(stderr, "Batch must be 1..%u\n", pp->info.nframes - 1);
+		return -EINVAL;
+	}
+
+	rtt = calloc(loops, sizeof(*rtt));
+	if (!rtt)
+		return -ENOMEM;
+
+	for (i = 0; i < loops; i++) {
+		start = now_ns();
+		ret = round_trip(pp, batch, &seq);
+		if (ret < 0) {
+			fprintf(stderr, "Round trip %u failed (%d)\n", i, ret);
+			goto out;
+		}
+		rtt[i] = now_ns() - start;
+		total += rtt[i];
+	}
+
+	qsort(rtt, loops, sizeof(*rtt), cmp_u64);
+	fprintf(stdout, "%u round trips of %u frames%s\n", loops, batch,
+		pp->spin ? ", spinning" : "");
+	fprintf(stdout, "  round trip ns: min %" PRIu64 " avg %" PRIu64
+		" p99 %" PRIu64 " max %" PRIu64 "\n",
+		rtt[0], total / loops, rtt[(loops - 1) * 99 / 100],
+		rtt[loops - 1]);
+	fprintf(stdout, "  per frame ns:  avg %" PRIu64 "\n",
+		total / ((uint64_t)loops * batch));
+
+out:
+	free(rtt);
+	return ret;
+}
+
+void print_usage(char *bin_name)
+{
+	fprintf(stderr, "Usage: %s [options]...\n"
+		"Measure IVC round trips between two ends of a queue\n"
+		"  -d <name>  ivc character device, e.g. ivc0\n"
+		"  -e         Echo frames back (run this on the other end first)\n"
+		" [-b <n>]    Frames sent at once (default 1)\n"
+		" [-c <n>]    Do <n> round trips (default 10000)\n"
+		" [-p]        Spin instead of waiting for notifications\n"
+		"  -h         This helptext\n"
+		"\n"
+		"Example:\n"
+		"%s -d ivc1 -e & %s -d ivc0 -b 16\n",
+		bin_name, bin_name, bin_name
+	);
+}
+
+int main(int argc, char **argv)
+{
+	const char *device_name = NULL;
+	unsigned int loops = 10000;
+	uint32_t batch = 1;
+	bool echo_mode = false;
+	bool spin = false;
+	struct pingpong pp;
+	int ret, c;
+
+	while ((c = getopt(argc, argv, "b:c:d:eph")) != -1) {
+		switch (c) {
+		case 'b':
+			batch = strtoul(optarg, NULL, 10);
+			break;
+		case 'c':
+			loops = strtoul(optarg, NULL, 10);
+			break;
+		case 'd':
+			device_name = optarg;
+			break;
+		case 'e':
+			echo_mode = true;
+			break;
+		case 'p':
+			spin = true;
+			break;
+		case 'h':
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!device_name || loops == 0) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	ret = pingpong_open(&pp, device_name, spin);
+	if (ret == 0)
+		ret = establish(&pp);
+	if (ret == 0)
+		ret = echo_mode ? echo(&pp) : ping(&pp, batch, loops);
+
+	if (ret < 0)
+		fprintf(stderr, "Failed (%d)\n", ret);
+	pingpong_close(&pp);
+
+	return ret < 0 ? 1 : 0;
+}